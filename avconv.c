@@ -2301,6 +2301,36 @@ static int transcode(void)
     return ret;
 }
 
+static void print_filter_profile(void)
+{
+    int i, j;
+
+    for (i = 0; i < nb_filtergraphs; i++) {
+        AVFilterGraph *graph = filtergraphs[i]->graph;
+
+        if (!graph)
+            continue;
+
+        printf("bench: filtergraph %d\n", i);
+        printf("bench: %-12s %8s %9s %10s %10s %10s %10s  %s\n",
+               "type", "calls", "frames_in", "frames_out",
+               "wall_ms", "cpu_ms", "alloc_kB", "name");
+        for (j = 0; j < graph->nb_filters; j++) {
+            AVFilterContext *f = graph->filters[j];
+            const AVFilterProfile *prof = avfilter_get_profile(f);
+
+            if (!prof)
+                continue;
+            printf("bench: %-12s %8"PRIu64" %9"PRIu64" %10"PRIu64" "
+                   "%10.3f %10.3f %10"PRIu64"  %s\n",
+                   f->filter->name, prof->nb_calls,
+                   prof->nb_frames_in, prof->nb_frames_out,
+                   prof->wall_time / 1000.0, prof->cpu_time / 1000.0,
+                   prof->bytes_allocated / 1024, f->name);
+        }
+    }
+}
+
 static int64_t getutime(void)
 {
 #if HAVE_GETRUSAGE
@@ -2382,6 +2412,8 @@ int main(int argc, char **argv)
         int maxrss = getmaxrss() / 1024;
         printf("bench: utime=%0.3fs maxrss=%ikB\n", ti / 1000000.0, maxrss);
     }
+    if (do_benchmark_filters)
+        print_filter_profile();
 
     exit_program(0);
     return 0;
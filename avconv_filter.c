@@ -583,6 +583,7 @@ int configure_filtergraph(FilterGraph *fg)
     avfilter_graph_free(&fg->graph);
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
+    fg->graph->profile = do_benchmark_filters;
 
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
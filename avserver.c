@@ -55,6 +55,12 @@
 #if HAVE_POLL_H
 #include <poll.h>
 #endif
+#if HAVE_EPOLL_CREATE
+#include <sys/epoll.h>
+#endif
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 #include <errno.h>
 #include <time.h>
 #include <sys/wait.h>
@@ -108,6 +114,14 @@ static const char *http_state[] = {
 
 #define SYNC_TIMEOUT (10 * 1000)
 
+/* maximum number of connections accepted per event loop iteration */
+#define ACCEPT_BATCH 64
+
+#define MAX_THREADS 64
+
+/* number of recently received packets kept in memory for each feed */
+#define FEED_CACHE_PACKETS 256
+
 typedef struct RTSPActionServerSetup {
     uint32_t ipaddr;
     char transport_option[512];
@@ -124,6 +138,8 @@ typedef struct HTTPContext {
     int fd; /* socket file descriptor */
     struct sockaddr_in from_addr; /* origin */
     struct pollfd *poll_entry; /* used when polling */
+    struct pollfd poll_fd; /* poll entry used with epoll */
+    int poll_events; /* events registered with epoll */
     int64_t timeout;
     uint8_t *buffer_ptr, *buffer_end;
     int http_error;
@@ -137,6 +153,8 @@ typedef struct HTTPContext {
     int feed_fd;
     /* input format handling */
     AVFormatContext *fmt_in;
+    AVIOContext *feed_pb;          /* reader of the feed storage */
+    int64_t feed_pos;              /* read position in the feed storage */
     int64_t start_time;            /* In milliseconds - this wraps fairly often */
     int64_t first_pts;            /* initial pts value */
     int64_t cur_pts;             /* current pts value from the stream in us */
@@ -250,6 +268,9 @@ typedef struct FFStream {
     int64_t feed_max_size;      /* maximum storage size, zero means unlimited */
     int64_t feed_write_index;   /* current write position in feed (it wraps around) */
     int64_t feed_size;          /* current size of feed */
+    int feed_read_fd;           /* descriptor shared by all readers of the feed */
+    uint8_t *feed_cache;        /* last packets received from the feeder */
+    int64_t *feed_cache_pos;    /* feed position of each cached packet */
     struct FFStream *next_feed;
 } FFStream;
 
@@ -266,7 +287,7 @@ static HTTPContext *first_http_ctx;
 static FFStream *first_feed;   /* contains only feeds */
 static FFStream *first_stream; /* contains all streams, including feeds */
 
-static void new_connection(int server_fd, int is_rtsp);
+static int new_connection(int server_fd, int is_rtsp);
 static void close_connection(HTTPContext *c);
 
 /* HTTP handling */
@@ -312,6 +333,32 @@ static unsigned int nb_max_http_connections = 2000;
 static unsigned int nb_max_connections = 5;
 static unsigned int nb_connections;
 
+/* connection handling threads */
+static int nb_threads = 1;
+#if HAVE_PTHREADS
+static pthread_mutex_t log_lock   = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t job_lock   = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  job_cond   = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  done_cond  = PTHREAD_COND_INITIALIZER;
+static unsigned job_generation;
+static int nb_jobs, next_job, nb_jobs_done;
+#endif
+static HTTPContext **jobs;
+static int *job_ret;
+
+#if HAVE_EPOLL_CREATE
+static int epoll_fd = -1;
+#endif
+
+#if HAVE_PTHREADS
+#define LOCK(x)   pthread_mutex_lock(&x)
+#define UNLOCK(x) pthread_mutex_unlock(&x)
+#else
+#define LOCK(x)
+#define UNLOCK(x)
+#endif
+
 static uint64_t max_bandwidth = 1000;
 static uint64_t current_bandwidth;
 
@@ -401,6 +448,7 @@ static char *ctime1(char *buf2)
     return buf2;
 }
 
+/* the caller must hold log_lock */
 static void http_vlog(const char *fmt, va_list vargs)
 {
     static int print_prefix = 1;
@@ -416,6 +464,17 @@ static void http_vlog(const char *fmt, va_list vargs)
     }
 }
 
+#ifdef __GNUC__
+__attribute__ ((format (printf, 1, 2)))
+#endif
+static void http_log_unlocked(const char *fmt, ...)
+{
+    va_list vargs;
+    va_start(vargs, fmt);
+    http_vlog(fmt, vargs);
+    va_end(vargs);
+}
+
 #ifdef __GNUC__
 __attribute__ ((format (printf, 1, 2)))
 #endif
@@ -423,7 +482,9 @@ static void http_log(const char *fmt, ...)
 {
     va_list vargs;
     va_start(vargs, fmt);
+    LOCK(log_lock);
     http_vlog(fmt, vargs);
+    UNLOCK(log_lock);
     va_end(vargs);
 }
 
@@ -433,10 +494,12 @@ static void http_av_log(void *ptr, int level, const char *fmt, va_list vargs)
     AVClass *avc = ptr ? *(AVClass**)ptr : NULL;
     if (level > av_log_get_level())
         return;
+    LOCK(log_lock);
     if (print_prefix && avc)
-        http_log("[%s @ %p]", avc->item_name(ptr), ptr);
+        http_log_unlocked("[%s @ %p]", avc->item_name(ptr), ptr);
     print_prefix = strstr(fmt, "\n") != NULL;
     http_vlog(fmt, vargs);
+    UNLOCK(log_lock);
 }
 
 static void log_connection(HTTPContext *c)
@@ -553,7 +616,7 @@ static int socket_open_listen(struct sockaddr_in *my_addr)
         return -1;
     }
 
-    if (listen (server_fd, 5) < 0) {
+    if (listen (server_fd, SOMAXCONN) < 0) {
         perror ("listen");
         closesocket(server_fd);
         return -1;
@@ -618,19 +681,200 @@ static void start_multicast(void)
     }
 }
 
+/* return the events to wait for on a connection, 0 if it is not polled */
+static int connection_events(HTTPContext *c, int *delay)
+{
+    switch(c->state) {
+    case HTTPSTATE_SEND_HEADER:
+    case RTSPSTATE_SEND_REPLY:
+    case RTSPSTATE_SEND_PACKET:
+        return POLLOUT;
+    case HTTPSTATE_SEND_DATA_HEADER:
+    case HTTPSTATE_SEND_DATA:
+    case HTTPSTATE_SEND_DATA_TRAILER:
+        if (!c->is_packetized) {
+            /* for TCP, we output as much as we can (may need to put a limit) */
+            return POLLOUT;
+        }
+        /* when avserver is doing the timing, we work by
+           looking at which packet need to be sent every
+           10 ms */
+        *delay = FFMIN(*delay, 10); /* one tick wait XXX: 10 ms assumed */
+        return 0;
+    case HTTPSTATE_WAIT_REQUEST:
+    case HTTPSTATE_RECEIVE_DATA:
+    case HTTPSTATE_WAIT_FEED:
+    case RTSPSTATE_WAIT_REQUEST:
+        /* need to catch errors */
+        return POLLIN; /* Maybe this will work */
+    default:
+        return 0;
+    }
+}
+
+#if HAVE_EPOLL_CREATE
+/* change the events epoll waits for on a poll entry, the descriptor is
+   removed from the epoll set when no events are requested */
+static int epoll_watch(struct pollfd *p, int *registered, int events)
+{
+    struct epoll_event ev = { 0 };
+    int op;
+
+    if (events == *registered)
+        return 0;
+    if (!events)
+        op = EPOLL_CTL_DEL;
+    else if (!*registered)
+        op = EPOLL_CTL_ADD;
+    else
+        op = EPOLL_CTL_MOD;
+    ev.events   = (events & POLLIN  ? EPOLLIN  : 0) |
+                  (events & POLLOUT ? EPOLLOUT : 0);
+    ev.data.ptr = p;
+    if (epoll_ctl(epoll_fd, op, p->fd, &ev) < 0)
+        return AVERROR(errno);
+    *registered = events;
+    return 0;
+}
+
+/* wait for events and report them in the poll entries they were
+   registered for */
+static int epoll_poll(struct epoll_event *events, int max_events, int delay)
+{
+    int i, ret = epoll_wait(epoll_fd, events, max_events, delay);
+
+    for (i = 0; i < ret; i++) {
+        struct pollfd *p = events[i].data.ptr;
+        p->revents |= (events[i].events & EPOLLIN  ? POLLIN  : 0) |
+                      (events[i].events & EPOLLOUT ? POLLOUT : 0) |
+                      (events[i].events & EPOLLERR ? POLLERR : 0) |
+                      (events[i].events & EPOLLHUP ? POLLHUP : 0);
+    }
+    return ret;
+}
+#endif
+
+/* The data connections of live streams only use their own state and the
+   feed storage, which is not written to while they are served, so they
+   are handled by all the threads at once. */
+static int is_parallel_job(HTTPContext *c)
+{
+    return jobs && c->state == HTTPSTATE_SEND_DATA && !c->is_packetized &&
+           c->stream->feed && c->poll_entry &&
+           c->poll_entry->revents & POLLOUT;
+}
+
+#if HAVE_PTHREADS
+/* handle the connections of the job list not taken yet, job_lock must be
+   held */
+static void execute_jobs(void)
+{
+    while (next_job < nb_jobs) {
+        int i, start = next_job;
+        int count = FFMAX((nb_jobs - next_job) / (2 * nb_threads), 1);
+
+        next_job += count;
+        UNLOCK(job_lock);
+        for (i = start; i < start + count; i++)
+            job_ret[i] = handle_connection(jobs[i]);
+        LOCK(job_lock);
+        nb_jobs_done += count;
+        if (nb_jobs_done == nb_jobs)
+            pthread_cond_signal(&done_cond);
+    }
+}
+
+static void *worker_thread(void *arg)
+{
+    unsigned generation = 0;
+
+    LOCK(job_lock);
+    for (;;) {
+        while (generation == job_generation)
+            pthread_cond_wait(&job_cond, &job_lock);
+        generation = job_generation;
+        execute_jobs();
+    }
+    return NULL;
+}
+#endif
+
+static void start_workers(void)
+{
+#if HAVE_PTHREADS
+    pthread_t thread;
+    int i, ret;
+
+    for (i = 1; i < nb_threads; i++) {
+        if ((ret = pthread_create(&thread, NULL, worker_thread, NULL))) {
+            http_log("Could not create thread: %s\n", strerror(ret));
+            break;
+        }
+        pthread_detach(thread);
+    }
+    nb_threads = i;
+#endif
+}
+
+/* handle the first count connections of the job list */
+static void run_jobs(int count)
+{
+#if HAVE_PTHREADS
+    LOCK(job_lock);
+    nb_jobs      = count;
+    next_job     = 0;
+    nb_jobs_done = 0;
+    job_generation++;
+    pthread_cond_broadcast(&job_cond);
+    execute_jobs();
+    while (nb_jobs_done < nb_jobs)
+        pthread_cond_wait(&done_cond, &job_lock);
+    UNLOCK(job_lock);
+#else
+    int i;
+
+    for (i = 0; i < count; i++)
+        job_ret[i] = handle_connection(jobs[i]);
+#endif
+}
+
+/* accept the pending connections, up to a limit so that the established
+   ones are still served when many clients connect at once */
+static void accept_connections(int server_fd, int is_rtsp)
+{
+    int i;
+
+    for (i = 0; i < ACCEPT_BATCH; i++)
+        if (new_connection(server_fd, is_rtsp) < 0)
+            break;
+}
+
 /* main loop of the http server */
 static int http_server(void)
 {
     int server_fd = 0, rtsp_server_fd = 0;
-    int ret, delay, delay1;
+    int ret, delay, events, nb_listen, count, i;
     struct pollfd *poll_table, *poll_entry;
     HTTPContext *c, *c_next;
+#if HAVE_EPOLL_CREATE
+    struct epoll_event *epoll_events = NULL;
+    int listen_events[2] = { 0 };
+#endif
 
     if(!(poll_table = av_mallocz((nb_max_http_connections + 2)*sizeof(*poll_table)))) {
         http_log("Impossible to allocate a poll table handling %d connections.\n", nb_max_http_connections);
         return -1;
     }
 
+    if (nb_threads > 1) {
+        jobs    = av_malloc(nb_max_http_connections * sizeof(*jobs));
+        job_ret = av_malloc(nb_max_http_connections * sizeof(*job_ret));
+        if (!jobs || !job_ret) {
+            http_log("Impossible to allocate a job list handling %d connections.\n", nb_max_http_connections);
+            return -1;
+        }
+    }
+
     if (my_http_addr.sin_port) {
         server_fd = socket_open_listen(&my_http_addr);
         if (server_fd < 0)
@@ -648,71 +892,76 @@ static int http_server(void)
         return -1;
     }
 
+    /* the listening sockets come first in the poll table */
+    poll_entry = poll_table;
+    if (server_fd) {
+        poll_entry->fd = server_fd;
+        poll_entry->events = POLLIN;
+        poll_entry++;
+    }
+    if (rtsp_server_fd) {
+        poll_entry->fd = rtsp_server_fd;
+        poll_entry->events = POLLIN;
+        poll_entry++;
+    }
+    nb_listen = poll_entry - poll_table;
+
+#if HAVE_EPOLL_CREATE
+    epoll_fd = epoll_create(nb_max_http_connections + 2);
+    if (epoll_fd >= 0) {
+        /* the feeder processes must not share the epoll set */
+        fcntl(epoll_fd, F_SETFD, FD_CLOEXEC);
+        epoll_events = av_malloc((nb_max_http_connections + 2) * sizeof(*epoll_events));
+        if (!epoll_events)
+            return -1;
+        for (i = 0; i < nb_listen; i++) {
+            if (epoll_watch(&poll_table[i], &listen_events[i], POLLIN) < 0) {
+                http_log("Could not add the listening sockets to epoll.\n");
+                return -1;
+            }
+        }
+    }
+#endif
+
     http_log("AVserver started.\n");
 
     start_children(first_feed);
 
     start_multicast();
 
+    start_workers();
+
     for(;;) {
-        poll_entry = poll_table;
-        if (server_fd) {
-            poll_entry->fd = server_fd;
-            poll_entry->events = POLLIN;
-            poll_entry++;
-        }
-        if (rtsp_server_fd) {
-            poll_entry->fd = rtsp_server_fd;
-            poll_entry->events = POLLIN;
-            poll_entry++;
-        }
+        for (i = 0; i < nb_listen; i++)
+            poll_table[i].revents = 0;
+        poll_entry = poll_table + nb_listen;
 
         /* wait for events on each HTTP handle */
         c = first_http_ctx;
         delay = 1000;
         while (c != NULL) {
-            int fd;
-            fd = c->fd;
-            switch(c->state) {
-            case HTTPSTATE_SEND_HEADER:
-            case RTSPSTATE_SEND_REPLY:
-            case RTSPSTATE_SEND_PACKET:
-                c->poll_entry = poll_entry;
-                poll_entry->fd = fd;
-                poll_entry->events = POLLOUT;
-                poll_entry++;
-                break;
-            case HTTPSTATE_SEND_DATA_HEADER:
-            case HTTPSTATE_SEND_DATA:
-            case HTTPSTATE_SEND_DATA_TRAILER:
-                if (!c->is_packetized) {
-                    /* for TCP, we output as much as we can (may need to put a limit) */
-                    c->poll_entry = poll_entry;
-                    poll_entry->fd = fd;
-                    poll_entry->events = POLLOUT;
-                    poll_entry++;
-                } else {
-                    /* when avserver is doing the timing, we work by
-                       looking at which packet need to be sent every
-                       10 ms */
-                    delay1 = 10; /* one tick wait XXX: 10 ms assumed */
-                    if (delay1 < delay)
-                        delay = delay1;
+            events = connection_events(c, &delay);
+#if HAVE_EPOLL_CREATE
+            if (epoll_fd >= 0) {
+                c->poll_entry = events ? &c->poll_fd : NULL;
+                c->poll_fd.revents = 0;
+                if (epoll_watch(&c->poll_fd, &c->poll_events, events) < 0 &&
+                    events) {
+                    /* make handle_connection() close it */
+                    c->poll_fd.revents = POLLERR;
+                    delay = 0;
                 }
-                break;
-            case HTTPSTATE_WAIT_REQUEST:
-            case HTTPSTATE_RECEIVE_DATA:
-            case HTTPSTATE_WAIT_FEED:
-            case RTSPSTATE_WAIT_REQUEST:
-                /* need to catch errors */
+                c = c->next;
+                continue;
+            }
+#endif
+            if (events) {
                 c->poll_entry = poll_entry;
-                poll_entry->fd = fd;
-                poll_entry->events = POLLIN;/* Maybe this will work */
+                poll_entry->fd = c->fd;
+                poll_entry->events = events;
                 poll_entry++;
-                break;
-            default:
+            } else {
                 c->poll_entry = NULL;
-                break;
             }
             c = c->next;
         }
@@ -720,6 +969,11 @@ static int http_server(void)
         /* wait for an event on one connection. We poll at least every
            second to handle timeouts */
         do {
+#if HAVE_EPOLL_CREATE
+            if (epoll_fd >= 0)
+                ret = epoll_poll(epoll_events, nb_max_http_connections + 2, delay);
+            else
+#endif
             ret = poll(poll_table, poll_entry - poll_table, delay);
             if (ret < 0 && ff_neterrno() != AVERROR(EAGAIN) &&
                 ff_neterrno() != AVERROR(EINTR))
@@ -734,26 +988,40 @@ static int http_server(void)
         }
 
         /* now handle the events */
+        count = 0;
         for(c = first_http_ctx; c != NULL; c = c_next) {
             c_next = c->next;
+            if (is_parallel_job(c)) {
+                jobs[count++] = c;
+                continue;
+            }
             if (handle_connection(c) < 0) {
                 /* close and free the connection */
                 log_connection(c);
                 close_connection(c);
             }
         }
+        if (count) {
+            run_jobs(count);
+            for (i = 0; i < count; i++) {
+                if (job_ret[i] < 0) {
+                    log_connection(jobs[i]);
+                    close_connection(jobs[i]);
+                }
+            }
+        }
 
         poll_entry = poll_table;
         if (server_fd) {
             /* new HTTP connection request ? */
             if (poll_entry->revents & POLLIN)
-                new_connection(server_fd, 0);
+                accept_connections(server_fd, 0);
             poll_entry++;
         }
         if (rtsp_server_fd) {
             /* new RTSP connection request ? */
             if (poll_entry->revents & POLLIN)
-                new_connection(rtsp_server_fd, 1);
+                accept_connections(rtsp_server_fd, 1);
         }
     }
 }
@@ -789,7 +1057,8 @@ static void http_send_too_busy_reply(int fd)
 }
 
 
-static void new_connection(int server_fd, int is_rtsp)
+/* accept a connection, return a negative value if none was pending */
+static int new_connection(int server_fd, int is_rtsp)
 {
     struct sockaddr_in from_addr;
     socklen_t len;
@@ -800,8 +1069,10 @@ static void new_connection(int server_fd, int is_rtsp)
     fd = accept(server_fd, (struct sockaddr *)&from_addr,
                 &len);
     if (fd < 0) {
-        http_log("error during accept %s\n", strerror(errno));
-        return;
+        int err = ff_neterrno();
+        if (err != AVERROR(EAGAIN) && err != AVERROR(EINTR))
+            http_log("error during accept %s\n", strerror(errno));
+        return err;
     }
     ff_socket_nonblock(fd, 1);
 
@@ -817,6 +1088,7 @@ static void new_connection(int server_fd, int is_rtsp)
 
     c->fd = fd;
     c->poll_entry = NULL;
+    c->poll_fd.fd = fd;
     c->from_addr = from_addr;
     c->buffer_size = IOBUFFER_INIT_SIZE;
     c->buffer = av_malloc(c->buffer_size);
@@ -829,7 +1101,7 @@ static void new_connection(int server_fd, int is_rtsp)
 
     start_wait_request(c, is_rtsp);
 
-    return;
+    return 0;
 
  fail:
     if (c) {
@@ -837,6 +1109,7 @@ static void new_connection(int server_fd, int is_rtsp)
         av_free(c);
     }
     closesocket(fd);
+    return 0;
 }
 
 static void close_connection(HTTPContext *c)
@@ -864,6 +1137,11 @@ static void close_connection(HTTPContext *c)
     }
 
     /* remove connection associated resources */
+#if HAVE_EPOLL_CREATE
+    /* the socket may outlive the close below in children */
+    if (c->poll_events)
+        epoll_watch(&c->poll_fd, &c->poll_events, 0);
+#endif
     if (c->fd >= 0)
         closesocket(c->fd);
     if (c->fmt_in) {
@@ -875,6 +1153,10 @@ static void close_connection(HTTPContext *c)
         }
         avformat_close_input(&c->fmt_in);
     }
+    if (c->feed_pb) {
+        av_free(c->feed_pb->buffer);
+        av_freep(&c->feed_pb);
+    }
 
     /* free RTP output streams if any */
     nb_streams = 0;
@@ -2138,6 +2420,51 @@ static void compute_status(HTTPContext *c)
     c->buffer_end = c->pb_buffer + len;
 }
 
+/* read the feed storage, from the packets cached in memory when possible */
+static int feed_read_packet(void *opaque, uint8_t *buf, int buf_size)
+{
+    HTTPContext *c = opaque;
+    FFStream *feed = c->stream->feed;
+    int64_t packet_pos = c->feed_pos - c->feed_pos % FFM_PACKET_SIZE;
+    int slot = packet_pos / FFM_PACKET_SIZE % FEED_CACHE_PACKETS;
+    int len;
+
+    if (packet_pos && feed->feed_cache_pos[slot] == packet_pos) {
+        len = FFMIN(buf_size, packet_pos + FFM_PACKET_SIZE - c->feed_pos);
+        memcpy(buf, feed->feed_cache + slot * FFM_PACKET_SIZE +
+               c->feed_pos - packet_pos, len);
+    } else {
+        len = pread(feed->feed_read_fd, buf, buf_size, c->feed_pos);
+        if (len < 0)
+            return AVERROR(errno);
+    }
+    c->feed_pos += len;
+    return len;
+}
+
+static int64_t feed_seek(void *opaque, int64_t offset, int whence)
+{
+    HTTPContext *c = opaque;
+
+    switch (whence) {
+    case AVSEEK_SIZE:
+        return c->stream->feed->feed_size;
+    case SEEK_SET:
+        break;
+    case SEEK_CUR:
+        offset += c->feed_pos;
+        break;
+    case SEEK_END:
+        offset += c->stream->feed->feed_size;
+        break;
+    default:
+        return AVERROR(EINVAL);
+    }
+    if (offset < 0)
+        return AVERROR(EINVAL);
+    return c->feed_pos = offset;
+}
+
 static int open_input_stream(HTTPContext *c, const char *info)
 {
     char buf[128];
@@ -2170,6 +2497,23 @@ static int open_input_stream(HTTPContext *c, const char *info)
     if (input_filename[0] == '\0')
         return -1;
 
+    if (c->stream->feed) {
+        /* all the readers of a feed share its storage */
+        uint8_t *buf = av_malloc(FFM_PACKET_SIZE);
+        if (!buf)
+            return -1;
+        c->feed_pb = avio_alloc_context(buf, FFM_PACKET_SIZE, 0, c,
+                                        feed_read_packet, NULL, feed_seek);
+        if (!c->feed_pb) {
+            av_free(buf);
+            return -1;
+        }
+        c->feed_pos = 0;
+        if (!(s = avformat_alloc_context()))
+            return -1;
+        s->pb = c->feed_pb;
+    }
+
     /* open stream */
     if ((ret = avformat_open_input(&s, input_filename, c->stream->ifmt, &c->stream->in_opts)) < 0) {
         http_log("could not open %s: %d\n", input_filename, ret);
@@ -2253,8 +2597,6 @@ static int http_prepare_data(HTTPContext *c)
 
             *(c->fmt_ctx.streams[i]) = *src;
             c->fmt_ctx.streams[i]->priv_data = 0;
-            c->fmt_ctx.streams[i]->codec->frame_number = 0; /* XXX: should be done in
-                                           AVStream, not in codec */
         }
         /* set output format parameters */
         c->fmt_ctx.oformat = c->stream->fmt;
@@ -2359,7 +2701,6 @@ static int http_prepare_data(HTTPContext *c)
                         }
                     }
                 } else {
-                    AVCodecContext *codec;
                     AVStream *ist, *ost;
                 send_it:
                     ist = c->fmt_in->streams[source_index];
@@ -2378,13 +2719,10 @@ static int http_prepare_data(HTTPContext *c)
                             av_free_packet(&pkt);
                             break;
                         }
-                        codec = ctx->streams[0]->codec;
                         /* only one stream per RTP connection */
                         pkt.stream_index = 0;
                     } else {
                         ctx = &c->fmt_ctx;
-                        /* Fudge here */
-                        codec = ctx->streams[pkt.stream_index]->codec;
                     }
 
                     if (c->is_packetized) {
@@ -2419,7 +2757,6 @@ static int http_prepare_data(HTTPContext *c)
                     c->buffer_ptr = c->pb_buffer;
                     c->buffer_end = c->pb_buffer + len;
 
-                    codec->frame_number++;
                     if (len == 0) {
                         av_free_packet(&pkt);
                         goto redo;
@@ -2565,8 +2902,11 @@ static int http_send_data(HTTPContext *c)
 
                 c->data_count += len;
                 update_datarate(&c->datarate, c->data_count);
-                if (c->stream)
+                if (c->stream) {
+                    LOCK(stats_lock);
                     c->stream->bytes_served += len;
+                    UNLOCK(stats_lock);
+                }
                 break;
             }
         }
@@ -2611,6 +2951,8 @@ static int http_start_receive_data(HTTPContext *c)
     c->stream->feed_write_index = FFMAX(ffm_read_write_index(fd), FFM_PACKET_SIZE);
     c->stream->feed_size = lseek(fd, 0, SEEK_END);
     lseek(fd, 0, SEEK_SET);
+    memset(c->stream->feed_cache_pos, 0,
+           FEED_CACHE_PACKETS * sizeof(*c->stream->feed_cache_pos));
 
     /* init buffer input */
     c->buffer_ptr = c->buffer;
@@ -2623,7 +2965,7 @@ static int http_start_receive_data(HTTPContext *c)
 static int http_receive_data(HTTPContext *c)
 {
     HTTPContext *c1;
-    int len, loop_run = 0;
+    int len, slot, loop_run = 0;
 
     while (c->chunked_encoding && !c->chunk_size &&
            c->buffer_end > c->buffer_ptr) {
@@ -2693,6 +3035,12 @@ static int http_receive_data(HTTPContext *c)
                 goto fail;
             }
 
+            /* keep it for the connections reading the feed */
+            slot = feed->feed_write_index / FFM_PACKET_SIZE % FEED_CACHE_PACKETS;
+            memcpy(feed->feed_cache + slot * FFM_PACKET_SIZE, c->buffer,
+                   FFM_PACKET_SIZE);
+            feed->feed_cache_pos[slot] = feed->feed_write_index;
+
             feed->feed_write_index += FFM_PACKET_SIZE;
             /* update file size */
             if (feed->feed_write_index > c->stream->feed_size)
@@ -3788,7 +4136,16 @@ static void build_feed_streams(void)
         if (feed->feed_max_size && feed->feed_max_size < feed->feed_size)
             feed->feed_max_size = feed->feed_size;
 
-        close(fd);
+        /* kept open for the connections reading the feed */
+        feed->feed_read_fd   = fd;
+        feed->feed_cache     = av_malloc(FEED_CACHE_PACKETS * FFM_PACKET_SIZE);
+        feed->feed_cache_pos = av_mallocz(FEED_CACHE_PACKETS *
+                                          sizeof(*feed->feed_cache_pos));
+        if (!feed->feed_cache || !feed->feed_cache_pos) {
+            http_log("Could not allocate the cache of feed '%s'\n",
+                     feed->filename);
+            exit(1);
+        }
     }
 }
 
@@ -4086,6 +4443,13 @@ static int parse_ffconfig(const char *filename)
                 ERROR("Invalid MaxBandwidth: %s\n", arg);
             } else
                 max_bandwidth = llval;
+        } else if (!av_strcasecmp(cmd, "Threads")) {
+            get_arg(arg, sizeof(arg), &p);
+            val = atoi(arg);
+            if (val < 1 || val > MAX_THREADS) {
+                ERROR("Invalid Threads: %s\n", arg);
+            } else
+                nb_threads = val;
         } else if (!av_strcasecmp(cmd, "CustomLog")) {
             if (!avserver_debug)
                 get_arg(logfilename, sizeof(logfilename), &p);
@@ -2452,6 +2452,8 @@ typedef struct AVCodecContext {
      * Which multithreading methods to use.
      * Use of FF_THREAD_FRAME will increase decoding delay by one frame per thread,
      * so clients which cannot provide future frames should not use it.
+     * Audio decoders only use FF_THREAD_FRAME if it is the only method set,
+     * each packet must then contain a single frame.
      *
      * - encoding: Set by user, otherwise the default is used.
      * - decoding: Set by user, otherwise the default is used.
@@ -2664,6 +2666,39 @@ typedef struct AVCodecContext {
      * - decoding: unused.
      */
     uint64_t vbv_delay;
+
+    /**
+     * Number of frames to preallocate in the frame pool used by
+     * avcodec_default_get_buffer2() whenever it is (re)initialized, e.g.
+     * after a change of the frame dimensions.
+     * - encoding: unused
+     * - decoding: Set by user.
+     */
+    int frame_pool_prealloc;
+
+    /**
+     * Maximum number of frames the frame pool used by
+     * avcodec_default_get_buffer2() may allocate, 0 for no limit. Once the
+     * limit is reached, get_buffer2() fails until frames are returned to the
+     * pool. It must be large enough for all the frames held at the same time
+     * by the decoder (including frame threads) and the caller.
+     * - encoding: unused
+     * - decoding: Set by user.
+     */
+    int frame_pool_max;
+
+    /**
+     * If set, frame threading returns each frame as soon as it is decoded,
+     * instead of first filling all the threads with packets and then always
+     * waiting for the oldest one. avcodec_decode_video2() and
+     * avcodec_decode_audio4() then only block when all the threads are busy,
+     * so the number of frames in flight follows the speed of the decoding
+     * rather than being always thread_count. Reordering done by the codec
+     * itself (has_b_frames) is not affected.
+     * - encoding: unused
+     * - decoding: Set by user, before avcodec_open2().
+     */
+    int thread_low_latency;
 } AVCodecContext;
 
 /**
@@ -3323,6 +3358,34 @@ attribute_deprecated void avcodec_default_release_buffer(AVCodecContext *s, AVFr
 attribute_deprecated int avcodec_default_reget_buffer(AVCodecContext *s, AVFrame *pic);
 #endif
 
+/**
+ * Statistics of the frame pool used by avcodec_default_get_buffer2().
+ *
+ * sizeof(AVFramePoolStats) is not a part of the public ABI, new fields may be
+ * added to the end with a minor version bump.
+ */
+typedef struct AVFramePoolStats {
+    uint64_t nb_requests;   ///< number of buffers requested from the pool
+    uint64_t nb_allocs;     ///< number of buffers the pool had to allocate
+    unsigned nb_inits;      ///< number of times the pool was set up for new frame parameters
+    int64_t  cur_bytes;     ///< size of the buffers allocated by the current pool
+    int64_t  peak_bytes;    ///< largest value of cur_bytes so far
+} AVFramePoolStats;
+
+/**
+ * Get the statistics of the frame pool used by avcodec_default_get_buffer2()
+ * for the given opened codec context.
+ *
+ * The returned structure is owned by the codec context and stays valid until
+ * it is closed. Buffers allocated through a user-supplied get_buffer2() are
+ * not accounted.
+ * With frame threading, the decoding threads keep updating the statistics
+ * between decoding calls.
+ *
+ * @return the statistics, or NULL if the context is not opened
+ */
+const AVFramePoolStats *avcodec_get_frame_pool_stats(AVCodecContext *avctx);
+
 /**
  * The default callback for AVCodecContext.get_buffer2(). It is made public so
  * it can be called by custom get_buffer2() implementations for decoders without
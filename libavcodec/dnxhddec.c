@@ -23,42 +23,55 @@
  */
 
 #include "libavutil/imgutils.h"
+#include "libavutil/mem.h"
 #include "avcodec.h"
 #include "get_bits.h"
 #include "dnxhddata.h"
 #include "dsputil.h"
 #include "internal.h"
 
+typedef struct RowContext {
+    DECLARE_ALIGNED(16, int16_t, blocks)[8][64];
+    GetBitContext gb;
+    int last_dc[3];
+} RowContext;
+
 typedef struct DNXHDContext {
     AVCodecContext *avctx;
-    GetBitContext gb;
+    RowContext *rows;                   ///< one per thread
+    const uint8_t *buf;                 ///< macroblock data of the current field
+    int buf_size;
     int cid;                            ///< compression id
     unsigned int width, height;
     unsigned int mb_width, mb_height;
     uint32_t mb_scan_index[68];         /* max for 1080p */
     int cur_field;                      ///< current interlaced field
     VLC ac_vlc, dc_vlc, run_vlc;
-    int last_dc[3];
     DSPContext dsp;
-    DECLARE_ALIGNED(16, int16_t, blocks)[8][64];
     ScanTable scantable;
     const CIDEntry *cid_table;
     int bit_depth; // 8, 10 or 0 if not initialized at all.
-    void (*decode_dct_block)(struct DNXHDContext *ctx, int16_t *block,
-                             int n, int qscale);
+    void (*decode_dct_block)(struct DNXHDContext *ctx, RowContext *row,
+                             int16_t *block, int n, int qscale);
 } DNXHDContext;
 
 #define DNXHD_VLC_BITS 9
 #define DNXHD_DC_VLC_BITS 7
 
-static void dnxhd_decode_dct_block_8(DNXHDContext *ctx, int16_t *block, int n, int qscale);
-static void dnxhd_decode_dct_block_10(DNXHDContext *ctx, int16_t *block, int n, int qscale);
+static void dnxhd_decode_dct_block_8(DNXHDContext *ctx, RowContext *row,
+                                     int16_t *block, int n, int qscale);
+static void dnxhd_decode_dct_block_10(DNXHDContext *ctx, RowContext *row,
+                                      int16_t *block, int n, int qscale);
 
 static av_cold int dnxhd_decode_init(AVCodecContext *avctx)
 {
     DNXHDContext *ctx = avctx->priv_data;
 
     ctx->avctx = avctx;
+    ctx->rows  = av_mallocz_array(FFMAX(avctx->thread_count, 1),
+                                  sizeof(*ctx->rows));
+    if (!ctx->rows)
+        return AVERROR(ENOMEM);
     return 0;
 }
 
@@ -174,6 +187,7 @@ static int dnxhd_decode_header(DNXHDContext *ctx, AVFrame *frame,
 }
 
 static av_always_inline void dnxhd_decode_dct_block(DNXHDContext *ctx,
+                                                    RowContext *row,
                                                     int16_t *block, int n,
                                                     int qscale,
                                                     int index_bits,
@@ -183,7 +197,7 @@ static av_always_inline void dnxhd_decode_dct_block(DNXHDContext *ctx,
     int i, j, index1, index2, len;
     int level, component, sign;
     const uint8_t *weight_matrix;
-    OPEN_READER(bs, &ctx->gb);
+    OPEN_READER(bs, &row->gb);
 
     if (n&2) {
         component = 1 + (n&1);
@@ -193,36 +207,36 @@ static av_always_inline void dnxhd_decode_dct_block(DNXHDContext *ctx,
         weight_matrix = ctx->cid_table->luma_weight;
     }
 
-    UPDATE_CACHE(bs, &ctx->gb);
-    GET_VLC(len, bs, &ctx->gb, ctx->dc_vlc.table, DNXHD_DC_VLC_BITS, 1);
+    UPDATE_CACHE(bs, &row->gb);
+    GET_VLC(len, bs, &row->gb, ctx->dc_vlc.table, DNXHD_DC_VLC_BITS, 1);
     if (len) {
-        level = GET_CACHE(bs, &ctx->gb);
-        LAST_SKIP_BITS(bs, &ctx->gb, len);
+        level = GET_CACHE(bs, &row->gb);
+        LAST_SKIP_BITS(bs, &row->gb, len);
         sign  = ~level >> 31;
         level = (NEG_USR32(sign ^ level, len) ^ sign) - sign;
-        ctx->last_dc[component] += level;
+        row->last_dc[component] += level;
     }
-    block[0] = ctx->last_dc[component];
+    block[0] = row->last_dc[component];
 
     for (i = 1; ; i++) {
-        UPDATE_CACHE(bs, &ctx->gb);
-        GET_VLC(index1, bs, &ctx->gb, ctx->ac_vlc.table,
+        UPDATE_CACHE(bs, &row->gb);
+        GET_VLC(index1, bs, &row->gb, ctx->ac_vlc.table,
                 DNXHD_VLC_BITS, 2);
         level = ctx->cid_table->ac_level[index1];
         if (!level) /* EOB */
             break;
 
-        sign = SHOW_SBITS(bs, &ctx->gb, 1);
-        SKIP_BITS(bs, &ctx->gb, 1);
+        sign = SHOW_SBITS(bs, &row->gb, 1);
+        SKIP_BITS(bs, &row->gb, 1);
 
         if (ctx->cid_table->ac_index_flag[index1]) {
-            level += SHOW_UBITS(bs, &ctx->gb, index_bits) << 6;
-            SKIP_BITS(bs, &ctx->gb, index_bits);
+            level += SHOW_UBITS(bs, &row->gb, index_bits) << 6;
+            SKIP_BITS(bs, &row->gb, index_bits);
         }
 
         if (ctx->cid_table->ac_run_flag[index1]) {
-            UPDATE_CACHE(bs, &ctx->gb);
-            GET_VLC(index2, bs, &ctx->gb, ctx->run_vlc.table,
+            UPDATE_CACHE(bs, &row->gb);
+            GET_VLC(index2, bs, &row->gb, ctx->run_vlc.table,
                     DNXHD_VLC_BITS, 2);
             i += ctx->cid_table->run[index2];
         }
@@ -241,22 +255,23 @@ static av_always_inline void dnxhd_decode_dct_block(DNXHDContext *ctx,
         block[j] = (level^sign) - sign;
     }
 
-    CLOSE_READER(bs, &ctx->gb);
+    CLOSE_READER(bs, &row->gb);
 }
 
-static void dnxhd_decode_dct_block_8(DNXHDContext *ctx, int16_t *block,
-                                     int n, int qscale)
+static void dnxhd_decode_dct_block_8(DNXHDContext *ctx, RowContext *row,
+                                     int16_t *block, int n, int qscale)
 {
-    dnxhd_decode_dct_block(ctx, block, n, qscale, 4, 32, 6);
+    dnxhd_decode_dct_block(ctx, row, block, n, qscale, 4, 32, 6);
 }
 
-static void dnxhd_decode_dct_block_10(DNXHDContext *ctx, int16_t *block,
-                                      int n, int qscale)
+static void dnxhd_decode_dct_block_10(DNXHDContext *ctx, RowContext *row,
+                                      int16_t *block, int n, int qscale)
 {
-    dnxhd_decode_dct_block(ctx, block, n, qscale, 6, 8, 4);
+    dnxhd_decode_dct_block(ctx, row, block, n, qscale, 6, 8, 4);
 }
 
-static int dnxhd_decode_macroblock(DNXHDContext *ctx, AVFrame *frame, int x, int y)
+static int dnxhd_decode_macroblock(DNXHDContext *ctx, RowContext *row,
+                                   AVFrame *frame, int x, int y)
 {
     int shift1 = ctx->bit_depth == 10;
     int dct_linesize_luma   = frame->linesize[0];
@@ -265,12 +280,12 @@ static int dnxhd_decode_macroblock(DNXHDContext *ctx, AVFrame *frame, int x, int
     int dct_y_offset, dct_x_offset;
     int qscale, i;
 
-    qscale = get_bits(&ctx->gb, 11);
-    skip_bits1(&ctx->gb);
+    qscale = get_bits(&row->gb, 11);
+    skip_bits1(&row->gb);
 
     for (i = 0; i < 8; i++) {
-        ctx->dsp.clear_block(ctx->blocks[i]);
-        ctx->decode_dct_block(ctx, ctx->blocks[i], i, qscale);
+        ctx->dsp.clear_block(row->blocks[i]);
+        ctx->decode_dct_block(ctx, row, row->blocks[i], i, qscale);
     }
 
     if (frame->interlaced_frame) {
@@ -290,36 +305,41 @@ static int dnxhd_decode_macroblock(DNXHDContext *ctx, AVFrame *frame, int x, int
 
     dct_y_offset = dct_linesize_luma << 3;
     dct_x_offset = 8 << shift1;
-    ctx->dsp.idct_put(dest_y,                               dct_linesize_luma, ctx->blocks[0]);
-    ctx->dsp.idct_put(dest_y + dct_x_offset,                dct_linesize_luma, ctx->blocks[1]);
-    ctx->dsp.idct_put(dest_y + dct_y_offset,                dct_linesize_luma, ctx->blocks[4]);
-    ctx->dsp.idct_put(dest_y + dct_y_offset + dct_x_offset, dct_linesize_luma, ctx->blocks[5]);
+    ctx->dsp.idct_put(dest_y,                               dct_linesize_luma, row->blocks[0]);
+    ctx->dsp.idct_put(dest_y + dct_x_offset,                dct_linesize_luma, row->blocks[1]);
+    ctx->dsp.idct_put(dest_y + dct_y_offset,                dct_linesize_luma, row->blocks[4]);
+    ctx->dsp.idct_put(dest_y + dct_y_offset + dct_x_offset, dct_linesize_luma, row->blocks[5]);
 
     if (!(ctx->avctx->flags & CODEC_FLAG_GRAY)) {
         dct_y_offset = dct_linesize_chroma << 3;
-        ctx->dsp.idct_put(dest_u,                dct_linesize_chroma, ctx->blocks[2]);
-        ctx->dsp.idct_put(dest_v,                dct_linesize_chroma, ctx->blocks[3]);
-        ctx->dsp.idct_put(dest_u + dct_y_offset, dct_linesize_chroma, ctx->blocks[6]);
-        ctx->dsp.idct_put(dest_v + dct_y_offset, dct_linesize_chroma, ctx->blocks[7]);
+        ctx->dsp.idct_put(dest_u,                dct_linesize_chroma, row->blocks[2]);
+        ctx->dsp.idct_put(dest_v,                dct_linesize_chroma, row->blocks[3]);
+        ctx->dsp.idct_put(dest_u + dct_y_offset, dct_linesize_chroma, row->blocks[6]);
+        ctx->dsp.idct_put(dest_v + dct_y_offset, dct_linesize_chroma, row->blocks[7]);
     }
 
     return 0;
 }
 
-static int dnxhd_decode_macroblocks(DNXHDContext *ctx, AVFrame *frame,
-                                    const uint8_t *buf, int buf_size)
+/* Each macroblock row is coded independently, starting at its scan index
+ * with its own DC predictors, so the rows are decoded as separate jobs. */
+static int dnxhd_decode_row(AVCodecContext *avctx, void *data,
+                            int rownb, int threadnr)
 {
-    int x, y;
-    for (y = 0; y < ctx->mb_height; y++) {
-        ctx->last_dc[0] =
-        ctx->last_dc[1] =
-        ctx->last_dc[2] = 1 << (ctx->bit_depth + 2); // for levels +2^(bitdepth-1)
-        init_get_bits(&ctx->gb, buf + ctx->mb_scan_index[y], (buf_size - ctx->mb_scan_index[y]) << 3);
-        for (x = 0; x < ctx->mb_width; x++) {
-            //START_TIMER;
-            dnxhd_decode_macroblock(ctx, frame, x, y);
-            //STOP_TIMER("decode macroblock");
-        }
+    DNXHDContext *ctx = avctx->priv_data;
+    RowContext *row   = &ctx->rows[threadnr];
+    AVFrame *frame    = data;
+    int x;
+
+    row->last_dc[0] =
+    row->last_dc[1] =
+    row->last_dc[2] = 1 << (ctx->bit_depth + 2); // for levels +2^(bitdepth-1)
+    init_get_bits(&row->gb, ctx->buf + ctx->mb_scan_index[rownb],
+                  (ctx->buf_size - ctx->mb_scan_index[rownb]) << 3);
+    for (x = 0; x < ctx->mb_width; x++) {
+        //START_TIMER;
+        dnxhd_decode_macroblock(ctx, row, frame, x, rownb);
+        //STOP_TIMER("decode macroblock");
     }
     return 0;
 }
@@ -360,7 +380,9 @@ static int dnxhd_decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
         picture->key_frame = 1;
     }
 
-    dnxhd_decode_macroblocks(ctx, picture, buf + 0x280, buf_size - 0x280);
+    ctx->buf      = buf + 0x280;
+    ctx->buf_size = buf_size - 0x280;
+    avctx->execute2(avctx, dnxhd_decode_row, picture, NULL, ctx->mb_height);
 
     if (first_field && picture->interlaced_frame) {
         buf      += ctx->cid_table->coding_unit_size;
@@ -380,6 +402,7 @@ static av_cold int dnxhd_decode_close(AVCodecContext *avctx)
     ff_free_vlc(&ctx->ac_vlc);
     ff_free_vlc(&ctx->dc_vlc);
     ff_free_vlc(&ctx->run_vlc);
+    av_freep(&ctx->rows);
     return 0;
 }
 
@@ -391,6 +414,6 @@ AVCodec ff_dnxhd_decoder = {
     .init           = dnxhd_decode_init,
     .close          = dnxhd_decode_close,
     .decode         = dnxhd_decode_frame,
-    .capabilities   = CODEC_CAP_DR1,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_SLICE_THREADS,
     .long_name      = NULL_IF_CONFIG_SMALL("VC3/DNxHD"),
 };
@@ -38,6 +38,7 @@
 #include "avcodec.h"
 #include "internal.h"
 #include "get_bits.h"
+#include "thread.h"
 #include "bytestream.h"
 #include "golomb.h"
 #include "flac.h"
@@ -400,7 +401,7 @@ static inline int decode_subframe(FLACContext *s, int channel)
 
 static int decode_frame(FLACContext *s)
 {
-    int i, ret;
+    int ret;
     GetBitContext *gb = &s->gb;
     FLACFrameInfo fi;
 
@@ -467,6 +468,14 @@ static int decode_frame(FLACContext *s)
 
 //    dump_headers(s->avctx, (FLACStreaminfo *)s);
 
+    return 0;
+}
+
+static int decode_frame_data(FLACContext *s)
+{
+    int i, ret;
+    GetBitContext *gb = &s->gb;
+
     /* subframes */
     for (i = 0; i < s->channels; i++) {
         if ((ret = decode_subframe(s, i)) < 0)
@@ -484,7 +493,7 @@ static int decode_frame(FLACContext *s)
 static int flac_decode_frame(AVCodecContext *avctx, void *data,
                              int *got_frame_ptr, AVPacket *avpkt)
 {
-    AVFrame *frame     = data;
+    ThreadFrame frame  = { .f = data };
     const uint8_t *buf = avpkt->data;
     int buf_size = avpkt->size;
     FLACContext *s = avctx->priv_data;
@@ -511,7 +520,14 @@ static int flac_decode_frame(AVCodecContext *avctx, void *data,
             av_log(s->avctx, AV_LOG_ERROR, "invalid header\n");
             return ret;
         }
-        return get_metadata_size(buf, buf_size);
+        ret = get_metadata_size(buf, buf_size);
+        /* with frame threads, the rest of the packet would be lost,
+         * so the frame following the header is decoded right away */
+        if (!(avctx->active_thread_type & FF_THREAD_FRAME) || !ret ||
+            buf_size - ret < FLAC_MIN_FRAME_SIZE)
+            return ret;
+        buf      += ret;
+        buf_size -= ret;
     }
 
     /* decode frame */
@@ -520,16 +536,25 @@ static int flac_decode_frame(AVCodecContext *avctx, void *data,
         av_log(s->avctx, AV_LOG_ERROR, "decode_frame() failed\n");
         return ret;
     }
-    bytes_read = (get_bits_count(&s->gb)+7)/8;
 
     /* get output buffer */
-    frame->nb_samples = s->blocksize;
-    if ((ret = ff_get_buffer(avctx, frame, 0)) < 0) {
+    frame.f->nb_samples = s->blocksize;
+    if ((ret = ff_thread_get_buffer(avctx, &frame, 0)) < 0) {
         av_log(avctx, AV_LOG_ERROR, "get_buffer() failed\n");
         return ret;
     }
 
-    s->dsp.decorrelate[s->ch_mode](frame->data, s->decoded, s->channels,
+    /* the stream parameters are known at this point, the remaining frame
+     * data can be decoded in parallel with the following frames */
+    ff_thread_finish_setup(avctx);
+
+    if ((ret = decode_frame_data(s)) < 0) {
+        av_log(s->avctx, AV_LOG_ERROR, "decode_frame() failed\n");
+        return ret;
+    }
+    bytes_read = (get_bits_count(&s->gb)+7)/8;
+
+    s->dsp.decorrelate[s->ch_mode](frame.f->data, s->decoded, s->channels,
                                    s->blocksize, s->sample_shift);
 
     if (bytes_read > buf_size) {
@@ -537,7 +562,8 @@ static int flac_decode_frame(AVCodecContext *avctx, void *data,
         return AVERROR_INVALIDDATA;
     }
     if (bytes_read < buf_size) {
-        av_log(s->avctx, AV_LOG_DEBUG, "underread: %d orig size: %d\n",
+        av_log(s->avctx, avctx->active_thread_type & FF_THREAD_FRAME ?
+               AV_LOG_WARNING : AV_LOG_DEBUG, "underread: %d orig size: %d\n",
                buf_size - bytes_read, buf_size);
     }
 
@@ -546,6 +572,36 @@ static int flac_decode_frame(AVCodecContext *avctx, void *data,
     return bytes_read;
 }
 
+static av_cold int init_thread_copy(AVCodecContext *avctx)
+{
+    FLACContext *s = avctx->priv_data;
+
+    s->avctx               = avctx;
+    s->decoded_buffer      = NULL;
+    s->decoded_buffer_size = 0;
+    if (s->max_blocksize)
+        return allocate_buffers(s);
+    return 0;
+}
+
+static int update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
+{
+    FLACContext *d = dst->priv_data;
+    const FLACContext *s = src->priv_data;
+
+    if (dst == src)
+        return 0;
+
+    *(FLACStreaminfo *)d = *(const FLACStreaminfo *)s;
+    d->sample_shift   = s->sample_shift;
+    d->got_streaminfo = s->got_streaminfo;
+    d->dsp            = s->dsp;
+
+    if (d->max_blocksize)
+        return allocate_buffers(d);
+    return 0;
+}
+
 static av_cold int flac_decode_close(AVCodecContext *avctx)
 {
     FLACContext *s = avctx->priv_data;
@@ -563,7 +619,9 @@ AVCodec ff_flac_decoder = {
     .init           = flac_decode_init,
     .close          = flac_decode_close,
     .decode         = flac_decode_frame,
-    .capabilities   = CODEC_CAP_DR1,
+    .init_thread_copy      = ONLY_IF_THREADS_ENABLED(init_thread_copy),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(update_thread_context),
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS,
     .long_name      = NULL_IF_CONFIG_SMALL("FLAC (Free Lossless Audio Codec)"),
     .sample_fmts    = (const enum AVSampleFormat[]) { AV_SAMPLE_FMT_S16,
                                                       AV_SAMPLE_FMT_S16P,
@@ -46,6 +46,12 @@
 
 #include <assert.h>
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#elif HAVE_W32THREADS
+#include "compat/w32pthreads.h"
+#endif
+
 const uint16_t ff_h264_mb_sizes[4] = { 256, 384, 512, 768 };
 
 static const uint8_t rem6[QP_MAX_NUM + 1] = {
@@ -1190,7 +1196,7 @@ static void free_tables(H264Context *h, int free_rbsp)
 
     h->cur_pic_ptr = NULL;
 
-    for (i = 0; i < MAX_THREADS; i++) {
+    for (i = 0; h->thread_context && i < h->slice_context_count; i++) {
         hx = h->thread_context[i];
         if (!hx)
             continue;
@@ -1553,6 +1559,9 @@ av_cold int ff_h264_decode_init(AVCodecContext *avctx)
     h->pixel_shift        = 0;
     h->sps.bit_depth_luma = avctx->bits_per_raw_sample = 8;
 
+    h->thread_context = av_mallocz(sizeof(*h->thread_context));
+    if (!h->thread_context)
+        return AVERROR(ENOMEM);
     h->thread_context[0] = h;
     h->outputed_poc      = h->next_outputed_poc = INT_MIN;
     for (i = 0; i < MAX_DELAYED_PIC_COUNT; i++)
@@ -1719,6 +1728,12 @@ static int decode_update_thread_context(AVCodecContext *dst,
         h->mb_type_pool      = NULL;
         h->ref_index_pool    = NULL;
         h->motion_val_pool   = NULL;
+        h->wf                = NULL;
+
+        h->thread_context = av_mallocz(sizeof(*h->thread_context));
+        if (!h->thread_context)
+            return AVERROR(ENOMEM);
+        h->thread_context[0] = h;
 
         ret = ff_h264_alloc_tables(h);
         if (ret < 0) {
@@ -1738,8 +1753,6 @@ static int decode_update_thread_context(AVCodecContext *dst,
         h->bipred_scratchpad = NULL;
         h->edge_emu_buffer   = NULL;
 
-        h->thread_context[0] = h;
-
         h->context_initialized = 1;
     }
 
@@ -3132,16 +3145,28 @@ static int h264_slice_header_init(H264Context *h, int reinit)
         return ret;
     }
 
-    if (nb_slices > MAX_THREADS || (nb_slices > h->mb_height && h->mb_height)) {
+    /* The loop filter finds the reference lists of a slice in
+     * ref2frm[slice_num & (MAX_SLICES - 1)], slice numbers are only
+     * unambiguous among MAX_SLICES consecutive slices, so no more slices
+     * than that are decoded at once. */
+    if (nb_slices > MAX_SLICES || (nb_slices > h->mb_height && h->mb_height)) {
         int max_slices;
         if (h->mb_height)
-            max_slices = FFMIN(MAX_THREADS, h->mb_height);
+            max_slices = FFMIN(MAX_SLICES, h->mb_height);
         else
-            max_slices = MAX_THREADS;
+            max_slices = MAX_SLICES;
         av_log(h->avctx, AV_LOG_WARNING, "too many threads/slices (%d),"
                " reducing to %d\n", nb_slices, max_slices);
         nb_slices = max_slices;
     }
+
+    ret = av_reallocp_array(&h->thread_context, nb_slices,
+                            sizeof(*h->thread_context));
+    if (ret < 0)
+        return ret;
+    h->thread_context[0] = h;
+    for (i = 1; i < nb_slices; i++)
+        h->thread_context[i] = NULL;
     h->slice_context_count = nb_slices;
 
     if (!HAVE_THREADS || !(h->avctx->active_thread_type & FF_THREAD_SLICE)) {
@@ -4106,6 +4131,39 @@ static int fill_filter_caches(H264Context *h, int mb_type)
     return 0;
 }
 
+#define WAVEFRONT_DECODE  1
+#define WAVEFRONT_DEBLOCK 2
+
+#if HAVE_THREADS
+/**
+ * State shared by the decoding and the deblocking job of a wavefront slice.
+ * It is kept out of H264Context, which gets copied into the slice and frame
+ * thread contexts.
+ */
+typedef struct H264Wavefront {
+    H264Context deblock_ctx;    ///< context of the deblocking job
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    int filter_end;     ///< (mb_y << 16) + mb_x of the first MB not ready for the loop filter
+    int done;           ///< the decoding of the slice is over
+} H264Wavefront;
+#endif
+
+/**
+ * Let the deblocking job of a wavefront slice filter up to the given MB.
+ */
+static void wavefront_report(H264Context *h, int filter_end)
+{
+#if HAVE_THREADS
+    H264Wavefront *wf = h->wf;
+
+    pthread_mutex_lock(&wf->lock);
+    wf->filter_end = filter_end;
+    pthread_cond_signal(&wf->cond);
+    pthread_mutex_unlock(&wf->lock);
+#endif
+}
+
 static void loop_filter(H264Context *h, int start_x, int end_x)
 {
     uint8_t *dest_y, *dest_cb, *dest_cr;
@@ -4152,9 +4210,14 @@ static void loop_filter(H264Context *h, int start_x, int end_x)
                     linesize   = h->mb_linesize   = h->linesize;
                     uvlinesize = h->mb_uvlinesize = h->uvlinesize;
                 }
-                backup_mb_border(h, dest_y, dest_cb, dest_cr, linesize,
-                                 uvlinesize, 0);
-                if (fill_filter_caches(h, mb_type))
+                /* in a wavefront slice, the decoding context only saves the
+                 * unfiltered borders and leaves the filtering to the
+                 * deblocking one */
+                if (h->wavefront != WAVEFRONT_DEBLOCK)
+                    backup_mb_border(h, dest_y, dest_cb, dest_cr, linesize,
+                                     uvlinesize, 0);
+                if (h->wavefront == WAVEFRONT_DECODE ||
+                    fill_filter_caches(h, mb_type))
                     continue;
                 h->chroma_qp[0] = get_chroma_qp(h, 0, h->cur_pic.qscale_table[mb_xy]);
                 h->chroma_qp[1] = get_chroma_qp(h, 1, h->cur_pic.qscale_table[mb_xy]);
@@ -4173,6 +4236,9 @@ static void loop_filter(H264Context *h, int start_x, int end_x)
     h->mb_y         = end_mb_y - FRAME_MBAFF(h);
     h->chroma_qp[0] = get_chroma_qp(h, 0, h->qscale);
     h->chroma_qp[1] = get_chroma_qp(h, 1, h->qscale);
+
+    if (h->wavefront == WAVEFRONT_DECODE)
+        wavefront_report(h, (h->mb_y << 16) + end_x);
 }
 
 static void predict_field_decoding_flag(H264Context *h)
@@ -4195,6 +4261,10 @@ static void decode_finish_row(H264Context *h)
     int height         =  16      << FRAME_MBAFF(h);
     int deblock_border = (16 + 4) << FRAME_MBAFF(h);
 
+    /* the rows are finished once filtered by the deblocking context */
+    if (h->wavefront == WAVEFRONT_DECODE)
+        return;
+
     if (h->deblocking_filter) {
         if ((top + height) >= pic_height)
             height += deblock_border;
@@ -4391,6 +4461,134 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
     }
 }
 
+#if HAVE_THREADS
+/**
+ * Loop filter the rows of a wavefront slice as they get decoded.
+ * The filtering stays a row behind the decoding, since the intra
+ * prediction of a row temporarily puts the saved unfiltered borders
+ * back into the last line of the row above.
+ */
+static void wavefront_deblock(H264Context *h)
+{
+    H264Wavefront *wf = h->wf;
+    H264Context *d    = &wf->deblock_ctx;
+    int mb_x          = d->mb_x;
+    int mb_y, end;
+
+    for (mb_y = d->mb_y; mb_y < d->mb_height; mb_y++) {
+        int row_end = (mb_y << 16) + d->mb_width;
+
+        pthread_mutex_lock(&wf->lock);
+        while (!wf->done && wf->filter_end < row_end + (1 << 16))
+            pthread_cond_wait(&wf->cond, &wf->lock);
+        end = FFMIN(wf->filter_end, row_end);
+        pthread_mutex_unlock(&wf->lock);
+
+        if (end <= (mb_y << 16) + mb_x)
+            break;
+        d->mb_y = mb_y;
+        loop_filter(d, mb_x, end - (mb_y << 16));
+        if (end < row_end)
+            break;
+        decode_finish_row(d);
+        mb_x = 0;
+    }
+}
+
+static int decode_slice_wavefront_job(AVCodecContext *avctx, void *arg,
+                                      int jobnr, int threadnr)
+{
+    H264Context *h = arg;
+    int ret;
+
+    if (jobnr) {
+        wavefront_deblock(h);
+        return 0;
+    }
+
+    ret = decode_slice(avctx, &h);
+
+    pthread_mutex_lock(&h->wf->lock);
+    h->wf->done = 1;
+    pthread_cond_signal(&h->wf->cond);
+    pthread_mutex_unlock(&h->wf->lock);
+    return ret;
+}
+
+/**
+ * Set up the context of the deblocking job with the state read by
+ * loop_filter() and decode_finish_row(), copying all of H264Context
+ * for each slice would cost more than the filtering of short slices.
+ */
+static void wavefront_init_deblock(H264Context *d, H264Context *h)
+{
+    d->avctx                 = h->avctx;
+    d->flags                 = h->flags;
+    d->h264dsp               = h->h264dsp;
+    d->sps                   = h->sps;
+    d->pps                   = h->pps;
+    d->cur_pic_ptr           = h->cur_pic_ptr;
+    d->cur_pic               = h->cur_pic;
+    d->ref_list[0][0]        = h->ref_list[0][0];
+    d->pixel_shift           = h->pixel_shift;
+    d->chroma_y_shift        = h->chroma_y_shift;
+    d->linesize              = h->linesize;
+    d->uvlinesize            = h->uvlinesize;
+    d->low_delay             = h->low_delay;
+    d->droppable             = h->droppable;
+    d->picture_structure     = h->picture_structure;
+    d->first_field           = h->first_field;
+    d->mb_aff_frame          = h->mb_aff_frame;
+    d->mb_width              = h->mb_width;
+    d->mb_height             = h->mb_height;
+    d->mb_stride             = h->mb_stride;
+    d->b_stride              = h->b_stride;
+    d->mb2b_xy               = h->mb2b_xy;
+    d->slice_table           = h->slice_table;
+    d->list_counts           = h->list_counts;
+    d->cbp_table             = h->cbp_table;
+    d->non_zero_count        = h->non_zero_count;
+    d->slice_type            = h->slice_type;
+    d->qscale                = h->qscale;
+    d->qp_thresh             = h->qp_thresh;
+    d->deblocking_filter     = h->deblocking_filter;
+    d->slice_alpha_c0_offset = h->slice_alpha_c0_offset;
+    d->slice_beta_offset     = h->slice_beta_offset;
+    d->mb_x                  = h->mb_x;
+    d->mb_y                  = h->mb_y;
+    /* the MBs at the slice edges are filtered against earlier slices */
+    memcpy(d->ref2frm, h->ref2frm, sizeof(h->ref2frm));
+    d->wavefront             = WAVEFRONT_DEBLOCK;
+}
+
+/**
+ * Decode a slice in one job while a second one runs the loop filter
+ * behind it, so that a single slice still uses two threads.
+ */
+static int decode_slice_wavefront(H264Context *h)
+{
+    H264Wavefront *wf = h->wf;
+    int ret[2];
+
+    if (!wf) {
+        wf = h->wf = av_mallocz(sizeof(*wf));
+        if (!wf)
+            return AVERROR(ENOMEM);
+        pthread_mutex_init(&wf->lock, NULL);
+        pthread_cond_init(&wf->cond, NULL);
+    }
+    wavefront_init_deblock(&wf->deblock_ctx, h);
+    wf->filter_end = 0;
+    wf->done       = 0;
+    h->wavefront   = WAVEFRONT_DECODE;
+
+    h->avctx->execute2(h->avctx, decode_slice_wavefront_job, h, ret, 2);
+
+    h->wavefront = 0;
+    return ret[0];
+}
+#endif
+
 /**
  * Call decode_slice() for each context.
  *
@@ -4406,6 +4604,18 @@ static int execute_decode_slices(H264Context *h, int context_count)
     if (h->avctx->hwaccel)
         return 0;
     if (context_count == 1) {
+#if HAVE_THREADS
+        /* the deblocking job lags a row behind, so it only gets something
+         * done in parallel in slices of at least 3 rows */
+        int first_mb = h->resync_mb_y * h->mb_width + h->resync_mb_x;
+
+        if ((avctx->active_thread_type & FF_THREAD_SLICE) &&
+            h->slice_context_count > 1 && h->deblocking_filter &&
+            h->picture_structure == PICT_FRAME && !FRAME_MBAFF(h) &&
+            ((h->slice_end_mb - 1) / h->mb_width - h->resync_mb_y >= 2 ||
+             (!first_mb && h->slice_end_mb == h->mb_num)))
+            return decode_slice_wavefront(h);
+#endif
         return decode_slice(avctx, &h);
     } else {
         for (i = 1; i < context_count; i++) {
@@ -4429,6 +4639,66 @@ static int execute_decode_slices(H264Context *h, int context_count)
     return 0;
 }
 
+/**
+ * Find where the slice ending at buf_index ends in the picture, from the
+ * first_mb_in_slice of the next slice NAL unit in the packet.
+ *
+ * @param next_avc end of the NAL unit in avc mode, buf_size otherwise
+ * @return address of the first MB after the slice, the number of MBs if
+ *         the slice is the last one of the packet
+ */
+static int find_slice_end(H264Context *h, const uint8_t *buf, int buf_index,
+                          int next_avc, int buf_size)
+{
+    int first_mb = h->resync_mb_y * h->mb_width + h->resync_mb_x;
+
+    for (;;) {
+        GetBitContext gb;
+        int next_mb, i;
+
+        if (h->is_avc) {
+            int nalsize = 0;
+
+            buf_index = next_avc;
+            if (buf_index >= buf_size - h->nal_length_size)
+                break;
+            for (i = 0; i < h->nal_length_size; i++)
+                nalsize = (nalsize << 8) | buf[buf_index++];
+            if (nalsize <= 1 || nalsize > buf_size - buf_index)
+                break;
+            next_avc = buf_index + nalsize;
+        } else {
+            for (; buf_index + 3 < buf_size; buf_index++)
+                if (buf[buf_index]     == 0 &&
+                    buf[buf_index + 1] == 0 &&
+                    buf[buf_index + 2] == 1)
+                    break;
+            buf_index += 3;
+            if (buf_index + 1 >= buf_size)
+                break;
+        }
+
+        switch (buf[buf_index] & 0x1F) {
+        case NAL_DPB:
+        case NAL_DPC:
+        case NAL_FILLER_DATA:
+            continue;
+        case NAL_SLICE:
+        case NAL_IDR_SLICE:
+        case NAL_DPA:
+            /* the golomb code of any valid MB address is too short to
+             * contain an emulation prevention byte */
+            init_get_bits(&gb, buf + buf_index + 1,
+                          8 * FFMIN(8, buf_size - buf_index - 1));
+            next_mb = get_ue_golomb_long(&gb);
+            if (next_mb > first_mb && next_mb < h->mb_num)
+                return next_mb;
+        }
+        break;
+    }
+    return h->mb_num;
+}
+
 static int decode_nal_units(H264Context *h, const uint8_t *buf, int buf_size,
                             int parse_extradata)
 {
@@ -4614,8 +4884,14 @@ again:
                                                            consumed);
                         if (ret < 0)
                             return ret;
-                    } else
+                    } else {
+                        if (HAVE_THREADS && h->slice_context_count > 1)
+                            hx->slice_end_mb = find_slice_end(hx, buf,
+                                                              buf_index,
+                                                              next_avc,
+                                                              buf_size);
                         context_count++;
+                    }
                 }
                 break;
             case NAL_DPA:
@@ -4645,8 +4921,12 @@ again:
                      hx->slice_type_nos != AV_PICTURE_TYPE_B) &&
                     (avctx->skip_frame < AVDISCARD_NONKEY ||
                      hx->slice_type_nos == AV_PICTURE_TYPE_I) &&
-                    avctx->skip_frame < AVDISCARD_ALL)
+                    avctx->skip_frame < AVDISCARD_ALL) {
+                    if (HAVE_THREADS && h->slice_context_count > 1)
+                        hx->slice_end_mb = find_slice_end(hx, buf, buf_index,
+                                                          next_avc, buf_size);
                     context_count++;
+                }
                 break;
             case NAL_SEI:
                 init_get_bits(&h->gb, ptr, bit_length);
@@ -4841,12 +5121,21 @@ av_cold void ff_h264_free_context(H264Context *h)
     int i;
 
     free_tables(h, 1); // FIXME cleanup init stuff perhaps
+    av_freep(&h->thread_context);
 
     for (i = 0; i < MAX_SPS_COUNT; i++)
         av_freep(h->sps_buffers + i);
 
     for (i = 0; i < MAX_PPS_COUNT; i++)
         av_freep(h->pps_buffers + i);
+
+#if HAVE_THREADS
+    if (h->wf) {
+        pthread_cond_destroy(&h->wf->cond);
+        pthread_mutex_destroy(&h->wf->lock);
+        av_freep(&h->wf);
+    }
+#endif
 }
 
 static av_cold int h264_decode_end(AVCodecContext *avctx)
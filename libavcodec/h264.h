@@ -53,10 +53,11 @@
 #define FMO 0
 
 /**
- * The maximum number of slices supported by the decoder.
+ * The maximum number of slices supported by the decoder, also the
+ * maximum number of slice contexts.
  * must be a power of 2
  */
-#define MAX_SLICES 16
+#define MAX_SLICES 32
 
 #ifdef ALLOW_INTERLACE
 #define MB_MBAFF(h)    h->mb_mbaff
@@ -544,7 +545,7 @@ typedef struct H264Context {
      * @name Members for slice based multithreading
      * @{
      */
-    struct H264Context *thread_context[MAX_THREADS];
+    struct H264Context **thread_context; ///< slice_context_count contexts, the first one is this one
 
     /**
      * current slice number, used to initalize slice_num of each thread/context
@@ -567,6 +568,16 @@ typedef struct H264Context {
      */
     int single_decode_warning;
 
+    /**
+     * Wavefront deblocking: a slice decoded alone with slice threads is
+     * loop filtered by a second context in another job, which follows
+     * the decoding one macroblock row behind.
+     * 1 in the decoding context, 2 in the filtering one, 0 otherwise.
+     */
+    int wavefront;
+    struct H264Wavefront *wf;   ///< synchronization of the two jobs, shared by both contexts
+    int slice_end_mb;           ///< first MB after the slice, set with slice threads
+
     enum AVPictureType pict_type;
 
     int last_slice_type;
@@ -394,6 +394,9 @@ static void close(AVCodecParserContext *s)
 static av_cold int init(AVCodecParserContext *s)
 {
     H264Context *h = s->priv_data;
+    h->thread_context = av_mallocz(sizeof(*h->thread_context));
+    if (!h->thread_context)
+        return AVERROR(ENOMEM);
     h->thread_context[0]   = h;
     h->slice_context_count = 1;
     ff_h264dsp_init(&h->h264dsp, 8, 1);
@@ -34,25 +34,6 @@
 
 #define FF_SANE_NB_CHANNELS 63U
 
-typedef struct FramePool {
-    /**
-     * Pools for each data plane. For audio all the planes have the same size,
-     * so only pools[0] is used.
-     */
-    AVBufferPool *pools[4];
-
-    /*
-     * Pool parameters
-     */
-    int format;
-    int width, height;
-    int stride_align[AV_NUM_DATA_POINTERS];
-    int linesize[4];
-    int planes;
-    int channels;
-    int samples;
-} FramePool;
-
 typedef struct AVCodecInternal {
     /**
      * Whether the parent AVCodecContext is a copy of the context which had
@@ -85,7 +66,7 @@ typedef struct AVCodecInternal {
 
     AVFrame to_free;
 
-    FramePool *pool;
+    struct FramePool *pool;
 } AVCodecInternal;
 
 struct AVCodecDefault {
@@ -46,6 +46,15 @@ typedef struct Jpeg2000TilePart {
     GetByteContext tpg;                 // bit stream in tile-part
 } Jpeg2000TilePart;
 
+/* A codeblock to decode and dequantize, in a job of its own */
+typedef struct Jpeg2000CblkJob {
+    Jpeg2000Component   *comp;
+    Jpeg2000CodingStyle *codsty;
+    Jpeg2000Band        *band;
+    Jpeg2000Cblk        *cblk;
+    int                 bandpos;
+} Jpeg2000CblkJob;
+
 /* RMK: For JPEG2000 DCINEMA 3 tile-parts in a tile
  * one per component, so tile_part elements have a size of 3 */
 typedef struct Jpeg2000Tile {
@@ -1096,16 +1105,15 @@ static void mct_decode(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile)
     }
 }
 
-static int jpeg2000_decode_tile(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile,
-                                AVFrame *picture)
+/* Fill jobs with the codeblocks of a tile, only count them if jobs is NULL.
+ * Codeblocks write to distinct parts of the component data, so they can be
+ * decoded in any order. */
+static int list_cblks(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile,
+                      Jpeg2000CblkJob *jobs)
 {
-    int compno, reslevelno, bandno;
-    int x, y;
+    int compno, reslevelno, bandno, nb_jobs = 0;
 
-    uint8_t *line;
-    Jpeg2000T1Context t1;
     /* Loop on tile components */
-
     for (compno = 0; compno < s->ncomponents; compno++) {
         Jpeg2000Component *comp     = tile->comp + compno;
         Jpeg2000CodingStyle *codsty = tile->codsty + compno;
@@ -1130,29 +1138,78 @@ static int jpeg2000_decode_tile(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile,
 
                     /* Loop on codeblocks */
                     for (cblkno = 0; cblkno < prec->nb_codeblocks_width * prec->nb_codeblocks_height; cblkno++) {
-                        int x, y;
-                        Jpeg2000Cblk *cblk = prec->cblk + cblkno;
-                        decode_cblk(s, codsty, &t1, cblk,
-                                    cblk->coord[0][1] - cblk->coord[0][0],
-                                    cblk->coord[1][1] - cblk->coord[1][0],
-                                    bandpos);
-
-                        x = cblk->coord[0][0];
-                        y = cblk->coord[1][0];
-
-                        if (codsty->transform == FF_DWT97)
-                            dequantization_float(x, y, cblk, comp, &t1, band);
-                        else
-                            dequantization_int(x, y, cblk, comp, &t1, band);
+                        if (jobs) {
+                            Jpeg2000CblkJob *job = jobs + nb_jobs;
+                            job->comp    = comp;
+                            job->codsty  = codsty;
+                            job->band    = band;
+                            job->cblk    = prec->cblk + cblkno;
+                            job->bandpos = bandpos;
+                        }
+                        nb_jobs++;
                    } /* end cblk */
                 } /*end prec */
             } /* end band */
         } /* end reslevel */
-
-        /* inverse DWT */
-        ff_dwt_decode(&comp->dwt, codsty->transform == FF_DWT97 ? (void*)comp->f_data : (void*)comp->i_data);
     } /*end comp */
 
+    return nb_jobs;
+}
+
+static int decode_cblk_job(AVCodecContext *avctx, void *arg,
+                           int jobnr, int threadnr)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+    Jpeg2000CblkJob *job      = (Jpeg2000CblkJob *)arg + jobnr;
+    Jpeg2000Cblk *cblk        = job->cblk;
+    int x = cblk->coord[0][0], y = cblk->coord[1][0];
+    Jpeg2000T1Context t1;
+
+    decode_cblk(s, job->codsty, &t1, cblk,
+                cblk->coord[0][1] - cblk->coord[0][0],
+                cblk->coord[1][1] - cblk->coord[1][0],
+                job->bandpos);
+
+    if (job->codsty->transform == FF_DWT97)
+        dequantization_float(x, y, cblk, job->comp, &t1, job->band);
+    else
+        dequantization_int(x, y, cblk, job->comp, &t1, job->band);
+    return 0;
+}
+
+static int dwt_job(AVCodecContext *avctx, void *arg, int compno, int threadnr)
+{
+    Jpeg2000Tile *tile          = arg;
+    Jpeg2000Component *comp     = tile->comp + compno;
+    Jpeg2000CodingStyle *codsty = tile->codsty + compno;
+
+    ff_dwt_decode(&comp->dwt, codsty->transform == FF_DWT97 ? (void*)comp->f_data : (void*)comp->i_data);
+    return 0;
+}
+
+static int jpeg2000_decode_tile(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile,
+                                AVFrame *picture)
+{
+    int compno, nb_jobs;
+    int x, y;
+
+    uint8_t *line;
+    Jpeg2000CblkJob *jobs;
+
+    /* tier-1 decoding and dequantization of all the codeblocks */
+    nb_jobs = list_cblks(s, tile, NULL);
+    if (nb_jobs) {
+        jobs = av_malloc_array(nb_jobs, sizeof(*jobs));
+        if (!jobs)
+            return AVERROR(ENOMEM);
+        list_cblks(s, tile, jobs);
+        s->avctx->execute2(s->avctx, decode_cblk_job, jobs, NULL, nb_jobs);
+        av_free(jobs);
+    }
+
+    /* inverse DWT, each component in a job */
+    s->avctx->execute2(s->avctx, dwt_job, tile, NULL, s->ncomponents);
+
     /* inverse MCT transformation */
     if (tile->codsty[0].mct)
         mct_decode(s, tile);
@@ -1496,7 +1553,7 @@ AVCodec ff_jpeg2000_decoder = {
     .long_name        = NULL_IF_CONFIG_SMALL("JPEG 2000"),
     .type             = AVMEDIA_TYPE_VIDEO,
     .id               = AV_CODEC_ID_JPEG2000,
-    .capabilities     = CODEC_CAP_FRAME_THREADS,
+    .capabilities     = CODEC_CAP_SLICE_THREADS | CODEC_CAP_FRAME_THREADS,
     .priv_data_size   = sizeof(Jpeg2000DecoderContext),
     .init_static_data = jpeg2000_init_static_data,
     .decode           = jpeg2000_decode_frame,
@@ -0,0 +1,81 @@
+/*
+ * JPEG 2000 DSP functions
+ *
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "jpeg2000dsp.h"
+
+#define VCOLS FF_DWT_VCOLS
+
+static void vlift53_sub_c(int32_t *p, int rows, int n)
+{
+    int i, c;
+
+    for (i = 0; i < rows; i++, p += 2 * VCOLS)
+        for (c = 0; c < n; c++)
+            p[c] -= (p[c - VCOLS] + p[c + VCOLS] + 2) >> 2;
+}
+
+static void vlift53_add_c(int32_t *p, int rows, int n)
+{
+    int i, c;
+
+    for (i = 0; i < rows; i++, p += 2 * VCOLS)
+        for (c = 0; c < n; c++)
+            p[c] += (p[c - VCOLS] + p[c + VCOLS]) >> 1;
+}
+
+static void vlift97_float_c(float *p, int rows, int n, float k)
+{
+    int i, c;
+
+    for (i = 0; i < rows; i++, p += 2 * VCOLS)
+        for (c = 0; c < n; c++)
+            p[c] += k * (p[c - VCOLS] + p[c + VCOLS]);
+}
+
+static void vlift97_int_sub_c(int32_t *p, int rows, int n, int k)
+{
+    int i, c;
+
+    for (i = 0; i < rows; i++, p += 2 * VCOLS)
+        for (c = 0; c < n; c++)
+            p[c] -= (k * (p[c - VCOLS] + p[c + VCOLS]) + (1 << 15)) >> 16;
+}
+
+static void vlift97_int_add_c(int32_t *p, int rows, int n, int k)
+{
+    int i, c;
+
+    for (i = 0; i < rows; i++, p += 2 * VCOLS)
+        for (c = 0; c < n; c++)
+            p[c] += (k * (p[c - VCOLS] + p[c + VCOLS]) + (1 << 15)) >> 16;
+}
+
+av_cold void ff_jpeg2000dsp_init(Jpeg2000DSPContext *c)
+{
+    c->vlift53_sub     = vlift53_sub_c;
+    c->vlift53_add     = vlift53_add_c;
+    c->vlift97_float   = vlift97_float_c;
+    c->vlift97_int_sub = vlift97_int_sub_c;
+    c->vlift97_int_add = vlift97_int_add_c;
+    if (ARCH_X86)
+        ff_jpeg2000dsp_init_x86(c);
+}
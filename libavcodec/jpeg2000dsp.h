@@ -0,0 +1,53 @@
+/*
+ * JPEG 2000 DSP functions
+ *
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_JPEG2000DSP_H
+#define AVCODEC_JPEG2000DSP_H
+
+#include <stdint.h>
+
+/** number of columns the vertical DWT passes lift at once */
+#define FF_DWT_VCOLS 16
+
+/**
+ * Vertical lifting steps of the inverse DWT.
+ *
+ * The samples of FF_DWT_VCOLS columns are stored row after row. Starting
+ * with the row at p, every second row of a run of rows rows is updated
+ * from the rows right above and below it. Only the first n columns are
+ * needed; the SIMD versions update all FF_DWT_VCOLS columns.
+ */
+typedef struct Jpeg2000DSPContext {
+    /** p -= (above + below + 2) >> 2 */
+    void (*vlift53_sub)(int32_t *p, int rows, int n);
+    /** p += (above + below) >> 1 */
+    void (*vlift53_add)(int32_t *p, int rows, int n);
+    /** p += c * (above + below) */
+    void (*vlift97_float)(float *p, int rows, int n, float c);
+    /** p -= (c * (above + below) + (1 << 15)) >> 16 */
+    void (*vlift97_int_sub)(int32_t *p, int rows, int n, int c);
+    /** p += (c * (above + below) + (1 << 15)) >> 16 */
+    void (*vlift97_int_add)(int32_t *p, int rows, int n, int c);
+} Jpeg2000DSPContext;
+
+void ff_jpeg2000dsp_init(Jpeg2000DSPContext *c);
+void ff_jpeg2000dsp_init_x86(Jpeg2000DSPContext *c);
+
+#endif /* AVCODEC_JPEG2000DSP_H */
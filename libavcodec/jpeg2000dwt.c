@@ -51,6 +51,9 @@
 #define I_LFTG_K       80621
 #define I_LFTG_X      106544
 
+/* The vertical passes lift this many columns at once, so that the inner
+ * loops run along the rows of the line buffer and can be vectorized. */
+#define VCOLS FF_DWT_VCOLS
 
 static inline void extend53(int *p, int i0, int i1)
 {
@@ -80,6 +83,26 @@ static inline void extend97_int(int32_t *p, int i0, int i1)
     }
 }
 
+static inline void copy_row(void *p, int dst, int src, int n, int size)
+{
+    memcpy((uint8_t *)p + dst * VCOLS * size,
+           (uint8_t *)p + src * VCOLS * size, n * size);
+}
+
+static void sr_1d53_v(Jpeg2000DSPContext *dsp, int *p, int i0, int i1, int n)
+{
+    if (i1 == i0 + 1)
+        return;
+
+    copy_row(p, i0 - 1, i0 + 1, n, sizeof(*p));
+    copy_row(p, i1,     i1 - 2, n, sizeof(*p));
+    copy_row(p, i0 - 2, i0 + 2, n, sizeof(*p));
+    copy_row(p, i1 + 1, i1 - 3, n, sizeof(*p));
+
+    dsp->vlift53_sub(p + 2 * (i0 / 2) * VCOLS,       i1 / 2 + 1 - i0 / 2, n);
+    dsp->vlift53_add(p + (2 * (i0 / 2) + 1) * VCOLS, i1 / 2     - i0 / 2, n);
+}
+
 static void sr_1d53(int *p, int i0, int i1)
 {
     int i;
@@ -99,7 +122,8 @@ static void dwt_decode53(DWTContext *s, int *t)
 {
     int lev;
     int w     = s->linelen[s->ndeclevels - 1][0];
-    int32_t *line = s->i_linebuf;
+    int32_t *line = s->i_linebuf, *vline;
+    vline = line + 3 * VCOLS;
     line += 3;
 
     for (lev = 0; lev < s->ndeclevels; lev++) {
@@ -127,19 +151,19 @@ static void dwt_decode53(DWTContext *s, int *t)
         }
 
         // VER_SD
-        l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
-            int i, j = 0;
+        l = vline + mv * VCOLS;
+        for (lp = 0; lp < lh; lp += VCOLS) {
+            int i, j = 0, n = FFMIN(VCOLS, lh - lp);
             // copy with interleaving
             for (i = mv; i < lv; i += 2, j++)
-                l[i] = t[w * j + lp];
+                memcpy(l + i * VCOLS, t + w * j + lp, n * sizeof(*l));
             for (i = 1 - mv; i < lv; i += 2, j++)
-                l[i] = t[w * j + lp];
+                memcpy(l + i * VCOLS, t + w * j + lp, n * sizeof(*l));
 
-            sr_1d53(line, mv, mv + lv);
+            sr_1d53_v(&s->dsp, vline, mv, mv + lv, n);
 
             for (i = 0; i < lv; i++)
-                t[w * i + lp] = l[i];
+                memcpy(t + w * i + lp, l + i * VCOLS, n * sizeof(*l));
         }
     }
 }
@@ -166,13 +190,39 @@ static void sr_1d97_float(float *p, int i0, int i1)
         p[2 * i + 1] += F_LFTG_ALPHA * (p[2 * i]     + p[2 * i + 2]);
 }
 
+static void sr_1d97_float_v(Jpeg2000DSPContext *dsp, float *p, int i0, int i1, int n)
+{
+    int i;
+
+    if (i1 == i0 + 1)
+        return;
+
+    for (i = 1; i <= 4; i++) {
+        copy_row(p, i0 - i,     i0 + i,     n, sizeof(*p));
+        copy_row(p, i1 + i - 1, i1 - i - 1, n, sizeof(*p));
+    }
+
+    dsp->vlift97_float(p + 2 * (i0 / 2 - 1) * VCOLS,       i1 / 2 + 3 - i0 / 2, n,
+                       -F_LFTG_DELTA);
+    /* step 4 */
+    dsp->vlift97_float(p + (2 * (i0 / 2 - 1) + 1) * VCOLS, i1 / 2 + 2 - i0 / 2, n,
+                       -F_LFTG_GAMMA);
+    /*step 5*/
+    dsp->vlift97_float(p + 2 * (i0 / 2) * VCOLS,           i1 / 2 + 1 - i0 / 2, n,
+                       F_LFTG_BETA);
+    /* step 6 */
+    dsp->vlift97_float(p + (2 * (i0 / 2) + 1) * VCOLS,     i1 / 2     - i0 / 2, n,
+                       F_LFTG_ALPHA);
+}
+
 static void dwt_decode97_float(DWTContext *s, float *t)
 {
     int lev;
     int w       = s->linelen[s->ndeclevels - 1][0];
-    float *line = s->f_linebuf;
+    float *line = s->f_linebuf, *vline;
     float *data = t;
     /* position at index O of line range [0-5,w+5] cf. extend function */
+    vline = line + 5 * VCOLS;
     line += 5;
 
     for (lev = 0; lev < s->ndeclevels; lev++) {
@@ -199,19 +249,21 @@ static void dwt_decode97_float(DWTContext *s, float *t)
         }
 
         // VER_SD
-        l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
-            int i, j = 0;
+        l = vline + mv * VCOLS;
+        for (lp = 0; lp < lh; lp += VCOLS) {
+            int i, j = 0, c, n = FFMIN(VCOLS, lh - lp);
             // copy with interleaving
             for (i = mv; i < lv; i += 2, j++)
-                l[i] = data[w * j + lp] * F_LFTG_K;
+                for (c = 0; c < n; c++)
+                    l[i * VCOLS + c] = data[w * j + lp + c] * F_LFTG_K;
             for (i = 1 - mv; i < lv; i += 2, j++)
-                l[i] = data[w * j + lp] * F_LFTG_X;
+                for (c = 0; c < n; c++)
+                    l[i * VCOLS + c] = data[w * j + lp + c] * F_LFTG_X;
 
-            sr_1d97_float(line, mv, mv + lv);
+            sr_1d97_float_v(&s->dsp, vline, mv, mv + lv, n);
 
             for (i = 0; i < lv; i++)
-                data[w * i + lp] = l[i];
+                memcpy(data + w * i + lp, l + i * VCOLS, n * sizeof(*l));
         }
     }
 }
@@ -238,13 +290,39 @@ static void sr_1d97_int(int32_t *p, int i0, int i1)
         p[2 * i + 1] += (I_LFTG_ALPHA * (p[2 * i]     + p[2 * i + 2]) + (1 << 15)) >> 16;
 }
 
+static void sr_1d97_int_v(Jpeg2000DSPContext *dsp, int32_t *p, int i0, int i1, int n)
+{
+    int i;
+
+    if (i1 == i0 + 1)
+        return;
+
+    for (i = 1; i <= 4; i++) {
+        copy_row(p, i0 - i,     i0 + i,     n, sizeof(*p));
+        copy_row(p, i1 + i - 1, i1 - i - 1, n, sizeof(*p));
+    }
+
+    dsp->vlift97_int_sub(p + 2 * (i0 / 2 - 1) * VCOLS,       i1 / 2 + 3 - i0 / 2, n,
+                         I_LFTG_DELTA);
+    /* step 4 */
+    dsp->vlift97_int_sub(p + (2 * (i0 / 2 - 1) + 1) * VCOLS, i1 / 2 + 2 - i0 / 2, n,
+                         I_LFTG_GAMMA);
+    /*step 5*/
+    dsp->vlift97_int_add(p + 2 * (i0 / 2) * VCOLS,           i1 / 2 + 1 - i0 / 2, n,
+                         I_LFTG_BETA);
+    /* step 6 */
+    dsp->vlift97_int_add(p + (2 * (i0 / 2) + 1) * VCOLS,     i1 / 2     - i0 / 2, n,
+                         I_LFTG_ALPHA);
+}
+
 static void dwt_decode97_int(DWTContext *s, int32_t *t)
 {
     int lev;
     int w       = s->linelen[s->ndeclevels - 1][0];
-    int32_t *line = s->i_linebuf;
+    int32_t *line = s->i_linebuf, *vline;
     int32_t *data = t;
     /* position at index O of line range [0-5,w+5] cf. extend function */
+    vline = line + 5 * VCOLS;
     line += 5;
 
     for (lev = 0; lev < s->ndeclevels; lev++) {
@@ -271,19 +349,21 @@ static void dwt_decode97_int(DWTContext *s, int32_t *t)
         }
 
         // VER_SD
-        l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
-            int i, j = 0;
+        l = vline + mv * VCOLS;
+        for (lp = 0; lp < lh; lp += VCOLS) {
+            int i, j = 0, c, n = FFMIN(VCOLS, lh - lp);
             // rescale with interleaving
             for (i = mv; i < lv; i += 2, j++)
-                l[i] = ((data[w * j + lp] * I_LFTG_K) + (1 << 15)) >> 16;
+                for (c = 0; c < n; c++)
+                    l[i * VCOLS + c] = ((data[w * j + lp + c] * I_LFTG_K) + (1 << 15)) >> 16;
             for (i = 1 - mv; i < lv; i += 2, j++)
-                l[i] = ((data[w * j + lp] * I_LFTG_X) + (1 << 15)) >> 16;
+                for (c = 0; c < n; c++)
+                    l[i * VCOLS + c] = ((data[w * j + lp + c] * I_LFTG_X) + (1 << 15)) >> 16;
 
-            sr_1d97_int(line, mv, mv + lv);
+            sr_1d97_int_v(&s->dsp, vline, mv, mv + lv, n);
 
             for (i = 0; i < lv; i++)
-                data[w * i + lp] = l[i];
+                memcpy(data + w * i + lp, l + i * VCOLS, n * sizeof(*l));
         }
     }
 }
@@ -310,19 +390,21 @@ int ff_jpeg2000_dwt_init(DWTContext *s, uint16_t border[2][2],
             for (j = 0; j < 2; j++)
                 b[i][j] = (b[i][j] + 1) >> 1;
         }
+    ff_jpeg2000dsp_init(&s->dsp);
+
     switch (type) {
     case FF_DWT97:
-        s->f_linebuf = av_malloc((maxlen + 12) * sizeof(*s->f_linebuf));
+        s->f_linebuf = av_mallocz((maxlen + 12) * VCOLS * sizeof(*s->f_linebuf));
         if (!s->f_linebuf)
             return AVERROR(ENOMEM);
         break;
      case FF_DWT97_INT:
-        s->i_linebuf = av_malloc((maxlen + 12) * sizeof(*s->i_linebuf));
+        s->i_linebuf = av_mallocz((maxlen + 12) * VCOLS * sizeof(*s->i_linebuf));
         if (!s->i_linebuf)
             return AVERROR(ENOMEM);
         break;
     case FF_DWT53:
-        s->i_linebuf = av_malloc((maxlen +  6) * sizeof(*s->i_linebuf));
+        s->i_linebuf = av_mallocz((maxlen +  6) * VCOLS * sizeof(*s->i_linebuf));
         if (!s->i_linebuf)
             return AVERROR(ENOMEM);
         break;
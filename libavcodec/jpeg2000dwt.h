@@ -29,6 +29,8 @@
 
 #include <stdint.h>
 
+#include "jpeg2000dsp.h"
+
 #define FF_DWT_MAX_DECLVLS 32 ///< max number of decomposition levels
 
 enum DWTType {
@@ -45,6 +47,7 @@ typedef struct DWTContext {
     uint8_t type;                        ///< 0 for 9/7; 1 for 5/3
     int32_t *i_linebuf;                  ///< int buffer used by transform
     float   *f_linebuf;                  ///< float buffer used by transform
+    Jpeg2000DSPContext dsp;
 } DWTContext;
 
 /**
@@ -41,9 +41,42 @@
 #include "jpeglsdec.h"
 
 
+static void build_fast_ac(int16_t *fast_ac, const uint8_t *huff_size,
+                          const uint16_t *huff_code)
+{
+    int sym;
+
+    memset(fast_ac, 0, sizeof(*fast_ac) << FAST_AC_BITS);
+    for (sym = 0; sym < 256; sym++) {
+        int run  = sym >> 4;
+        int size = sym & 15;
+        int len  = huff_size[sym] + size;
+        int m, k;
+
+        if (!huff_size[sym] || len > FAST_AC_BITS)
+            continue;
+        if (!size) {
+            /* end of block and run of 16 zeros, stored with a 0 level */
+            if (sym == 0x00 || sym == 0xf0)
+                for (k = 0; k < 1 << (FAST_AC_BITS - len); k++)
+                    fast_ac[(huff_code[sym] << (FAST_AC_BITS - len)) + k] =
+                        run * 16 + len;
+            continue;
+        }
+        for (m = 0; m < 1 << size; m++) {
+            int level = m >> (size - 1) ? m : m - (1 << size) + 1;
+            int index = (huff_code[sym] << size | m) << (FAST_AC_BITS - len);
+            if (level < -128 || level > 127)
+                continue;
+            for (k = 0; k < 1 << (FAST_AC_BITS - len); k++)
+                fast_ac[index + k] = level * 256 + run * 16 + len;
+        }
+    }
+}
+
 static int build_vlc(VLC *vlc, const uint8_t *bits_table,
                      const uint8_t *val_table, int nb_codes,
-                     int use_static, int is_ac)
+                     int use_static, int is_ac, int16_t *fast_ac)
 {
     uint8_t huff_size[256] = { 0 };
     uint16_t huff_code[256];
@@ -54,6 +87,9 @@ static int build_vlc(VLC *vlc, const uint8_t *bits_table,
 
     ff_mjpeg_build_huffman_codes(huff_size, huff_code, bits_table, val_table);
 
+    if (fast_ac)
+        build_fast_ac(fast_ac, huff_size, huff_code);
+
     for (i = 0; i < 256; i++)
         huff_sym[i] = i + 16 * is_ac;
 
@@ -67,17 +103,17 @@ static int build_vlc(VLC *vlc, const uint8_t *bits_table,
 static void build_basic_mjpeg_vlc(MJpegDecodeContext *s)
 {
     build_vlc(&s->vlcs[0][0], avpriv_mjpeg_bits_dc_luminance,
-              avpriv_mjpeg_val_dc, 12, 0, 0);
+              avpriv_mjpeg_val_dc, 12, 0, 0, NULL);
     build_vlc(&s->vlcs[0][1], avpriv_mjpeg_bits_dc_chrominance,
-              avpriv_mjpeg_val_dc, 12, 0, 0);
+              avpriv_mjpeg_val_dc, 12, 0, 0, NULL);
     build_vlc(&s->vlcs[1][0], avpriv_mjpeg_bits_ac_luminance,
-              avpriv_mjpeg_val_ac_luminance, 251, 0, 1);
+              avpriv_mjpeg_val_ac_luminance, 251, 0, 1, s->fast_ac[0]);
     build_vlc(&s->vlcs[1][1], avpriv_mjpeg_bits_ac_chrominance,
-              avpriv_mjpeg_val_ac_chrominance, 251, 0, 1);
+              avpriv_mjpeg_val_ac_chrominance, 251, 0, 1, s->fast_ac[1]);
     build_vlc(&s->vlcs[2][0], avpriv_mjpeg_bits_ac_luminance,
-              avpriv_mjpeg_val_ac_luminance, 251, 0, 0);
+              avpriv_mjpeg_val_ac_luminance, 251, 0, 0, NULL);
     build_vlc(&s->vlcs[2][1], avpriv_mjpeg_bits_ac_chrominance,
-              avpriv_mjpeg_val_ac_chrominance, 251, 0, 0);
+              avpriv_mjpeg_val_ac_chrominance, 251, 0, 0, NULL);
 }
 
 av_cold int ff_mjpeg_decode_init(AVCodecContext *avctx)
@@ -196,13 +232,14 @@ int ff_mjpeg_decode_dht(MJpegDecodeContext *s)
         av_log(s->avctx, AV_LOG_DEBUG, "class=%d index=%d nb_codes=%d\n",
                class, index, code_max + 1);
         if ((ret = build_vlc(&s->vlcs[class][index], bits_table, val_table,
-                             code_max + 1, 0, class > 0)) < 0)
+                             code_max + 1, 0, class > 0,
+                             class > 0 ? s->fast_ac[index] : NULL)) < 0)
             return ret;
 
         if (class > 0) {
             ff_free_vlc(&s->vlcs[2][index]);
             if ((ret = build_vlc(&s->vlcs[2][index], bits_table, val_table,
-                                 code_max + 1, 0, 0)) < 0)
+                                 code_max + 1, 0, 0, NULL)) < 0)
                 return ret;
         }
     }
@@ -398,10 +435,11 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
     return 0;
 }
 
-static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
+static inline int mjpeg_decode_dc(MJpegDecodeContext *s, GetBitContext *gb,
+                                  int dc_index)
 {
     int code;
-    code = get_vlc2(&s->gb, s->vlcs[0][dc_index].table, 9, 2);
+    code = get_vlc2(gb, s->vlcs[0][dc_index].table, 9, 2);
     if (code < 0) {
         av_log(s->avctx, AV_LOG_WARNING,
                "mjpeg_decode_dc: bad vlc: %d:%d (%p)\n",
@@ -410,73 +448,88 @@ static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
     }
 
     if (code)
-        return get_xbits(&s->gb, code);
+        return get_xbits(gb, code);
     else
         return 0;
 }
 
 /* decode block and dequantize */
-static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
-                        int dc_index, int ac_index, int16_t *quant_matrix)
+static int decode_block(MJpegDecodeContext *s, GetBitContext *gb,
+                        int16_t *block, int *last_dc, int dc_index,
+                        int ac_index, int16_t *quant_matrix)
 {
+    const int16_t *fast_ac = s->fast_ac[ac_index];
     int code, i, j, level, val;
 
     /* DC coef */
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, gb, dc_index);
     if (val == 0xffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
     }
-    val = val * quant_matrix[0] + s->last_dc[component];
-    s->last_dc[component] = val;
+    val = val * quant_matrix[0] + *last_dc;
+    *last_dc = val;
     block[0] = val;
     /* AC coefs */
     i = 0;
-    {OPEN_READER(re, &s->gb);
+    {OPEN_READER(re, gb);
     do {
-        UPDATE_CACHE(re, &s->gb);
-        GET_VLC(code, re, &s->gb, s->vlcs[1][ac_index].table, 9, 2);
-
-        i += ((unsigned)code) >> 4;
-            code &= 0xf;
+        UPDATE_CACHE(re, gb);
+        /* most codes and their coefficient bits fit in a single lookup */
+        code = fast_ac[SHOW_UBITS(re, gb, FAST_AC_BITS)];
         if (code) {
+            i    += ((code >> 4) & 0xf) + 1;
+            level = code >> 8;
+            LAST_SKIP_BITS(re, gb, code & 0xf);
+            if (!level) {
+                if (code < 0x10) /* end of block */
+                    break;
+                continue;
+            }
+        } else {
+            GET_VLC(code, re, gb, s->vlcs[1][ac_index].table, 9, 2);
+
+            i += ((unsigned)code) >> 4;
+                code &= 0xf;
+            if (!code)
+                continue;
             if (code > MIN_CACHE_BITS - 16)
-                UPDATE_CACHE(re, &s->gb);
+                UPDATE_CACHE(re, gb);
 
             {
-                int cache = GET_CACHE(re, &s->gb);
+                int cache = GET_CACHE(re, gb);
                 int sign  = (~cache) >> 31;
                 level     = (NEG_USR32(sign ^ cache,code) ^ sign) - sign;
             }
 
-            LAST_SKIP_BITS(re, &s->gb, code);
+            LAST_SKIP_BITS(re, gb, code);
+        }
 
-            if (i > 63) {
-                av_log(s->avctx, AV_LOG_ERROR, "error count: %d\n", i);
-                return AVERROR_INVALIDDATA;
-            }
-            j        = s->scantable.permutated[i];
-            block[j] = level * quant_matrix[j];
+        if (i > 63) {
+            av_log(s->avctx, AV_LOG_ERROR, "error count: %d\n", i);
+            return AVERROR_INVALIDDATA;
         }
+        j        = s->scantable.permutated[i];
+        block[j] = level * quant_matrix[j];
     } while (i < 63);
-    CLOSE_READER(re, &s->gb);}
+    CLOSE_READER(re, gb);}
 
     return 0;
 }
 
-static int decode_dc_progressive(MJpegDecodeContext *s, int16_t *block,
-                                 int component, int dc_index,
+static int decode_dc_progressive(MJpegDecodeContext *s, GetBitContext *gb,
+                                 int16_t *block, int *last_dc, int dc_index,
                                  int16_t *quant_matrix, int Al)
 {
     int val;
     s->dsp.clear_block(block);
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, gb, dc_index);
     if (val == 0xffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
     }
-    val = (val * quant_matrix[0] << Al) + s->last_dc[component];
-    s->last_dc[component] = val;
+    val = (val * quant_matrix[0] << Al) + *last_dc;
+    *last_dc = val;
     block[0] = val;
     return 0;
 }
@@ -684,7 +737,7 @@ static int ljpeg_decode_rgb_scan(MJpegDecodeContext *s, int predictor,
                 PREDICT(pred, topleft[i], top[i], left[i], modified_predictor);
 
                 left[i] = buffer[mb_x][i] =
-                    mask & (pred + (mjpeg_decode_dc(s, s->dc_index[i]) << point_transform));
+                    mask & (pred + (mjpeg_decode_dc(s, &s->gb, s->dc_index[i]) << point_transform));
             }
 
             if (s->restart_interval && !--s->restart_count) {
@@ -759,7 +812,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
 
                         if (s->interlaced && s->bottom_field)
                             ptr += linesize >> 1;
-                        *ptr = pred + (mjpeg_decode_dc(s, s->dc_index[i]) << point_transform);
+                        *ptr = pred + (mjpeg_decode_dc(s, &s->gb, s->dc_index[i]) << point_transform);
 
                         if (++x == h) {
                             x = 0;
@@ -788,7 +841,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
                               (h * mb_x + x);
                         PREDICT(pred, ptr[-linesize - 1],
                                 ptr[-linesize], ptr[-1], predictor);
-                        *ptr = pred + (mjpeg_decode_dc(s, s->dc_index[i]) << point_transform);
+                        *ptr = pred + (mjpeg_decode_dc(s, &s->gb, s->dc_index[i]) << point_transform);
                         if (++x == h) {
                             x = 0;
                             y++;
@@ -805,18 +858,156 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
     return 0;
 }
 
+/* destination of a scan, shared by its restart intervals */
+typedef struct ScanContext {
+    int nb_components;
+    int Ah, Al;
+    uint8_t *data[MAX_COMPONENTS];
+    const uint8_t *reference_data[MAX_COMPONENTS];
+    int linesize[MAX_COMPONENTS];
+    GetBitContext *mb_bitmask_gb;
+    int start;                  ///< byte position of the scan data in buffer
+    int end;                    ///< bit position after the last interval
+} ScanContext;
+
+static int decode_scan_mcus(MJpegDecodeContext *s, ScanContext *sc,
+                            GetBitContext *gb, int16_t *block, int *last_dc,
+                            int mb_start, int mb_end)
+{
+    int i, mb;
+    int mb_x = mb_start % s->mb_width;
+    int mb_y = mb_start / s->mb_width;
+
+    for (mb = mb_start; mb < mb_end; mb++) {
+        const int copy_mb = sc->mb_bitmask_gb && !get_bits1(sc->mb_bitmask_gb);
+
+        if (get_bits_left(gb) < 0) {
+            av_log(s->avctx, AV_LOG_ERROR, "overread %d\n",
+                   -get_bits_left(gb));
+            return AVERROR_INVALIDDATA;
+        }
+        for (i = 0; i < sc->nb_components; i++) {
+            uint8_t *ptr;
+            int n, h, v, x, y, c, j;
+            int block_offset;
+            n = s->nb_blocks[i];
+            c = s->comp_index[i];
+            h = s->h_scount[i];
+            v = s->v_scount[i];
+            x = 0;
+            y = 0;
+            for (j = 0; j < n; j++) {
+                block_offset = ((sc->linesize[c] * (v * mb_y + y) * 8) +
+                                (h * mb_x + x) * 8);
+
+                if (s->interlaced && s->bottom_field)
+                    block_offset += sc->linesize[c] >> 1;
+                ptr = sc->data[c] + block_offset;
+                if (!s->progressive) {
+                    if (copy_mb)
+                        s->hdsp.put_pixels_tab[1][0](ptr,
+                            sc->reference_data[c] + block_offset,
+                            sc->linesize[c], 8);
+                    else {
+                        s->dsp.clear_block(block);
+                        if (decode_block(s, gb, block, &last_dc[i],
+                                         s->dc_index[i], s->ac_index[i],
+                                         s->quant_matrixes[s->quant_index[c]]) < 0) {
+                            av_log(s->avctx, AV_LOG_ERROR,
+                                   "error y=%d x=%d\n", mb_y, mb_x);
+                            return AVERROR_INVALIDDATA;
+                        }
+                        s->dsp.idct_put(ptr, sc->linesize[c], block);
+                    }
+                } else {
+                    int block_idx  = s->block_stride[c] * (v * mb_y + y) +
+                                     (h * mb_x + x);
+                    int16_t *pblock = s->blocks[c][block_idx];
+                    if (sc->Ah)
+                        pblock[0] += get_bits1(gb) *
+                                     s->quant_matrixes[s->quant_index[c]][0] << sc->Al;
+                    else if (decode_dc_progressive(s, gb, pblock, &last_dc[i],
+                                                   s->dc_index[i],
+                                                   s->quant_matrixes[s->quant_index[c]],
+                                                   sc->Al) < 0) {
+                        av_log(s->avctx, AV_LOG_ERROR,
+                               "error y=%d x=%d\n", mb_y, mb_x);
+                        return AVERROR_INVALIDDATA;
+                    }
+                }
+                av_dlog(s->avctx, "mb: %d %d processed\n", mb_y, mb_x);
+                av_dlog(s->avctx, "%d %d %d %d %d %d %d %d \n",
+                        mb_x, mb_y, x, y, c, s->bottom_field,
+                        (v * mb_y + y) * 8, (h * mb_x + x) * 8);
+                if (++x == h) {
+                    x = 0;
+                    y++;
+                }
+            }
+        }
+
+        if (s->restart_interval) {
+            i = 8 + ((-get_bits_count(gb)) & 7);
+            /* skip RSTn */
+            if (show_bits(gb, i) == (1 << i) - 1) {
+                int pos = get_bits_count(gb);
+                align_get_bits(gb);
+                while (get_bits_left(gb) >= 8 && show_bits(gb, 8) == 0xFF)
+                    skip_bits(gb, 8);
+                if ((get_bits(gb, 8) & 0xF8) == 0xD0) {
+                    for (i = 0; i < sc->nb_components; i++) /* reset dc */
+                        last_dc[i] = 1024;
+                } else
+                    skip_bits_long(gb, pos - get_bits_count(gb));
+            }
+        }
+
+        if (++mb_x == s->mb_width) {
+            mb_x = 0;
+            mb_y++;
+        }
+    }
+    return 0;
+}
+
+/* decode one restart interval, starting right after its restart marker */
+static int decode_restart_interval(AVCodecContext *avctx, void *arg,
+                                   int jobnr, int threadnr)
+{
+    MJpegDecodeContext *s = avctx->priv_data;
+    ScanContext *sc       = arg;
+    int nb_mbs            = s->mb_width * s->mb_height;
+    int mb_start          = jobnr * s->restart_interval;
+    int mb_end            = FFMIN(mb_start + s->restart_interval, nb_mbs);
+    int start             = jobnr ? s->restart_pos[jobnr - 1] : sc->start;
+    int end               = mb_end < nb_mbs ? s->restart_pos[jobnr] - 2
+                                            : s->gb.size_in_bits >> 3;
+    int last_dc[MAX_COMPONENTS];
+    LOCAL_ALIGNED_16(int16_t, block, [64]);
+    GetBitContext gb;
+    int i, ret;
+
+    for (i = 0; i < sc->nb_components; i++)
+        last_dc[i] = 1024;
+    init_get_bits(&gb, s->buffer + start, FFMAX(end - start, 0) * 8);
+    ret = decode_scan_mcus(s, sc, &gb, block, last_dc, mb_start, mb_end);
+    if (mb_end == nb_mbs)
+        sc->end = start * 8 + get_bits_count(&gb);
+    return ret;
+}
+
 static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                              int Al, const uint8_t *mb_bitmask,
                              const AVFrame *reference)
 {
-    int i, mb_x, mb_y;
-    uint8_t *data[MAX_COMPONENTS];
-    const uint8_t *reference_data[MAX_COMPONENTS];
-    int linesize[MAX_COMPONENTS];
+    int i, nb_intervals;
+    ScanContext sc = { 0 };
     GetBitContext mb_bitmask_gb;
 
-    if (mb_bitmask)
+    if (mb_bitmask) {
         init_get_bits(&mb_bitmask_gb, mb_bitmask, s->mb_width * s->mb_height);
+        sc.mb_bitmask_gb = &mb_bitmask_gb;
+    }
 
     if (s->flipped && s->avctx->flags & CODEC_FLAG_EMU_EDGE) {
         av_log(s->avctx, AV_LOG_ERROR,
@@ -824,112 +1015,49 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
         s->flipped = 0;
     }
 
+    sc.nb_components = nb_components;
+    sc.Ah            = Ah;
+    sc.Al            = Al;
     for (i = 0; i < nb_components; i++) {
         int c   = s->comp_index[i];
-        data[c] = s->picture_ptr->data[c];
-        reference_data[c] = reference ? reference->data[c] : NULL;
-        linesize[c] = s->linesize[c];
+        sc.data[c] = s->picture_ptr->data[c];
+        sc.reference_data[c] = reference ? reference->data[c] : NULL;
+        sc.linesize[c] = s->linesize[c];
         s->coefs_finished[c] |= 1;
         if (s->flipped) {
             // picture should be flipped upside-down for this codec
-            int offset = (linesize[c] * (s->v_scount[i] *
+            int offset = (sc.linesize[c] * (s->v_scount[i] *
                          (8 * s->mb_height - ((s->height / s->v_max) & 7)) - 1));
-            data[c]           += offset;
-            reference_data[c] += offset;
-            linesize[c]       *= -1;
+            sc.data[c]           += offset;
+            sc.reference_data[c] += offset;
+            sc.linesize[c]       *= -1;
         }
     }
 
-    for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
-        for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
-            const int copy_mb = mb_bitmask && !get_bits1(&mb_bitmask_gb);
-
-            if (s->restart_interval && !s->restart_count)
-                s->restart_count = s->restart_interval;
-
-            if (get_bits_left(&s->gb) < 0) {
-                av_log(s->avctx, AV_LOG_ERROR, "overread %d\n",
-                       -get_bits_left(&s->gb));
-                return AVERROR_INVALIDDATA;
-            }
-            for (i = 0; i < nb_components; i++) {
-                uint8_t *ptr;
-                int n, h, v, x, y, c, j;
-                int block_offset;
-                n = s->nb_blocks[i];
-                c = s->comp_index[i];
-                h = s->h_scount[i];
-                v = s->v_scount[i];
-                x = 0;
-                y = 0;
-                for (j = 0; j < n; j++) {
-                    block_offset = ((linesize[c] * (v * mb_y + y) * 8) +
-                                    (h * mb_x + x) * 8);
-
-                    if (s->interlaced && s->bottom_field)
-                        block_offset += linesize[c] >> 1;
-                    ptr = data[c] + block_offset;
-                    if (!s->progressive) {
-                        if (copy_mb)
-                            s->hdsp.put_pixels_tab[1][0](ptr,
-                                reference_data[c] + block_offset,
-                                linesize[c], 8);
-                        else {
-                            s->dsp.clear_block(s->block);
-                            if (decode_block(s, s->block, i,
-                                             s->dc_index[i], s->ac_index[i],
-                                             s->quant_matrixes[s->quant_index[c]]) < 0) {
-                                av_log(s->avctx, AV_LOG_ERROR,
-                                       "error y=%d x=%d\n", mb_y, mb_x);
-                                return AVERROR_INVALIDDATA;
-                            }
-                            s->dsp.idct_put(ptr, linesize[c], s->block);
-                        }
-                    } else {
-                        int block_idx  = s->block_stride[c] * (v * mb_y + y) +
-                                         (h * mb_x + x);
-                        int16_t *block = s->blocks[c][block_idx];
-                        if (Ah)
-                            block[0] += get_bits1(&s->gb) *
-                                        s->quant_matrixes[s->quant_index[c]][0] << Al;
-                        else if (decode_dc_progressive(s, block, i, s->dc_index[i],
-                                                       s->quant_matrixes[s->quant_index[c]],
-                                                       Al) < 0) {
-                            av_log(s->avctx, AV_LOG_ERROR,
-                                   "error y=%d x=%d\n", mb_y, mb_x);
-                            return AVERROR_INVALIDDATA;
-                        }
-                    }
-                    av_dlog(s->avctx, "mb: %d %d processed\n", mb_y, mb_x);
-                    av_dlog(s->avctx, "%d %d %d %d %d %d %d %d \n",
-                            mb_x, mb_y, x, y, c, s->bottom_field,
-                            (v * mb_y + y) * 8, (h * mb_x + x) * 8);
-                    if (++x == h) {
-                        x = 0;
-                        y++;
-                    }
-                }
-            }
-
-            if (s->restart_interval) {
-                s->restart_count--;
-                i = 8 + ((-get_bits_count(&s->gb)) & 7);
-                /* skip RSTn */
-                if (show_bits(&s->gb, i) == (1 << i) - 1) {
-                    int pos = get_bits_count(&s->gb);
-                    align_get_bits(&s->gb);
-                    while (get_bits_left(&s->gb) >= 8 && show_bits(&s->gb, 8) == 0xFF)
-                        skip_bits(&s->gb, 8);
-                    if ((get_bits(&s->gb, 8) & 0xF8) == 0xD0) {
-                        for (i = 0; i < nb_components; i++) /* reset dc */
-                            s->last_dc[i] = 1024;
-                    } else
-                        skip_bits_long(&s->gb, pos - get_bits_count(&s->gb));
-                }
-            }
-        }
+    /* The restart intervals are decoded in parallel when the positions of
+     * all their markers are known. */
+    nb_intervals = s->restart_interval ?
+                   (s->mb_width * s->mb_height + s->restart_interval - 1) /
+                   s->restart_interval : 0;
+    if (s->avctx->active_thread_type & FF_THREAD_SLICE &&
+        !s->progressive && !mb_bitmask && nb_intervals > 1 &&
+        s->nb_restart_pos == nb_intervals - 1) {
+        av_fast_malloc(&s->restart_ret, &s->restart_ret_size,
+                       nb_intervals * sizeof(*s->restart_ret));
+        if (!s->restart_ret)
+            return AVERROR(ENOMEM);
+        sc.start = get_bits_count(&s->gb) >> 3;
+        s->avctx->execute2(s->avctx, decode_restart_interval, &sc,
+                           s->restart_ret, nb_intervals);
+        skip_bits_long(&s->gb, sc.end - get_bits_count(&s->gb));
+        for (i = 0; i < nb_intervals; i++)
+            if (s->restart_ret[i] < 0)
+                return s->restart_ret[i];
+        return 0;
     }
-    return 0;
+
+    return decode_scan_mcus(s, &sc, &s->gb, s->block, s->last_dc,
+                            0, s->mb_width * s->mb_height);
 }
 
 static int mjpeg_decode_scan_progressive_ac(MJpegDecodeContext *s, int ss,
@@ -1383,7 +1511,10 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
     if (start_code == SOS && !s->ls) {
         const uint8_t *src = *buf_ptr;
         uint8_t *dst = s->buffer;
+        /* the restart intervals can only be found before unescaping */
+        int find_restart = !!(s->avctx->active_thread_type & FF_THREAD_SLICE);
 
+        s->nb_restart_pos = 0;
         while (src < buf_end) {
             uint8_t x = *(src++);
 
@@ -1393,9 +1524,23 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                     while (src < buf_end && x == 0xff)
                         x = *(src++);
 
-                    if (x >= 0xd0 && x <= 0xd7)
+                    if (x >= 0xd0 && x <= 0xd7) {
                         *(dst++) = x;
-                    else if (x)
+                        if (find_restart) {
+                            int *pos = av_fast_realloc(s->restart_pos,
+                                                       &s->restart_pos_size,
+                                                       (s->nb_restart_pos + 1) *
+                                                       sizeof(*s->restart_pos));
+                            if (pos) {
+                                s->restart_pos = pos;
+                                s->restart_pos[s->nb_restart_pos++] =
+                                    dst - s->buffer;
+                            } else {
+                                /* decode the scan serially */
+                                s->nb_restart_pos = find_restart = 0;
+                            }
+                        }
+                    } else if (x)
                         break;
                 }
             }
@@ -1653,6 +1798,8 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
         av_frame_unref(s->picture_ptr);
 
     av_free(s->buffer);
+    av_freep(&s->restart_pos);
+    av_freep(&s->restart_ret);
     av_freep(&s->ljpeg_buffer);
     s->ljpeg_buffer_size = 0;
 
@@ -1690,7 +1837,7 @@ AVCodec ff_mjpeg_decoder = {
     .init           = ff_mjpeg_decode_init,
     .close          = ff_mjpeg_decode_end,
     .decode         = ff_mjpeg_decode_frame,
-    .capabilities   = CODEC_CAP_DR1,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_SLICE_THREADS,
     .long_name      = NULL_IF_CONFIG_SMALL("MJPEG (Motion JPEG)"),
     .priv_class     = &mjpegdec_class,
 };
@@ -38,6 +38,9 @@
 
 #define MAX_COMPONENTS 4
 
+/* number of bits looked up at once when decoding AC coefficients */
+#define FAST_AC_BITS 9
+
 typedef struct MJpegDecodeContext {
     AVClass *class;
     AVCodecContext *avctx;
@@ -49,6 +52,11 @@ typedef struct MJpegDecodeContext {
 
     int16_t quant_matrixes[4][64];
     VLC vlcs[3][4];
+    /**
+     * run, level and total length of the AC codes and coefficients fitting
+     * in FAST_AC_BITS bits, indexed by these bits; 0 if they do not fit
+     */
+    int16_t fast_ac[4][1 << FAST_AC_BITS];
     int qscale[4];      ///< quantizer scale calculated from quant_matrixes
 
     int org_height;  /* size given at codec init */
@@ -99,6 +107,11 @@ typedef struct MJpegDecodeContext {
 
     int restart_interval;
     int restart_count;
+    int *restart_pos;   ///< position in buffer after each restart marker of the scan
+    unsigned int restart_pos_size;
+    int nb_restart_pos;
+    int *restart_ret;   ///< return values of the slice threads, one per interval
+    unsigned int restart_ret_size;
 
     int buggy_avid;
     int cs_itu601;
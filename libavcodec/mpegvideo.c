@@ -652,6 +652,7 @@ int ff_mpeg_update_thread_context(AVCodecContext *dst,
         s->avctx                 = dst;
         s->bitstream_buffer      = NULL;
         s->bitstream_buffer_size = s->allocated_bitstream_buffer_size = 0;
+        s->thread_context        = NULL;
 
         ff_MPV_common_init(s);
     }
@@ -999,12 +1000,12 @@ av_cold int ff_MPV_common_init(MpegEncContext *s)
         return -1;
     }
 
-    if (nb_slices > MAX_THREADS || (nb_slices > s->mb_height && s->mb_height)) {
+    if (nb_slices > MAX_SLICE_CONTEXTS || (nb_slices > s->mb_height && s->mb_height)) {
         int max_slices;
         if (s->mb_height)
-            max_slices = FFMIN(MAX_THREADS, s->mb_height);
+            max_slices = FFMIN(MAX_SLICE_CONTEXTS, s->mb_height);
         else
-            max_slices = MAX_THREADS;
+            max_slices = MAX_SLICE_CONTEXTS;
         av_log(s->avctx, AV_LOG_WARNING, "too many threads/slices (%d),"
                " reducing to %d\n", nb_slices, max_slices);
         nb_slices = max_slices;
@@ -1079,6 +1080,9 @@ av_cold int ff_MPV_common_init(MpegEncContext *s)
         s->parse_context.state = -1;
     }
 
+    FF_ALLOCZ_OR_GOTO(s->avctx, s->thread_context,
+                      nb_slices * sizeof(*s->thread_context), fail);
+
     s->context_initialized = 1;
     s->thread_context[0]   = s;
 
@@ -1253,6 +1257,7 @@ void ff_MPV_common_end(MpegEncContext *s)
         }
         s->slice_context_count = 1;
     } else free_duplicate_context(s);
+    av_freep(&s->thread_context);
 
     av_freep(&s->parse_context.buffer);
     s->parse_context.buffer_size = 0;
@@ -62,6 +62,9 @@ enum OutputFormat {
 
 #define MAX_THREADS 16
 
+/* slice contexts are allocated at runtime, this only bounds their number */
+#define MAX_SLICE_CONTEXTS 128
+
 #define MAX_PICTURE_COUNT 32
 
 #define ME_MAP_SIZE 64
@@ -310,7 +313,7 @@ typedef struct MpegEncContext {
 
     int start_mb_y;            ///< start mb_y of this thread (so current thread should process start_mb_y <= row < end_mb_y)
     int end_mb_y;              ///< end   mb_y of this thread (so current thread should process start_mb_y <= row < end_mb_y)
-    struct MpegEncContext *thread_context[MAX_THREADS];
+    struct MpegEncContext **thread_context; ///< slice contexts, allocated by ff_MPV_common_init()
     int slice_context_count;   ///< number of used thread_contexts
 
     /**
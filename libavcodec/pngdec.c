@@ -24,6 +24,7 @@
 #include "internal.h"
 #include "png.h"
 #include "pngdsp.h"
+#include "thread.h"
 
 /* TODO:
  * - add 2, 4 and 16 bit depth support
@@ -35,7 +36,8 @@ typedef struct PNGDecContext {
     PNGDSPContext dsp;
 
     GetByteContext gb;
-    AVFrame *prev;
+    ThreadFrame last_picture;
+    ThreadFrame picture;
 
     int state;
     int width, height;
@@ -50,6 +52,7 @@ typedef struct PNGDecContext {
 
     uint8_t *image_buf;
     int image_linesize;
+    int direct; /* rows are inflated in place into the image */
     uint32_t palette[256];
     uint8_t *crow_buf;
     uint8_t *last_row;
@@ -187,7 +190,8 @@ void ff_add_png_paeth_prediction(uint8_t *dst, uint8_t *src, uint8_t *top, int w
         }\
     }
 
-/* NOTE: 'dst' can be equal to 'last' */
+/* NOTE: 'dst' can be equal to 'last', and to 'src' unless the filter is
+ * paeth with a bpp other than 4 */
 static void png_filter_row(PNGDSPContext *dsp, uint8_t *dst, int filter_type,
                            uint8_t *src, uint8_t *last, int size, int bpp)
 {
@@ -195,7 +199,8 @@ static void png_filter_row(PNGDSPContext *dsp, uint8_t *dst, int filter_type,
 
     switch (filter_type) {
     case PNG_FILTER_VALUE_NONE:
-        memcpy(dst, src, size);
+        if (dst != src)
+            memcpy(dst, src, size);
         break;
     case PNG_FILTER_VALUE_SUB:
         for (i = 0; i < bpp; i++) {
@@ -221,8 +226,20 @@ static void png_filter_row(PNGDSPContext *dsp, uint8_t *dst, int filter_type,
             p = (last[i] >> 1);
             dst[i] = p + src[i];
         }
+        if (bpp == 4) {
+            unsigned x = *(unsigned *)dst;
+            for (; i < size; i += bpp) {
+                unsigned s = *(unsigned *)(src + i);
+                unsigned l = *(unsigned *)(last + i);
+                /* bytewise (x + l) >> 1 and x + s without carries */
+                x = (x & l) + (((x ^ l) & 0xfefefefe) >> 1);
+                x = ((x & 0x7f7f7f7f) + (s & 0x7f7f7f7f)) ^ ((x ^ s) & 0x80808080);
+                *(unsigned *)(dst + i) = x;
+            }
+        } else {
 #define OP_AVG(x,s,l) (((x + l) >> 1) + s) & 0xff
-        UNROLL_FILTER(OP_AVG);
+            UNROLL_FILTER(OP_AVG);
+        }
         break;
     case PNG_FILTER_VALUE_PAETH:
         for (i = 0; i < bpp; i++) {
@@ -301,7 +318,10 @@ static void png_handle_row(PNGDecContext *s)
             else
                 last_row = ptr - s->image_linesize;
 
-            png_filter_row(&s->dsp, ptr, s->crow_buf[0], s->crow_buf + 1,
+            /* the row may have been inflated in place */
+            png_filter_row(&s->dsp, ptr, s->crow_buf[0],
+                           s->zstream.next_out == ptr + s->row_size ?
+                           ptr : s->crow_buf + 1,
                            last_row, s->row_size, s->bpp);
         }
         /* loco lags by 1 row so that it doesn't interfere with top prediction */
@@ -358,6 +378,18 @@ static void png_handle_row(PNGDecContext *s)
     }
 }
 
+/* set up the output of the next row, either the whole compressed row or
+ * only its filter type if the row itself can be inflated into the image */
+static void png_next_row(PNGDecContext *s)
+{
+    if (s->direct && !(s->state & PNG_ALLIMAGE)) {
+        s->zstream.avail_out = 1;
+    } else {
+        s->zstream.avail_out = s->crow_size;
+    }
+    s->zstream.next_out = s->crow_buf;
+}
+
 static int png_decode_idat(PNGDecContext *s, int length)
 {
     int ret;
@@ -372,11 +404,24 @@ static int png_decode_idat(PNGDecContext *s, int length)
             return -1;
         }
         if (s->zstream.avail_out == 0) {
+            if (s->zstream.next_out == s->crow_buf + 1 &&
+                s->direct && !(s->state & PNG_ALLIMAGE)) {
+                /* the filter type was read, the paeth dsp functions may
+                 * write ahead of the current pixel so such rows can only be
+                 * undone in place with a bpp of 4 */
+                if (s->crow_buf[0] != PNG_FILTER_VALUE_PAETH || s->bpp == 4) {
+                    s->zstream.next_out  = s->image_buf +
+                                           s->image_linesize * s->y;
+                    s->zstream.avail_out = s->row_size;
+                } else {
+                    s->zstream.avail_out = s->row_size;
+                }
+                continue;
+            }
             if (!(s->state & PNG_ALLIMAGE)) {
                 png_handle_row(s);
             }
-            s->zstream.avail_out = s->crow_size;
-            s->zstream.next_out  = s->crow_buf;
+            png_next_row(s);
         }
     }
     return 0;
@@ -389,7 +434,7 @@ static int decode_frame(AVCodecContext *avctx,
     PNGDecContext * const s = avctx->priv_data;
     const uint8_t *buf      = avpkt->data;
     int buf_size            = avpkt->size;
-    AVFrame *p              = data;
+    AVFrame *p;
     uint8_t *crow_buf_base  = NULL;
     uint32_t tag, length;
     int ret;
@@ -400,6 +445,10 @@ static int decode_frame(AVCodecContext *avctx,
         memcmp(buf, ff_mngsig, 8) != 0)
         return -1;
 
+    ff_thread_release_buffer(avctx, &s->last_picture);
+    FFSWAP(ThreadFrame, s->picture, s->last_picture);
+    p = s->picture.f;
+
     bytestream2_init(&s->gb, buf + 8, buf_size - 8);
     s->y = s->state = 0;
 
@@ -485,7 +534,8 @@ static int decode_frame(AVCodecContext *avctx,
                     goto fail;
                 }
 
-                if (ff_get_buffer(avctx, p, AV_GET_BUFFER_FLAG_REF) < 0) {
+                if (ff_thread_get_buffer(avctx, &s->picture,
+                                         AV_GET_BUFFER_FLAG_REF) < 0) {
                     av_log(avctx, AV_LOG_ERROR, "get_buffer() failed\n");
                     goto fail;
                 }
@@ -493,6 +543,8 @@ static int decode_frame(AVCodecContext *avctx,
                 p->key_frame        = 1;
                 p->interlaced_frame = !!s->interlace_type;
 
+                ff_thread_finish_setup(avctx);
+
                 /* compute the compressed row size */
                 if (!s->interlace_type) {
                     s->crow_size = s->row_size + 1;
@@ -526,9 +578,12 @@ static int decode_frame(AVCodecContext *avctx,
                     goto fail;
 
                 /* we want crow_buf+1 to be 16-byte aligned */
-                s->crow_buf          = crow_buf_base + 15;
-                s->zstream.avail_out = s->crow_size;
-                s->zstream.next_out  = s->crow_buf;
+                s->crow_buf = crow_buf_base + 15;
+                /* the filters are undone in the image, except where the
+                 * pixels are rearranged */
+                s->direct   = !s->interlace_type &&
+                              s->color_type != PNG_COLOR_TYPE_RGB_ALPHA;
+                png_next_row(s);
             }
             s->state |= PNG_IDAT;
             if (png_decode_idat(s, length) < 0)
@@ -586,11 +641,13 @@ static int decode_frame(AVCodecContext *avctx,
     }
  exit_loop:
      /* handle p-frames only if a predecessor frame is available */
-     if (s->prev->data[0]) {
+     if (s->last_picture.f->data[0]) {
          if (!(avpkt->flags & AV_PKT_FLAG_KEY)) {
             int i, j;
             uint8_t *pd      = p->data[0];
-            uint8_t *pd_last = s->prev->data[0];
+            uint8_t *pd_last = s->last_picture.f->data[0];
+
+            ff_thread_await_progress(&s->last_picture, INT_MAX, 0);
 
             for (j = 0; j < s->height; j++) {
                 for (i = 0; i < s->width * s->bpp; i++) {
@@ -602,14 +659,14 @@ static int decode_frame(AVCodecContext *avctx,
         }
     }
 
-     av_frame_unref(s->prev);
-     if ((ret = av_frame_ref(s->prev, p)) < 0)
-         goto fail;
+    if ((ret = av_frame_ref(data, p)) < 0)
+        goto the_end;
 
     *got_frame = 1;
 
     ret = bytestream2_tell(&s->gb);
  the_end:
+    ff_thread_report_progress(&s->picture, INT_MAX, 0);
     inflateEnd(&s->zstream);
     av_free(crow_buf_base);
     s->crow_buf = NULL;
@@ -621,24 +678,58 @@ static int decode_frame(AVCodecContext *avctx,
     goto the_end;
 }
 
-static av_cold int png_dec_init(AVCodecContext *avctx)
+static av_cold int png_dec_end(AVCodecContext *avctx)
 {
     PNGDecContext *s = avctx->priv_data;
 
-    s->prev = av_frame_alloc();
-    if (!s->prev)
-        return AVERROR(ENOMEM);
+    ff_thread_release_buffer(avctx, &s->last_picture);
+    av_frame_free(&s->last_picture.f);
+    ff_thread_release_buffer(avctx, &s->picture);
+    av_frame_free(&s->picture.f);
 
-    ff_pngdsp_init(&s->dsp);
+    return 0;
+}
+
+static av_cold int png_dec_init_frames(AVCodecContext *avctx)
+{
+    PNGDecContext *s = avctx->priv_data;
+
+    s->last_picture.f = av_frame_alloc();
+    s->picture.f      = av_frame_alloc();
+    if (!s->last_picture.f || !s->picture.f) {
+        png_dec_end(avctx);
+        return AVERROR(ENOMEM);
+    }
 
     return 0;
 }
 
-static av_cold int png_dec_end(AVCodecContext *avctx)
+static av_cold int png_dec_init(AVCodecContext *avctx)
 {
     PNGDecContext *s = avctx->priv_data;
 
-    av_frame_free(&s->prev);
+    ff_pngdsp_init(&s->dsp);
+    avctx->internal->allocate_progress = 1;
+
+    return png_dec_init_frames(avctx);
+}
+
+static int update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
+{
+    PNGDecContext *pdst = dst->priv_data;
+    PNGDecContext *psrc = src->priv_data;
+    int ret;
+
+    if (dst == src)
+        return 0;
+
+    /* the palette may be carried over to the following images */
+    memcpy(pdst->palette, psrc->palette, sizeof(pdst->palette));
+
+    ff_thread_release_buffer(dst, &pdst->picture);
+    if (psrc->picture.f->data[0] &&
+        (ret = ff_thread_ref_frame(&pdst->picture, &psrc->picture)) < 0)
+        return ret;
 
     return 0;
 }
@@ -651,6 +742,8 @@ AVCodec ff_png_decoder = {
     .init           = png_dec_init,
     .close          = png_dec_end,
     .decode         = decode_frame,
-    .capabilities   = CODEC_CAP_DR1 /*| CODEC_CAP_DRAW_HORIZ_BAND*/,
+    .init_thread_copy      = ONLY_IF_THREADS_ENABLED(png_dec_init_frames),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(update_thread_context),
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS /*| CODEC_CAP_DRAW_HORIZ_BAND*/,
     .long_name      = NULL_IF_CONFIG_SMALL("PNG (Portable Network Graphics) image"),
 };
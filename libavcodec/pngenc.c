@@ -31,6 +31,19 @@
 
 #define IOBUF_SIZE 4096
 
+/* minimum amount of filtered rows deflated by each thread, so that the
+ * cost of splitting the stream is negligible */
+#define MIN_BAND_SIZE (128 << 10)
+
+/** rows filtered and deflated by one thread */
+typedef struct PNGBand {
+    int y_start, y_end;
+    uint8_t *buf;               ///< zlib header room and deflated rows
+    unsigned int buf_size;
+    int len;                    ///< size of the deflated rows
+    uLong adler;                ///< checksum of the filtered rows
+} PNGBand;
+
 typedef struct PNGEncContext {
     DSPContext dsp;
 
@@ -40,9 +53,18 @@ typedef struct PNGEncContext {
     AVFrame picture;
 
     int filter_type;
+    int color_type;
+    int bits_per_pixel;
+    int row_size;
+    int compression_level;
 
     z_stream zstream;
     uint8_t buf[IOBUF_SIZE];
+
+    PNGBand *bands;
+    int nb_bands;               ///< number of allocated bands
+    uint8_t *filter_buf;        ///< filtered rows, preceded by their filter type
+    unsigned int filter_buf_size;
 } PNGEncContext;
 
 static void png_get_interlaced_row(uint8_t *dst, int row_size,
@@ -227,6 +249,188 @@ static int png_write_row(PNGEncContext *s, const uint8_t *data, int size)
     return 0;
 }
 
+static int filter_band(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    PNGEncContext *s = avctx->priv_data;
+    PNGBand *band    = &s->bands[jobnr];
+    AVFrame *p       = &s->picture;
+    int row_size     = s->row_size;
+    int is_rgba      = s->color_type == PNG_COLOR_TYPE_RGB_ALPHA;
+    uint8_t *crow_base, *rgba_base = NULL, *rgba_buf = NULL, *top_buf = NULL;
+    uint8_t *ptr, *top = NULL, *crow;
+    int y;
+
+    crow_base = av_malloc((row_size + 32) << (s->filter_type == PNG_FILTER_VALUE_MIXED));
+    if (is_rgba) {
+        /* the sub filter reads before the start of the row */
+        rgba_base = av_malloc(2 * (row_size + 16));
+        rgba_buf  = rgba_base + 16;
+        top_buf   = rgba_buf + row_size + 16;
+    }
+    if (!crow_base || is_rgba && !rgba_base) {
+        av_free(crow_base);
+        av_free(rgba_base);
+        return AVERROR(ENOMEM);
+    }
+
+    if (band->y_start) {
+        top = p->data[0] + (band->y_start - 1) * p->linesize[0];
+        if (is_rgba) {
+            convert_from_rgb32(rgba_buf, top, avctx->width);
+            top = rgba_buf;
+        }
+    }
+    for (y = band->y_start; y < band->y_end; y++) {
+        ptr = p->data[0] + y * p->linesize[0];
+        if (is_rgba) {
+            FFSWAP(uint8_t*, rgba_buf, top_buf);
+            convert_from_rgb32(rgba_buf, ptr, avctx->width);
+            ptr = rgba_buf;
+        }
+        crow = png_choose_filter(s, crow_base + 15, ptr, top, row_size,
+                                 s->bits_per_pixel >> 3);
+        memcpy(s->filter_buf + y * (row_size + 1), crow, row_size + 1);
+        top = ptr;
+    }
+
+    av_free(crow_base);
+    av_free(rgba_base);
+    return 0;
+}
+
+static int deflate_band(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    PNGEncContext *s = avctx->priv_data;
+    PNGBand *band    = &s->bands[jobnr];
+    int stride       = s->row_size + 1;
+    uint8_t *src     = s->filter_buf + band->y_start * stride;
+    int size         = (band->y_end - band->y_start) * stride;
+    int last         = band->y_end == avctx->height;
+    z_stream zstream;
+    int ret;
+
+    zstream.zalloc = ff_png_zalloc;
+    zstream.zfree  = ff_png_zfree;
+    zstream.opaque = NULL;
+    if (deflateInit2(&zstream, s->compression_level,
+                     Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return -1;
+    /* start with the window the serial compression would have at this
+     * point, so that matches can reach into the previous band */
+    if (band->y_start) {
+        int dict_size = FFMIN(band->y_start * stride, 1 << 15);
+        deflateSetDictionary(&zstream, src - dict_size, dict_size);
+    }
+
+    /* room for the zlib header, the empty block ending the band and the
+     * checksum */
+    av_fast_malloc(&band->buf, &band->buf_size,
+                   deflateBound(&zstream, size) + 2 + 5 + 4);
+    if (!band->buf) {
+        deflateEnd(&zstream);
+        return AVERROR(ENOMEM);
+    }
+    zstream.next_in   = src;
+    zstream.avail_in  = size;
+    zstream.next_out  = band->buf + 2;
+    zstream.avail_out = band->buf_size - 2 - 4;
+    /* all but the last band end on a byte boundary without a final block */
+    ret = deflate(&zstream, last ? Z_FINISH : Z_SYNC_FLUSH);
+    band->len = zstream.next_out - band->buf - 2;
+    deflateEnd(&zstream);
+    if (ret != (last ? Z_STREAM_END : Z_OK) || zstream.avail_in)
+        return -1;
+
+    band->adler = adler32(adler32(0, NULL, 0), src, size);
+    return 0;
+}
+
+/**
+ * Filter and deflate bands of rows in parallel and write them as a single
+ * zlib stream.
+ */
+static int png_write_bands(AVCodecContext *avctx, int nb_bands)
+{
+    PNGEncContext *s = avctx->priv_data;
+    int stride       = s->row_size + 1;
+    int band_height  = (avctx->height + nb_bands - 1) / nb_bands;
+    int level = s->compression_level < 0 ? 6 : s->compression_level;
+    int *rets, level_flags, ret, i;
+    uLong adler;
+
+    nb_bands = (avctx->height + band_height - 1) / band_height;
+    if (nb_bands > s->nb_bands) {
+        PNGBand *tmp = av_realloc(s->bands, nb_bands * sizeof(*tmp));
+        if (!tmp)
+            return AVERROR(ENOMEM);
+        memset(tmp + s->nb_bands, 0, (nb_bands - s->nb_bands) * sizeof(*tmp));
+        s->bands    = tmp;
+        s->nb_bands = nb_bands;
+    }
+    for (i = 0; i < nb_bands; i++) {
+        s->bands[i].y_start = i * band_height;
+        s->bands[i].y_end   = FFMIN((i + 1) * band_height, avctx->height);
+    }
+    av_fast_malloc(&s->filter_buf, &s->filter_buf_size,
+                   avctx->height * stride);
+    if (!s->filter_buf)
+        return AVERROR(ENOMEM);
+
+    rets = av_malloc(nb_bands * sizeof(*rets));
+    if (!rets)
+        return AVERROR(ENOMEM);
+    /* the filters of the first row of a band only read the source rows,
+     * but the dictionary of a band is the end of the previous one */
+    avctx->execute2(avctx, filter_band, NULL, rets, nb_bands);
+    for (i = 0; i < nb_bands && rets[i] >= 0; i++)
+        ;
+    if (i == nb_bands) {
+        avctx->execute2(avctx, deflate_band, NULL, rets, nb_bands);
+        for (i = 0; i < nb_bands && rets[i] >= 0; i++)
+            ;
+    }
+    ret = i < nb_bands ? rets[i] : 0;
+    av_free(rets);
+    if (ret < 0)
+        return ret;
+
+    /* zlib header, as deflateInit() would write it */
+    if (level < 2)
+        level_flags = 0;
+    else if (level < 6)
+        level_flags = 1;
+    else if (level == 6)
+        level_flags = 2;
+    else
+        level_flags = 3;
+    s->bands[0].buf[0] = 0x78;
+    s->bands[0].buf[1] = level_flags << 6;
+    s->bands[0].buf[1] += 31 - AV_RB16(s->bands[0].buf) % 31;
+
+    adler = s->bands[0].adler;
+    for (i = 1; i < nb_bands; i++)
+        adler = adler32_combine(adler, s->bands[i].adler,
+                                (s->bands[i].y_end - s->bands[i].y_start) * stride);
+    AV_WB32(s->bands[nb_bands - 1].buf + 2 + s->bands[nb_bands - 1].len, adler);
+
+    for (i = 0; i < nb_bands; i++) {
+        PNGBand *band = &s->bands[i];
+        uint8_t *data = band->buf + 2;
+        int len       = band->len;
+
+        if (!i) {
+            data -= 2;
+            len  += 2;
+        }
+        if (i == nb_bands - 1)
+            len += 4;
+        if (s->bytestream_end - s->bytestream < len + 12)
+            return AVERROR(EINVAL);
+        png_write_chunk(&s->bytestream, MKTAG('I', 'D', 'A', 'T'), data, len);
+    }
+    return 0;
+}
+
 static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                         const AVFrame *pict, int *got_packet)
 {
@@ -234,7 +438,7 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     AVFrame * const p= &s->picture;
     int bit_depth, color_type, y, len, row_size, ret, is_progressive;
     int bits_per_pixel, pass_row_size, enc_row_size, max_packet_size;
-    int compression_level;
+    int compression_level, nb_bands;
     uint8_t *ptr, *top;
     uint8_t *crow_base = NULL, *crow_buf, *crow;
     uint8_t *progressive_buf = NULL;
@@ -276,6 +480,9 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     }
     bits_per_pixel = ff_png_get_nb_channels(color_type) * bit_depth;
     row_size = (avctx->width * bits_per_pixel + 7) >> 3;
+    s->color_type     = color_type;
+    s->bits_per_pixel = bits_per_pixel;
+    s->row_size       = row_size;
 
     s->zstream.zalloc = ff_png_zalloc;
     s->zstream.zfree = ff_png_zfree;
@@ -283,6 +490,7 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     compression_level = avctx->compression_level == FF_COMPRESSION_DEFAULT ?
                             Z_DEFAULT_COMPRESSION :
                             av_clip(avctx->compression_level, 0, 9);
+    s->compression_level = compression_level;
     ret = deflateInit2(&s->zstream, compression_level,
                        Z_DEFLATED, 15, 8, Z_DEFAULT_STRATEGY);
     if (ret != Z_OK)
@@ -362,64 +570,75 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
         }
     }
 
-    /* now put each row */
-    s->zstream.avail_out = IOBUF_SIZE;
-    s->zstream.next_out = s->buf;
-    if (is_progressive) {
-        int pass;
-
-        for(pass = 0; pass < NB_PASSES; pass++) {
-            /* NOTE: a pass is completely omitted if no pixels would be
-               output */
-            pass_row_size = ff_png_pass_row_size(pass, bits_per_pixel, avctx->width);
-            if (pass_row_size > 0) {
-                top = NULL;
-                for(y = 0; y < avctx->height; y++) {
-                    if ((ff_png_pass_ymask[pass] << (y & 7)) & 0x80) {
-                        ptr = p->data[0] + y * p->linesize[0];
-                        FFSWAP(uint8_t*, progressive_buf, top_buf);
-                        if (color_type == PNG_COLOR_TYPE_RGB_ALPHA) {
-                            convert_from_rgb32(rgba_buf, ptr, avctx->width);
-                            ptr = rgba_buf;
+    /* with threads, bands of rows large enough are compressed in
+     * parallel */
+    nb_bands = 1;
+    if (avctx->active_thread_type & FF_THREAD_SLICE && !is_progressive)
+        nb_bands = FFMIN(avctx->thread_count,
+                         avctx->height * (row_size + 1LL) / MIN_BAND_SIZE);
+    if (nb_bands > 1) {
+        if ((ret = png_write_bands(avctx, nb_bands)) < 0)
+            goto the_end;
+    } else {
+        /* now put each row */
+        s->zstream.avail_out = IOBUF_SIZE;
+        s->zstream.next_out = s->buf;
+        if (is_progressive) {
+            int pass;
+
+            for(pass = 0; pass < NB_PASSES; pass++) {
+                /* NOTE: a pass is completely omitted if no pixels would be
+                   output */
+                pass_row_size = ff_png_pass_row_size(pass, bits_per_pixel, avctx->width);
+                if (pass_row_size > 0) {
+                    top = NULL;
+                    for(y = 0; y < avctx->height; y++) {
+                        if ((ff_png_pass_ymask[pass] << (y & 7)) & 0x80) {
+                            ptr = p->data[0] + y * p->linesize[0];
+                            FFSWAP(uint8_t*, progressive_buf, top_buf);
+                            if (color_type == PNG_COLOR_TYPE_RGB_ALPHA) {
+                                convert_from_rgb32(rgba_buf, ptr, avctx->width);
+                                ptr = rgba_buf;
+                            }
+                            png_get_interlaced_row(progressive_buf, pass_row_size,
+                                                   bits_per_pixel, pass,
+                                                   ptr, avctx->width);
+                            crow = png_choose_filter(s, crow_buf, progressive_buf, top, pass_row_size, bits_per_pixel>>3);
+                            png_write_row(s, crow, pass_row_size + 1);
+                            top = progressive_buf;
                         }
-                        png_get_interlaced_row(progressive_buf, pass_row_size,
-                                               bits_per_pixel, pass,
-                                               ptr, avctx->width);
-                        crow = png_choose_filter(s, crow_buf, progressive_buf, top, pass_row_size, bits_per_pixel>>3);
-                        png_write_row(s, crow, pass_row_size + 1);
-                        top = progressive_buf;
                     }
                 }
             }
-        }
-    } else {
-        top = NULL;
-        for(y = 0; y < avctx->height; y++) {
-            ptr = p->data[0] + y * p->linesize[0];
-            if (color_type == PNG_COLOR_TYPE_RGB_ALPHA) {
-                FFSWAP(uint8_t*, rgba_buf, top_buf);
-                convert_from_rgb32(rgba_buf, ptr, avctx->width);
-                ptr = rgba_buf;
+        } else {
+            top = NULL;
+            for(y = 0; y < avctx->height; y++) {
+                ptr = p->data[0] + y * p->linesize[0];
+                if (color_type == PNG_COLOR_TYPE_RGB_ALPHA) {
+                    FFSWAP(uint8_t*, rgba_buf, top_buf);
+                    convert_from_rgb32(rgba_buf, ptr, avctx->width);
+                    ptr = rgba_buf;
+                }
+                crow = png_choose_filter(s, crow_buf, ptr, top, row_size, bits_per_pixel>>3);
+                png_write_row(s, crow, row_size + 1);
+                top = ptr;
             }
-            crow = png_choose_filter(s, crow_buf, ptr, top, row_size, bits_per_pixel>>3);
-            png_write_row(s, crow, row_size + 1);
-            top = ptr;
         }
-    }
-    /* compress last bytes */
-    for(;;) {
-        ret = deflate(&s->zstream, Z_FINISH);
-        if (ret == Z_OK || ret == Z_STREAM_END) {
-            len = IOBUF_SIZE - s->zstream.avail_out;
-            if (len > 0 && s->bytestream_end - s->bytestream > len + 100) {
-                png_write_chunk(&s->bytestream, MKTAG('I', 'D', 'A', 'T'), s->buf, len);
+        /* compress last bytes */
+        for(;;) {
+            ret = deflate(&s->zstream, Z_FINISH);
+            if (ret == Z_OK || ret == Z_STREAM_END) {
+                len = IOBUF_SIZE - s->zstream.avail_out;
+                if (len > 0 && s->bytestream_end - s->bytestream > len + 100) {
+                    png_write_chunk(&s->bytestream, MKTAG('I', 'D', 'A', 'T'), s->buf, len);
+                }
+                s->zstream.avail_out = IOBUF_SIZE;
+                s->zstream.next_out = s->buf;
+                if (ret == Z_STREAM_END)
+                    break;
+            } else {
+                goto fail;
             }
-            s->zstream.avail_out = IOBUF_SIZE;
-            s->zstream.next_out = s->buf;
-            if (ret == Z_STREAM_END)
-                break;
-        } else {
-            goto fail;
         }
     }
     png_write_chunk(&s->bytestream, MKTAG('I', 'E', 'N', 'D'), NULL, 0);
@@ -455,13 +674,29 @@ static av_cold int png_enc_init(AVCodecContext *avctx){
     return 0;
 }
 
+static av_cold int png_enc_close(AVCodecContext *avctx)
+{
+    PNGEncContext *s = avctx->priv_data;
+    int i;
+
+    for (i = 0; i < s->nb_bands; i++)
+        av_freep(&s->bands[i].buf);
+    av_freep(&s->bands);
+    s->nb_bands = 0;
+    av_freep(&s->filter_buf);
+
+    return 0;
+}
+
 AVCodec ff_png_encoder = {
     .name           = "png",
     .type           = AVMEDIA_TYPE_VIDEO,
     .id             = AV_CODEC_ID_PNG,
     .priv_data_size = sizeof(PNGEncContext),
     .init           = png_enc_init,
+    .close          = png_enc_close,
     .encode2        = encode_frame,
+    .capabilities   = CODEC_CAP_SLICE_THREADS,
     .pix_fmts       = (const enum AVPixelFormat[]){
         AV_PIX_FMT_RGB24, AV_PIX_FMT_RGB32, AV_PIX_FMT_PAL8, AV_PIX_FMT_GRAY8,
         AV_PIX_FMT_GRAY16BE,
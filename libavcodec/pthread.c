@@ -129,14 +129,31 @@ typedef struct FrameThreadContext {
                                     * While it is set, ff_thread_en/decode_frame won't return any results.
                                     */
 
+    int low_latency;               ///< Return frames as soon as they are decoded, see AVCodecContext.thread_low_latency.
+
     int die;                       ///< Set when threads should exit.
 } FrameThreadContext;
 
 
-/* H264 slice threading seems to be buggy with more than 16 threads,
- * limit the number of threads to 16 for automatic detection */
+/* limit the number of threads to 16 for automatic detection */
 #define MAX_AUTO_THREADS 16
 
+/* Slice threading of frames taller than 1024 lines gets one more thread
+ * per 64 lines, up to MAX_AUTO_SLICE_THREADS. Frame threads don't split
+ * frames, so they stay at MAX_AUTO_THREADS. */
+#define MAX_AUTO_SLICE_THREADS 128
+/* MAX_SLICES in h264.h, the H.264 decoder uses no more slice contexts */
+#define MAX_AUTO_H264_SLICE_THREADS 32
+
+static int max_auto_slice_threads(AVCodecContext *avctx)
+{
+    int height = FFMAX(avctx->height, avctx->coded_height);
+
+    return av_clip(height >> 6, MAX_AUTO_THREADS,
+                   avctx->codec_id == AV_CODEC_ID_H264 ?
+                   MAX_AUTO_H264_SLICE_THREADS : MAX_AUTO_SLICE_THREADS);
+}
+
 static void* attribute_align_arg worker(void *v)
 {
     AVCodecContext *avctx = v;
@@ -246,7 +263,7 @@ static int thread_init_internal(AVCodecContext *avctx)
         av_log(avctx, AV_LOG_DEBUG, "detected %d logical cores\n", nb_cpus);
         // use number of cores + 1 as thread count if there is more than one
         if (nb_cpus > 1)
-            thread_count = avctx->thread_count = FFMIN(nb_cpus + 1, MAX_AUTO_THREADS);
+            thread_count = avctx->thread_count = FFMIN(nb_cpus + 1, max_auto_slice_threads(avctx));
         else
             thread_count = avctx->thread_count = 1;
     }
@@ -324,14 +341,17 @@ static attribute_align_arg void *frame_worker_thread(void *arg)
         p->result = codec->decode(avctx, &p->frame, &p->got_frame, &p->avpkt);
 
         /* many decoders assign whole AVFrames, thus overwriting extended_data;
-         * make sure it's set correctly */
-        p->frame.extended_data = p->frame.data;
+         * make sure it's set correctly; assume audio decoders that actually
+         * use extended_data are doing it correctly */
+        if (avctx->codec_type != AVMEDIA_TYPE_AUDIO ||
+            !av_sample_fmt_is_planar(p->frame.format) ||
+            avctx->channels <= AV_NUM_DATA_POINTERS)
+            p->frame.extended_data = p->frame.data;
 
         if (p->state == STATE_SETTING_UP) ff_thread_finish_setup(avctx);
 
-        p->state = STATE_INPUT_READY;
-
         pthread_mutex_lock(&p->progress_mutex);
+        p->state = STATE_INPUT_READY;
         pthread_cond_signal(&p->output_cond);
         pthread_mutex_unlock(&p->progress_mutex);
 
@@ -382,6 +402,11 @@ static int update_context_from_thread(AVCodecContext *dst, AVCodecContext *src,
 
         dst->hwaccel = src->hwaccel;
         dst->hwaccel_context = src->hwaccel_context;
+
+        dst->sample_rate    = src->sample_rate;
+        dst->sample_fmt     = src->sample_fmt;
+        dst->channels       = src->channels;
+        dst->channel_layout = src->channel_layout;
     }
 
     if (for_user) {
@@ -560,11 +585,31 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
     err = submit_packet(p, avpkt);
     if (err) return err;
 
+    if (fctx->next_decoding >= avctx->thread_count) fctx->next_decoding = 0;
+
     /*
-     * If we're still receiving the initial packets, don't return a frame.
+     * In low latency mode, only wait for the oldest thread if all of them
+     * are busy, i.e. the next packet would have to be submitted to it.
      */
 
-    if (fctx->delaying) {
+    if (fctx->low_latency) {
+        if (avpkt->size && fctx->next_decoding != finished) {
+            int done;
+
+            p = &fctx->threads[finished];
+            pthread_mutex_lock(&p->progress_mutex);
+            done = p->state == STATE_INPUT_READY;
+            pthread_mutex_unlock(&p->progress_mutex);
+
+            if (!done) {
+                *got_picture_ptr = 0;
+                return avpkt->size;
+            }
+        }
+    } else if (fctx->delaying) {
+        /*
+         * If we're still receiving the initial packets, don't return a frame.
+         */
         if (fctx->next_decoding >= (avctx->thread_count-1)) fctx->delaying = 0;
 
         *got_picture_ptr=0;
@@ -606,8 +651,6 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
 
     update_context_from_thread(avctx, p->avctx, 1);
 
-    if (fctx->next_decoding >= avctx->thread_count) fctx->next_decoding = 0;
-
     fctx->next_finished = finished;
 
     /* return the size of the consumed packet if no error occurred */
@@ -764,6 +807,7 @@ static int frame_thread_init(AVCodecContext *avctx)
     fctx->threads = av_mallocz(sizeof(PerThreadContext) * thread_count);
     pthread_mutex_init(&fctx->buffer_mutex, NULL);
     fctx->delaying = 1;
+    fctx->low_latency = avctx->thread_low_latency;
 
     for (i = 0; i < thread_count; i++) {
         AVCodecContext *copy = av_malloc(sizeof(AVCodecContext));
@@ -795,12 +839,14 @@ static int frame_thread_init(AVCodecContext *avctx)
 
             update_context_from_thread(avctx, copy, 1);
         } else {
-            copy->priv_data = av_malloc(codec->priv_data_size);
-            if (!copy->priv_data) {
-                err = AVERROR(ENOMEM);
-                goto error;
+            if (codec->priv_data_size) {
+                copy->priv_data = av_malloc(codec->priv_data_size);
+                if (!copy->priv_data) {
+                    err = AVERROR(ENOMEM);
+                    goto error;
+                }
+                memcpy(copy->priv_data, src->priv_data, codec->priv_data_size);
             }
-            memcpy(copy->priv_data, src->priv_data, codec->priv_data_size);
             copy->internal = av_malloc(sizeof(AVCodecInternal));
             if (!copy->internal) {
                 err = AVERROR(ENOMEM);
@@ -978,10 +1024,16 @@ fail:
  */
 static void validate_thread_parameters(AVCodecContext *avctx)
 {
+    int max_threads;
+    /* A packet is always consumed entirely with frame threading, audio
+     * decoders can get packets of several frames, so they only use it if
+     * it is the only threading method requested. */
     int frame_threading_supported = (avctx->codec->capabilities & CODEC_CAP_FRAME_THREADS)
                                 && !(avctx->flags & CODEC_FLAG_TRUNCATED)
                                 && !(avctx->flags & CODEC_FLAG_LOW_DELAY)
-                                && !(avctx->flags2 & CODEC_FLAG2_CHUNKS);
+                                && !(avctx->flags2 & CODEC_FLAG2_CHUNKS)
+                                && (avctx->codec_type != AVMEDIA_TYPE_AUDIO ||
+                                    avctx->thread_type == FF_THREAD_FRAME);
     if (avctx->thread_count == 1) {
         avctx->active_thread_type = 0;
     } else if (frame_threading_supported && (avctx->thread_type & FF_THREAD_FRAME)) {
@@ -994,10 +1046,12 @@ static void validate_thread_parameters(AVCodecContext *avctx)
         avctx->active_thread_type = 0;
     }
 
-    if (avctx->thread_count > MAX_AUTO_THREADS)
+    max_threads = avctx->active_thread_type == FF_THREAD_SLICE ?
+                  max_auto_slice_threads(avctx) : MAX_AUTO_THREADS;
+    if (avctx->thread_count > max_threads)
         av_log(avctx, AV_LOG_WARNING,
                "Application has requested %d threads. Using a thread count greater than %d is not recommended.\n",
-               avctx->thread_count, MAX_AUTO_THREADS);
+               avctx->thread_count, max_threads);
 }
 
 int ff_thread_init(AVCodecContext *avctx)
@@ -48,6 +48,9 @@ void ff_simple_idct_mmx(int16_t *block);
 void ff_simple_idct_add_mmx(uint8_t *dest, int line_size, int16_t *block);
 void ff_simple_idct_put_mmx(uint8_t *dest, int line_size, int16_t *block);
 
+void ff_simple_idct_put_10_sse4(uint8_t *dest, int line_size, int16_t *block);
+void ff_simple_idct_add_10_sse4(uint8_t *dest, int line_size, int16_t *block);
+
 void ff_simple_idct248_put(uint8_t *dest, int line_size, int16_t *block);
 
 void ff_simple_idct84_add(uint8_t *dest, int line_size, int16_t *block);
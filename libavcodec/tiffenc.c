@@ -31,6 +31,7 @@
 #endif
 
 #include "libavutil/log.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "avcodec.h"
@@ -47,6 +48,16 @@ static const uint8_t type_sizes2[6] = {
     0, 1, 1, 2, 4, 8
 };
 
+/** a strip compressed separately, possibly by another thread */
+typedef struct TiffStrip {
+    uint8_t *src;                           ///< uncompressed rows of the strip
+    unsigned int src_size;
+    uint8_t *dst;                           ///< compressed strip
+    unsigned int dst_size;
+    int size;                               ///< compressed size or error code
+    struct LZWEncodeState *lzws;            ///< LZW encode state
+} TiffStrip;
+
 typedef struct TiffEncoderContext {
     AVClass *class;                         ///< for private options
     AVCodecContext *avctx;
@@ -66,7 +77,10 @@ typedef struct TiffEncoderContext {
     uint8_t *buf_start;                     ///< pointer to first byte in buffer
     int buf_size;                           ///< buffer size
     uint16_t subsampling[2];                ///< YUV subsampling factors
-    struct LZWEncodeState *lzws;            ///< LZW encode state
+    int is_yuv;                             ///< rows are packed from YUV planes
+    int bytes_per_row;                      ///< size of a packed row
+    TiffStrip *strip_data;                  ///< strips compressed as a whole
+    int nb_strip_data;                      ///< number of allocated strip_data
 } TiffEncoderContext;
 
 /**
@@ -157,18 +171,6 @@ static int encode_strip(TiffEncoderContext *s, const int8_t *src,
                         uint8_t *dst, int n, int compr)
 {
     switch (compr) {
-#if CONFIG_ZLIB
-    case TIFF_DEFLATE:
-    case TIFF_ADOBE_DEFLATE:
-    {
-        unsigned long zlen = s->buf_size - (*s->buf - s->buf_start);
-        if (compress(dst, &zlen, src, n) != Z_OK) {
-            av_log(s->avctx, AV_LOG_ERROR, "Compressing failed\n");
-            return -1;
-        }
-        return zlen;
-    }
-#endif
     case TIFF_RAW:
         if (check_size(s, n))
             return -1;
@@ -177,8 +179,6 @@ static int encode_strip(TiffEncoderContext *s, const int8_t *src,
     case TIFF_PACKBITS:
         return ff_rle_encode(dst, s->buf_size - (*s->buf - s->buf_start),
                              src, 1, n, 2, 0xff, -1, 0);
-    case TIFF_LZW:
-        return ff_lzw_encode(s->lzws, src, n);
     default:
         return -1;
     }
@@ -201,6 +201,74 @@ static void pack_yuv(TiffEncoderContext *s, uint8_t *dst, int lnum)
     }
 }
 
+/**
+ * Compress a whole strip with deflate or LZW into its own buffer.
+ * Strips are independent, so this is run for all of them in parallel.
+ */
+static int compress_strip(AVCodecContext *avctx, void *arg,
+                          int jobnr, int threadnr)
+{
+    TiffEncoderContext *s = avctx->priv_data;
+    TiffStrip *strip      = &s->strip_data[jobnr];
+    AVFrame *p            = &s->picture;
+    int start             = jobnr * s->rps;
+    int end               = FFMIN(start + s->rps, s->height);
+    int i, n = 0;
+
+    av_fast_malloc(&strip->src, &strip->src_size,
+                   s->rps / s->subsampling[1] * s->bytes_per_row);
+    if (!strip->src)
+        return strip->size = AVERROR(ENOMEM);
+    for (i = start; i < end; i += s->subsampling[1]) {
+        if (s->is_yuv)
+            pack_yuv(s, strip->src + n, i);
+        else
+            memcpy(strip->src + n, p->data[0] + i * p->linesize[0],
+                   s->bytes_per_row);
+        n += s->bytes_per_row;
+    }
+
+    switch (s->compr) {
+#if CONFIG_ZLIB
+    case TIFF_DEFLATE:
+    case TIFF_ADOBE_DEFLATE:
+    {
+        unsigned long zlen = compressBound(n);
+
+        av_fast_malloc(&strip->dst, &strip->dst_size, zlen);
+        if (!strip->dst)
+            return strip->size = AVERROR(ENOMEM);
+        if (compress(strip->dst, &zlen, strip->src, n) != Z_OK) {
+            av_log(s->avctx, AV_LOG_ERROR, "Compressing failed\n");
+            return strip->size = -1;
+        }
+        strip->size = zlen;
+        break;
+    }
+#endif
+    case TIFF_LZW:
+    {
+        int ret;
+
+        if (!strip->lzws && !(strip->lzws = av_malloc(ff_lzw_encode_state_size)))
+            return strip->size = AVERROR(ENOMEM);
+        /* the worst case of 12 bits codes for each byte */
+        av_fast_malloc(&strip->dst, &strip->dst_size, n + n / 2 + 64);
+        if (!strip->dst)
+            return strip->size = AVERROR(ENOMEM);
+        ff_lzw_encode_init(strip->lzws, strip->dst, strip->dst_size,
+                           12, FF_LZW_TIFF, put_bits);
+        if ((ret = ff_lzw_encode(strip->lzws, strip->src, n)) < 0)
+            return strip->size = -1;
+        strip->size = ret + ff_lzw_encode_flush(strip->lzws, flush_put_bits);
+        break;
+    }
+    default:
+        return strip->size = -1;
+    }
+    return 0;
+}
+
 static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                         const AVFrame *pict, int *got_packet)
 {
@@ -216,7 +284,6 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     uint32_t res[2]    = { 72, 1 };     // image resolution (72/1)
     uint16_t bpp_tab[] = { 8, 8, 8, 8 };
     int ret;
-    int is_yuv = 0;
     uint8_t *yuv_line = NULL;
     int shift_h, shift_v;
     const AVPixFmtDescriptor *pfd;
@@ -232,6 +299,7 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     s->height         = avctx->height;
     s->subsampling[0] = 1;
     s->subsampling[1] = 1;
+    s->is_yuv         = 0;
 
     switch (avctx->pix_fmt) {
     case AV_PIX_FMT_RGB48LE:
@@ -272,7 +340,7 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
         s->subsampling[0]             = 1 << shift_h;
         s->subsampling[1]             = 1 << shift_v;
         s->bpp_tab_size               = 3;
-        is_yuv                        = 1;
+        s->is_yuv                     = 1;
         break;
     default:
         av_log(s->avctx, AV_LOG_ERROR,
@@ -282,10 +350,14 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
 
     if (s->compr == TIFF_DEFLATE       ||
         s->compr == TIFF_ADOBE_DEFLATE ||
-        s->compr == TIFF_LZW)
-        // best choice for DEFLATE
-        s->rps = s->height;
-    else
+        s->compr == TIFF_LZW) {
+        // best choice for DEFLATE, unless the strips are compressed by
+        // several threads
+        if (avctx->active_thread_type & FF_THREAD_SLICE)
+            s->rps = (s->height - 1) / avctx->thread_count + 1;
+        else
+            s->rps = s->height;
+    } else
         // suggest size of strip
         s->rps = FFMAX(8192 / (((s->width * s->bpp) >> 3) + 1), 1);
     // round rps up
@@ -305,8 +377,10 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     s->buf       = &ptr;
     s->buf_size  = pkt->size;
 
-    if (check_size(s, 8))
+    if (check_size(s, 8)) {
+        ret = AVERROR(EINVAL);
         goto fail;
+    }
 
     // write header
     bytestream_put_le16(&ptr, 0x4949);
@@ -324,7 +398,8 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
 
     bytes_per_row = (((s->width - 1) / s->subsampling[0] + 1) * s->bpp *
                      s->subsampling[0] * s->subsampling[1] + 7) >> 3;
-    if (is_yuv) {
+    s->bytes_per_row = bytes_per_row;
+    if (s->is_yuv) {
         yuv_line = av_malloc(bytes_per_row);
         if (yuv_line == NULL) {
             av_log(s->avctx, AV_LOG_ERROR, "Not enough memory\n");
@@ -333,78 +408,56 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
         }
     }
 
-#if CONFIG_ZLIB
-    if (s->compr == TIFF_DEFLATE || s->compr == TIFF_ADOBE_DEFLATE) {
-        uint8_t *zbuf;
-        int zlen, zn;
-        int j;
-
-        zlen = bytes_per_row * s->rps;
-        zbuf = av_malloc(zlen);
-        if (!zbuf) {
-            ret = AVERROR(ENOMEM);
-            goto fail;
-        }
-        strip_offsets[0] = ptr - pkt->data;
-        zn               = 0;
-        for (j = 0; j < s->rps; j++) {
-            if (is_yuv) {
-                pack_yuv(s, yuv_line, j);
-                memcpy(zbuf + zn, yuv_line, bytes_per_row);
-                j += s->subsampling[1] - 1;
-            } else
-                memcpy(zbuf + j * bytes_per_row,
-                       p->data[0] + j * p->linesize[0], bytes_per_row);
-            zn += bytes_per_row;
-        }
-        ret = encode_strip(s, zbuf, ptr, zn, s->compr);
-        av_free(zbuf);
-        if (ret < 0) {
-            av_log(s->avctx, AV_LOG_ERROR, "Encode strip failed\n");
-            goto fail;
-        }
-        ptr           += ret;
-        strip_sizes[0] = ptr - pkt->data - strip_offsets[0];
-    } else
-#endif
-    if (s->compr == TIFF_LZW) {
-        s->lzws = av_malloc(ff_lzw_encode_state_size);
-        if (!s->lzws) {
-            ret = AVERROR(ENOMEM);
-            goto fail;
-        }
-    }
-    for (i = 0; i < s->height; i++) {
-        if (strip_sizes[i / s->rps] == 0) {
-            if (s->compr == TIFF_LZW) {
-                ff_lzw_encode_init(s->lzws, ptr,
-                                   s->buf_size - (*s->buf - s->buf_start),
-                                   12, FF_LZW_TIFF, put_bits);
+    if (s->compr == TIFF_DEFLATE       ||
+        s->compr == TIFF_ADOBE_DEFLATE ||
+        s->compr == TIFF_LZW) {
+        if (strips > s->nb_strip_data) {
+            TiffStrip *tmp = av_realloc(s->strip_data, strips * sizeof(*tmp));
+            if (!tmp) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
             }
-            strip_offsets[i / s->rps] = ptr - pkt->data;
+            memset(tmp + s->nb_strip_data, 0,
+                   (strips - s->nb_strip_data) * sizeof(*tmp));
+            s->strip_data    = tmp;
+            s->nb_strip_data = strips;
         }
-        if (is_yuv) {
-            pack_yuv(s, yuv_line, i);
-            ret = encode_strip(s, yuv_line, ptr, bytes_per_row, s->compr);
-            i  += s->subsampling[1] - 1;
-        } else
-            ret = encode_strip(s, p->data[0] + i * p->linesize[0],
-                               ptr, bytes_per_row, s->compr);
-        if (ret < 0) {
-            av_log(s->avctx, AV_LOG_ERROR, "Encode strip failed\n");
-            goto fail;
+        avctx->execute2(avctx, compress_strip, NULL, NULL, strips);
+        for (i = 0; i < strips; i++) {
+            TiffStrip *strip = &s->strip_data[i];
+
+            if (strip->size < 0) {
+                av_log(s->avctx, AV_LOG_ERROR, "Encode strip failed\n");
+                ret = strip->size;
+                goto fail;
+            }
+            if (check_size(s, strip->size)) {
+                ret = AVERROR(EINVAL);
+                goto fail;
+            }
+            strip_offsets[i] = ptr - pkt->data;
+            strip_sizes[i]   = strip->size;
+            bytestream_put_buffer(&ptr, strip->dst, strip->size);
         }
-        strip_sizes[i / s->rps] += ret;
-        ptr                     += ret;
-        if (s->compr == TIFF_LZW &&
-            (i == s->height - 1 || i % s->rps == s->rps - 1)) {
-            ret = ff_lzw_encode_flush(s->lzws, flush_put_bits);
-            strip_sizes[(i / s->rps)] += ret;
-            ptr                       += ret;
+    } else {
+        for (i = 0; i < s->height; i++) {
+            if (strip_sizes[i / s->rps] == 0)
+                strip_offsets[i / s->rps] = ptr - pkt->data;
+            if (s->is_yuv) {
+                pack_yuv(s, yuv_line, i);
+                ret = encode_strip(s, yuv_line, ptr, bytes_per_row, s->compr);
+                i  += s->subsampling[1] - 1;
+            } else
+                ret = encode_strip(s, p->data[0] + i * p->linesize[0],
+                                   ptr, bytes_per_row, s->compr);
+            if (ret < 0) {
+                av_log(s->avctx, AV_LOG_ERROR, "Encode strip failed\n");
+                goto fail;
+            }
+            strip_sizes[i / s->rps] += ret;
+            ptr                     += ret;
         }
     }
-    if (s->compr == TIFF_LZW)
-        av_free(s->lzws);
 
     s->num_entries = 0;
 
@@ -442,7 +495,7 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
         }
         add_entry(s, TIFF_PAL, TIFF_SHORT, 256 * 3, pal);
     }
-    if (is_yuv) {
+    if (s->is_yuv) {
         /** according to CCIR Recommendation 601.1 */
         uint32_t refbw[12] = { 15, 1, 235, 1, 128, 1, 240, 1, 128, 1, 240, 1 };
         add_entry(s, TIFF_YCBCR_SUBSAMPLING, TIFF_SHORT,    2, s->subsampling);
@@ -462,6 +515,7 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     pkt->size   = ptr - pkt->data;
     pkt->flags |= AV_PKT_FLAG_KEY;
     *got_packet = 1;
+    ret         = 0;
 
 fail:
     av_free(strip_sizes);
@@ -470,6 +524,22 @@ fail:
     return ret;
 }
 
+static av_cold int encode_close(AVCodecContext *avctx)
+{
+    TiffEncoderContext *s = avctx->priv_data;
+    int i;
+
+    for (i = 0; i < s->nb_strip_data; i++) {
+        av_freep(&s->strip_data[i].src);
+        av_freep(&s->strip_data[i].dst);
+        av_freep(&s->strip_data[i].lzws);
+    }
+    av_freep(&s->strip_data);
+    s->nb_strip_data = 0;
+
+    return 0;
+}
+
 #define OFFSET(x) offsetof(TiffEncoderContext, x)
 #define VE AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_ENCODING_PARAM
 static const AVOption options[] = {
@@ -497,6 +567,8 @@ AVCodec ff_tiff_encoder = {
     .id             = AV_CODEC_ID_TIFF,
     .priv_data_size = sizeof(TiffEncoderContext),
     .encode2        = encode_frame,
+    .close          = encode_close,
+    .capabilities   = CODEC_CAP_SLICE_THREADS,
     .pix_fmts       = (const enum AVPixelFormat[]) {
         AV_PIX_FMT_RGB24, AV_PIX_FMT_RGB48LE, AV_PIX_FMT_PAL8,
         AV_PIX_FMT_GRAY8, AV_PIX_FMT_GRAY16LE,
@@ -49,6 +49,48 @@
 #include <stdarg.h>
 #include <limits.h>
 #include <float.h>
+#if HAVE_PTHREADS
+#include <pthread.h>
+#elif HAVE_W32THREADS
+#include "compat/w32pthreads.h"
+#endif
+
+typedef struct FramePoolPlane {
+    struct FramePool *parent;
+    int size;                   ///< size of the buffers in the pool
+    int nb_allocated;           ///< number of buffers allocated by the pool
+    int max_allocated;          ///< allocation limit, 0 for no limit
+} FramePoolPlane;
+
+typedef struct FramePool {
+    /**
+     * Pools for each data plane. For audio all the planes have the same size,
+     * so only pools[0] is used.
+     */
+    AVBufferPool *pools[4];
+    FramePoolPlane plane[4];
+
+    AVFramePoolStats stats;
+
+#if HAVE_THREADS
+    /**
+     * Frame threads share the pool, this protects the pool setup, the
+     * allocation counts and the statistics.
+     */
+    pthread_mutex_t mutex;
+#endif
+
+    /*
+     * Pool parameters
+     */
+    int format;
+    int width, height;
+    int stride_align[AV_NUM_DATA_POINTERS];
+    int linesize[4];
+    int planes;
+    int channels;
+    int samples;
+} FramePool;
 
 static int volatile entangled_thread_counter = 0;
 static int (*lockmgr_cb)(void **mutex, enum AVLockOp op);
@@ -307,6 +349,99 @@ int avcodec_fill_audio_frame(AVFrame *frame, int nb_channels,
     return ret;
 }
 
+static AVBufferRef *frame_pool_alloc(void *opaque, int size)
+{
+    FramePoolPlane *plane = opaque;
+    AVFramePoolStats *stats = &plane->parent->stats;
+    AVBufferRef *buf;
+
+    if (plane->max_allocated && plane->nb_allocated >= plane->max_allocated)
+        return NULL;
+
+    buf = av_buffer_alloc(size);
+    if (!buf)
+        return NULL;
+
+    plane->nb_allocated++;
+    stats->nb_allocs++;
+    stats->cur_bytes += size;
+    stats->peak_bytes = FFMAX(stats->peak_bytes, stats->cur_bytes);
+
+    return buf;
+}
+
+static void frame_pool_uninit_plane(FramePool *pool, int i)
+{
+    FramePoolPlane *plane = &pool->plane[i];
+
+    av_buffer_pool_uninit(&pool->pools[i]);
+    pool->stats.cur_bytes -= (int64_t)plane->nb_allocated * plane->size;
+    plane->nb_allocated = 0;
+    plane->size         = 0;
+}
+
+/**
+ * (Re)initialize the pool for one data plane.
+ *
+ * @param nb_bufs number of buffers per frame taken from this pool
+ */
+static int frame_pool_init_plane(AVCodecContext *avctx, FramePool *pool, int i,
+                                 int size, int nb_bufs)
+{
+    FramePoolPlane *plane = &pool->plane[i];
+    AVBufferRef **bufs;
+    int j, nb_prealloc, ret = 0;
+
+    frame_pool_uninit_plane(pool, i);
+    if (!size)
+        return 0;
+
+    plane->parent        = pool;
+    plane->size          = size;
+    plane->max_allocated = avctx->frame_pool_max * nb_bufs;
+
+    pool->pools[i] = av_buffer_pool_init2(size, plane, frame_pool_alloc);
+    if (!pool->pools[i])
+        return AVERROR(ENOMEM);
+
+    nb_prealloc = avctx->frame_pool_prealloc * nb_bufs;
+    if (avctx->frame_pool_max)
+        nb_prealloc = FFMIN(nb_prealloc, plane->max_allocated);
+    if (!nb_prealloc)
+        return 0;
+
+    /* take the buffers out of the pool and return them at once, so that
+     * they are kept allocated for the following requests */
+    bufs = av_malloc(nb_prealloc * sizeof(*bufs));
+    if (!bufs)
+        return AVERROR(ENOMEM);
+    for (j = 0; j < nb_prealloc; j++) {
+        bufs[j] = av_buffer_pool_get(pool->pools[i]);
+        if (!bufs[j]) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+    }
+    while (j--)
+        av_buffer_unref(&bufs[j]);
+    av_free(bufs);
+
+    return ret;
+}
+
+static AVBufferRef *frame_pool_get(FramePool *pool, int i)
+{
+    pool->stats.nb_requests++;
+    return av_buffer_pool_get(pool->pools[i]);
+}
+
+const AVFramePoolStats *avcodec_get_frame_pool_stats(AVCodecContext *avctx)
+{
+    if (!avctx->internal || !avctx->internal->pool)
+        return NULL;
+    return &avctx->internal->pool->stats;
+}
+
 static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
 {
     FramePool *pool = avctx->internal->pool;
@@ -352,16 +487,13 @@ static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
             size[i] = picture.data[i + 1] - picture.data[i];
         size[i] = tmpsize - (picture.data[i] - picture.data[0]);
 
+        pool->stats.nb_inits++;
         for (i = 0; i < 4; i++) {
-            av_buffer_pool_uninit(&pool->pools[i]);
             pool->linesize[i] = picture.linesize[i];
-            if (size[i]) {
-                pool->pools[i] = av_buffer_pool_init(size[i] + 16, NULL);
-                if (!pool->pools[i]) {
-                    ret = AVERROR(ENOMEM);
-                    goto fail;
-                }
-            }
+            ret = frame_pool_init_plane(avctx, pool, i,
+                                        size[i] ? size[i] + 16 : 0, 1);
+            if (ret < 0)
+                goto fail;
         }
         pool->format = frame->format;
         pool->width  = frame->width;
@@ -378,17 +510,16 @@ static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
             pool->channels == ch && frame->nb_samples == pool->samples)
             return 0;
 
-        av_buffer_pool_uninit(&pool->pools[0]);
+        frame_pool_uninit_plane(pool, 0);
         ret = av_samples_get_buffer_size(&pool->linesize[0], ch,
                                          frame->nb_samples, frame->format, 0);
         if (ret < 0)
             goto fail;
 
-        pool->pools[0] = av_buffer_pool_init(pool->linesize[0], NULL);
-        if (!pool->pools[0]) {
-            ret = AVERROR(ENOMEM);
+        pool->stats.nb_inits++;
+        ret = frame_pool_init_plane(avctx, pool, 0, pool->linesize[0], planes);
+        if (ret < 0)
             goto fail;
-        }
 
         pool->format     = frame->format;
         pool->planes     = planes;
@@ -401,7 +532,7 @@ static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
     return 0;
 fail:
     for (i = 0; i < 4; i++)
-        av_buffer_pool_uninit(&pool->pools[i]);
+        frame_pool_uninit_plane(pool, i);
     pool->format = -1;
     pool->planes = pool->channels = pool->samples = 0;
     pool->width  = pool->height = 0;
@@ -430,13 +561,13 @@ static int audio_get_buffer(AVCodecContext *avctx, AVFrame *frame)
         frame->extended_data = frame->data;
 
     for (i = 0; i < FFMIN(planes, AV_NUM_DATA_POINTERS); i++) {
-        frame->buf[i] = av_buffer_pool_get(pool->pools[0]);
+        frame->buf[i] = frame_pool_get(pool, 0);
         if (!frame->buf[i])
             goto fail;
         frame->extended_data[i] = frame->data[i] = frame->buf[i]->data;
     }
     for (i = 0; i < frame->nb_extended_buf; i++) {
-        frame->extended_buf[i] = av_buffer_pool_get(pool->pools[0]);
+        frame->extended_buf[i] = frame_pool_get(pool, 0);
         if (!frame->extended_buf[i])
             goto fail;
         frame->extended_data[i + AV_NUM_DATA_POINTERS] = frame->extended_buf[i]->data;
@@ -475,7 +606,7 @@ static int video_get_buffer(AVCodecContext *s, AVFrame *pic)
 
         pic->linesize[i] = pool->linesize[i];
 
-        pic->buf[i] = av_buffer_pool_get(pool->pools[i]);
+        pic->buf[i] = frame_pool_get(pool, i);
         if (!pic->buf[i])
             goto fail;
 
@@ -506,10 +637,15 @@ fail:
 
 int avcodec_default_get_buffer2(AVCodecContext *avctx, AVFrame *frame, int flags)
 {
+    FramePool *pool = avctx->internal->pool;
     int ret;
 
+#if HAVE_THREADS
+    pthread_mutex_lock(&pool->mutex);
+#endif
+
     if ((ret = update_frame_pool(avctx, frame)) < 0)
-        return ret;
+        goto end;
 
 #if FF_API_GET_BUFFER
 FF_DISABLE_DEPRECATION_WARNINGS
@@ -519,12 +655,20 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
     switch (avctx->codec_type) {
     case AVMEDIA_TYPE_VIDEO:
-        return video_get_buffer(avctx, frame);
+        ret = video_get_buffer(avctx, frame);
+        break;
     case AVMEDIA_TYPE_AUDIO:
-        return audio_get_buffer(avctx, frame);
+        ret = audio_get_buffer(avctx, frame);
+        break;
     default:
-        return -1;
+        ret = -1;
     }
+
+end:
+#if HAVE_THREADS
+    pthread_mutex_unlock(&pool->mutex);
+#endif
+    return ret;
 }
 
 #if FF_API_GET_BUFFER
@@ -901,6 +1045,9 @@ int attribute_align_arg avcodec_open2(AVCodecContext *avctx, const AVCodec *code
         ret = AVERROR(ENOMEM);
         goto free_and_end;
     }
+#if HAVE_THREADS
+    pthread_mutex_init(&avctx->internal->pool->mutex, NULL);
+#endif
 
     if (codec->priv_data_size > 0) {
         if (!avctx->priv_data) {
@@ -1087,8 +1234,12 @@ end:
 free_and_end:
     av_dict_free(&tmp);
     av_freep(&avctx->priv_data);
-    if (avctx->internal)
+    if (avctx->internal && avctx->internal->pool) {
+#if HAVE_THREADS
+        pthread_mutex_destroy(&avctx->internal->pool->mutex);
+#endif
         av_freep(&avctx->internal->pool);
+    }
     av_freep(&avctx->internal);
     avctx->codec = NULL;
     goto end;
@@ -1448,11 +1599,19 @@ int attribute_align_arg avcodec_decode_audio4(AVCodecContext *avctx,
     if (!avctx->refcounted_frames)
         av_frame_unref(&avci->to_free);
 
-    if ((avctx->codec->capabilities & CODEC_CAP_DELAY) || avpkt->size) {
-        ret = avctx->codec->decode(avctx, frame, got_frame_ptr, avpkt);
+    if ((avctx->codec->capabilities & CODEC_CAP_DELAY) || avpkt->size ||
+        (avctx->active_thread_type & FF_THREAD_FRAME)) {
+        if (HAVE_THREADS && avctx->active_thread_type & FF_THREAD_FRAME) {
+            ret = ff_thread_decode_frame(avctx, frame, got_frame_ptr, avpkt);
+            /* the frame comes from an earlier packet than avpkt */
+            if (ret >= 0 && *got_frame_ptr)
+                frame->pts = frame->pkt_pts;
+        } else {
+            ret = avctx->codec->decode(avctx, frame, got_frame_ptr, avpkt);
+            frame->pkt_dts = avpkt->dts;
+        }
         if (ret >= 0 && *got_frame_ptr) {
             avctx->frame_number++;
-            frame->pkt_dts = avpkt->dts;
             if (frame->format == AV_SAMPLE_FMT_NONE)
                 frame->format = avctx->sample_fmt;
 
@@ -1538,6 +1697,9 @@ av_cold int avcodec_close(AVCodecContext *avctx)
             av_frame_unref(&avctx->internal->to_free);
         for (i = 0; i < FF_ARRAY_ELEMS(pool->pools); i++)
             av_buffer_pool_uninit(&pool->pools[i]);
+#if HAVE_THREADS
+        pthread_mutex_destroy(&pool->mutex);
+#endif
         av_freep(&avctx->internal->pool);
         av_freep(&avctx->internal);
     }
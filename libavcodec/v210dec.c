@@ -23,12 +23,28 @@
 
 #include "avcodec.h"
 #include "internal.h"
+#include "thread.h"
+#include "v210dsp.h"
 #include "libavutil/bswap.h"
+#include "libavutil/common.h"
 #include "libavutil/internal.h"
 #include "libavutil/mem.h"
 
+typedef struct V210DecContext {
+    V210DSPContext dsp;
+} V210DecContext;
+
+typedef struct ThreadData {
+    AVFrame *frame;
+    const uint8_t *buf;
+    int stride;
+    int nb_jobs;
+} ThreadData;
+
 static av_cold int decode_init(AVCodecContext *avctx)
 {
+    V210DecContext *s = avctx->priv_data;
+
     if (avctx->width & 1) {
         av_log(avctx, AV_LOG_ERROR, "v210 needs even width\n");
         return AVERROR_INVALIDDATA;
@@ -36,52 +52,39 @@ static av_cold int decode_init(AVCodecContext *avctx)
     avctx->pix_fmt             = AV_PIX_FMT_YUV422P10;
     avctx->bits_per_raw_sample = 10;
 
+    ff_v210dsp_init(&s->dsp);
+
     return 0;
 }
 
-static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
-                        AVPacket *avpkt)
+static int decode_rows(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
 {
-    int h, w, ret;
-    AVFrame *pic = data;
-    const uint8_t *psrc = avpkt->data;
-    uint16_t *y, *u, *v;
-    int aligned_width = ((avctx->width + 47) / 48) * 48;
-    int stride = aligned_width * 8 / 3;
-
-    if (avpkt->size < stride * avctx->height) {
-        av_log(avctx, AV_LOG_ERROR, "packet too small\n");
-        return AVERROR_INVALIDDATA;
-    }
+    V210DecContext *s = avctx->priv_data;
+    ThreadData *td    = arg;
+    AVFrame *pic      = td->frame;
+    int start = avctx->height *  jobnr      / td->nb_jobs;
+    int end   = avctx->height * (jobnr + 1) / td->nb_jobs;
+    int w     = avctx->width / 6 * 6;
+    int h;
 
-    if ((ret = ff_get_buffer(avctx, pic, 0)) < 0)
-        return ret;
+    for (h = start; h < end; h++) {
+        const uint32_t *src = (const uint32_t*)(td->buf + h * td->stride);
+        uint16_t *y = (uint16_t*)(pic->data[0] + h * pic->linesize[0]);
+        uint16_t *u = (uint16_t*)(pic->data[1] + h * pic->linesize[1]);
+        uint16_t *v = (uint16_t*)(pic->data[2] + h * pic->linesize[2]);
+        uint32_t val = 0;
 
-    y = (uint16_t*)pic->data[0];
-    u = (uint16_t*)pic->data[1];
-    v = (uint16_t*)pic->data[2];
-    pic->pict_type = AV_PICTURE_TYPE_I;
-    pic->key_frame = 1;
+        s->dsp.unpack_line(src, y, u, v, w);
+        src += w / 6 * 4;
+        y   += w;
+        u   += w >> 1;
+        v   += w >> 1;
 
-#define READ_PIXELS(a, b, c)         \
-    do {                             \
-        val  = av_le2ne32(*src++);   \
-        *a++ =  val & 0x3FF;         \
-        *b++ = (val >> 10) & 0x3FF;  \
-        *c++ = (val >> 20) & 0x3FF;  \
-    } while (0)
-
-    for (h = 0; h < avctx->height; h++) {
-        const uint32_t *src = (const uint32_t*)psrc;
-        uint32_t val;
-        for (w = 0; w < avctx->width - 5; w += 6) {
-            READ_PIXELS(u, y, v);
-            READ_PIXELS(y, u, y);
-            READ_PIXELS(v, y, u);
-            READ_PIXELS(y, v, y);
-        }
         if (w < avctx->width - 1) {
-            READ_PIXELS(u, y, v);
+            val  = av_le2ne32(*src++);
+            *u++ =  val & 0x3FF;
+            *y++ = (val >> 10) & 0x3FF;
+            *v++ = (val >> 20) & 0x3FF;
 
             val  = av_le2ne32(*src++);
             *y++ =  val & 0x3FF;
@@ -94,13 +97,41 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
             *v++ =  val & 0x3FF;
             *y++ = (val >> 10) & 0x3FF;
         }
+    }
+
+    return 0;
+}
+
+static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
+                        AVPacket *avpkt)
+{
+    ThreadFrame frame = { .f = data };
+    AVFrame *pic = data;
+    ThreadData td;
+    int ret;
+    int aligned_width = ((avctx->width + 47) / 48) * 48;
+    int stride = aligned_width * 8 / 3;
 
-        psrc += stride;
-        y += pic->linesize[0] / 2 - avctx->width;
-        u += pic->linesize[1] / 2 - avctx->width / 2;
-        v += pic->linesize[2] / 2 - avctx->width / 2;
+    if (avpkt->size < stride * avctx->height) {
+        av_log(avctx, AV_LOG_ERROR, "packet too small\n");
+        return AVERROR_INVALIDDATA;
     }
 
+    if ((ret = ff_thread_get_buffer(avctx, &frame, 0)) < 0)
+        return ret;
+
+    pic->pict_type = AV_PICTURE_TYPE_I;
+    pic->key_frame = 1;
+
+    /* rows are independent, decode one band of rows per slice thread */
+    td.frame   = pic;
+    td.buf     = avpkt->data;
+    td.stride  = stride;
+    td.nb_jobs = 1;
+    if (avctx->active_thread_type & FF_THREAD_SLICE)
+        td.nb_jobs = FFMIN(avctx->thread_count, avctx->height);
+    avctx->execute2(avctx, decode_rows, &td, NULL, td.nb_jobs);
+
     *got_frame      = 1;
 
     return avpkt->size;
@@ -110,8 +141,10 @@ AVCodec ff_v210_decoder = {
     .name           = "v210",
     .type           = AVMEDIA_TYPE_VIDEO,
     .id             = AV_CODEC_ID_V210,
+    .priv_data_size = sizeof(V210DecContext),
     .init           = decode_init,
     .decode         = decode_frame,
-    .capabilities   = CODEC_CAP_DR1,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_SLICE_THREADS |
+                      CODEC_CAP_FRAME_THREADS,
     .long_name      = NULL_IF_CONFIG_SMALL("Uncompressed 4:2:2 10-bit"),
 };
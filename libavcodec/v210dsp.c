@@ -0,0 +1,76 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/bswap.h"
+#include "libavutil/common.h"
+#include "v210dsp.h"
+
+#define READ_PIXELS(a, b, c)         \
+    do {                             \
+        val  = av_le2ne32(*src++);   \
+        *a++ =  val & 0x3FF;         \
+        *b++ = (val >> 10) & 0x3FF;  \
+        *c++ = (val >> 20) & 0x3FF;  \
+    } while (0)
+
+static void v210_unpack_line_c(const uint32_t *src, uint16_t *y, uint16_t *u,
+                               uint16_t *v, int width)
+{
+    uint32_t val;
+    int i;
+
+    for (i = 0; i < width; i += 6) {
+        READ_PIXELS(u, y, v);
+        READ_PIXELS(y, u, y);
+        READ_PIXELS(v, y, u);
+        READ_PIXELS(y, v, y);
+    }
+}
+
+#define CLIP(v) av_clip(v, 4, 1019)
+
+#define WRITE_PIXELS(a, b, c)                                   \
+    do {                                                        \
+        val  =  CLIP(*a++);                                     \
+        val |= (CLIP(*b++) << 10) | (CLIP(*c++) << 20);         \
+        *dst++ = av_le2ne32(val);                               \
+    } while (0)
+
+static void v210_pack_line_c(const uint16_t *y, const uint16_t *u,
+                             const uint16_t *v, uint32_t *dst, int width)
+{
+    uint32_t val;
+    int i;
+
+    for (i = 0; i < width; i += 6) {
+        WRITE_PIXELS(u, y, v);
+        WRITE_PIXELS(y, u, y);
+        WRITE_PIXELS(v, y, u);
+        WRITE_PIXELS(y, v, y);
+    }
+}
+
+av_cold void ff_v210dsp_init(V210DSPContext *c)
+{
+    c->unpack_line = v210_unpack_line_c;
+    c->pack_line   = v210_pack_line_c;
+    if (ARCH_X86)
+        ff_v210dsp_init_x86(c);
+}
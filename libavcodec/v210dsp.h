@@ -0,0 +1,43 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_V210DSP_H
+#define AVCODEC_V210DSP_H
+
+#include <stdint.h>
+
+typedef struct V210DSPContext {
+    /**
+     * Unpack width pixels of a v210 line to planar 4:2:2.
+     * width must be a multiple of 6, nothing after it is written.
+     */
+    void (*unpack_line)(const uint32_t *src, uint16_t *y, uint16_t *u,
+                        uint16_t *v, int width);
+
+    /**
+     * Clip width pixels of planar 4:2:2 to [4, 1019] and pack them to a
+     * v210 line. width must be a multiple of 6, nothing after it is read.
+     */
+    void (*pack_line)(const uint16_t *y, const uint16_t *u,
+                      const uint16_t *v, uint32_t *dst, int width);
+} V210DSPContext;
+
+void ff_v210dsp_init(V210DSPContext *c);
+void ff_v210dsp_init_x86(V210DSPContext *c);
+
+#endif /* AVCODEC_V210DSP_H */
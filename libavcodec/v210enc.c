@@ -24,9 +24,16 @@
 #include "avcodec.h"
 #include "bytestream.h"
 #include "internal.h"
+#include "v210dsp.h"
+
+typedef struct V210EncContext {
+    V210DSPContext dsp;
+} V210EncContext;
 
 static av_cold int encode_init(AVCodecContext *avctx)
 {
+    V210EncContext *s = avctx->priv_data;
+
     if (avctx->width & 1) {
         av_log(avctx, AV_LOG_ERROR, "v210 needs even width\n");
         return AVERROR(EINVAL);
@@ -42,27 +49,17 @@ static av_cold int encode_init(AVCodecContext *avctx)
 
     avctx->coded_frame->pict_type = AV_PICTURE_TYPE_I;
 
+    ff_v210dsp_init(&s->dsp);
+
     return 0;
 }
 
-static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
-                        const AVFrame *pic, int *got_packet)
-{
-    int aligned_width = ((avctx->width + 47) / 48) * 48;
-    int stride = aligned_width * 8 / 3;
-    int line_padding = stride - ((avctx->width * 8 + 11) / 12) * 4;
-    int h, w, ret;
-    const uint16_t *y = (const uint16_t*)pic->data[0];
-    const uint16_t *u = (const uint16_t*)pic->data[1];
-    const uint16_t *v = (const uint16_t*)pic->data[2];
-    PutByteContext p;
-
-    if ((ret = ff_alloc_packet(pkt, avctx->height * stride)) < 0) {
-        av_log(avctx, AV_LOG_ERROR, "Error getting output packet.\n");
-        return ret;
-    }
-
-    bytestream2_init_writer(&p, pkt->data, pkt->size);
+typedef struct ThreadData {
+    const AVFrame *frame;
+    uint8_t *buf;
+    int stride;
+    int nb_jobs;
+} ThreadData;
 
 #define CLIP(v) av_clip(v, 4, 1019)
 
@@ -74,14 +71,31 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
         bytestream2_put_le32u(&p, val); \
     } while (0)
 
-    for (h = 0; h < avctx->height; h++) {
-        uint32_t val;
-        for (w = 0; w < avctx->width - 5; w += 6) {
-            WRITE_PIXELS(u, y, v);
-            WRITE_PIXELS(y, u, y);
-            WRITE_PIXELS(v, y, u);
-            WRITE_PIXELS(y, v, y);
-        }
+static int encode_rows(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    V210EncContext *s  = avctx->priv_data;
+    ThreadData *td     = arg;
+    const AVFrame *pic = td->frame;
+    int start = avctx->height *  jobnr      / td->nb_jobs;
+    int end   = avctx->height * (jobnr + 1) / td->nb_jobs;
+    int w     = avctx->width / 6 * 6;
+    int h;
+
+    for (h = start; h < end; h++) {
+        const uint16_t *y = (const uint16_t*)(pic->data[0] + h * pic->linesize[0]);
+        const uint16_t *u = (const uint16_t*)(pic->data[1] + h * pic->linesize[1]);
+        const uint16_t *v = (const uint16_t*)(pic->data[2] + h * pic->linesize[2]);
+        uint8_t *dst      = td->buf + h * td->stride;
+        PutByteContext p;
+        uint32_t val = 0;
+
+        s->dsp.pack_line(y, u, v, (uint32_t*)dst, w);
+        y += w;
+        u += w >> 1;
+        v += w >> 1;
+
+        bytestream2_init_writer(&p, dst + w / 6 * 16, td->stride - w / 6 * 16);
+
         if (w < avctx->width - 1) {
             WRITE_PIXELS(u, y, v);
 
@@ -97,13 +111,35 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
             bytestream2_put_le32u(&p, val);
         }
 
-        bytestream2_set_buffer(&p, 0, line_padding);
+        bytestream2_set_buffer(&p, 0, bytestream2_get_bytes_left_p(&p));
+    }
+
+    return 0;
+}
+
+static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
+                        const AVFrame *pic, int *got_packet)
+{
+    int aligned_width = ((avctx->width + 47) / 48) * 48;
+    int stride = aligned_width * 8 / 3;
+    ThreadData td;
+    int ret;
 
-        y += pic->linesize[0] / 2 - avctx->width;
-        u += pic->linesize[1] / 2 - avctx->width / 2;
-        v += pic->linesize[2] / 2 - avctx->width / 2;
+    if ((ret = ff_alloc_packet(pkt, avctx->height * stride)) < 0) {
+        av_log(avctx, AV_LOG_ERROR, "Error getting output packet.\n");
+        return ret;
     }
 
+    /* every row starts at a fixed offset, encode one band of rows per
+     * slice thread */
+    td.frame   = pic;
+    td.buf     = pkt->data;
+    td.stride  = stride;
+    td.nb_jobs = 1;
+    if (avctx->active_thread_type & FF_THREAD_SLICE)
+        td.nb_jobs = FFMIN(avctx->thread_count, avctx->height);
+    avctx->execute2(avctx, encode_rows, &td, NULL, td.nb_jobs);
+
     pkt->flags |= AV_PKT_FLAG_KEY;
     *got_packet = 1;
     return 0;
@@ -120,9 +156,11 @@ AVCodec ff_v210_encoder = {
     .name           = "v210",
     .type           = AVMEDIA_TYPE_VIDEO,
     .id             = AV_CODEC_ID_V210,
+    .priv_data_size = sizeof(V210EncContext),
     .init           = encode_init,
     .encode2        = encode_frame,
     .close          = encode_close,
+    .capabilities   = CODEC_CAP_SLICE_THREADS,
     .pix_fmts       = (const enum AVPixelFormat[]){ AV_PIX_FMT_YUV422P10, AV_PIX_FMT_NONE },
     .long_name      = NULL_IF_CONFIG_SMALL("Uncompressed 4:2:2 10-bit"),
 };
@@ -24,6 +24,14 @@
 #include "libavutil/intreadwrite.h"
 #include "avcodec.h"
 #include "internal.h"
+#include "thread.h"
+
+typedef struct ThreadData {
+    AVFrame *frame;
+    const uint8_t *buf;
+    int stride;
+    int nb_jobs;
+} ThreadData;
 
 static av_cold int v410_decode_init(AVCodecContext *avctx)
 {
@@ -42,21 +50,47 @@ static av_cold int v410_decode_init(AVCodecContext *avctx)
     return 0;
 }
 
+static int v410_decode_rows(AVCodecContext *avctx, void *arg,
+                            int jobnr, int threadnr)
+{
+    ThreadData *td = arg;
+    AVFrame *pic   = td->frame;
+    int start = avctx->height *  jobnr      / td->nb_jobs;
+    int end   = avctx->height * (jobnr + 1) / td->nb_jobs;
+    int i, j;
+
+    for (i = start; i < end; i++) {
+        const uint8_t *src = td->buf + i * td->stride;
+        uint16_t *y = (uint16_t *)(pic->data[0] + i * pic->linesize[0]);
+        uint16_t *u = (uint16_t *)(pic->data[1] + i * pic->linesize[1]);
+        uint16_t *v = (uint16_t *)(pic->data[2] + i * pic->linesize[2]);
+        uint32_t val;
+
+        for (j = 0; j < avctx->width; j++) {
+            val = AV_RL32(src + 4 * j);
+
+            u[j] = (val >>  2) & 0x3FF;
+            y[j] = (val >> 12) & 0x3FF;
+            v[j] = (val >> 22);
+        }
+    }
+
+    return 0;
+}
+
 static int v410_decode_frame(AVCodecContext *avctx, void *data,
                              int *got_frame, AVPacket *avpkt)
 {
+    ThreadFrame frame = { .f = data };
     AVFrame *pic = data;
-    uint8_t *src = avpkt->data;
-    uint16_t *y, *u, *v;
-    uint32_t val;
-    int i, j;
+    ThreadData td;
 
     if (avpkt->size < 4 * avctx->height * avctx->width) {
         av_log(avctx, AV_LOG_ERROR, "Insufficient input data.\n");
         return AVERROR(EINVAL);
     }
 
-    if (ff_get_buffer(avctx, pic, 0) < 0) {
+    if (ff_thread_get_buffer(avctx, &frame, 0) < 0) {
         av_log(avctx, AV_LOG_ERROR, "Could not allocate buffer.\n");
         return AVERROR(ENOMEM);
     }
@@ -64,25 +98,13 @@ static int v410_decode_frame(AVCodecContext *avctx, void *data,
     pic->key_frame = 1;
     pic->pict_type = AV_PICTURE_TYPE_I;
 
-    y = (uint16_t *)pic->data[0];
-    u = (uint16_t *)pic->data[1];
-    v = (uint16_t *)pic->data[2];
-
-    for (i = 0; i < avctx->height; i++) {
-        for (j = 0; j < avctx->width; j++) {
-            val = AV_RL32(src);
-
-            u[j] = (val >>  2) & 0x3FF;
-            y[j] = (val >> 12) & 0x3FF;
-            v[j] = (val >> 22);
-
-            src += 4;
-        }
-
-        y += pic->linesize[0] >> 1;
-        u += pic->linesize[1] >> 1;
-        v += pic->linesize[2] >> 1;
-    }
+    td.frame   = pic;
+    td.buf     = avpkt->data;
+    td.stride  = 4 * avctx->width;
+    td.nb_jobs = 1;
+    if (avctx->active_thread_type & FF_THREAD_SLICE)
+        td.nb_jobs = FFMIN(avctx->thread_count, avctx->height);
+    avctx->execute2(avctx, v410_decode_rows, &td, NULL, td.nb_jobs);
 
     *got_frame = 1;
 
@@ -95,6 +117,7 @@ AVCodec ff_v410_decoder = {
     .id           = AV_CODEC_ID_V410,
     .init         = v410_decode_init,
     .decode       = v410_decode_frame,
-    .capabilities = CODEC_CAP_DR1,
+    .capabilities = CODEC_CAP_DR1 | CODEC_CAP_SLICE_THREADS |
+                    CODEC_CAP_FRAME_THREADS,
     .long_name    = NULL_IF_CONFIG_SMALL("Uncompressed 4:4:4 10-bit"),
 };
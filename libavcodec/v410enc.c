@@ -25,6 +25,13 @@
 #include "avcodec.h"
 #include "internal.h"
 
+typedef struct ThreadData {
+    const AVFrame *frame;
+    uint8_t *buf;
+    int stride;
+    int nb_jobs;
+} ThreadData;
+
 static av_cold int v410_encode_init(AVCodecContext *avctx)
 {
     if (avctx->width & 1) {
@@ -42,39 +49,54 @@ static av_cold int v410_encode_init(AVCodecContext *avctx)
     return 0;
 }
 
+static int v410_encode_rows(AVCodecContext *avctx, void *arg,
+                            int jobnr, int threadnr)
+{
+    ThreadData *td     = arg;
+    const AVFrame *pic = td->frame;
+    int start = avctx->height *  jobnr      / td->nb_jobs;
+    int end   = avctx->height * (jobnr + 1) / td->nb_jobs;
+    int i, j;
+
+    for (i = start; i < end; i++) {
+        uint8_t *dst      = td->buf + i * td->stride;
+        const uint16_t *y = (const uint16_t *)(pic->data[0] + i * pic->linesize[0]);
+        const uint16_t *u = (const uint16_t *)(pic->data[1] + i * pic->linesize[1]);
+        const uint16_t *v = (const uint16_t *)(pic->data[2] + i * pic->linesize[2]);
+        uint32_t val;
+
+        for (j = 0; j < avctx->width; j++) {
+            val  = u[j] << 2;
+            val |= y[j] << 12;
+            val |= (uint32_t) v[j] << 22;
+            AV_WL32(dst + 4 * j, val);
+        }
+    }
+
+    return 0;
+}
+
 static int v410_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                              const AVFrame *pic, int *got_packet)
 {
-    uint8_t *dst;
-    uint16_t *y, *u, *v;
-    uint32_t val;
-    int i, j, ret;
+    ThreadData td;
+    int ret;
 
     if ((ret = ff_alloc_packet(pkt, avctx->width * avctx->height * 4)) < 0) {
         av_log(avctx, AV_LOG_ERROR, "Error getting output packet.\n");
         return ret;
     }
-    dst = pkt->data;
 
     avctx->coded_frame->key_frame = 1;
     avctx->coded_frame->pict_type = AV_PICTURE_TYPE_I;
 
-    y = (uint16_t *)pic->data[0];
-    u = (uint16_t *)pic->data[1];
-    v = (uint16_t *)pic->data[2];
-
-    for (i = 0; i < avctx->height; i++) {
-        for (j = 0; j < avctx->width; j++) {
-            val  = u[j] << 2;
-            val |= y[j] << 12;
-            val |= (uint32_t) v[j] << 22;
-            AV_WL32(dst, val);
-            dst += 4;
-        }
-        y += pic->linesize[0] >> 1;
-        u += pic->linesize[1] >> 1;
-        v += pic->linesize[2] >> 1;
-    }
+    td.frame   = pic;
+    td.buf     = pkt->data;
+    td.stride  = 4 * avctx->width;
+    td.nb_jobs = 1;
+    if (avctx->active_thread_type & FF_THREAD_SLICE)
+        td.nb_jobs = FFMIN(avctx->thread_count, avctx->height);
+    avctx->execute2(avctx, v410_encode_rows, &td, NULL, td.nb_jobs);
 
     pkt->flags |= AV_PKT_FLAG_KEY;
     *got_packet = 1;
@@ -95,6 +117,7 @@ AVCodec ff_v410_encoder = {
     .init         = v410_encode_init,
     .encode2      = v410_encode_frame,
     .close        = v410_encode_close,
+    .capabilities = CODEC_CAP_SLICE_THREADS,
     .pix_fmts     = (const enum AVPixelFormat[]){ AV_PIX_FMT_YUV444P10, AV_PIX_FMT_NONE },
     .long_name    = NULL_IF_CONFIG_SMALL("Uncompressed 4:4:4 10-bit"),
 };
@@ -39,7 +39,7 @@ static void free_buffers(VP8Context *s)
 {
     int i;
     if (s->thread_data)
-        for (i = 0; i < MAX_THREADS; i++) {
+        for (i = 0; i < s->num_thread_data; i++) {
 #if HAVE_THREADS
             pthread_cond_destroy(&s->thread_data[i].cond);
             pthread_mutex_destroy(&s->thread_data[i].lock);
@@ -138,9 +138,13 @@ static int update_dimensions(VP8Context *s, int width, int height)
         s->macroblocks_base       = av_mallocz((s->mb_width+2)*(s->mb_height+2)*sizeof(*s->macroblocks));
     s->top_nnz                    = av_mallocz(s->mb_width*sizeof(*s->top_nnz));
     s->top_border                 = av_mallocz((s->mb_width+1)*sizeof(*s->top_border));
-    s->thread_data                = av_mallocz(MAX_THREADS*sizeof(VP8ThreadData));
+    /* only as many jobs as threads run at once, and only one without
+     * slice threading */
+    s->num_thread_data            = avctx->active_thread_type == FF_THREAD_SLICE ?
+                                    av_clip(avctx->thread_count, 1, MAX_THREADS) : 1;
+    s->thread_data                = av_mallocz(s->num_thread_data*sizeof(VP8ThreadData));
 
-    for (i = 0; i < MAX_THREADS; i++) {
+    for (i = 0; i < s->num_thread_data; i++) {
         s->thread_data[i].filter_strength = av_mallocz(s->mb_width*sizeof(*s->thread_data[0].filter_strength));
 #if HAVE_THREADS
         pthread_mutex_init(&s->thread_data[i].lock, NULL);
@@ -1946,7 +1950,7 @@ int ff_vp8_decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
     s->uvlinesize = curframe->tf.f->linesize[1];
 
     if (!s->thread_data[0].edge_emu_buffer)
-        for (i = 0; i < MAX_THREADS; i++)
+        for (i = 0; i < s->num_thread_data; i++)
             s->thread_data[i].edge_emu_buffer = av_malloc(21*s->linesize);
 
     memset(s->top_nnz, 0, s->mb_width*sizeof(*s->top_nnz));
@@ -1983,7 +1987,7 @@ int ff_vp8_decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
     s->prev_frame = prev_frame;
     s->mv_min.y   = -MARGIN;
     s->mv_max.y   = ((s->mb_height - 1) << 6) + MARGIN;
-    for (i = 0; i < MAX_THREADS; i++) {
+    for (i = 0; i < num_jobs; i++) {
         s->thread_data[i].thread_mb_pos = 0;
         s->thread_data[i].wait_mb_pos = INT_MAX;
     }
@@ -129,9 +129,12 @@ typedef struct VP8Frame {
     AVBufferRef *seg_map;
 } VP8Frame;
 
+/* rows sharing a coefficient partition are decoded in order, so no more
+ * jobs than the 8 partitions allowed can run in parallel */
 #define MAX_THREADS 8
 typedef struct VP8Context {
     VP8ThreadData *thread_data;
+    int num_thread_data;
     AVCodecContext *avctx;
     VP8Frame *framep[4];
     VP8Frame *next_framep[4];
@@ -683,6 +683,12 @@ static av_cold void dsputil_init_sse4(DSPContext *c, AVCodecContext *avctx,
                                       int cpu_flags)
 {
 #if HAVE_SSE4_EXTERNAL
+#if ARCH_X86_64
+    if (avctx->bits_per_raw_sample == 10) {
+        c->idct_put = ff_simple_idct_put_10_sse4;
+        c->idct_add = ff_simple_idct_add_10_sse4;
+    }
+#endif /* ARCH_X86_64 */
     c->vector_clip_int32 = ff_vector_clip_int32_sse4;
 #endif /* HAVE_SSE4_EXTERNAL */
 }
@@ -711,7 +717,7 @@ av_cold void ff_dsputil_init_x86(DSPContext *c, AVCodecContext *avctx)
     if (EXTERNAL_SSSE3(cpu_flags))
         dsputil_init_ssse3(c, avctx, cpu_flags);
 
-    if (EXTERNAL_SSE4(cpu_flags))
+    if (X86_SSE4(cpu_flags))
         dsputil_init_sse4(c, avctx, cpu_flags);
 
     if (CONFIG_ENCODERS)
@@ -30,6 +30,9 @@ SECTION_RODATA
 
 pb_A1: times 16 db 0xA1
 pb_3_1: times 4 db 3, 1
+pw_4_avx2: times 16 dw 4
+; tc0[0..3] to one byte per pixel of a 16-pixel edge
+pb_tc0_shuf: db 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3
 
 SECTION .text
 
@@ -392,6 +395,200 @@ DEBLOCK_LUMA
 INIT_XMM avx
 DEBLOCK_LUMA
 
+%if HAVE_AVX2_EXTERNAL
+; The bS < 4 luma filter of 16 pixels across an edge, on words.
+; in: m1..m6 = p2 p1 p0 q0 q1 q2, m13 = alpha, m14 = beta, m15 = tc0
+; out: m2..m5 = p1 p0 q0 q1
+%macro LUMA_FILTER_W 0
+    ; mask = |p0-q0| < alpha && |p1-p0| < beta && |q1-q0| < beta && tc0 >= 0
+    psubw       m7, m3, m4
+    pabsw       m7, m7
+    pcmpgtw     m0, m13, m7
+    psubw       m7, m2, m3
+    pabsw       m7, m7
+    pcmpgtw     m7, m14, m7
+    pand        m0, m7
+    psubw       m7, m5, m4
+    pabsw       m7, m7
+    pcmpgtw     m7, m14, m7
+    pand        m0, m7
+    pcmpeqw     m7, m7
+    pcmpgtw     m7, m15, m7
+    pand        m0, m7
+    ; ap = |p2-p0| < beta, aq = |q2-q0| < beta, both within the mask
+    psubw       m8, m1, m3
+    pabsw       m8, m8
+    pcmpgtw     m8, m14, m8
+    pand        m8, m0
+    psubw       m9, m6, m4
+    pabsw       m9, m9
+    pcmpgtw     m9, m14, m9
+    pand        m9, m0
+    ; tc = tc0 + ap + aq
+    psubw      m10, m15, m8
+    psubw      m10, m9
+    ; p1 += ap & clip(((p2 + ((p0 + q0 + 1) >> 1)) >> 1) - p1, -tc0, tc0)
+    pavgw      m11, m3, m4
+    pxor       m12, m12
+    psubw      m12, m15
+    paddw       m7, m1, m11
+    psraw       m7, 1
+    psubw       m7, m2
+    pminsw      m7, m15
+    pmaxsw      m7, m12
+    pand        m7, m8
+    ; q1 likewise with aq
+    paddw       m1, m6, m11
+    psraw       m1, 1
+    psubw       m1, m5
+    pminsw      m1, m15
+    pmaxsw      m1, m12
+    pand        m1, m9
+    ; delta = mask & clip((((q0 - p0) << 2) + (p1 - q1) + 4) >> 3, -tc, tc)
+    psubw      m11, m4, m3
+    psllw      m11, 2
+    paddw      m11, m2
+    psubw      m11, m5
+    paddw      m11, [pw_4_avx2]
+    psraw      m11, 3
+    pxor       m12, m12
+    psubw      m12, m10
+    pminsw     m11, m10
+    pmaxsw     m11, m12
+    pand       m11, m0
+    paddw       m2, m7
+    paddw       m3, m11
+    psubw       m4, m11
+    paddw       m5, m1
+%endmacro
+
+%macro LUMA_FILTER_W_INIT 3 ; alpha, beta, tc0
+    vmovd      xmm13, %1
+    vmovd      xmm14, %2
+    vmovd      xmm15, [%3]
+    vpbroadcastw m13, xmm13
+    vpbroadcastw m14, xmm14
+    vpshufb    xmm15, xmm15, [pb_tc0_shuf]
+    vpmovsxbw    m15, xmm15
+%endmacro
+
+INIT_YMM avx2
+;-----------------------------------------------------------------------------
+; void deblock_v_luma( uint8_t *pix, int stride, int alpha, int beta, int8_t *tc0 )
+;-----------------------------------------------------------------------------
+cglobal deblock_v_luma_8, 5,6,16, pix, stride, alpha, beta, tc0, p
+    movsxdifnidn strideq, strided
+    LUMA_FILTER_W_INIT alphad, betad, tc0q
+    lea          pq, [strideq*3]
+    neg          pq
+    add          pq, pixq      ; pix-3*stride
+    vpmovzxbw    m1, [pq]
+    vpmovzxbw    m2, [pq+strideq]
+    vpmovzxbw    m3, [pq+strideq*2]
+    vpmovzxbw    m4, [pixq]
+    vpmovzxbw    m5, [pixq+strideq]
+    vpmovzxbw    m6, [pixq+strideq*2]
+    LUMA_FILTER_W
+    packuswb     m2, m3
+    packuswb     m4, m5
+    vpermq       m2, m2, 0xD8
+    vpermq       m4, m4, 0xD8
+    movu         [pq+strideq], xmm2
+    vextracti128 [pq+strideq*2], m2, 1
+    movu         [pixq], xmm4
+    vextracti128 [pixq+strideq], m4, 1
+    RET
+
+; row %1 of the edge to the low and row %1 + 8 to the high lane of m%1
+%macro LOAD_ROWS_H 3 ; row, src rows 0-7, src rows 8-15
+    vmovq       xmm%1, [%2]
+    vmovq        xmm8, [%3]
+    vinserti128   m%1, m%1, xmm8, 1
+%endmacro
+
+;-----------------------------------------------------------------------------
+; void deblock_h_luma( uint8_t *pix, int stride, int alpha, int beta, int8_t *tc0 )
+;-----------------------------------------------------------------------------
+cglobal deblock_h_luma_8, 5,9,16, pix, stride, alpha, beta, tc0, p, p8, stride3, q
+    movsxdifnidn strideq, strided
+    LUMA_FILTER_W_INIT alphad, betad, tc0q
+    lea    stride3q, [strideq*3]
+    lea          pq, [pixq-4]
+    lea         p8q, [pq+strideq*8]
+    ; rows 0-7 in the low lanes, 8-15 in the high lanes
+    LOAD_ROWS_H 0, pq, p8q
+    LOAD_ROWS_H 1, pq+strideq, p8q+strideq
+    LOAD_ROWS_H 2, pq+strideq*2, p8q+strideq*2
+    LOAD_ROWS_H 3, pq+stride3q, p8q+stride3q
+    lea          pq, [pq+strideq*4]
+    lea         p8q, [p8q+strideq*4]
+    LOAD_ROWS_H 4, pq, p8q
+    LOAD_ROWS_H 5, pq+strideq, p8q+strideq
+    LOAD_ROWS_H 6, pq+strideq*2, p8q+strideq*2
+    LOAD_ROWS_H 7, pq+stride3q, p8q+stride3q
+    ; 8x8 byte transpose per lane: columns p3 p2, p1 p0, q0 q1, q2 q3
+    ; in the two qwords of m8..m11
+    punpcklbw    m0, m1
+    punpcklbw    m2, m3
+    punpcklbw    m4, m5
+    punpcklbw    m6, m7
+    punpcklwd    m1, m0, m2
+    punpckhwd    m3, m0, m2
+    punpcklwd    m5, m4, m6
+    punpckhwd    m7, m4, m6
+    punpckldq    m8, m1, m5
+    punpckhdq    m9, m1, m5
+    punpckldq   m10, m3, m7
+    punpckhdq   m11, m3, m7
+    ; one column of 16 rows per xmm: p2 = m8 high, p1 p0 = m9,
+    ; q0 q1 = m10, q2 = m11 low
+    vpermq       m8, m8, 0xD8
+    vpermq       m9, m9, 0xD8
+    vpermq      m10, m10, 0xD8
+    vpermq      m11, m11, 0xD8
+    vextracti128 xmm1, m8, 1
+    vextracti128 xmm3, m9, 1
+    vextracti128 xmm5, m10, 1
+    vpmovzxbw    m1, xmm1
+    vpmovzxbw    m2, xmm9
+    vpmovzxbw    m3, xmm3
+    vpmovzxbw    m4, xmm10
+    vpmovzxbw    m5, xmm5
+    vpmovzxbw    m6, xmm11
+    LUMA_FILTER_W
+    ; back to bytes and rows of p1 p0 q0 q1
+    packuswb     m2, m3
+    packuswb     m4, m5
+    psrldq       m3, m2, 8
+    psrldq       m5, m4, 8
+    punpcklbw    m2, m3
+    punpcklbw    m4, m5
+    punpcklwd    m0, m2, m4
+    punpckhwd    m1, m2, m4
+    vextracti128 xmm2, m0, 1
+    vextracti128 xmm3, m1, 1
+    lea          pq, [pixq+strideq*4]
+    lea         p8q, [pixq+strideq*8]
+    lea          qq, [p8q+strideq*4]
+    vmovd        [pixq-2], xmm0
+    vpextrd      [pixq+strideq-2], xmm0, 1
+    vpextrd      [pixq+strideq*2-2], xmm0, 2
+    vpextrd      [pixq+stride3q-2], xmm0, 3
+    vmovd        [pq-2], xmm1
+    vpextrd      [pq+strideq-2], xmm1, 1
+    vpextrd      [pq+strideq*2-2], xmm1, 2
+    vpextrd      [pq+stride3q-2], xmm1, 3
+    vmovd        [p8q-2], xmm2
+    vpextrd      [p8q+strideq-2], xmm2, 1
+    vpextrd      [p8q+strideq*2-2], xmm2, 2
+    vpextrd      [p8q+stride3q-2], xmm2, 3
+    vmovd        [qq-2], xmm3
+    vpextrd      [qq+strideq-2], xmm3, 1
+    vpextrd      [qq+strideq*2-2], xmm3, 2
+    vpextrd      [qq+stride3q-2], xmm3, 3
+    RET
+%endif ; HAVE_AVX2_EXTERNAL
+
 %else
 
 %macro DEBLOCK_LUMA 2
@@ -1070,3 +1070,137 @@ INIT_MMX mmx
 IDCT_DC_DEQUANT 0
 INIT_MMX sse2
 IDCT_DC_DEQUANT 7
+
+%if HAVE_AVX2_EXTERNAL && ARCH_X86_64
+; the two 16-pixel rows at %6 and %6+%7 += %1 >> %5 and %2 >> %5
+%macro STORE_DIFF16x2 7 ; add1, add2, reg1, reg2, shift, dst, stride
+    psraw         %1, %5
+    psraw         %2, %5
+    vpmovzxbw     %3, [%6]
+    vpmovzxbw     %4, [%6+%7]
+    paddw         %1, %3
+    paddw         %2, %4
+    packuswb      %1, %2
+    vpermq        %1, %1, 0xD8
+    vextracti128  [%6], %1, 0
+    vextracti128  [%6+%7], %1, 1
+%endmacro
+
+INIT_YMM avx2
+ALIGN 16
+; r0 = uint8_t *dst (clobbered), r6 = int16_t *block, r3 = int stride
+; the 4x4 blocks at r6, r6+32, r6+128 and r6+160 cover 16x4 pixels,
+; the lanes hold the left and right 8x4 halves
+h264_add16x4_idct_avx2:
+    movu          xmm4, [r6+  0]
+    movu          xmm5, [r6+ 32]
+    movu          xmm6, [r6+ 16]
+    movu          xmm7, [r6+ 48]
+    vinserti128     m4, m4, [r6+128], 1
+    vinserti128     m5, m5, [r6+160], 1
+    vinserti128     m6, m6, [r6+144], 1
+    vinserti128     m7, m7, [r6+176], 1
+    punpcklqdq      m0, m4, m5
+    punpckhqdq      m1, m4, m5
+    punpcklqdq      m2, m6, m7
+    punpckhqdq      m3, m6, m7
+    IDCT4_1D w,0,1,2,3,4,5
+    TRANSPOSE2x4x4W 0,1,2,3,4
+    vpbroadcastw    m4, [pw_32]
+    paddw           m0, m4
+    IDCT4_1D w,0,1,2,3,4,5
+    pxor            m7, m7
+    movu     [r6+  0], m7
+    movu     [r6+ 32], m7
+    movu     [r6+128], m7
+    movu     [r6+160], m7
+    STORE_DIFF16x2  m0, m1, m4, m5, 6, r0, r3
+    lea             r0, [r0+r3*2]
+    STORE_DIFF16x2  m2, m3, m4, m5, 6, r0, r3
+    ret
+
+%macro add16_avx2_cycle 2
+    mov        r0d, dword [r4+%2]
+    test       r0d, r0d
+    jz .cycle%1end
+    mov        r0d, dword [r1+%1*4]
+    add         r0, r5
+    lea         r6, [r2+%1*32]
+    call        h264_add16x4_idct_avx2
+.cycle%1end:
+%endmacro
+
+; ff_h264_idct_add16_avx2(uint8_t *dst, const int *block_offset,
+;                         int16_t *block, int stride, const uint8_t nnzc[6*8])
+cglobal h264_idct_add16_8, 5, 7, 8
+    movsxdifnidn r3, r3d
+    mov         r5, r0
+    ; like the sse2 version, coded groups of blocks are transformed in full
+    add16_avx2_cycle 0, 0xc
+    add16_avx2_cycle 2, 0x14
+    add16_avx2_cycle 8, 0x1c
+    add16_avx2_cycle 10, 0x24
+    RET
+
+ALIGN 16
+; r0 = uint8_t *dst (clobbered), r6 = int16_t *block, r3 = int stride
+; the 8x8 blocks at r6 and r6+128 side by side, one per lane
+h264_add16x8_idct8_avx2:
+%assign i 1
+%rep 7
+%if i != 4
+    movu          xmm %+ i, [r6+16*i]
+    vinserti128     m %+ i, m %+ i, [r6+16*i+128], 1
+%endif
+%assign i i+1
+%endrep
+    movu          xmm8, [r6]
+    movu          xmm9, [r6+64]
+    vinserti128     m8, m8, [r6+128], 1
+    vinserti128     m9, m9, [r6+192], 1
+    IDCT8_1D        m8, m9
+    TRANSPOSE8x8W   0, 1, 2, 3, 4, 5, 6, 7, 8
+    vpbroadcastw    m8, [pw_32]
+    paddw           m0, m8
+    SWAP             0, 8
+    SWAP             4, 9
+    IDCT8_1D        m8, m9
+    SWAP             6, 8
+    SWAP             7, 9
+    STORE_DIFF16x2  m0, m1, m6, m7, 6, r0, r3
+    lea             r0, [r0+r3*2]
+    STORE_DIFF16x2  m2, m3, m6, m7, 6, r0, r3
+    lea             r0, [r0+r3*2]
+    STORE_DIFF16x2  m4, m5, m6, m7, 6, r0, r3
+    lea             r0, [r0+r3*2]
+    STORE_DIFF16x2  m8, m9, m6, m7, 6, r0, r3
+    pxor            m7, m7
+%assign i 0
+%rep 8
+    movu  [r6+32*i], m7
+%assign i i+1
+%endrep
+    ret
+
+%macro add8x8_avx2_cycle 3
+    movzx      r0d, byte [r4+%2]
+    movzx      r6d, byte [r4+%3]
+    or         r0d, r6d
+    jz .cycle%1end
+    mov        r0d, dword [r1+%1*4]
+    add         r0, r5
+    lea         r6, [r2+%1*32]
+    call        h264_add16x8_idct8_avx2
+.cycle%1end:
+%endmacro
+
+; ff_h264_idct8_add4_avx2(uint8_t *dst, const int *block_offset,
+;                         int16_t *block, int stride, const uint8_t nnzc[6*8])
+cglobal h264_idct8_add4_8, 5, 7, 10
+    movsxdifnidn r3, r3d
+    mov         r5, r0
+    ; a DC-only block is transformed in full, which gives the DC add result
+    add8x8_avx2_cycle 0, 0xc, 0xe
+    add8x8_avx2_cycle 8, 0x1c, 0x1e
+    RET
+%endif ; HAVE_AVX2_EXTERNAL && ARCH_X86_64
@@ -500,6 +500,119 @@ QPEL16_OP(mc33, MMX)
 QPEL16(mmxext)
 #endif
 
+#if ARCH_X86_64
+#define DEF_QPEL_AVX2(OPNAME)\
+void ff_ ## OPNAME ## h264_qpel16_h_lowpass_avx2(uint8_t *dst, uint8_t *src, int dstStride, int srcStride);\
+void ff_ ## OPNAME ## h264_qpel8_h_lowpass_avx2(uint8_t *dst, uint8_t *src, int dstStride, int srcStride);\
+void ff_ ## OPNAME ## h264_qpel16_v_lowpass_avx2(uint8_t *dst, uint8_t *src, int dstStride, int srcStride);\
+void ff_ ## OPNAME ## h264_qpel8_v_lowpass_avx2(uint8_t *dst, uint8_t *src, int dstStride, int srcStride);\
+void ff_ ## OPNAME ## h264_qpel16_hv2_lowpass_avx2(uint8_t *dst, int16_t *tmp, int dstStride);\
+void ff_ ## OPNAME ## h264_qpel8_hv2_lowpass_avx2(uint8_t *dst, int16_t *tmp, int dstStride);\
+void ff_ ## OPNAME ## pixels16_l2_avx2(uint8_t *dst, uint8_t *src1, uint8_t *src2, int dstStride, int src1Stride, int h);\
+void ff_ ## OPNAME ## pixels8_l2_avx2(uint8_t *dst, uint8_t *src1, uint8_t *src2, int dstStride, int src1Stride, int h);\
+\
+static av_always_inline void ff_ ## OPNAME ## h264_qpel16_hv_lowpass_avx2(uint8_t *dst, uint8_t *src, int dstStride, int srcStride){\
+    DECLARE_ALIGNED(32, int16_t, tmp)[21 * 16];\
+    ff_h264_qpel16_hv1_lowpass_avx2(src, tmp, srcStride);\
+    ff_ ## OPNAME ## h264_qpel16_hv2_lowpass_avx2(dst, tmp, dstStride);\
+}\
+static av_always_inline void ff_ ## OPNAME ## h264_qpel8_hv_lowpass_avx2(uint8_t *dst, uint8_t *src, int dstStride, int srcStride){\
+    DECLARE_ALIGNED(32, int16_t, tmp)[13 * 8];\
+    ff_h264_qpel8_hv1_lowpass_avx2(src, tmp, srcStride);\
+    ff_ ## OPNAME ## h264_qpel8_hv2_lowpass_avx2(dst, tmp, dstStride);\
+}
+
+void ff_h264_qpel16_hv1_lowpass_avx2(uint8_t *src, int16_t *tmp, int srcStride);
+void ff_h264_qpel8_hv1_lowpass_avx2(uint8_t *src, int16_t *tmp, int srcStride);
+
+DEF_QPEL_AVX2(put_)
+DEF_QPEL_AVX2(avg_)
+
+/* 8-bit luma MC with 256-bit registers. The quarter positions average two
+ * of the filtered planes, exactly like the C versions. */
+
+#define H264_MC_H_AVX2(OPNAME, SIZE, MC, OFF)                               \
+static void OPNAME ## h264_qpel ## SIZE ## _ ## MC ## _avx2(uint8_t *dst,   \
+                                                          uint8_t *src,     \
+                                                          ptrdiff_t stride) \
+{                                                                           \
+    DECLARE_ALIGNED(16, uint8_t, half)[SIZE * SIZE];                        \
+    ff_put_h264_qpel ## SIZE ## _h_lowpass_avx2(half, src, SIZE, stride);   \
+    ff_ ## OPNAME ## pixels ## SIZE ## _l2_avx2(dst, src + (OFF), half,     \
+                                                stride, stride, SIZE);      \
+}
+
+#define H264_MC_V_AVX2(OPNAME, SIZE, MC, OFF)                               \
+static void OPNAME ## h264_qpel ## SIZE ## _ ## MC ## _avx2(uint8_t *dst,   \
+                                                          uint8_t *src,     \
+                                                          ptrdiff_t stride) \
+{                                                                           \
+    DECLARE_ALIGNED(16, uint8_t, half)[SIZE * SIZE];                        \
+    ff_put_h264_qpel ## SIZE ## _v_lowpass_avx2(half, src, SIZE, stride);   \
+    ff_ ## OPNAME ## pixels ## SIZE ## _l2_avx2(dst, src + (OFF), half,     \
+                                                stride, stride, SIZE);      \
+}
+
+/* average of two filtered planes, A is one of h, v and B one of v, hv */
+#define H264_MC_2D_AVX2(OPNAME, SIZE, MC, A, AOFF, B, BOFF)                 \
+static void OPNAME ## h264_qpel ## SIZE ## _ ## MC ## _avx2(uint8_t *dst,   \
+                                                          uint8_t *src,     \
+                                                          ptrdiff_t stride) \
+{                                                                           \
+    DECLARE_ALIGNED(16, uint8_t, halfA)[SIZE * SIZE];                       \
+    DECLARE_ALIGNED(16, uint8_t, halfB)[SIZE * SIZE];                       \
+    ff_put_h264_qpel ## SIZE ## _ ## A ## _lowpass_avx2(halfA, src + (AOFF), \
+                                                        SIZE, stride);      \
+    ff_put_h264_qpel ## SIZE ## _ ## B ## _lowpass_avx2(halfB, src + (BOFF), \
+                                                        SIZE, stride);      \
+    ff_ ## OPNAME ## pixels ## SIZE ## _l2_avx2(dst, halfA, halfB,          \
+                                                stride, SIZE, SIZE);        \
+}
+
+#define H264_MC_AVX2(OPNAME, SIZE)                                          \
+H264_MC_H_AVX2(OPNAME, SIZE, mc10, 0)                                       \
+H264_MC_H_AVX2(OPNAME, SIZE, mc30, 1)                                       \
+H264_MC_V_AVX2(OPNAME, SIZE, mc01, 0)                                       \
+H264_MC_V_AVX2(OPNAME, SIZE, mc03, stride)                                  \
+H264_MC_2D_AVX2(OPNAME, SIZE, mc11, h, 0,      v,  0)                       \
+H264_MC_2D_AVX2(OPNAME, SIZE, mc31, h, 0,      v,  1)                       \
+H264_MC_2D_AVX2(OPNAME, SIZE, mc13, h, stride, v,  0)                       \
+H264_MC_2D_AVX2(OPNAME, SIZE, mc33, h, stride, v,  1)                       \
+H264_MC_2D_AVX2(OPNAME, SIZE, mc21, h, 0,      hv, 0)                       \
+H264_MC_2D_AVX2(OPNAME, SIZE, mc23, h, stride, hv, 0)                       \
+H264_MC_2D_AVX2(OPNAME, SIZE, mc12, v, 0,      hv, 0)                       \
+H264_MC_2D_AVX2(OPNAME, SIZE, mc32, v, 1,      hv, 0)                       \
+                                                                            \
+static void OPNAME ## h264_qpel ## SIZE ## _mc20_avx2(uint8_t *dst,         \
+                                                      uint8_t *src,         \
+                                                      ptrdiff_t stride)     \
+{                                                                           \
+    ff_ ## OPNAME ## h264_qpel ## SIZE ## _h_lowpass_avx2(dst, src,         \
+                                                          stride, stride);  \
+}                                                                           \
+                                                                            \
+static void OPNAME ## h264_qpel ## SIZE ## _mc02_avx2(uint8_t *dst,         \
+                                                      uint8_t *src,         \
+                                                      ptrdiff_t stride)     \
+{                                                                           \
+    ff_ ## OPNAME ## h264_qpel ## SIZE ## _v_lowpass_avx2(dst, src,         \
+                                                          stride, stride);  \
+}                                                                           \
+                                                                            \
+static void OPNAME ## h264_qpel ## SIZE ## _mc22_avx2(uint8_t *dst,         \
+                                                      uint8_t *src,         \
+                                                      ptrdiff_t stride)     \
+{                                                                           \
+    ff_ ## OPNAME ## h264_qpel ## SIZE ## _hv_lowpass_avx2(dst, src,        \
+                                                           stride, stride); \
+}
+
+H264_MC_AVX2(put_, 16)
+H264_MC_AVX2(put_,  8)
+H264_MC_AVX2(avg_, 16)
+H264_MC_AVX2(avg_,  8)
+#endif /* ARCH_X86_64 */
+
 #endif /* HAVE_YASM */
 
 #define SET_QPEL_FUNCS(PFX, IDX, SIZE, CPU, PREFIX)                          \
@@ -540,10 +653,10 @@ QPEL16(mmxext)
 
 av_cold void ff_h264qpel_init_x86(H264QpelContext *c, int bit_depth)
 {
-#if HAVE_YASM
     int high_bit_depth = bit_depth > 8;
     int cpu_flags = av_get_cpu_flags();
 
+#if HAVE_YASM
     if (EXTERNAL_MMXEXT(cpu_flags)) {
         if (!high_bit_depth) {
             SET_QPEL_FUNCS(put_h264_qpel, 0, 16, mmxext, );
@@ -630,5 +743,25 @@ av_cold void ff_h264qpel_init_x86(H264QpelContext *c, int bit_depth)
             H264_QPEL_FUNCS_10(3, 0, sse2);
         }
     }
-#endif
+
+#if ARCH_X86_64
+    if (EXTERNAL_AVX2(cpu_flags) && !high_bit_depth) {
+        H264_QPEL_FUNCS(0, 1, avx2);
+        H264_QPEL_FUNCS(0, 2, avx2);
+        H264_QPEL_FUNCS(0, 3, avx2);
+        H264_QPEL_FUNCS(1, 0, avx2);
+        H264_QPEL_FUNCS(1, 1, avx2);
+        H264_QPEL_FUNCS(1, 2, avx2);
+        H264_QPEL_FUNCS(1, 3, avx2);
+        H264_QPEL_FUNCS(2, 0, avx2);
+        H264_QPEL_FUNCS(2, 1, avx2);
+        H264_QPEL_FUNCS(2, 2, avx2);
+        H264_QPEL_FUNCS(2, 3, avx2);
+        H264_QPEL_FUNCS(3, 0, avx2);
+        H264_QPEL_FUNCS(3, 1, avx2);
+        H264_QPEL_FUNCS(3, 2, avx2);
+        H264_QPEL_FUNCS(3, 3, avx2);
+    }
+#endif /* ARCH_X86_64 */
+#endif /* HAVE_YASM */
 }
@@ -27,7 +27,12 @@
 
 SECTION_RODATA 32
 
+pw_1_m5: times 8 dw 1, -5
+pw_m5_1: times 8 dw -5, 1
+pd_512:  times 8 dd 512
+
 cextern pw_16
+cextern pw_20
 cextern pw_5
 cextern pb_0
 
@@ -860,3 +865,381 @@ INIT_XMM ssse3
 QPEL16_H_LOWPASS_L2_OP put
 QPEL16_H_LOWPASS_L2_OP avg
 %endif
+
+
+%if HAVE_AVX2_EXTERNAL && ARCH_X86_64
+; The 6-tap filter on words: a 16-pixel row fills one register and the
+; 8-pixel versions keep two rows in the two lanes. The centre (hv) position
+; filters horizontally into a word buffer without rounding (hv1), then
+; vertically in dwords with pmaddwd (hv2).
+;
+; The filter is a + 5 * (4 * c - b), with a = s[-2] + s[3],
+; b = s[-1] + s[2] and c = s[0] + s[1]; m13 holds pw_5.
+
+; %1 = filter of the 16 pixels at %2
+%macro QPEL_FILTER_H16 4 ; dst, src, tmp1, tmp2
+    vpmovzxbw     %3, [%2]
+    vpmovzxbw     %4, [%2+1]
+    paddw         %3, %4
+    psllw         %3, 2
+    vpmovzxbw     %1, [%2-1]
+    vpmovzxbw     %4, [%2+2]
+    paddw         %1, %4
+    psubw         %3, %1
+    pmullw        %3, m13
+    vpmovzxbw     %1, [%2-2]
+    vpmovzxbw     %4, [%2+3]
+    paddw         %1, %4
+    paddw         %1, %3
+%endmacro
+
+; %2 = filter of the two 8-pixel rows whose bytes from s[-2] on are in
+; the lanes of %1, m12 is zero
+%macro QPEL_FILTER_H8 4 ; src, dst, tmp1, tmp2
+    psrldq        %3, %1, 2
+    psrldq        %4, %1, 3
+    punpcklbw     %3, m12
+    punpcklbw     %4, m12
+    paddw         %3, %4
+    psllw         %3, 2
+    psrldq        %2, %1, 1
+    psrldq        %4, %1, 4
+    punpcklbw     %2, m12
+    punpcklbw     %4, m12
+    paddw         %2, %4
+    psubw         %3, %2
+    pmullw        %3, m13
+    psrldq        %4, %1, 5
+    punpcklbw     %2, %1, m12
+    punpcklbw     %4, m12
+    paddw         %2, %4
+    paddw         %2, %3
+%endmacro
+
+; %7 = filter of the rows in %1 to %6
+%macro QPEL_FILTER_V 8 ; r0, r1, r2, r3, r4, r5, dst, tmp
+    paddw         %8, %3, %4
+    psllw         %8, 2
+    paddw         %7, %2, %5
+    psubw         %8, %7
+    pmullw        %8, m13
+    paddw         %7, %1, %6
+    paddw         %7, %8
+%endmacro
+
+; (x + 16) >> 5, m15 holds pw_16
+%macro QPEL_ROUND5 1
+    paddw         %1, m15
+    psraw         %1, 5
+%endmacro
+
+; %1 = (filter of the word rows in %1 to %6 + 512) >> 10, in dwords;
+; m12-15 hold pw_1_m5, pw_20, pw_m5_1 and pd_512
+%macro QPEL_FILTER_HV 7 ; r0, r1, r2, r3, r4, r5, tmp
+    punpckhwd     %7, %1, %2
+    punpcklwd     %1, %2
+    punpckhwd     %2, %3, %4
+    punpcklwd     %3, %4
+    punpckhwd     %4, %5, %6
+    punpcklwd     %5, %6
+    pmaddwd       %1, m12
+    pmaddwd       %7, m12
+    pmaddwd       %3, m13
+    pmaddwd       %2, m13
+    pmaddwd       %5, m14
+    pmaddwd       %4, m14
+    paddd         %1, %3
+    paddd         %7, %2
+    paddd         %1, %5
+    paddd         %7, %4
+    paddd         %1, m15
+    paddd         %7, m15
+    psrad         %1, 10
+    psrad         %7, 10
+    packssdw      %1, %7
+%endmacro
+
+; two 16-pixel word rows to the two lanes of %1, as bytes
+%macro QPEL_PACK16 2
+    packuswb      %1, %2
+    vpermq        %1, %1, 0xD8
+%endmacro
+
+; words of one 16-pixel row or of two 8-pixel rows to bytes in the low lane
+%macro QPEL_PACK8 1
+    packuswb      %1, %1
+    vpermq        %1, %1, 0x08
+%endmacro
+
+; store (or average into) two 16-pixel rows from the lanes of register %2
+%macro QPEL_OP16_2 5 ; put/avg, reg, tmp, row0, row1
+%ifidn %1, avg
+    vmovdqu    xmm%3, %4
+    vinserti128  m%3, m%3, %5, 1
+    pavgb        m%2, m%3
+%endif
+    vmovdqu       %4, xmm%2
+    vextracti128  %5, m%2, 1
+%endmacro
+
+%macro QPEL_OP16_1 3 ; put/avg, reg, row
+%ifidn %1, avg
+    vpavgb     xmm%2, xmm%2, %3
+%endif
+    vmovdqu       %3, xmm%2
+%endmacro
+
+; store (or average into) two 8-pixel rows from the qwords of xmm%2
+%macro QPEL_OP8_2 5 ; put/avg, reg, tmp, row0, row1
+%ifidn %1, avg
+    vmovq      xmm%3, %4
+    vmovhps    xmm%3, xmm%3, %5
+    vpavgb     xmm%2, xmm%2, xmm%3
+%endif
+    vmovq         %4, xmm%2
+    vmovhps       %5, xmm%2
+%endmacro
+
+%macro QPEL_LOWPASS_AVX2 1
+cglobal %1_h264_qpel16_h_lowpass, 4,5,16 ; dst, src, dstStride, srcStride
+    movsxdifnidn  r2, r2d
+    movsxdifnidn  r3, r3d
+    vpbroadcastw m13, [pw_5]
+    vpbroadcastw m15, [pw_16]
+    mov          r4d, 8
+.loop:
+    QPEL_FILTER_H16 m0, r1, m1, m2
+    QPEL_FILTER_H16 m3, r1+r3, m4, m5
+    QPEL_ROUND5   m0
+    QPEL_ROUND5   m3
+    QPEL_PACK16   m0, m3
+    QPEL_OP16_2   %1, 0, 1, [r0], [r0+r2]
+    lea           r1, [r1+r3*2]
+    lea           r0, [r0+r2*2]
+    dec          r4d
+    jnz .loop
+    RET
+
+cglobal %1_h264_qpel8_h_lowpass, 4,5,16 ; dst, src, dstStride, srcStride
+    movsxdifnidn  r2, r2d
+    movsxdifnidn  r3, r3d
+    vpbroadcastw m13, [pw_5]
+    vpbroadcastw m15, [pw_16]
+    pxor         m12, m12
+    mov          r4d, 2
+.loop:
+    vmovdqu     xmm0, [r1-2]
+    vinserti128   m0, m0, [r1+r3-2], 1
+    lea           r1, [r1+r3*2]
+    vmovdqu     xmm4, [r1-2]
+    vinserti128   m4, m4, [r1+r3-2], 1
+    lea           r1, [r1+r3*2]
+    QPEL_FILTER_H8 m0, m1, m2, m3
+    QPEL_FILTER_H8 m4, m5, m6, m7
+    QPEL_ROUND5   m1
+    QPEL_ROUND5   m5
+    QPEL_PACK8    m1
+    QPEL_PACK8    m5
+    QPEL_OP8_2    %1, 1, 2, [r0], [r0+r2]
+    lea           r0, [r0+r2*2]
+    QPEL_OP8_2    %1, 5, 6, [r0], [r0+r2]
+    lea           r0, [r0+r2*2]
+    dec          r4d
+    jnz .loop
+    RET
+
+cglobal %1_h264_qpel16_v_lowpass, 4,5,16 ; dst, src, dstStride, srcStride
+    movsxdifnidn  r2, r2d
+    movsxdifnidn  r3, r3d
+    vpbroadcastw m13, [pw_5]
+    vpbroadcastw m15, [pw_16]
+    sub           r1, r3
+    sub           r1, r3
+    vpmovzxbw     m0, [r1]
+    vpmovzxbw     m1, [r1+r3]
+    lea           r1, [r1+r3*2]
+    vpmovzxbw     m2, [r1]
+    vpmovzxbw     m3, [r1+r3]
+    lea           r1, [r1+r3*2]
+    vpmovzxbw     m4, [r1]
+    mov          r4d, 8
+.loop:
+    vpmovzxbw     m5, [r1+r3]
+    lea           r1, [r1+r3*2]
+    vpmovzxbw     m6, [r1]
+    QPEL_FILTER_V m0, m1, m2, m3, m4, m5, m7, m9
+    QPEL_FILTER_V m1, m2, m3, m4, m5, m6, m8, m10
+    QPEL_ROUND5   m7
+    QPEL_ROUND5   m8
+    QPEL_PACK16   m7, m8
+    QPEL_OP16_2   %1, 7, 9, [r0], [r0+r2]
+    mova          m0, m2
+    mova          m1, m3
+    mova          m2, m4
+    mova          m3, m5
+    mova          m4, m6
+    lea           r0, [r0+r2*2]
+    dec          r4d
+    jnz .loop
+    RET
+
+; rows y and y + 4 in the two lanes
+cglobal %1_h264_qpel8_v_lowpass, 4,7,16 ; dst, src, dstStride, srcStride
+    movsxdifnidn  r2, r2d
+    movsxdifnidn  r3, r3d
+    vpbroadcastw m13, [pw_5]
+    vpbroadcastw m15, [pw_16]
+    sub           r1, r3
+    sub           r1, r3
+    lea           r5, [r3*4]
+    lea           r6, [r2*4]
+%assign i 0
+%rep 5
+    vmovq      xmm %+ i, [r1]
+    vmovhps    xmm %+ i, xmm %+ i, [r1+r5]
+    add           r1, r3
+    vpmovzxbw   m %+ i, xmm %+ i
+%assign i i+1
+%endrep
+    mov          r4d, 4
+.loop:
+    vmovq       xmm5, [r1]
+    vmovhps     xmm5, xmm5, [r1+r5]
+    add           r1, r3
+    vpmovzxbw     m5, xmm5
+    QPEL_FILTER_V m0, m1, m2, m3, m4, m5, m6, m7
+    QPEL_ROUND5   m6
+    QPEL_PACK8    m6
+    QPEL_OP8_2    %1, 6, 7, [r0], [r0+r6]
+    mova          m0, m1
+    mova          m1, m2
+    mova          m2, m3
+    mova          m3, m4
+    mova          m4, m5
+    add           r0, r2
+    dec          r4d
+    jnz .loop
+    RET
+
+cglobal %1_h264_qpel16_hv2_lowpass, 3,4,16 ; dst, tmp, dstStride
+    movsxdifnidn  r2, r2d
+    mova         m12, [pw_1_m5]
+    vpbroadcastw m13, [pw_20]
+    mova         m14, [pw_m5_1]
+    mova         m15, [pd_512]
+    mov          r3d, 16
+.loop:
+    mova          m0, [r1]
+    mova          m1, [r1+32]
+    mova          m2, [r1+64]
+    mova          m3, [r1+96]
+    mova          m4, [r1+128]
+    mova          m5, [r1+160]
+    QPEL_FILTER_HV m0, m1, m2, m3, m4, m5, m6
+    QPEL_PACK8    m0
+    QPEL_OP16_1   %1, 0, [r0]
+    add           r1, 32
+    add           r0, r2
+    dec          r3d
+    jnz .loop
+    RET
+
+cglobal %1_h264_qpel8_hv2_lowpass, 3,5,16 ; dst, tmp, dstStride
+    movsxdifnidn  r2, r2d
+    lea           r4, [r2*4]
+    mova         m12, [pw_1_m5]
+    vpbroadcastw m13, [pw_20]
+    mova         m14, [pw_m5_1]
+    mova         m15, [pd_512]
+    mov          r3d, 4
+.loop:
+%assign i 0
+%rep 6
+    vmovdqa    xmm %+ i, [r1+i*16]
+    vinserti128 m %+ i, m %+ i, [r1+i*16+64], 1
+%assign i i+1
+%endrep
+    QPEL_FILTER_HV m0, m1, m2, m3, m4, m5, m6
+    QPEL_PACK8    m0
+    QPEL_OP8_2    %1, 0, 1, [r0], [r0+r4]
+    add           r1, 16
+    add           r0, r2
+    dec          r3d
+    jnz .loop
+    RET
+
+; src2 has a stride of 16
+cglobal %1_pixels16_l2, 6,6,2 ; dst, src1, src2, dstStride, src1Stride, h
+    movsxdifnidn  r3, r3d
+    movsxdifnidn  r4, r4d
+.loop:
+    vmovdqu     xmm0, [r1]
+    vinserti128   m0, m0, [r1+r4], 1
+    pavgb         m0, [r2]
+    QPEL_OP16_2   %1, 0, 1, [r0], [r0+r3]
+    lea           r1, [r1+r4*2]
+    lea           r0, [r0+r3*2]
+    add           r2, 32
+    sub          r5d, 2
+    jg .loop
+    RET
+
+; src2 has a stride of 8
+cglobal %1_pixels8_l2, 6,6,2 ; dst, src1, src2, dstStride, src1Stride, h
+    movsxdifnidn  r3, r3d
+    movsxdifnidn  r4, r4d
+.loop:
+    vmovq       xmm0, [r1]
+    vmovhps     xmm0, xmm0, [r1+r4]
+    vpavgb      xmm0, xmm0, [r2]
+    QPEL_OP8_2    %1, 0, 1, [r0], [r0+r3]
+    lea           r1, [r1+r4*2]
+    lea           r0, [r0+r3*2]
+    add           r2, 16
+    sub          r5d, 2
+    jg .loop
+    RET
+%endmacro
+
+INIT_YMM avx2
+QPEL_LOWPASS_AVX2 put
+QPEL_LOWPASS_AVX2 avg
+
+; the horizontal pass of hv into 21 (13) rows of words at tmp
+cglobal h264_qpel16_hv1_lowpass, 3,4,16 ; src, tmp, srcStride
+    movsxdifnidn  r2, r2d
+    vpbroadcastw m13, [pw_5]
+    sub           r0, r2
+    sub           r0, r2
+    mov          r3d, 21
+.loop:
+    QPEL_FILTER_H16 m0, r0, m1, m2
+    mova        [r1], m0
+    add           r0, r2
+    add           r1, 32
+    dec          r3d
+    jnz .loop
+    RET
+
+cglobal h264_qpel8_hv1_lowpass, 3,4,16 ; src, tmp, srcStride
+    movsxdifnidn  r2, r2d
+    vpbroadcastw m13, [pw_5]
+    pxor         m12, m12
+    sub           r0, r2
+    sub           r0, r2
+    mov          r3d, 6
+.loop:
+    vmovdqu     xmm0, [r0-2]
+    vinserti128   m0, m0, [r0+r2-2], 1
+    QPEL_FILTER_H8 m0, m1, m2, m3
+    vmovdqa     [r1], xmm1
+    vextracti128 [r1+16], m1, 1
+    lea           r0, [r0+r2*2]
+    add           r1, 32
+    dec          r3d
+    jnz .loop
+    vmovdqu     xmm0, [r0-2]
+    QPEL_FILTER_H8 m0, m1, m2, m3
+    vmovdqa     [r1], xmm1
+    RET
+%endif ; HAVE_AVX2_EXTERNAL && ARCH_X86_64
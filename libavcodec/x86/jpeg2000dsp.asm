@@ -0,0 +1,185 @@
+;******************************************************************************
+;* JPEG 2000 DSP functions, SIMD-optimized
+;*
+;* This file is part of Libav.
+;*
+;* Libav is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* Libav is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with Libav; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA 32
+
+pd_2:     times 8 dd 2
+pd_32768: times 8 dd 1 << 15
+
+SECTION .text
+
+; A row of the line buffer is FF_DWT_VCOLS (16) samples, i.e. 64 bytes.
+; The kernels lift a whole row, reading the rows right above (-64) and
+; below (+64) it, and step two rows (128 bytes) at a time. The results
+; match the C versions exactly.
+
+; m0 = above + below of the mmsize bytes at offset %1 of the row, with %2
+%macro VLIFT_SUM 3 ; offset, add instruction, tmp
+    movu          m0, [pq+%1-64]
+    movu          %3, [pq+%1+64]
+    %2            m0, %3
+%endmacro
+
+;------------------------------------------------------------------------------
+; void jpeg2000_vlift97_float(float *p, int rows, int n, float k)
+;------------------------------------------------------------------------------
+%macro VLIFT97_FLOAT 0
+cglobal jpeg2000_vlift97_float, 2, 2, 4, p, rows, n, k
+%if UNIX64
+    %define kx xmm0
+%elif WIN64
+    %define kx xmm3
+%else
+    %define kx xmm2
+    movss          kx, km
+%endif
+    ; p += k * (above + below)
+%if mmsize == 32
+    vshufps     xmm2, kx, kx, 0
+    vinsertf128    m2, m2, xmm2, 1
+%else
+    shufps         kx, kx, 0
+    movaps         m2, kx
+%endif
+    test        rowsd, rowsd
+    jle .end
+.loop:
+%assign i 0
+%rep 64 / mmsize
+    VLIFT_SUM      i, addps, m1
+    mulps          m0, m2
+    movu           m1, [pq+i]
+    addps          m0, m1
+    movu       [pq+i], m0
+%assign i i+mmsize
+%endrep
+    add            pq, 128
+    dec         rowsd
+    jnz .loop
+.end:
+    RET
+%endmacro
+
+INIT_XMM sse
+VLIFT97_FLOAT
+INIT_YMM avx
+VLIFT97_FLOAT
+
+;------------------------------------------------------------------------------
+; void jpeg2000_vlift53_sub(int32_t *p, int rows, int n)
+; void jpeg2000_vlift53_add(int32_t *p, int rows, int n)
+;------------------------------------------------------------------------------
+%macro VLIFT53 0
+cglobal jpeg2000_vlift53_sub, 2, 2, 3, p, rows
+    ; p -= (above + below + 2) >> 2
+    mova           m2, [pd_2]
+    test        rowsd, rowsd
+    jle .end
+.loop:
+%assign i 0
+%rep 64 / mmsize
+    VLIFT_SUM      i, paddd, m1
+    paddd          m0, m2
+    psrad          m0, 2
+    movu           m1, [pq+i]
+    psubd          m1, m0
+    movu       [pq+i], m1
+%assign i i+mmsize
+%endrep
+    add            pq, 128
+    dec         rowsd
+    jnz .loop
+.end:
+    RET
+
+cglobal jpeg2000_vlift53_add, 2, 2, 2, p, rows
+    ; p += (above + below) >> 1
+    test        rowsd, rowsd
+    jle .end
+.loop:
+%assign i 0
+%rep 64 / mmsize
+    VLIFT_SUM      i, paddd, m1
+    psrad          m0, 1
+    movu           m1, [pq+i]
+    paddd          m0, m1
+    movu       [pq+i], m0
+%assign i i+mmsize
+%endrep
+    add            pq, 128
+    dec         rowsd
+    jnz .loop
+.end:
+    RET
+%endmacro
+
+INIT_XMM sse2
+VLIFT53
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+VLIFT53
+%endif
+
+;------------------------------------------------------------------------------
+; void jpeg2000_vlift97_int_sub(int32_t *p, int rows, int n, int k)
+; void jpeg2000_vlift97_int_add(int32_t *p, int rows, int n, int k)
+;------------------------------------------------------------------------------
+; p op= (k * (above + below) + (1 << 15)) >> 16
+%macro VLIFT97_INT 2 ; name, op
+cglobal jpeg2000_vlift97_int_%1, 4, 4, 5, p, rows, n, k
+%if mmsize == 32
+    vmovd       xmm3, kd
+    vpbroadcastd   m3, xmm3
+%else
+    movd           m3, kd
+    pshufd         m3, m3, 0
+%endif
+    mova           m4, [pd_32768]
+    test        rowsd, rowsd
+    jle .end
+.loop:
+%assign i 0
+%rep 64 / mmsize
+    VLIFT_SUM      i, paddd, m1
+    pmulld         m0, m3
+    paddd          m0, m4
+    psrad          m0, 16
+    movu           m1, [pq+i]
+    %2             m1, m0
+    movu       [pq+i], m1
+%assign i i+mmsize
+%endrep
+    add            pq, 128
+    dec         rowsd
+    jnz .loop
+.end:
+    RET
+%endmacro
+
+INIT_XMM sse4
+VLIFT97_INT sub, psubd
+VLIFT97_INT add, paddd
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+VLIFT97_INT sub, psubd
+VLIFT97_INT add, paddd
+%endif
@@ -0,0 +1,61 @@
+/*
+ * JPEG 2000 DSP functions, x86-optimized
+ *
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavcodec/jpeg2000dsp.h"
+
+void ff_jpeg2000_vlift97_float_sse(float *p, int rows, int n, float k);
+void ff_jpeg2000_vlift97_float_avx(float *p, int rows, int n, float k);
+void ff_jpeg2000_vlift53_sub_sse2(int32_t *p, int rows, int n);
+void ff_jpeg2000_vlift53_add_sse2(int32_t *p, int rows, int n);
+void ff_jpeg2000_vlift53_sub_avx2(int32_t *p, int rows, int n);
+void ff_jpeg2000_vlift53_add_avx2(int32_t *p, int rows, int n);
+void ff_jpeg2000_vlift97_int_sub_sse4(int32_t *p, int rows, int n, int k);
+void ff_jpeg2000_vlift97_int_add_sse4(int32_t *p, int rows, int n, int k);
+void ff_jpeg2000_vlift97_int_sub_avx2(int32_t *p, int rows, int n, int k);
+void ff_jpeg2000_vlift97_int_add_avx2(int32_t *p, int rows, int n, int k);
+
+av_cold void ff_jpeg2000dsp_init_x86(Jpeg2000DSPContext *c)
+{
+#if HAVE_YASM
+    int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_SSE(cpu_flags))
+        c->vlift97_float = ff_jpeg2000_vlift97_float_sse;
+    if (EXTERNAL_SSE2(cpu_flags)) {
+        c->vlift53_sub = ff_jpeg2000_vlift53_sub_sse2;
+        c->vlift53_add = ff_jpeg2000_vlift53_add_sse2;
+    }
+    if (EXTERNAL_SSE4(cpu_flags)) {
+        c->vlift97_int_sub = ff_jpeg2000_vlift97_int_sub_sse4;
+        c->vlift97_int_add = ff_jpeg2000_vlift97_int_add_sse4;
+    }
+    if (EXTERNAL_AVX(cpu_flags))
+        c->vlift97_float = ff_jpeg2000_vlift97_float_avx;
+    if (EXTERNAL_AVX2(cpu_flags)) {
+        c->vlift53_sub     = ff_jpeg2000_vlift53_sub_avx2;
+        c->vlift53_add     = ff_jpeg2000_vlift53_add_avx2;
+        c->vlift97_int_sub = ff_jpeg2000_vlift97_int_sub_avx2;
+        c->vlift97_int_add = ff_jpeg2000_vlift97_int_add_avx2;
+    }
+#endif
+}
@@ -0,0 +1,335 @@
+;******************************************************************************
+;* 10-bit simple IDCT, SSE4-optimized
+;*
+;* This file is part of Libav.
+;*
+;* Libav is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* Libav is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with Libav; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+%if ARCH_X86_64
+
+SECTION_RODATA
+
+idct10_w1:        times 4 dd 90901
+idct10_w2:        times 4 dd 85627
+idct10_w3:        times 4 dd 77062
+idct10_w4:        times 4 dd 65535
+idct10_w5:        times 4 dd 51491
+idct10_w6:        times 4 dd 35468
+idct10_w7:        times 4 dd 18081
+; (1 << (ROW_SHIFT - 1)) and (1 << (COL_SHIFT - 1)) / W4
+idct10_row_round: times 4 dd 1 << 14
+idct10_col_bias:  times 4 dd 8
+idct10_pix_max:   times 8 dw 1023
+idct10_ac_mask:   dw 0, -1, -1, -1, -1, -1, -1, -1
+; low words of four dwords, i.e. the int16_t truncation of the C code
+idct10_low_words: times 2 db 0, 1, 4, 5, 8, 9, 12, 13
+
+SECTION .text
+
+; This is ff_simple_idct_put_10() / ff_simple_idct_add_10() computed on
+; four rows or columns at once in 32-bit lanes, with the same results.
+; The 10-bit coefficients do not fit pmaddwd, so the block is transposed
+; and every coefficient is multiplied with pmulld. Rows with only a DC
+; coefficient take the C shortcut (DC << 1), which is selected per row.
+; Blocks with only a DC coefficient, the most common ones, skip both
+; passes. The block is left in the same state as by the C version.
+
+; transpose the words of m0-7; the rows end up in m0, m2, m1, m6, m8, m9,
+; m3, m11
+%macro TRANSPOSE8W 0
+    punpckhwd      m8, m0, m1
+    punpcklwd      m0, m1
+    punpckhwd      m9, m2, m3
+    punpcklwd      m2, m3
+    punpckhwd     m10, m4, m5
+    punpcklwd      m4, m5
+    punpckhwd     m11, m6, m7
+    punpcklwd      m6, m7
+    punpckhdq      m1, m0, m2
+    punpckldq      m0, m2
+    punpckhdq      m3, m8, m9
+    punpckldq      m8, m9
+    punpckhdq      m5, m4, m6
+    punpckldq      m4, m6
+    punpckhdq      m7, m10, m11
+    punpckldq     m10, m11
+    punpckhqdq     m2, m0, m4
+    punpcklqdq     m0, m4
+    punpckhqdq     m6, m1, m5
+    punpcklqdq     m1, m5
+    punpckhqdq     m9, m8, m10
+    punpcklqdq     m8, m10
+    punpckhqdq    m11, m3, m7
+    punpcklqdq     m3, m7
+%endmacro
+
+%macro STORE_TRANSPOSED 0
+    mova   [blockq+  0], m0
+    mova   [blockq+ 16], m2
+    mova   [blockq+ 32], m1
+    mova   [blockq+ 48], m6
+    mova   [blockq+ 64], m8
+    mova   [blockq+ 80], m9
+    mova   [blockq+ 96], m3
+    mova   [blockq+112], m11
+%endmacro
+
+; m%5 %4= w%3 * coefficients %1 of half %2 of the block
+%macro MAC 5
+    pmovsxwd       m8, [blockq+%1*16+%2*8]
+    pmulld         m8, [idct10_w%3]
+    %4            m%5, m8
+%endmacro
+
+; m%5 %4= w%3 * coefficients %1 of half %2, m%7 %6= the same
+%macro MAC2 7
+    MAC            %1, %2, %3, %4, %5
+    %6            m%7, m8
+%endmacro
+
+; 1-D IDCT of half %1: a0-a3 in m0-3, b0-b3 in m4-7; the DC term is set
+; up by %2
+%macro IDCT_1D 2
+    %2             %1
+    mova           m1, m0
+    mova           m2, m0
+    mova           m3, m0
+    MAC2            2, %1, 2, paddd, 0, psubd, 3
+    MAC2            2, %1, 6, paddd, 1, psubd, 2
+    MAC2            4, %1, 4, paddd, 0, psubd, 1
+    psubd          m2, m8
+    paddd          m3, m8
+    MAC2            6, %1, 6, paddd, 0, psubd, 3
+    MAC2            6, %1, 2, psubd, 1, paddd, 2
+    pmovsxwd       m4, [blockq+16+%1*8]
+    mova           m5, m4
+    mova           m6, m4
+    mova           m7, m4
+    pmulld         m4, [idct10_w1]
+    pmulld         m5, [idct10_w3]
+    pmulld         m6, [idct10_w5]
+    pmulld         m7, [idct10_w7]
+    MAC             3, %1, 3, paddd, 4
+    MAC             3, %1, 7, psubd, 5
+    MAC             3, %1, 1, psubd, 6
+    MAC             3, %1, 5, psubd, 7
+    MAC             5, %1, 5, paddd, 4
+    MAC             5, %1, 1, psubd, 5
+    MAC             5, %1, 7, paddd, 6
+    MAC             5, %1, 3, paddd, 7
+    MAC             7, %1, 7, paddd, 4
+    MAC             7, %1, 5, psubd, 5
+    MAC             7, %1, 3, paddd, 6
+    MAC             7, %1, 1, psubd, 7
+%endmacro
+
+%macro ROW_FIRST 1
+    pmovsxwd       m0, [blockq+%1*8]
+    pmulld         m0, [idct10_w4]
+    paddd          m0, [idct10_row_round]
+%endmacro
+
+%macro COL_FIRST 1
+    pmovsxwd       m0, [blockq+%1*8]
+    paddd          m0, [idct10_col_bias]
+    pmulld         m0, [idct10_w4]
+%endmacro
+
+; m9 = (a%1 + b%2) >> %3, m%1 = (a%1 - b%2) >> %3
+%macro BUTTERFLY 3
+    paddd          m9, m%1, m%2
+    psubd         m%1, m%2
+    psrad          m9, %3
+    psrad         m%1, %3
+%endmacro
+
+; outputs %2 and %3 = 7 - %2 of half %1 of the row pass back into the block;
+; the second half is merged with the first one, so that whole rows are
+; stored and can be forwarded to the loads after the pass
+%macro ROW_OUT 4 ; half, i, j, b
+    BUTTERFLY      %2, %4, 15
+    pshufb         m9, m10
+    pshufb        m%2, m10
+%if %1 == 0
+    movq  [blockq+%2*16], m9
+    movq  [blockq+%3*16], m%2
+%else
+    movq           m8, [blockq+%2*16]
+    punpcklqdq     m8, m9
+    mova  [blockq+%2*16], m8
+    movq           m8, [blockq+%3*16]
+    punpcklqdq     m8, m%2
+    mova  [blockq+%3*16], m8
+%endif
+%endmacro
+
+%macro ROW_PASS 1
+    IDCT_1D        %1, ROW_FIRST
+    ROW_OUT        %1, 0, 7, 4
+    ROW_OUT        %1, 1, 6, 5
+    ROW_OUT        %1, 2, 5, 6
+    ROW_OUT        %1, 3, 4, 7
+%endmacro
+
+; select the DC only result (m14) for the rows in the mask (m15)
+%macro LOAD_ROW_OUT 1
+    mova          m%1, m15
+    pandn         m%1, [blockq+%1*16]
+    por           m%1, m14
+%endmacro
+
+%define PIXELS0 dstq
+%define PIXELS1 dstq+lsq
+%define PIXELS2 dstq+lsq*2
+%define PIXELS3 dstq+ls3q
+%define PIXELS4 dst4q
+%define PIXELS5 dst4q+lsq
+%define PIXELS6 dst4q+lsq*2
+%define PIXELS7 dst4q+ls3q
+
+%macro STORE_PUT 3 ; reg, row, half
+    packusdw      m%1, m%1
+    pminuw        m%1, m10
+    movq [PIXELS%2+%3*8], m%1
+%endmacro
+
+%macro STORE_ADD 3
+    pmovzxwd       m8, [PIXELS%2+%3*8]
+    paddd         m%1, m8
+    STORE_PUT      %1, %2, %3
+%endmacro
+
+%macro COL_OUT 5 ; half, i, j, b, STORE
+    BUTTERFLY      %2, %4, 20
+    %5              9, %2, %1
+    %5             %2, %3, %1
+%endmacro
+
+%macro COL_PASS 2 ; half, STORE
+    IDCT_1D        %1, COL_FIRST
+    COL_OUT        %1, 0, 7, 4, %2
+    COL_OUT        %1, 1, 6, 5, %2
+    COL_OUT        %1, 2, 5, 6, %2
+    COL_OUT        %1, 3, 4, 7, %2
+%endmacro
+
+; only a DC coefficient: the first row becomes DC << 1 and all the pixels
+; get the same value, m9 holds it as four dwords
+%macro DC_ONLY 0
+    pshuflw        m8, m0, 0
+    punpcklqdq     m8, m8
+    psllw          m8, 1
+    mova     [blockq], m8
+    pmovsxwd       m9, m8
+    paddd          m9, [idct10_col_bias]
+    pmulld         m9, [idct10_w4]
+    psrad          m9, 20
+%endmacro
+
+%macro DC_PUT 0
+    packusdw       m9, m9
+    pminuw         m9, [idct10_pix_max]
+%assign i 0
+%rep 8
+    movu  [PIXELS %+ i], m9
+%assign i i+1
+%endrep
+%endmacro
+
+; the pixels and the differences both fit in words
+%macro DC_ADD 0
+    packssdw       m9, m9
+    pxor          m10, m10
+    mova          m11, [idct10_pix_max]
+%assign i 0
+%rep 8
+    movu           m8, [PIXELS %+ i]
+    paddw          m8, m9
+    pmaxsw         m8, m10
+    pminsw         m8, m11
+    movu  [PIXELS %+ i], m8
+%assign i i+1
+%endrep
+%endmacro
+
+;------------------------------------------------------------------------------
+; void simple_idct_put_10(uint8_t *dest, int line_size, int16_t *block)
+; void simple_idct_add_10(uint8_t *dest, int line_size, int16_t *block)
+;------------------------------------------------------------------------------
+%macro SIMPLE_IDCT10 3 ; name, STORE, DC_STORE
+cglobal simple_idct_%1_10, 3, 5, 16, dst, ls, block, dst4, ls3
+    movsxdifnidn   lsq, lsd
+    lea           ls3q, [lsq*3]
+    lea          dst4q, [dstq+lsq*4]
+%assign i 0
+%rep 8
+    mova       m %+ i, [blockq+i*16]
+%assign i i+1
+%endrep
+    mova           m8, [idct10_ac_mask]
+    pand           m8, m0
+    por            m8, m1
+    por            m8, m2
+    por            m8, m3
+    por            m8, m4
+    por            m8, m5
+    por            m8, m6
+    por            m8, m7
+    ptest          m8, m8
+    jnz .idct
+    DC_ONLY
+    %3
+    RET
+.idct:
+    TRANSPOSE8W
+    STORE_TRANSPOSED
+    ; rows with only a DC coefficient
+    por           m15, m2, m1
+    por           m15, m6
+    por           m15, m8
+    por           m15, m9
+    por           m15, m3
+    por           m15, m11
+    pxor          m14, m14
+    pcmpeqw       m15, m14
+    psllw         m14, m0, 1
+    pand          m14, m15
+    mova          m10, [idct10_low_words]
+    ROW_PASS        0
+    ROW_PASS        1
+    LOAD_ROW_OUT    0
+    LOAD_ROW_OUT    1
+    LOAD_ROW_OUT    2
+    LOAD_ROW_OUT    3
+    LOAD_ROW_OUT    4
+    LOAD_ROW_OUT    5
+    LOAD_ROW_OUT    6
+    LOAD_ROW_OUT    7
+    TRANSPOSE8W
+    STORE_TRANSPOSED
+    mova          m10, [idct10_pix_max]
+    COL_PASS        0, %2
+    COL_PASS        1, %2
+    RET
+%endmacro
+
+INIT_XMM sse4
+SIMPLE_IDCT10 put, STORE_PUT, DC_PUT
+SIMPLE_IDCT10 add, STORE_ADD, DC_ADD
+
+%endif ; ARCH_X86_64
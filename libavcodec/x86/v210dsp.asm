@@ -0,0 +1,290 @@
+;******************************************************************************
+;* v210 packing and unpacking, SIMD-optimized
+;*
+;* This file is part of Libav.
+;*
+;* Libav is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* Libav is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with Libav; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+%if ARCH_X86_64
+
+SECTION_RODATA 32
+
+; A group of 6 pixels is 4 dwords of 3 10-bit samples each:
+;   U0 Y0 V0 | Y1 U1 Y2 | V1 Y3 U2 | Y4 V2 Y5
+; The kernels split every dword into its first and last sample (f0, f2)
+; and its middle sample (f1) as words, and shuffle those into place.
+; The tables are repeated for both lanes of a ymm register.
+
+v210_mask_f0:       times 8 dd 0x3FF
+v210_mask_f2:       times 8 dd 0x3FF0000
+
+; unpacking: words f0/f2 (x) and f1 (y) to luma and chroma, chroma is
+; stored as U0 U1 U2 0 V0 V1 V2 0
+v210_luma_shuf_x:   times 2 db -1, -1,  4,  5,  6,  7, -1, -1, 12, 13, 14, 15, -1, -1, -1, -1
+v210_luma_shuf_y:   times 2 db  0,  1, -1, -1, -1, -1,  8,  9, -1, -1, -1, -1, -1, -1, -1, -1
+v210_chroma_shuf_x: times 2 db  0,  1, -1, -1, 10, 11, -1, -1,  2,  3,  8,  9, -1, -1, -1, -1
+v210_chroma_shuf_y: times 2 db -1, -1,  4,  5, -1, -1, -1, -1, -1, -1, -1, -1, 12, 13, -1, -1
+
+; packing: luma and U0 U1 U2 x V0 V1 V2 x chroma to the f0/f1 word pairs
+; (a) and to f2 in the low word of each dword (b)
+v210_luma_shuf_a:   times 2 db -1, -1,  0,  1,  2,  3, -1, -1, -1, -1,  6,  7,  8,  9, -1, -1
+v210_chroma_shuf_a: times 2 db  0,  1, -1, -1, -1, -1,  2,  3, 10, 11, -1, -1, -1, -1, 12, 13
+v210_luma_shuf_b:   times 2 db -1, -1, -1, -1,  4,  5, -1, -1, -1, -1, -1, -1, 10, 11, -1, -1
+v210_chroma_shuf_b: times 2 db  8,  9, -1, -1, -1, -1, -1, -1,  4,  5, -1, -1, -1, -1, -1, -1
+v210_clip_add:      times 16 dw 0xFFFF - 1019
+v210_clip_sub:      times 16 dw 0xFFFF - 1019 + 4
+v210_clip_min:      times 16 dw 4
+v210_pack_mult:     times 8 dw 1, 1 << 10
+
+; gathers the 12 luma words of both lanes into the low 24 bytes
+v210_luma_perm:     dd 0, 1, 2, 4, 5, 6, 3, 7
+
+SECTION .text
+
+; The plain group loops load or store a few samples past the end of the
+; group, which the next group overwrites or ignores; the last group of a
+; line uses exact loads and stores. The AVX2 versions handle two groups
+; per iteration, one in each lane, and finish the line with a single group
+; loaded into the low lane.
+
+; m0 = source dwords -> m0 = chroma, m2 = luma
+%macro V210_UNPACK_GROUP 0
+    psrld          m1, m0, 10
+    psrld          m2, m0, 4
+    pand           m0, m8
+    pand           m1, m8
+    pand           m2, m9
+    por            m0, m2
+    pshufb         m2, m0, m10
+    pshufb         m3, m1, m11
+    pshufb         m0, m12
+    pshufb         m1, m13
+    por            m2, m3
+    por            m0, m1
+%endmacro
+
+;------------------------------------------------------------------------------
+; void v210_unpack_line(const uint32_t *src, uint16_t *y, uint16_t *u,
+;                       uint16_t *v, int width)
+;------------------------------------------------------------------------------
+%macro V210_UNPACK 0
+cglobal v210_unpack_line, 5, 6, 15, src, y, u, v, width, tmp
+    cmp        widthd, 6
+    jl .end
+    mova           m8, [v210_mask_f0]
+    mova           m9, [v210_mask_f2]
+    mova          m10, [v210_luma_shuf_x]
+    mova          m11, [v210_luma_shuf_y]
+    mova          m12, [v210_chroma_shuf_x]
+    mova          m13, [v210_chroma_shuf_y]
+%if mmsize == 32
+    mova          m14, [v210_luma_perm]
+    sub        widthd, 18
+    jl .single
+.loop2:
+    movu           m0, [srcq]
+    V210_UNPACK_GROUP
+    vpermd         m2, m14, m2
+    vextracti128 xmm1, m0, 1
+    movu         [yq], m2
+    vmovq        [uq], xmm0
+    vmovq      [uq+6], xmm1
+    vmovhps      [vq], xmm0
+    vmovhps    [vq+6], xmm1
+    add          srcq, 32
+    add            yq, 24
+    add            uq, 12
+    add            vq, 12
+    sub        widthd, 12
+    jge .loop2
+.single:
+    cmp        widthd, -12
+    je .last
+    movu         xmm0, [srcq]
+    V210_UNPACK_GROUP
+    movu         [yq], xmm2
+    vmovq        [uq], xmm0
+    vmovhps      [vq], xmm0
+    add          srcq, 16
+    add            yq, 12
+    add            uq, 6
+    add            vq, 6
+.last:
+    movu         xmm0, [srcq]
+    V210_UNPACK_GROUP
+    vmovq        [yq], xmm2
+    vpsrldq      xmm2, xmm2, 8
+    vmovd      [yq+8], xmm2
+    vmovd        [uq], xmm0
+    vpextrw      tmpd, xmm0, 2
+    mov        [uq+4], tmpw
+    vpsrldq      xmm0, xmm0, 8
+    vmovd        [vq], xmm0
+    vpextrw      tmpd, xmm0, 2
+%else
+    sub        widthd, 12
+    jl .last
+.loop:
+    movu           m0, [srcq]
+    V210_UNPACK_GROUP
+    movu         [yq], m2
+    movq         [uq], m0
+    movhps       [vq], m0
+    add          srcq, 16
+    add            yq, 12
+    add            uq, 6
+    add            vq, 6
+    sub        widthd, 6
+    jge .loop
+.last:
+    movu           m0, [srcq]
+    V210_UNPACK_GROUP
+    movq         [yq], m2
+    psrldq         m2, 8
+    movd       [yq+8], m2
+    movd         [uq], m0
+    pextrw       tmpd, m0, 2
+    mov        [uq+4], tmpw
+    psrldq         m0, 8
+    movd         [vq], m0
+    pextrw       tmpd, m0, 2
+%endif
+    mov        [vq+4], tmpw
+.end:
+    RET
+%endmacro
+
+; m0 = luma, m1 = chroma -> m2 = packed dwords
+%macro V210_PACK_GROUP 0
+    paddusw        m0, m8
+    paddusw        m1, m8
+    psubusw        m0, m9
+    psubusw        m1, m9
+    paddw          m0, m10
+    paddw          m1, m10
+    pshufb         m2, m0, m11
+    pshufb         m3, m1, m12
+    pshufb         m0, m13
+    pshufb         m1, m14
+    por            m2, m3
+    por            m0, m1
+    pmaddwd        m2, m15
+    pslld          m0, 20
+    por            m2, m0
+%endmacro
+
+;------------------------------------------------------------------------------
+; void v210_pack_line(const uint16_t *y, const uint16_t *u,
+;                     const uint16_t *v, uint32_t *dst, int width)
+;------------------------------------------------------------------------------
+%macro V210_PACK 0
+cglobal v210_pack_line, 5, 5, 16, y, u, v, dst, width
+    cmp        widthd, 6
+    jl .end
+    mova           m8, [v210_clip_add]
+    mova           m9, [v210_clip_sub]
+    mova          m10, [v210_clip_min]
+    mova          m11, [v210_luma_shuf_a]
+    mova          m12, [v210_chroma_shuf_a]
+    mova          m13, [v210_luma_shuf_b]
+    mova          m14, [v210_chroma_shuf_b]
+    mova          m15, [v210_pack_mult]
+%if mmsize == 32
+    sub        widthd, 18
+    jl .single
+.loop2:
+    movu         xmm0, [yq]
+    vinserti128    m0, m0, [yq+12], 1
+    vmovq        xmm1, [uq]
+    vmovhps      xmm1, xmm1, [vq]
+    vmovq        xmm2, [uq+6]
+    vmovhps      xmm2, xmm2, [vq+6]
+    vinserti128    m1, m1, xmm2, 1
+    V210_PACK_GROUP
+    movu       [dstq], m2
+    add            yq, 24
+    add            uq, 12
+    add            vq, 12
+    add          dstq, 32
+    sub        widthd, 12
+    jge .loop2
+.single:
+    cmp        widthd, -12
+    je .last
+    movu         xmm0, [yq]
+    vmovq        xmm1, [uq]
+    vmovhps      xmm1, xmm1, [vq]
+    V210_PACK_GROUP
+    movu       [dstq], xmm2
+    add            yq, 12
+    add            uq, 6
+    add            vq, 6
+    add          dstq, 16
+.last:
+    vmovq        xmm0, [yq]
+    vmovd        xmm2, [yq+8]
+    vpunpcklqdq  xmm0, xmm0, xmm2
+    vmovd        xmm1, [uq]
+    vpinsrw      xmm1, xmm1, [uq+4], 2
+    vmovd        xmm2, [vq]
+    vpinsrw      xmm2, xmm2, [vq+4], 2
+    vpunpcklqdq  xmm1, xmm1, xmm2
+    V210_PACK_GROUP
+    movu       [dstq], xmm2
+%else
+    sub        widthd, 12
+    jl .last
+.loop:
+    movu           m0, [yq]
+    movq           m1, [uq]
+    movhps         m1, [vq]
+    V210_PACK_GROUP
+    movu       [dstq], m2
+    add            yq, 12
+    add            uq, 6
+    add            vq, 6
+    add          dstq, 16
+    sub        widthd, 6
+    jge .loop
+.last:
+    movq           m0, [yq]
+    movd           m2, [yq+8]
+    punpcklqdq     m0, m2
+    movd           m1, [uq]
+    pinsrw         m1, [uq+4], 2
+    movd           m2, [vq]
+    pinsrw         m2, [vq+4], 2
+    punpcklqdq     m1, m2
+    V210_PACK_GROUP
+    movu       [dstq], m2
+%endif
+.end:
+    RET
+%endmacro
+
+INIT_XMM ssse3
+V210_UNPACK
+V210_PACK
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+V210_UNPACK
+V210_PACK
+%endif
+
+%endif ; ARCH_X86_64
@@ -0,0 +1,49 @@
+/*
+ * v210 packing and unpacking, x86-optimized
+ *
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavcodec/v210dsp.h"
+
+void ff_v210_unpack_line_ssse3(const uint32_t *src, uint16_t *y,
+                               uint16_t *u, uint16_t *v, int width);
+void ff_v210_unpack_line_avx2(const uint32_t *src, uint16_t *y,
+                              uint16_t *u, uint16_t *v, int width);
+void ff_v210_pack_line_ssse3(const uint16_t *y, const uint16_t *u,
+                             const uint16_t *v, uint32_t *dst, int width);
+void ff_v210_pack_line_avx2(const uint16_t *y, const uint16_t *u,
+                            const uint16_t *v, uint32_t *dst, int width);
+
+av_cold void ff_v210dsp_init_x86(V210DSPContext *c)
+{
+#if ARCH_X86_64
+    int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_SSSE3(cpu_flags)) {
+        c->unpack_line = ff_v210_unpack_line_ssse3;
+        c->pack_line   = ff_v210_pack_line_ssse3;
+    }
+    if (EXTERNAL_AVX2(cpu_flags)) {
+        c->unpack_line = ff_v210_unpack_line_avx2;
+        c->pack_line   = ff_v210_pack_line_avx2;
+    }
+#endif
+}
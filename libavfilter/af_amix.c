@@ -34,11 +34,11 @@
 #include "libavutil/avstring.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/common.h"
-#include "libavutil/float_dsp.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/samplefmt.h"
 
+#include "af_amix.h"
 #include "audio.h"
 #include "avfilter.h"
 #include "formats.h"
@@ -155,7 +155,7 @@ static int frame_list_add_frame(FrameList *frame_list, int nb_samples, int64_t p
 
 typedef struct MixContext {
     const AVClass *class;       /**< class for AVOptions */
-    AVFloatDSPContext fdsp;
+    AMixDSPContext dsp;
 
     int nb_inputs;              /**< number of inputs */
     int active_inputs;          /**< number of input currently active */
@@ -169,6 +169,9 @@ typedef struct MixContext {
     uint8_t *input_state;       /**< current state of each input */
     float *input_scale;         /**< mixing scale factor for each input */
     float scale_norm;           /**< normalization factor for all inputs */
+    AVFrame **in_bufs;          /**< input buffers for the current output frame */
+    const float **mix_src;      /**< per-plane pointers into in_bufs */
+    float *mix_scale;           /**< scale factors for the inputs in mix_src */
     int64_t next_pts;           /**< calculated pts for next output frame */
     FrameList *frame_list;      /**< list of frame info for the first input */
 } MixContext;
@@ -197,6 +200,27 @@ static const AVClass amix_class = {
 };
 
 
+static void mix_inputs_c(float *dst, const float **src, const float *scale,
+                         int nb_inputs, int len)
+{
+    int i, j;
+
+    for (i = 0; i < len; i++) {
+        float v = dst[i];
+        for (j = 0; j < nb_inputs; j++)
+            v += src[j][i] * scale[j];
+        dst[i] = v;
+    }
+}
+
+av_cold void ff_amix_dsp_init(AMixDSPContext *dsp)
+{
+    dsp->mix_inputs = mix_inputs_c;
+
+    if (ARCH_X86)
+        ff_amix_dsp_init_x86(dsp);
+}
+
 /**
  * Update the scaling factors to apply to each input during mixing.
  *
@@ -260,6 +284,15 @@ static int config_output(AVFilterLink *outlink)
     s->scale_norm = s->active_inputs;
     calculate_scales(s, 0);
 
+    av_freep(&s->in_bufs);
+    av_freep(&s->mix_src);
+    av_freep(&s->mix_scale);
+    s->in_bufs   = av_mallocz(s->nb_inputs * sizeof(*s->in_bufs));
+    s->mix_src   = av_mallocz(s->nb_inputs * sizeof(*s->mix_src));
+    s->mix_scale = av_mallocz(s->nb_inputs * sizeof(*s->mix_scale));
+    if (!s->in_bufs || !s->mix_src || !s->mix_scale)
+        return AVERROR(ENOMEM);
+
     av_get_channel_layout_string(buf, sizeof(buf), -1, outlink->channel_layout);
 
     av_log(ctx, AV_LOG_VERBOSE,
@@ -276,8 +309,8 @@ static int output_frame(AVFilterLink *outlink, int nb_samples)
 {
     AVFilterContext *ctx = outlink->src;
     MixContext      *s = ctx->priv;
-    AVFrame *out_buf, *in_buf;
-    int i;
+    AVFrame *out_buf;
+    int i, nb_mix = 0, planes, plane_size, p, ret = 0;
 
     calculate_scales(s, nb_samples);
 
@@ -285,31 +318,43 @@ static int output_frame(AVFilterLink *outlink, int nb_samples)
     if (!out_buf)
         return AVERROR(ENOMEM);
 
-    in_buf = ff_get_audio_buffer(outlink, nb_samples);
-    if (!in_buf) {
-        av_frame_free(&out_buf);
-        return AVERROR(ENOMEM);
-    }
-
+    /* read all active inputs first so that they can be mixed in one pass */
     for (i = 0; i < s->nb_inputs; i++) {
         if (s->input_state[i] == INPUT_ON) {
-            int planes, plane_size, p;
+            AVFrame *in_buf = ff_get_audio_buffer(outlink, nb_samples);
+            if (!in_buf) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            s->in_bufs[nb_mix]   = in_buf;
+            s->mix_scale[nb_mix] = s->input_scale[i];
+            nb_mix++;
 
             av_audio_fifo_read(s->fifos[i], (void **)in_buf->extended_data,
                                nb_samples);
+        }
+    }
 
-            planes     = s->planar ? s->nb_channels : 1;
-            plane_size = nb_samples * (s->planar ? 1 : s->nb_channels);
-            plane_size = FFALIGN(plane_size, 16);
+    if (nb_mix) {
+        planes     = s->planar ? s->nb_channels : 1;
+        plane_size = nb_samples * (s->planar ? 1 : s->nb_channels);
+        plane_size = FFALIGN(plane_size, 16);
 
-            for (p = 0; p < planes; p++) {
-                s->fdsp.vector_fmac_scalar((float *)out_buf->extended_data[p],
-                                           (float *) in_buf->extended_data[p],
-                                           s->input_scale[i], plane_size);
-            }
+        for (p = 0; p < planes; p++) {
+            for (i = 0; i < nb_mix; i++)
+                s->mix_src[i] = (const float *)s->in_bufs[i]->extended_data[p];
+            s->dsp.mix_inputs((float *)out_buf->extended_data[p], s->mix_src,
+                              s->mix_scale, nb_mix, plane_size);
         }
     }
-    av_frame_free(&in_buf);
+
+fail:
+    for (i = 0; i < nb_mix; i++)
+        av_frame_free(&s->in_bufs[i]);
+    if (ret < 0) {
+        av_frame_free(&out_buf);
+        return ret;
+    }
 
     out_buf->pts = s->next_pts;
     if (s->next_pts != AV_NOPTS_VALUE)
@@ -506,7 +551,7 @@ static av_cold int init(AVFilterContext *ctx)
         ff_insert_inpad(ctx, i, &pad);
     }
 
-    avpriv_float_dsp_init(&s->fdsp, 0);
+    ff_amix_dsp_init(&s->dsp);
 
     return 0;
 }
@@ -525,6 +570,9 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->frame_list);
     av_freep(&s->input_state);
     av_freep(&s->input_scale);
+    av_freep(&s->in_bufs);
+    av_freep(&s->mix_src);
+    av_freep(&s->mix_scale);
 
     for (i = 0; i < ctx->nb_inputs; i++)
         av_freep(&ctx->input_pads[i].name);
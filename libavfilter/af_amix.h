@@ -0,0 +1,51 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * audio mix filter DSP functions
+ */
+
+#ifndef AVFILTER_AF_AMIX_H
+#define AVFILTER_AF_AMIX_H
+
+typedef struct AMixDSPContext {
+    /**
+     * Scale and accumulate several input vectors into dst in a single pass:
+     * dst[i] += src[0][i] * scale[0] + ... + src[n-1][i] * scale[n-1]
+     *
+     * The inputs are accumulated in order, so the result is bit-identical to
+     * calling vector_fmac_scalar() once per input.
+     *
+     * @param dst       output/accumulation vector
+     *                  constraints: 32-byte aligned
+     * @param src       array of nb_inputs input vectors
+     *                  constraints: each 32-byte aligned
+     * @param scale     array of nb_inputs scale factors
+     * @param nb_inputs number of input vectors, must be at least 1
+     * @param len       number of elements in each vector
+     *                  constraints: multiple of 16
+     */
+    void (*mix_inputs)(float *dst, const float **src, const float *scale,
+                       int nb_inputs, int len);
+} AMixDSPContext;
+
+void ff_amix_dsp_init(AMixDSPContext *dsp);
+void ff_amix_dsp_init_x86(AMixDSPContext *dsp);
+
+#endif /* AVFILTER_AF_AMIX_H */
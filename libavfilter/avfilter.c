@@ -19,6 +19,15 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
+
+#if HAVE_GETRUSAGE
+#include <sys/time.h>
+#include <sys/resource.h>
+#elif HAVE_GETPROCESSTIMES
+#include <windows.h>
+#endif
+
 #include "libavutil/avstring.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/common.h"
@@ -28,6 +37,7 @@
 #include "libavutil/pixdesc.h"
 #include "libavutil/rational.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/time.h"
 
 #include "audio.h"
 #include "avfilter.h"
@@ -241,13 +251,116 @@ void ff_dlog_link(void *ctx, AVFilterLink *link, int end)
     }
 }
 
+static int64_t profile_cpu_time(void)
+{
+#if HAVE_GETRUSAGE
+    struct rusage rusage;
+#ifdef RUSAGE_THREAD
+    getrusage(RUSAGE_THREAD, &rusage);
+#else
+    getrusage(RUSAGE_SELF, &rusage);
+#endif
+    return (rusage.ru_utime.tv_sec + rusage.ru_stime.tv_sec) * 1000000LL +
+           rusage.ru_utime.tv_usec + rusage.ru_stime.tv_usec;
+#elif HAVE_GETPROCESSTIMES
+    FILETIME c, e, k, u;
+    GetProcessTimes(GetCurrentProcess(), &c, &e, &k, &u);
+    return (((int64_t)k.dwHighDateTime << 32 | k.dwLowDateTime) +
+            ((int64_t)u.dwHighDateTime << 32 | u.dwLowDateTime)) / 10;
+#else
+    return av_gettime();
+#endif
+}
+
+static int profile_enabled(const AVFilterContext *ctx)
+{
+    return ctx->graph && ctx->graph->profile;
+}
+
+static void profile_account(AVFilterContext *ctx, int64_t wall, int64_t cpu)
+{
+    AVFilterInternal *in = ctx->internal;
+
+    in->profile.wall_time += wall - in->profile_wall_start;
+    in->profile.cpu_time  += cpu  - in->profile_cpu_start;
+    in->profile_wall_start = wall;
+    in->profile_cpu_start  = cpu;
+}
+
+/**
+ * Start timing a callback of ctx, pausing the filter that called into it.
+ *
+ * @return the previously running filter, to be passed to profile_leave()
+ */
+static AVFilterContext *profile_enter(AVFilterContext *ctx)
+{
+    AVFilterGraphInternal *gi = ctx->graph->internal;
+    AVFilterContext *prev     = gi->profile_current;
+    int64_t wall = av_gettime();
+    int64_t cpu  = profile_cpu_time();
+
+    if (prev)
+        profile_account(prev, wall, cpu);
+
+    ctx->internal->profile_wall_start = wall;
+    ctx->internal->profile_cpu_start  = cpu;
+    ctx->internal->profile.nb_calls++;
+    gi->profile_current = ctx;
+
+    return prev;
+}
+
+static void profile_leave(AVFilterContext *ctx, AVFilterContext *prev)
+{
+    int64_t wall = av_gettime();
+    int64_t cpu  = profile_cpu_time();
+
+    profile_account(ctx, wall, cpu);
+
+    if (prev) {
+        prev->internal->profile_wall_start = wall;
+        prev->internal->profile_cpu_start  = cpu;
+    }
+    ctx->graph->internal->profile_current = prev;
+}
+
+void ff_filter_profile_alloc(AVFilterLink *link, const AVFrame *frame)
+{
+    AVFilterContext *ctx = link->src;
+    uint64_t size = 0;
+    int i;
+
+    if (!profile_enabled(ctx))
+        return;
+    if (ctx->graph->internal->profile_current)
+        ctx = ctx->graph->internal->profile_current;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(frame->buf) && frame->buf[i]; i++)
+        size += frame->buf[i]->size;
+    for (i = 0; i < frame->nb_extended_buf; i++)
+        size += frame->extended_buf[i]->size;
+
+    ctx->internal->profile.bytes_allocated += size;
+}
+
+const AVFilterProfile *avfilter_get_profile(const AVFilterContext *ctx)
+{
+    return ctx->graph ? &ctx->internal->profile : NULL;
+}
+
 int ff_request_frame(AVFilterLink *link)
 {
     FF_DPRINTF_START(NULL, request_frame); ff_dlog_link(NULL, link, 1);
 
-    if (link->srcpad->request_frame)
+    if (link->srcpad->request_frame) {
+        if (profile_enabled(link->src)) {
+            AVFilterContext *prev = profile_enter(link->src);
+            int ret = link->srcpad->request_frame(link);
+            profile_leave(link->src, prev);
+            return ret;
+        }
         return link->srcpad->request_frame(link);
-    else if (link->src->inputs[0])
+    } else if (link->src->inputs[0])
         return ff_request_frame(link->src->inputs[0]);
     else return -1;
 }
@@ -771,6 +884,19 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
     } else
         out = frame;
 
+    if (profile_enabled(link->dst)) {
+        AVFilterContext *prev;
+        int ret;
+
+        link->src->internal->profile.nb_frames_out++;
+        link->dst->internal->profile.nb_frames_in++;
+
+        prev = profile_enter(link->dst);
+        ret  = filter_frame(link, out);
+        profile_leave(link->dst, prev);
+        return ret;
+    }
+
     return filter_frame(link, out);
 }
 
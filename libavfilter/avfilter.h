@@ -941,8 +941,62 @@ typedef struct AVFilterGraph {
      * Opaque object for libavfilter internal use.
      */
     AVFilterGraphInternal *internal;
+
+    /**
+     * If nonzero, collect per-filter profiling counters for the filters in
+     * this graph, retrievable with avfilter_get_profile().
+     *
+     * May be set by the caller at any point, the counters are only updated
+     * while this is set.
+     */
+    int profile;
 } AVFilterGraph;
 
+/**
+ * Profiling counters of a filter instance, collected when
+ * AVFilterGraph.profile is set.
+ *
+ * The time spent in a filter excludes the time spent in the filters it calls
+ * into, so the counters of all filters in a graph add up to the time spent
+ * in the whole graph.
+ *
+ * sizeof(AVFilterProfile) is not a part of the public ABI, new fields may be
+ * added to the end with a minor version bump.
+ */
+typedef struct AVFilterProfile {
+    /**
+     * Wall clock time spent in the filter_frame() and request_frame()
+     * callbacks of the filter, in microseconds.
+     */
+    int64_t wall_time;
+
+    /**
+     * CPU time spent in the filter_frame() and request_frame() callbacks of
+     * the filter, in microseconds. Where the system does not provide per-thread
+     * CPU usage, this is the CPU time of the whole process.
+     */
+    int64_t cpu_time;
+
+    uint64_t nb_calls;      ///< number of filter_frame()/request_frame() calls
+    uint64_t nb_frames_in;  ///< number of frames received on all inputs
+    uint64_t nb_frames_out; ///< number of frames sent on all outputs
+
+    /**
+     * Total size, in bytes, of the frame buffers allocated while the filter
+     * was running.
+     */
+    uint64_t bytes_allocated;
+} AVFilterProfile;
+
+/**
+ * Get the profiling counters of a filter instance.
+ *
+ * @return the counters, or NULL if the filter does not belong to a graph. The
+ * returned structure is owned by the filter and remains valid until it is
+ * freed.
+ */
+const AVFilterProfile *avfilter_get_profile(const AVFilterContext *ctx);
+
 /**
  * Allocate a filter graph.
  */
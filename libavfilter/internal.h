@@ -124,11 +124,21 @@ struct AVFilterGraphInternal {
     void *thread;
     int (*thread_execute)(AVFilterContext *ctx, action_func *func, void *arg,
                           int *ret, int nb_jobs);
+
+    /**
+     * The filter whose callback is currently running, used to attribute
+     * profiling counters.
+     */
+    AVFilterContext *profile_current;
 };
 
 struct AVFilterInternal {
     int (*execute)(AVFilterContext *ctx, action_func *func, void *arg,
                    int *ret, int nb_jobs);
+
+    AVFilterProfile profile;
+    int64_t profile_wall_start;
+    int64_t profile_cpu_start;
 };
 
 #if FF_API_AVFILTERBUFFER
@@ -136,6 +146,12 @@ struct AVFilterInternal {
 void ff_avfilter_default_free_buffer(AVFilterBuffer *buf);
 #endif
 
+/**
+ * Account a newly allocated frame in the profiling counters of the filter
+ * currently running in the graph of the given link.
+ */
+void ff_filter_profile_alloc(AVFilterLink *link, const AVFrame *frame);
+
 /** Tell is a format is contained in the provided list terminated by -1. */
 int ff_fmt_is_in(int fmt, const int *fmts);
 
@@ -25,15 +25,19 @@
  * Ported from MPlayer libmpcodecs/vf_boxblur.c.
  */
 
+#include "config.h"
+#include "libavutil/attributes.h"
 #include "libavutil/avstring.h"
 #include "libavutil/common.h"
 #include "libavutil/eval.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "avfilter.h"
 #include "formats.h"
 #include "internal.h"
 #include "video.h"
+#include "vf_boxblur.h"
 
 static const char *const var_names[] = {
     "w",
@@ -73,6 +77,10 @@ typedef struct {
     int radius[4];
     int power[4];
     uint8_t *temp[2]; ///< temporary buffer used in blur_power()
+    uint8_t *plane[2];  ///< temporary planes used by the vertical blur
+    int plane_linesize;
+    int32_t *sum;       ///< per-column running sums of the vertical blur
+    BoxBlurDSPContext dsp;
 } BoxBlurContext;
 
 #define Y 0
@@ -111,6 +119,9 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     av_freep(&s->temp[0]);
     av_freep(&s->temp[1]);
+    av_freep(&s->plane[0]);
+    av_freep(&s->plane[1]);
+    av_freep(&s->sum);
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -139,14 +150,10 @@ static int config_input(AVFilterLink *inlink)
     char *expr;
     int ret;
 
-    av_freep(&s->temp[0]);
-    av_freep(&s->temp[1]);
-    if (!(s->temp[0] = av_malloc(FFMAX(w, h))))
-       return AVERROR(ENOMEM);
-    if (!(s->temp[1] = av_malloc(FFMAX(w, h)))) {
-        av_freep(&s->temp[0]);
+    uninit(ctx);
+    if (!(s->temp[0] = av_malloc(FFMAX(w, h))) ||
+        !(s->temp[1] = av_malloc(FFMAX(w, h))))
         return AVERROR(ENOMEM);
-    }
 
     s->hsub = desc->log2_chroma_w;
     s->vsub = desc->log2_chroma_h;
@@ -202,6 +209,16 @@ static int config_input(AVFilterLink *inlink)
     s->power[U] = s->power[V] = s->chroma_param.power;
     s->power[A] = s->alpha_param.power;
 
+    /* the second plane is only needed to iterate the vertical blur */
+    s->plane_linesize = FFALIGN(w, 32);
+    if (!(s->plane[0] = av_malloc(s->plane_linesize * h)) ||
+        (FFMAX3(s->power[Y], s->power[U], s->power[A]) > 1 &&
+         !(s->plane[1] = av_malloc(s->plane_linesize * h))) ||
+        !(s->sum = av_malloc(w * sizeof(*s->sum))))
+        return AVERROR(ENOMEM);
+
+    ff_boxblur_dsp_init(&s->dsp);
+
     return 0;
 }
 
@@ -277,25 +294,81 @@ static void hblur(uint8_t *dst, int dst_linesize, const uint8_t *src, int src_li
 {
     int y;
 
-    if (radius == 0 && dst == src)
-        return;
-
     for (y = 0; y < h; y++)
         blur_power(dst + y*dst_linesize, 1, src + y*src_linesize, 1,
                    w, radius, power, temp);
 }
 
-static void vblur(uint8_t *dst, int dst_linesize, const uint8_t *src, int src_linesize,
-                  int w, int h, int radius, int power, uint8_t *temp[2])
+static void vblur_line_c(uint8_t *dst, int32_t *sum, const uint8_t *add,
+                         const uint8_t *sub, int len, int inv)
 {
     int x;
 
-    if (radius == 0 && dst == src)
-        return;
+    for (x = 0; x < len; x++) {
+        sum[x] += add[x] - sub[x];
+        dst[x]  = (sum[x]*inv + (1<<15))>>16;
+    }
+}
+
+av_cold void ff_boxblur_dsp_init(BoxBlurDSPContext *dsp)
+{
+    dsp->vblur_line = vblur_line_c;
+
+    if (ARCH_X86)
+        ff_boxblur_dsp_init_x86(dsp);
+}
+
+/* Same as blur() applied to every column, but walking the plane line by
+ * line with one running sum per column, so that whole lines are processed
+ * at once. */
+static void vblur_once(BoxBlurContext *s, uint8_t *dst, int dst_linesize,
+                       const uint8_t *src, int src_linesize,
+                       int w, int h, int radius)
+{
+    const int length = radius*2 + 1;
+    const int inv = ((1<<16) + length/2)/length;
+    int32_t *sum = s->sum;
+    int w8 = w & ~7;
+    int x, y, add, sub;
 
     for (x = 0; x < w; x++)
-        blur_power(dst + x, dst_linesize, src + x, src_linesize,
-                   h, radius, power, temp);
+        sum[x] = src[radius*src_linesize + x];
+    for (y = 0; y < radius; y++)
+        for (x = 0; x < w; x++)
+            sum[x] += src[y*src_linesize + x]<<1;
+
+    for (y = 0; y < h; y++) {
+        add = y < h - radius ? radius + y : 2*h - radius - y - 1;
+        sub = y <= radius    ? radius - y : y - radius - 1;
+
+        s->dsp.vblur_line(dst + y*dst_linesize, sum,
+                          src + add*src_linesize, src + sub*src_linesize,
+                          w8, inv);
+        if (w8 < w)
+            vblur_line_c(dst + y*dst_linesize + w8, sum + w8,
+                         src + add*src_linesize + w8, src + sub*src_linesize + w8,
+                         w - w8, inv);
+    }
+}
+
+static void vblur(BoxBlurContext *s, uint8_t *dst, int dst_linesize,
+                  const uint8_t *src, int src_linesize,
+                  int w, int h, int radius, int power)
+{
+    const uint8_t *cur = src;
+    uint8_t *next;
+    int cur_linesize = src_linesize;
+
+    for (; power > 0; power--) {
+        if (power == 1)
+            next = dst;
+        else
+            next = cur == s->plane[0] ? s->plane[1] : s->plane[0];
+        vblur_once(s, next, power == 1 ? dst_linesize : s->plane_linesize,
+                   cur, cur_linesize, w, h, radius);
+        cur          = next;
+        cur_linesize = s->plane_linesize;
+    }
 }
 
 static int filter_frame(AVFilterLink *inlink, AVFrame *in)
@@ -316,17 +389,22 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     }
     av_frame_copy_props(out, in);
 
-    for (plane = 0; in->data[plane] && plane < 4; plane++)
-        hblur(out->data[plane], out->linesize[plane],
-              in ->data[plane], in ->linesize[plane],
-              w[plane], h[plane], s->radius[plane], s->power[plane],
-              s->temp);
+    for (plane = 0; in->data[plane] && plane < 4; plane++) {
+        if (!s->radius[plane] || !s->power[plane]) {
+            av_image_copy_plane(out->data[plane], out->linesize[plane],
+                                in ->data[plane], in ->linesize[plane],
+                                w[plane], h[plane]);
+            continue;
+        }
 
-    for (plane = 0; in->data[plane] && plane < 4; plane++)
-        vblur(out->data[plane], out->linesize[plane],
-              out->data[plane], out->linesize[plane],
+        hblur(s->plane[0], s->plane_linesize,
+              in->data[plane], in->linesize[plane],
               w[plane], h[plane], s->radius[plane], s->power[plane],
               s->temp);
+        vblur(s, out->data[plane], out->linesize[plane],
+              s->plane[0], s->plane_linesize,
+              w[plane], h[plane], s->radius[plane], s->power[plane]);
+    }
 
     av_frame_free(&in);
 
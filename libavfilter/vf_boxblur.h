@@ -0,0 +1,50 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Libav; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file
+ * boxblur filter DSP functions
+ */
+
+#ifndef AVFILTER_VF_BOXBLUR_H
+#define AVFILTER_VF_BOXBLUR_H
+
+#include <stdint.h>
+
+typedef struct BoxBlurDSPContext {
+    /**
+     * Advance the per-column running sums of a vertical box blur by one
+     * line and output the blurred line:
+     * sum[i] += add[i] - sub[i]
+     * dst[i]  = (sum[i] * inv + (1 << 15)) >> 16
+     *
+     * @param dst line to write
+     * @param sum running sums, one per column
+     * @param add line entering the box
+     * @param sub line leaving the box
+     * @param len number of pixels, constraints: multiple of 8
+     * @param inv reciprocal of the box length in 16.16 fixed point
+     */
+    void (*vblur_line)(uint8_t *dst, int32_t *sum, const uint8_t *add,
+                       const uint8_t *sub, int len, int inv);
+} BoxBlurDSPContext;
+
+void ff_boxblur_dsp_init(BoxBlurDSPContext *dsp);
+void ff_boxblur_dsp_init_x86(BoxBlurDSPContext *dsp);
+
+#endif /* AVFILTER_VF_BOXBLUR_H */
@@ -55,7 +55,8 @@ static uint32_t lowpass(int prev, int cur, int16_t *coef, int depth)
 }
 
 av_always_inline
-static void denoise_temporal(uint8_t *src, uint8_t *dst,
+static void denoise_temporal(HQDN3DContext *s,
+                             uint8_t *src, uint8_t *dst,
                              uint16_t *frame_ant,
                              int w, int h, int sstride, int dstride,
                              int16_t *temporal, int depth)
@@ -66,6 +67,13 @@ static void denoise_temporal(uint8_t *src, uint8_t *dst,
     temporal += 256 << LUT_BITS;
 
     for (y = 0; y < h; y++) {
+        if (s->denoise_temporal_row[depth]) {
+            s->denoise_temporal_row[depth](src, dst, frame_ant, w, temporal);
+            src += sstride;
+            dst += dstride;
+            frame_ant += w;
+            continue;
+        }
         for (x = 0; x < w; x++) {
             frame_ant[x] = tmp = lowpass(frame_ant[x], LOAD(x), temporal, depth);
             STORE(x, tmp);
@@ -145,7 +153,7 @@ static void denoise_depth(HQDN3DContext *s,
         denoise_spatial(s, src, dst, line_ant, frame_ant,
                         w, h, sstride, dstride, spatial, temporal, depth);
     else
-        denoise_temporal(src, dst, frame_ant,
+        denoise_temporal(s, src, dst, frame_ant,
                          w, h, sstride, dstride, temporal, depth);
 }
 
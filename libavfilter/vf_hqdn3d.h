@@ -33,6 +33,7 @@ typedef struct {
     int hsub, vsub;
     int depth;
     void (*denoise_row[17])(uint8_t *src, uint8_t *dst, uint16_t *line_ant, uint16_t *frame_ant, ptrdiff_t w, int16_t *spatial, int16_t *temporal);
+    void (*denoise_temporal_row[17])(uint8_t *src, uint8_t *dst, uint16_t *frame_ant, ptrdiff_t w, int16_t *temporal);
 } HQDN3DContext;
 
 #define LUMA_SPATIAL   0
@@ -36,10 +36,13 @@
  * http://www.engin.umd.umich.edu/~jwvm/ece581/21_GBlur.pdf
  */
 
+#include "config.h"
 #include "avfilter.h"
 #include "formats.h"
 #include "internal.h"
 #include "video.h"
+#include "vf_unsharp.h"
+#include "libavutil/attributes.h"
 #include "libavutil/common.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
@@ -60,6 +63,7 @@ typedef struct FilterParam {
     int scalebits;                           ///< bits to shift pixel
     int32_t halfscale;                       ///< amount to add to pixel
     uint32_t *sc[(MAX_SIZE * MAX_SIZE) - 1]; ///< finite state machine storage
+    uint32_t *row;                           ///< horizontally filtered line
 } FilterParam;
 
 typedef struct {
@@ -69,18 +73,71 @@ typedef struct {
     FilterParam luma;   ///< luma parameters (width, height, amount)
     FilterParam chroma; ///< chroma parameters (width, height, amount)
     int hsub, vsub;
+    UnsharpDSPContext dsp;
 } UnsharpContext;
 
-static void apply_unsharp(      uint8_t *dst, int dst_stride,
+static void hsum_c(uint32_t *row, int len)
+{
+    uint32_t prev = 0, cur;
+    int i;
+
+    for (i = 0; i < len; i++) {
+        cur    = row[i];
+        row[i] = cur + prev;
+        prev   = cur;
+    }
+}
+
+static void vsum_c(uint32_t *row, uint32_t *state, int len)
+{
+    uint32_t cur;
+    int i;
+
+    for (i = 0; i < len; i++) {
+        cur      = row[i];
+        row[i]   = cur + state[i];
+        state[i] = cur;
+    }
+}
+
+static void sharpen_c(uint8_t *dst, const uint8_t *src, const uint32_t *blur,
+                      int len, int amount, int halfscale, int scalebits)
+{
+    int32_t res;
+    int i;
+
+    for (i = 0; i < len; i++) {
+        res    = (int32_t)src[i] + ((((int32_t)src[i] - (int32_t)((blur[i] + halfscale) >> scalebits)) * amount) >> 16);
+        dst[i] = av_clip_uint8(res);
+    }
+}
+
+av_cold void ff_unsharp_dsp_init(UnsharpDSPContext *dsp)
+{
+    dsp->hsum    = hsum_c;
+    dsp->vsum    = vsum_c;
+    dsp->sharpen = sharpen_c;
+
+    if (ARCH_X86)
+        ff_unsharp_dsp_init_x86(dsp);
+}
+
+/* The blur is a cascade of 2 * steps [1 1] filters in each direction. Each
+ * source line is padded with copies of its edge pixels and run through the
+ * horizontal stages, then through the vertical stages, whose state holds
+ * the previous lines. Output line y is complete once line y + steps_y has
+ * been fed in. */
+static void apply_unsharp(UnsharpDSPContext *dsp,
+                                uint8_t *dst, int dst_stride,
                           const uint8_t *src, int src_stride,
                           int width, int height, FilterParam *fp)
 {
     uint32_t **sc = fp->sc;
-    uint32_t sr[(MAX_SIZE * MAX_SIZE) - 1], tmp1, tmp2;
-
-    int32_t res;
-    int x, y, z;
+    uint32_t *row = fp->row;
+    int row_len = width + 2 * fp->steps_x;
+    int width8  = width & ~7;
     const uint8_t *src2;
+    int x, y, z;
 
     if (!fp->amount) {
         if (dst_stride == src_stride)
@@ -92,34 +149,34 @@ static void apply_unsharp(      uint8_t *dst, int dst_stride,
     }
 
     for (y = 0; y < 2 * fp->steps_y; y++)
-        memset(sc[y], 0, sizeof(sc[y][0]) * (width + 2 * fp->steps_x));
+        memset(sc[y], 0, sizeof(sc[y][0]) * width);
 
     for (y = -fp->steps_y; y < height + fp->steps_y; y++) {
-        if (y < height)
-            src2 = src;
-
-        memset(sr, 0, sizeof(sr[0]) * (2 * fp->steps_x - 1));
-        for (x = -fp->steps_x; x < width + fp->steps_x; x++) {
-            tmp1 = x <= 0 ? src2[0] : x >= width ? src2[width-1] : src2[x];
-            for (z = 0; z < fp->steps_x * 2; z += 2) {
-                tmp2 = sr[z + 0] + tmp1; sr[z + 0] = tmp1;
-                tmp1 = sr[z + 1] + tmp2; sr[z + 1] = tmp2;
-            }
-            for (z = 0; z < fp->steps_y * 2; z += 2) {
-                tmp2 = sc[z + 0][x + fp->steps_x] + tmp1; sc[z + 0][x + fp->steps_x] = tmp1;
-                tmp1 = sc[z + 1][x + fp->steps_x] + tmp2; sc[z + 1][x + fp->steps_x] = tmp2;
-            }
-            if (x >= fp->steps_x && y >= fp->steps_y) {
-                const uint8_t *srx = src - fp->steps_y * src_stride + x - fp->steps_x;
-                uint8_t *dsx       = dst - fp->steps_y * dst_stride + x - fp->steps_x;
-
-                res = (int32_t)*srx + ((((int32_t) * srx - (int32_t)((tmp1 + fp->halfscale) >> fp->scalebits)) * fp->amount) >> 16);
-                *dsx = av_clip_uint8(res);
-            }
+        src2 = src + av_clip(y, 0, height - 1) * src_stride;
+
+        for (x = 0; x < fp->steps_x; x++) {
+            row[x]                       = src2[0];
+            row[fp->steps_x + width + x] = src2[width - 1];
         }
-        if (y >= 0) {
-            dst += dst_stride;
-            src += src_stride;
+        for (x = 0; x < width; x++)
+            row[fp->steps_x + x] = src2[x];
+
+        for (z = 0; z < 2 * fp->steps_x; z++)
+            dsp->hsum(row, row_len);
+        /* only the columns of complete horizontal windows are kept */
+        for (z = 0; z < 2 * fp->steps_y; z++)
+            dsp->vsum(row + 2 * fp->steps_x, sc[z], width);
+
+        if (y >= fp->steps_y) {
+            const uint8_t *srx = src + (y - fp->steps_y) * src_stride;
+            uint8_t       *dsx = dst + (y - fp->steps_y) * dst_stride;
+            const uint32_t *blur = row + 2 * fp->steps_x;
+
+            dsp->sharpen(dsx, srx, blur, width8,
+                         fp->amount, fp->halfscale, fp->scalebits);
+            if (width8 < width)
+                sharpen_c(dsx + width8, srx + width8, blur + width8,
+                          width - width8, fp->amount, fp->halfscale, fp->scalebits);
         }
     }
 }
@@ -159,7 +216,7 @@ static int query_formats(AVFilterContext *ctx)
     return 0;
 }
 
-static void init_filter_param(AVFilterContext *ctx, FilterParam *fp, const char *effect_type, int width)
+static int init_filter_param(AVFilterContext *ctx, FilterParam *fp, const char *effect_type, int width)
 {
     int z;
     const char *effect;
@@ -169,20 +226,35 @@ static void init_filter_param(AVFilterContext *ctx, FilterParam *fp, const char
     av_log(ctx, AV_LOG_VERBOSE, "effect:%s type:%s msize_x:%d msize_y:%d amount:%0.2f\n",
            effect, effect_type, fp->msize_x, fp->msize_y, fp->amount / 65535.0);
 
-    for (z = 0; z < 2 * fp->steps_y; z++)
-        fp->sc[z] = av_malloc(sizeof(*(fp->sc[z])) * (width + 2 * fp->steps_x));
+    for (z = 0; z < 2 * fp->steps_y; z++) {
+        fp->sc[z] = av_malloc(sizeof(*(fp->sc[z])) * FFALIGN(width, 8));
+        if (!fp->sc[z])
+            return AVERROR(ENOMEM);
+    }
+    fp->row = av_malloc(sizeof(*fp->row) * (FFALIGN(width + 2 * fp->steps_x, 8) + 8));
+    if (!fp->row)
+        return AVERROR(ENOMEM);
+
+    return 0;
 }
 
 static int config_props(AVFilterLink *link)
 {
     UnsharpContext *unsharp = link->dst->priv;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(link->format);
+    int ret;
 
     unsharp->hsub = desc->log2_chroma_w;
     unsharp->vsub = desc->log2_chroma_h;
 
-    init_filter_param(link->dst, &unsharp->luma,   "luma",   link->w);
-    init_filter_param(link->dst, &unsharp->chroma, "chroma", SHIFTUP(link->w, unsharp->hsub));
+    ret = init_filter_param(link->dst, &unsharp->luma,   "luma",   link->w);
+    if (ret < 0)
+        return ret;
+    ret = init_filter_param(link->dst, &unsharp->chroma, "chroma", SHIFTUP(link->w, unsharp->hsub));
+    if (ret < 0)
+        return ret;
+
+    ff_unsharp_dsp_init(&unsharp->dsp);
 
     return 0;
 }
@@ -192,7 +264,8 @@ static void free_filter_param(FilterParam *fp)
     int z;
 
     for (z = 0; z < 2 * fp->steps_y; z++)
-        av_free(fp->sc[z]);
+        av_freep(&fp->sc[z]);
+    av_freep(&fp->row);
 }
 
 static av_cold void uninit(AVFilterContext *ctx)
@@ -218,9 +291,9 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
     }
     av_frame_copy_props(out, in);
 
-    apply_unsharp(out->data[0], out->linesize[0], in->data[0], in->linesize[0], link->w, link->h, &unsharp->luma);
-    apply_unsharp(out->data[1], out->linesize[1], in->data[1], in->linesize[1], cw,      ch,      &unsharp->chroma);
-    apply_unsharp(out->data[2], out->linesize[2], in->data[2], in->linesize[2], cw,      ch,      &unsharp->chroma);
+    apply_unsharp(&unsharp->dsp, out->data[0], out->linesize[0], in->data[0], in->linesize[0], link->w, link->h, &unsharp->luma);
+    apply_unsharp(&unsharp->dsp, out->data[1], out->linesize[1], in->data[1], in->linesize[1], cw,      ch,      &unsharp->chroma);
+    apply_unsharp(&unsharp->dsp, out->data[2], out->linesize[2], in->data[2], in->linesize[2], cw,      ch,      &unsharp->chroma);
 
     av_frame_free(&in);
     return ff_filter_frame(outlink, out);
@@ -0,0 +1,65 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * unsharp filter DSP functions
+ */
+
+#ifndef AVFILTER_VF_UNSHARP_H
+#define AVFILTER_VF_UNSHARP_H
+
+#include <stdint.h>
+
+typedef struct UnsharpDSPContext {
+    /**
+     * Apply one stage of the horizontal [1 1] filter in place:
+     * row[i] = row[i] + row[i - 1], with row[-1] taken as 0.
+     *
+     * @param row buffer of at least FFALIGN(len, 8) elements,
+     *            elements past len may be overwritten
+     * @param len number of elements
+     */
+    void (*hsum)(uint32_t *row, int len);
+
+    /**
+     * Apply one stage of the vertical [1 1] filter:
+     * row[i] = row[i] + state[i], state[i] = previous row[i].
+     *
+     * @param row   buffer of at least FFALIGN(len, 8) elements,
+     *              elements past len may be overwritten
+     * @param state filter state of the same size as row
+     * @param len   number of elements
+     */
+    void (*vsum)(uint32_t *row, uint32_t *state, int len);
+
+    /**
+     * Mix the source with its blurred version:
+     * dst[i] = av_clip_uint8(src[i] + (((src[i] -
+     *          ((blur[i] + halfscale) >> scalebits)) * amount) >> 16))
+     *
+     * @param len number of pixels, constraints: multiple of 8
+     */
+    void (*sharpen)(uint8_t *dst, const uint8_t *src, const uint32_t *blur,
+                    int len, int amount, int halfscale, int scalebits);
+} UnsharpDSPContext;
+
+void ff_unsharp_dsp_init(UnsharpDSPContext *dsp);
+void ff_unsharp_dsp_init_x86(UnsharpDSPContext *dsp);
+
+#endif /* AVFILTER_VF_UNSHARP_H */
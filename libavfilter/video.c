@@ -50,6 +50,8 @@ AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
     ret = av_frame_get_buffer(frame, 32);
     if (ret < 0)
         av_frame_free(&frame);
+    else
+        ff_filter_profile_alloc(link, frame);
 
     return frame;
 }
@@ -0,0 +1,74 @@
+;*****************************************************************************
+;* x86-optimized functions for amix filter
+;*
+;* This file is part of Libav.
+;*
+;* Libav is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* Libav is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with Libav; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_TEXT
+
+;------------------------------------------------------------------------------
+; void ff_mix_inputs(float *dst, const float **src, const float *scale,
+;                    int nb_inputs, int len)
+;------------------------------------------------------------------------------
+
+%macro MIX_INPUTS 0
+cglobal mix_inputs, 5,8,6, dst, src, scale, nb_inputs, len, pos, in, ptr
+    movsxdifnidn nb_inputsq, nb_inputsd
+    movsxdifnidn lenq, lend
+    shl         lenq, 2
+    xor         posq, posq
+.loop:
+    ; accumulate in input order to stay bit-identical with vector_fmac_scalar
+%assign i 0
+%rep 64/mmsize
+    mova        m %+ i, [dstq+posq+i*mmsize]
+%assign i i+1
+%endrep
+    xor          inq, inq
+.input:
+    mov         ptrq, [srcq+inq*gprsize]
+    VBROADCASTSS  m4, [scaleq+inq*4]
+%assign i 0
+%rep 64/mmsize
+    mulps         m5, m4, [ptrq+posq+i*mmsize]
+    addps       m %+ i, m %+ i, m5
+%assign i i+1
+%endrep
+    inc          inq
+    cmp          inq, nb_inputsq
+    jl .input
+%assign i 0
+%rep 64/mmsize
+    mova  [dstq+posq+i*mmsize], m %+ i
+%assign i i+1
+%endrep
+    add         posq, 64
+    cmp         posq, lenq
+    jl .loop
+    REP_RET
+%endmacro
+
+%if ARCH_X86_64
+INIT_XMM sse
+MIX_INPUTS
+%if HAVE_AVX_EXTERNAL
+INIT_YMM avx
+MIX_INPUTS
+%endif
+%endif
@@ -36,7 +36,7 @@ SECTION_TEXT
 ;                           int volume)
 ;------------------------------------------------------------------------------
 
-INIT_XMM sse2
+%macro SCALE_SAMPLES_S16 0
 cglobal scale_samples_s16, 4,4,4, dst, src, len, volume
     movd        m0, volumem
     pshuflw     m0, m0, 0
@@ -57,6 +57,14 @@ cglobal scale_samples_s16, 4,4,4, dst, src, len, volume
     sub       lenq, mmsize
     jge .loop
     REP_RET
+%endmacro
+
+INIT_XMM sse2
+SCALE_SAMPLES_S16
+%if HAVE_AVX_EXTERNAL
+INIT_XMM avx
+SCALE_SAMPLES_S16
+%endif
 
 ;------------------------------------------------------------------------------
 ; void ff_scale_samples_s32(uint8_t *dst, const uint8_t *src, int len,
@@ -136,3 +144,35 @@ cglobal scale_samples_s32, 4,4,8, dst, src, len, volume
     sub       lenq, mmsize
     jge .loop
     REP_RET
+
+;------------------------------------------------------------------------------
+; void ff_scale_samples_flt(float *dst, const float *src, float volume,
+;                           int len)
+;------------------------------------------------------------------------------
+
+%if HAVE_AVX_EXTERNAL
+INIT_YMM avx
+%if UNIX64
+cglobal scale_samples_flt, 3,3,3, dst, src, len
+%else
+cglobal scale_samples_flt, 4,4,3, dst, src, volume, len
+%endif
+%if ARCH_X86_32
+    VBROADCASTSS     m0, volumem
+%else
+%if WIN64
+    mova           xmm0, xmm2
+%endif
+    shufps         xmm0, xmm0, 0
+    vinsertf128      m0, m0, xmm0, 1
+%endif
+    lea            lenq, [lend*4-2*mmsize]
+.loop:
+    mulps            m1, m0, [srcq+lenq       ]
+    mulps            m2, m0, [srcq+lenq+mmsize]
+    mova  [dstq+lenq       ], m1
+    mova  [dstq+lenq+mmsize], m2
+    sub            lenq, 2*mmsize
+    jge .loop
+    REP_RET
+%endif
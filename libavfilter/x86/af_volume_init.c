@@ -25,6 +25,8 @@
 
 void ff_scale_samples_s16_sse2(uint8_t *dst, const uint8_t *src, int len,
                                int volume);
+void ff_scale_samples_s16_avx(uint8_t *dst, const uint8_t *src, int len,
+                              int volume);
 
 void ff_scale_samples_s32_sse2(uint8_t *dst, const uint8_t *src, int len,
                                int volume);
@@ -33,6 +35,9 @@ void ff_scale_samples_s32_ssse3_atom(uint8_t *dst, const uint8_t *src, int len,
 void ff_scale_samples_s32_avx(uint8_t *dst, const uint8_t *src, int len,
                               int volume);
 
+void ff_scale_samples_flt_avx(float *dst, const float *src, float volume,
+                              int len);
+
 av_cold void ff_volume_init_x86(VolumeContext *vol)
 {
     int cpu_flags = av_get_cpu_flags();
@@ -43,6 +48,10 @@ av_cold void ff_volume_init_x86(VolumeContext *vol)
             vol->scale_samples = ff_scale_samples_s16_sse2;
             vol->samples_align = 8;
         }
+        if (EXTERNAL_AVX(cpu_flags) && vol->volume_i < 32768) {
+            vol->scale_samples = ff_scale_samples_s16_avx;
+            vol->samples_align = 8;
+        }
     } else if (sample_fmt == AV_SAMPLE_FMT_S32) {
         if (EXTERNAL_SSE2(cpu_flags)) {
             vol->scale_samples = ff_scale_samples_s32_sse2;
@@ -56,5 +65,10 @@ av_cold void ff_volume_init_x86(VolumeContext *vol)
             vol->scale_samples = ff_scale_samples_s32_avx;
             vol->samples_align = 8;
         }
+    } else if (sample_fmt == AV_SAMPLE_FMT_FLT) {
+        if (EXTERNAL_AVX(cpu_flags)) {
+            vol->scale_samples_flt = ff_scale_samples_flt_avx;
+            vol->samples_align = 16;
+        }
     }
 }
@@ -0,0 +1,131 @@
+;*****************************************************************************
+;* x86-optimized functions for boxblur filter
+;*
+;* This file is part of Libav.
+;*
+;* Libav is free software; you can redistribute it and/or modify
+;* it under the terms of the GNU General Public License as published by
+;* the Free Software Foundation; either version 2 of the License, or
+;* (at your option) any later version.
+;*
+;* Libav is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+;* GNU General Public License for more details.
+;*
+;* You should have received a copy of the GNU General Public License along
+;* with Libav; if not, write to the Free Software Foundation, Inc.,
+;* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA
+
+pd_32768: times 4 dd 32768
+pd_255:   times 4 dd 255
+
+SECTION_TEXT
+
+; low 32 bits of a dword multiply, only lanes 0 and 2 of %2 are used
+%macro PMULLD_LO 3 ; dst/src, coef, tmp
+%if cpuflag(sse4)
+    pmulld    %1, %2
+%else
+    pshufd    %3, %1, 0xF5
+    pmuludq   %1, %2
+    pmuludq   %3, %2
+    pshufd    %1, %1, 0x08
+    pshufd    %3, %3, 0x08
+    punpckldq %1, %3
+%endif
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_boxblur_vblur_line(uint8_t *dst, int32_t *sum, const uint8_t *add,
+;                            const uint8_t *sub, int len, int inv)
+;------------------------------------------------------------------------------
+
+%macro VBLUR_LINE 0
+cglobal boxblur_vblur_line, 6,6,8, dst, sum, add, sub, len, inv
+    movsxdifnidn lenq, lend
+    movd      m6, invd
+    pshufd    m6, m6, 0
+    mova      m7, [pd_32768]
+    mova      m5, [pd_255]
+    pxor      m4, m4
+    add       dstq, lenq
+    add       addq, lenq
+    add       subq, lenq
+    lea       sumq, [sumq+lenq*4]
+    neg       lenq
+.loop:
+    movq      m0, [addq+lenq]
+    movq      m1, [subq+lenq]
+    punpcklbw m0, m4
+    punpcklbw m1, m4
+    psubw     m0, m1
+    ; sign-extend the differences to dwords
+    punpcklwd m1, m0
+    punpckhwd m2, m0
+    psrad     m1, 16
+    psrad     m2, 16
+    movu      m0, [sumq+lenq*4]
+    movu      m3, [sumq+lenq*4+mmsize]
+    paddd     m0, m1
+    paddd     m3, m2
+    movu      [sumq+lenq*4],        m0
+    movu      [sumq+lenq*4+mmsize], m3
+    PMULLD_LO m0, m6, m1
+    PMULLD_LO m3, m6, m2
+    paddd     m0, m7
+    paddd     m3, m7
+    psrld     m0, 16
+    psrld     m3, 16
+    ; the C version stores the result modulo 256
+    pand      m0, m5
+    pand      m3, m5
+    packssdw  m0, m3
+    packuswb  m0, m0
+    movq      [dstq+lenq], m0
+    add       lenq, 8
+    jl .loop
+    REP_RET
+%endmacro
+
+INIT_XMM sse2
+VBLUR_LINE
+INIT_XMM sse4
+VBLUR_LINE
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+cglobal boxblur_vblur_line, 6,6,6, dst, sum, add, sub, len, inv
+    movsxdifnidn lenq, lend
+    vmovd     xmm5, invd
+    vpbroadcastd m5, xmm5
+    vpbroadcastd m4, [pd_32768]
+    vpbroadcastd m3, [pd_255]
+    add       dstq, lenq
+    add       addq, lenq
+    add       subq, lenq
+    lea       sumq, [sumq+lenq*4]
+    neg       lenq
+.loop:
+    vpmovzxbd m0, [addq+lenq]
+    vpmovzxbd m1, [subq+lenq]
+    vpsubd    m0, m0, m1
+    vpaddd    m0, m0, [sumq+lenq*4]
+    movu      [sumq+lenq*4], m0
+    vpmulld   m0, m0, m5
+    vpaddd    m0, m0, m4
+    vpsrld    m0, m0, 16
+    vpand     m0, m0, m3
+    vextracti128 xmm1, m0, 1
+    vpackssdw xmm0, xmm0, xmm1
+    vpackuswb xmm0, xmm0, xmm0
+    vmovq     [dstq+lenq], xmm0
+    add       lenq, 8
+    jl .loop
+    REP_RET
+%endif
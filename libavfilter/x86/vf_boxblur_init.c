@@ -0,0 +1,42 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Libav; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/vf_boxblur.h"
+
+void ff_boxblur_vblur_line_sse2(uint8_t *dst, int32_t *sum, const uint8_t *add,
+                                const uint8_t *sub, int len, int inv);
+void ff_boxblur_vblur_line_sse4(uint8_t *dst, int32_t *sum, const uint8_t *add,
+                                const uint8_t *sub, int len, int inv);
+void ff_boxblur_vblur_line_avx2(uint8_t *dst, int32_t *sum, const uint8_t *add,
+                                const uint8_t *sub, int len, int inv);
+
+av_cold void ff_boxblur_dsp_init_x86(BoxBlurDSPContext *dsp)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_SSE2(cpu_flags))
+        dsp->vblur_line = ff_boxblur_vblur_line_sse2;
+    if (EXTERNAL_SSE4(cpu_flags))
+        dsp->vblur_line = ff_boxblur_vblur_line_sse4;
+    if (EXTERNAL_AVX2(cpu_flags))
+        dsp->vblur_line = ff_boxblur_vblur_line_avx2;
+}
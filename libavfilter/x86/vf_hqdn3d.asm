@@ -104,3 +104,38 @@ HQDN3D_ROW 8
 HQDN3D_ROW 9
 HQDN3D_ROW 10
 HQDN3D_ROW 16
+
+%if ARCH_X86_64
+%macro HQDN3D_TEMPORAL_ROW 1 ; bitdepth
+cglobal hqdn3d_temporal_row_%1_x86, 5,7,0, src, dst, frameant, width, temporal, t0, t1
+    %assign bytedepth (%1+7)>>3
+    %assign lut_bits 4+4*(%1/16)
+    lea    srcq, [srcq+widthq*bytedepth]
+    lea    dstq, [dstq+widthq*bytedepth]
+    lea    frameantq, [frameantq+widthq*2]
+    neg    widthq
+    %define xq widthq
+ALIGN 16
+.loop:
+    LOAD      t1d, xq, %1
+    movzx     t0d, word [frameantq+xq*2]
+    LOWPASS   t0, t1, temporal
+    mov       [frameantq+xq*2], t0w
+%if %1 != 16
+    shr    t0d, 16-%1
+%endif
+%if %1 == 8
+    mov    [dstq+xq], t0b
+%else
+    mov    [dstq+xq*2], t0w
+%endif
+    inc    xq
+    jl .loop
+    REP_RET
+%endmacro ; HQDN3D_TEMPORAL_ROW
+
+HQDN3D_TEMPORAL_ROW 8
+HQDN3D_TEMPORAL_ROW 9
+HQDN3D_TEMPORAL_ROW 10
+HQDN3D_TEMPORAL_ROW 16
+%endif
@@ -27,6 +27,10 @@ void ff_hqdn3d_row_8_x86(uint8_t *src, uint8_t *dst, uint16_t *line_ant, uint16_
 void ff_hqdn3d_row_9_x86(uint8_t *src, uint8_t *dst, uint16_t *line_ant, uint16_t *frame_ant, ptrdiff_t w, int16_t *spatial, int16_t *temporal);
 void ff_hqdn3d_row_10_x86(uint8_t *src, uint8_t *dst, uint16_t *line_ant, uint16_t *frame_ant, ptrdiff_t w, int16_t *spatial, int16_t *temporal);
 void ff_hqdn3d_row_16_x86(uint8_t *src, uint8_t *dst, uint16_t *line_ant, uint16_t *frame_ant, ptrdiff_t w, int16_t *spatial, int16_t *temporal);
+void ff_hqdn3d_temporal_row_8_x86(uint8_t *src, uint8_t *dst, uint16_t *frame_ant, ptrdiff_t w, int16_t *temporal);
+void ff_hqdn3d_temporal_row_9_x86(uint8_t *src, uint8_t *dst, uint16_t *frame_ant, ptrdiff_t w, int16_t *temporal);
+void ff_hqdn3d_temporal_row_10_x86(uint8_t *src, uint8_t *dst, uint16_t *frame_ant, ptrdiff_t w, int16_t *temporal);
+void ff_hqdn3d_temporal_row_16_x86(uint8_t *src, uint8_t *dst, uint16_t *frame_ant, ptrdiff_t w, int16_t *temporal);
 
 av_cold void ff_hqdn3d_init_x86(HQDN3DContext *hqdn3d)
 {
@@ -35,5 +39,11 @@ av_cold void ff_hqdn3d_init_x86(HQDN3DContext *hqdn3d)
     hqdn3d->denoise_row[ 9] = ff_hqdn3d_row_9_x86;
     hqdn3d->denoise_row[10] = ff_hqdn3d_row_10_x86;
     hqdn3d->denoise_row[16] = ff_hqdn3d_row_16_x86;
+#if ARCH_X86_64
+    hqdn3d->denoise_temporal_row[ 8] = ff_hqdn3d_temporal_row_8_x86;
+    hqdn3d->denoise_temporal_row[ 9] = ff_hqdn3d_temporal_row_9_x86;
+    hqdn3d->denoise_temporal_row[10] = ff_hqdn3d_temporal_row_10_x86;
+    hqdn3d->denoise_temporal_row[16] = ff_hqdn3d_temporal_row_16_x86;
+#endif /* ARCH_X86_64 */
 #endif
 }
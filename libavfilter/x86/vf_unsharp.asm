@@ -0,0 +1,182 @@
+;*****************************************************************************
+;* x86-optimized functions for unsharp filter
+;*
+;* This file is part of Libav.
+;*
+;* Libav is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* Libav is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with Libav; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA 32
+
+; rotates a block of dwords right by one element
+pd_rotate_r: dd 7, 0, 1, 2, 3, 4, 5, 6
+
+SECTION_TEXT
+
+INIT_XMM sse2
+;------------------------------------------------------------------------------
+; void ff_unsharp_hsum(uint32_t *row, int len)
+;------------------------------------------------------------------------------
+
+cglobal unsharp_hsum, 2,2,3, row, len
+    movsxdifnidn lenq, lend
+    lea       rowq, [rowq+lenq*4]
+    neg       lenq
+    pxor      m1, m1              ; previous block, row[-1] = 0
+.loop:
+    movu      m0, [rowq+lenq*4]
+    mova      m2, m0
+    pslldq    m2, 4
+    psrldq    m1, 12
+    por       m2, m1              ; row[i-1]
+    paddd     m2, m0
+    mova      m1, m0
+    movu      [rowq+lenq*4], m2
+    add       lenq, mmsize/4
+    jl .loop
+    REP_RET
+
+%macro UNSHARP_VSUM 0
+;------------------------------------------------------------------------------
+; void ff_unsharp_vsum(uint32_t *row, uint32_t *state, int len)
+;------------------------------------------------------------------------------
+
+cglobal unsharp_vsum, 3,3,4, row, state, len
+    movsxdifnidn lenq, lend
+    lea       rowq,   [rowq  +lenq*4]
+    lea       stateq, [stateq+lenq*4]
+    neg       lenq
+.loop:
+    ; 8 elements per iteration, the buffers are only padded to that
+    movu      m0, [rowq  +lenq*4]
+    movu      m2, [stateq+lenq*4]
+    movu      [stateq+lenq*4],        m0
+%if mmsize == 16
+    movu      m1, [rowq  +lenq*4+mmsize]
+    movu      m3, [stateq+lenq*4+mmsize]
+    movu      [stateq+lenq*4+mmsize], m1
+    paddd     m1, m3
+    movu      [rowq+lenq*4+mmsize],   m1
+%endif
+    paddd     m0, m2
+    movu      [rowq+lenq*4],          m0
+    add       lenq, 8
+    jl .loop
+    REP_RET
+%endmacro
+
+INIT_XMM sse2
+UNSHARP_VSUM
+
+INIT_XMM sse4
+;------------------------------------------------------------------------------
+; void ff_unsharp_sharpen(uint8_t *dst, const uint8_t *src,
+;                         const uint32_t *blur, int len, int amount,
+;                         int halfscale, int scalebits)
+;------------------------------------------------------------------------------
+
+cglobal unsharp_sharpen, 7,7,8, dst, src, blur, len, amount, halfscale, scalebits
+    movsxdifnidn lenq, lend
+    ; (src - blur) * amount == (blur - src) * -amount
+    neg       amountd
+    movd      m5, amountd
+    movd      m6, halfscaled
+    movd      m7, scalebitsd
+    pshufd    m5, m5, 0
+    pshufd    m6, m6, 0
+    pxor      m4, m4
+    add       dstq, lenq
+    add       srcq, lenq
+    lea       blurq, [blurq+lenq*4]
+    neg       lenq
+.loop:
+    movq      m0, [srcq+lenq]
+    punpcklbw m0, m4
+    mova      m1, m0
+    punpcklwd m0, m4
+    punpckhwd m1, m4
+    movu      m2, [blurq+lenq*4]
+    movu      m3, [blurq+lenq*4+mmsize]
+    paddd     m2, m6
+    paddd     m3, m6
+    psrld     m2, m7
+    psrld     m3, m7
+    psubd     m2, m0
+    psubd     m3, m1
+    pmulld    m2, m5
+    pmulld    m3, m5
+    psrad     m2, 16
+    psrad     m3, 16
+    paddd     m2, m0
+    paddd     m3, m1
+    packssdw  m2, m3
+    packuswb  m2, m2
+    movq      [dstq+lenq], m2
+    add       lenq, 8
+    jl .loop
+    REP_RET
+
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+cglobal unsharp_hsum, 2,2,5, row, len
+    movsxdifnidn lenq, lend
+    lea       rowq, [rowq+lenq*4]
+    neg       lenq
+    mova      m3, [pd_rotate_r]
+    pxor      m1, m1              ; previous block rotated, row[-1] = 0
+.loop:
+    movu      m0, [rowq+lenq*4]
+    vpermd    m2, m3, m0
+    vpblendd  m4, m2, m1, 0x01    ; row[i-1]
+    mova      m1, m2
+    paddd     m4, m0
+    movu      [rowq+lenq*4], m4
+    add       lenq, mmsize/4
+    jl .loop
+    REP_RET
+
+UNSHARP_VSUM
+
+cglobal unsharp_sharpen, 7,7,6, dst, src, blur, len, amount, halfscale, scalebits
+    movsxdifnidn lenq, lend
+    neg       amountd
+    vmovd     xmm3, amountd
+    vmovd     xmm4, halfscaled
+    vmovd     xmm5, scalebitsd
+    vpbroadcastd m3, xmm3
+    vpbroadcastd m4, xmm4
+    add       dstq, lenq
+    add       srcq, lenq
+    lea       blurq, [blurq+lenq*4]
+    neg       lenq
+.loop:
+    vpmovzxbd m0, [srcq+lenq]
+    movu      m1, [blurq+lenq*4]
+    vpaddd    m1, m1, m4
+    vpsrld    m1, m1, xmm5
+    vpsubd    m1, m1, m0
+    vpmulld   m1, m1, m3
+    vpsrad    m1, m1, 16
+    vpaddd    m1, m1, m0
+    vextracti128 xmm2, m1, 1
+    vpackssdw xmm1, xmm1, xmm2
+    vpackuswb xmm1, xmm1, xmm1
+    vmovq     [dstq+lenq], xmm1
+    add       lenq, 8
+    jl .loop
+    REP_RET
+%endif
@@ -0,0 +1,51 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/vf_unsharp.h"
+
+void ff_unsharp_hsum_sse2(uint32_t *row, int len);
+void ff_unsharp_vsum_sse2(uint32_t *row, uint32_t *state, int len);
+void ff_unsharp_sharpen_sse4(uint8_t *dst, const uint8_t *src,
+                             const uint32_t *blur, int len, int amount,
+                             int halfscale, int scalebits);
+void ff_unsharp_hsum_avx2(uint32_t *row, int len);
+void ff_unsharp_vsum_avx2(uint32_t *row, uint32_t *state, int len);
+void ff_unsharp_sharpen_avx2(uint8_t *dst, const uint8_t *src,
+                             const uint32_t *blur, int len, int amount,
+                             int halfscale, int scalebits);
+
+av_cold void ff_unsharp_dsp_init_x86(UnsharpDSPContext *dsp)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_SSE2(cpu_flags)) {
+        dsp->hsum = ff_unsharp_hsum_sse2;
+        dsp->vsum = ff_unsharp_vsum_sse2;
+    }
+    if (EXTERNAL_SSE4(cpu_flags))
+        dsp->sharpen = ff_unsharp_sharpen_sse4;
+    if (EXTERNAL_AVX2(cpu_flags)) {
+        dsp->hsum    = ff_unsharp_hsum_avx2;
+        dsp->vsum    = ff_unsharp_vsum_avx2;
+        dsp->sharpen = ff_unsharp_sharpen_avx2;
+    }
+}
@@ -29,6 +29,9 @@
 #include "network.h"
 #endif
 #include "url.h"
+#if HAVE_WRITEV
+#include <sys/uio.h>
+#endif
 
 static URLProtocol *first_protocol = NULL;
 
@@ -273,6 +276,47 @@ int ffurl_write(URLContext *h, const unsigned char *buf, int size)
     return retry_transfer_wrapper(h, buf, size, size, h->prot->url_write);
 }
 
+#if HAVE_WRITEV
+int ffurl_writev(URLContext *h, struct iovec *iov, int iovcnt)
+{
+    int ret;
+    int fast_retries = 5;
+
+    if (!(h->flags & AVIO_FLAG_WRITE) || !h->prot->url_writev)
+        return AVERROR(EIO);
+
+    while (iovcnt > 0) {
+        ret = h->prot->url_writev(h, iov, iovcnt);
+        if (ret == AVERROR(EINTR))
+            continue;
+        if (ret == AVERROR(EAGAIN) && !(h->flags & AVIO_FLAG_NONBLOCK)) {
+            ret = 0;
+            if (fast_retries)
+                fast_retries--;
+            else
+                av_usleep(1000);
+        } else if (ret < 1) {
+            return ret < 0 ? ret : AVERROR(EIO);
+        }
+        if (ret)
+            fast_retries = FFMAX(fast_retries, 2);
+        /* skip what has been written, resume inside a partial buffer */
+        while (iovcnt > 0 && (size_t)ret >= iov->iov_len) {
+            ret -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base  = (uint8_t *)iov->iov_base + ret;
+            iov->iov_len  -= ret;
+        }
+        if (ff_check_interrupt(&h->interrupt_callback))
+            return AVERROR_EXIT;
+    }
+    return 0;
+}
+#endif
+
 int64_t ffurl_seek(URLContext *h, int64_t pos, int whence)
 {
     int64_t ret;
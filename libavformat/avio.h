@@ -28,6 +28,7 @@
 
 #include <stdint.h>
 
+#include "libavutil/buffer.h"
 #include "libavutil/common.h"
 #include "libavutil/dict.h"
 #include "libavutil/log.h"
@@ -115,6 +116,21 @@ typedef struct AVIOContext {
      * A combination of AVIO_SEEKABLE_ flags or 0 when the stream is not seekable.
      */
     int seekable;
+
+    /**
+     * If set, avio_write() passes writes of at least buffer_size bytes
+     * directly to write_packet() instead of copying them through the buffer,
+     * so write_packet() may be called with more than buffer_size bytes.
+     * Set by avio_open2() for protocols without a maximum packet size.
+     * Contexts allocated with avio_alloc_context() start with 0; the caller
+     * may set it if its write_packet() accepts any size.
+     */
+    int direct;
+
+    /**
+     * Buffers queued by avio_write_buffer(), private to libavformat.
+     */
+    struct AVIOWriteQueue *write_queue;
 } AVIOContext;
 
 /* unbuffered I/O */
@@ -146,6 +162,8 @@ int avio_check(const char *url, int flags);
  * @param opaque An opaque pointer to user-specific data.
  * @param read_packet  A function for refilling the buffer, may be NULL.
  * @param write_packet A function for writing the buffer contents, may be NULL.
+ *        It is called with at most buffer_size bytes unless
+ *        AVIOContext.direct is set.
  * @param seek A function for seeking to specified byte position, may be NULL.
  *
  * @return Allocated AVIOContext or NULL on failure.
@@ -161,6 +179,23 @@ AVIOContext *avio_alloc_context(
 
 void avio_w8(AVIOContext *s, int b);
 void avio_write(AVIOContext *s, const unsigned char *buf, int size);
+
+/**
+ * Write size bytes of data without copying them, where possible.
+ *
+ * Contexts opened with avio_open2() on protocols supporting vectored
+ * writes queue a new reference to buf instead of copying data into the
+ * I/O buffer. The queued data is written out together with the buffered
+ * bytes around it when the context is flushed. Otherwise, or if buf is
+ * NULL, this is equivalent to avio_write().
+ *
+ * @param buf  reference to the buffer containing data, may be NULL;
+ *             the data must not be modified while it is queued
+ * @param data start of the data to write, inside buf if buf is set
+ * @param size number of bytes to write
+ */
+void avio_write_buffer(AVIOContext *s, AVBufferRef *buf,
+                       const uint8_t *data, int size);
 void avio_wl64(AVIOContext *s, uint64_t val);
 void avio_wb64(AVIOContext *s, uint64_t val);
 void avio_wl32(AVIOContext *s, unsigned int val);
@@ -30,9 +30,32 @@
 #include "internal.h"
 #include "url.h"
 #include <stdarg.h>
+#if HAVE_WRITEV
+#include <sys/uio.h>
+#endif
 
 #define IO_BUFFER_SIZE 32768
 
+/**
+ * Maximum number of buffers queued by avio_write_buffer(). Together with
+ * the buffered bytes around them this stays within the 16 vectors POSIX
+ * guarantees writev() to accept.
+ */
+#define MAX_QUEUED_BUFFERS 7
+
+typedef struct AVIOQueuedBuffer {
+    AVBufferRef *buf;
+    uint8_t *data;
+    int size;
+    int buf_pos;            /**< bytes of the I/O buffer written before it */
+} AVIOQueuedBuffer;
+
+typedef struct AVIOWriteQueue {
+    AVIOQueuedBuffer bufs[MAX_QUEUED_BUFFERS];
+    int nb_bufs;
+    int64_t size;           /**< total size of the queued buffers */
+} AVIOWriteQueue;
+
 /**
  * Do seeks within this distance ahead of the current buffer by skipping
  * data instead of calling the protocol seek function, for seekable
@@ -121,8 +144,59 @@ AVIOContext *avio_alloc_context(
     return s;
 }
 
+#if HAVE_WRITEV
+static void flush_queue(AVIOContext *s)
+{
+    AVIOWriteQueue *q = s->write_queue;
+    struct iovec iov[2 * MAX_QUEUED_BUFFERS + 1];
+    int i, nb_iov = 0, buf_pos = 0;
+
+    for (i = 0; i < q->nb_bufs; i++) {
+        AVIOQueuedBuffer *b = &q->bufs[i];
+        if (b->buf_pos > buf_pos) {
+            iov[nb_iov].iov_base = s->buffer + buf_pos;
+            iov[nb_iov].iov_len  = b->buf_pos - buf_pos;
+            nb_iov++;
+            buf_pos = b->buf_pos;
+        }
+        iov[nb_iov].iov_base = b->data;
+        iov[nb_iov].iov_len  = b->size;
+        nb_iov++;
+    }
+    if (s->buf_ptr - s->buffer > buf_pos) {
+        iov[nb_iov].iov_base = s->buffer + buf_pos;
+        iov[nb_iov].iov_len  = s->buf_ptr - s->buffer - buf_pos;
+        nb_iov++;
+    }
+
+    if (!s->error) {
+        int ret = ffurl_writev(s->opaque, iov, nb_iov);
+        if (ret < 0)
+            s->error = ret;
+    }
+    if (s->update_checksum) {
+        s->checksum     = s->update_checksum(s->checksum, s->checksum_ptr,
+                                             s->buf_ptr - s->checksum_ptr);
+        s->checksum_ptr = s->buffer;
+    }
+    s->pos += s->buf_ptr - s->buffer + q->size;
+
+    for (i = 0; i < q->nb_bufs; i++)
+        av_buffer_unref(&q->bufs[i].buf);
+    q->nb_bufs = 0;
+    q->size    = 0;
+}
+#endif
+
 static void flush_buffer(AVIOContext *s)
 {
+#if HAVE_WRITEV
+    if (s->write_queue && s->write_queue->nb_bufs) {
+        flush_queue(s);
+        s->buf_ptr = s->buffer;
+        return;
+    }
+#endif
     if (s->buf_ptr > s->buffer) {
         if (s->write_packet && !s->error) {
             int ret = s->write_packet(s->opaque, s->buffer,
@@ -164,6 +238,23 @@ void ffio_fill(AVIOContext *s, int b, int count)
 
 void avio_write(AVIOContext *s, const unsigned char *buf, int size)
 {
+    /* Payloads at least as large as the buffer are passed on directly
+     * rather than copied through it. Packetized outputs need the data
+     * split by the buffer, and checksums are computed on the buffer. */
+    if (s->direct && size >= s->buffer_size && s->write_packet &&
+        !s->max_packet_size && !s->update_checksum) {
+        flush_buffer(s);
+        if (!s->error) {
+            /* the callback takes a non-const buffer for API compatibility,
+             * but must not modify it */
+            int ret = s->write_packet(s->opaque, (uint8_t *)buf, size);
+            if (ret < 0)
+                s->error = ret;
+        }
+        s->pos += size;
+        return;
+    }
+
     while (size > 0) {
         int len = FFMIN(s->buf_end - s->buf_ptr, size);
         memcpy(s->buf_ptr, buf, len);
@@ -177,6 +268,30 @@ void avio_write(AVIOContext *s, const unsigned char *buf, int size)
     }
 }
 
+void avio_write_buffer(AVIOContext *s, AVBufferRef *buf,
+                       const uint8_t *data, int size)
+{
+#if HAVE_WRITEV
+    AVIOWriteQueue *q = s->write_queue;
+
+    /* checksums are computed on the I/O buffer */
+    if (q && buf && size > 0 && !s->update_checksum) {
+        AVIOQueuedBuffer *b = &q->bufs[q->nb_bufs];
+
+        if ((b->buf = av_buffer_ref(buf))) {
+            b->data    = b->buf->data + (data - buf->data);
+            b->size    = size;
+            b->buf_pos = s->buf_ptr - s->buffer;
+            q->size   += size;
+            if (++q->nb_bufs == MAX_QUEUED_BUFFERS)
+                flush_buffer(s);
+            return;
+        }
+    }
+#endif
+    avio_write(s, data, size);
+}
+
 void avio_flush(AVIOContext *s)
 {
     flush_buffer(s);
@@ -200,10 +315,17 @@ int64_t avio_seek(AVIOContext *s, int64_t offset, int whence)
 
     if (whence == SEEK_CUR) {
         offset1 = pos + (s->buf_ptr - s->buffer);
+        if (s->write_queue)
+            offset1 += s->write_queue->size;
         if (offset == 0)
             return offset1;
         offset += offset1;
     }
+    /* buffer offsets do not map to file offsets with buffers queued */
+    if (s->write_queue && s->write_queue->nb_bufs) {
+        flush_buffer(s);
+        pos = s->pos;
+    }
     offset1 = offset - pos;
     if (!s->must_flush &&
         offset1 >= 0 && offset1 <= (s->buf_end - s->buffer)) {
@@ -693,6 +815,18 @@ int ffio_fdopen(AVIOContext **s, URLContext *h)
     }
     (*s)->seekable = h->is_streamed ? 0 : AVIO_SEEKABLE_NORMAL;
     (*s)->max_packet_size = max_packet_size;
+    (*s)->direct = !max_packet_size;
+#if HAVE_WRITEV
+    if (!max_packet_size && h->prot && h->prot->url_writev &&
+        (h->flags & AVIO_FLAG_WRITE) && !(h->flags & AVIO_FLAG_NONBLOCK)) {
+        (*s)->write_queue = av_mallocz(sizeof(*(*s)->write_queue));
+        if (!(*s)->write_queue) {
+            av_free(buffer);
+            av_freep(s);
+            return AVERROR(ENOMEM);
+        }
+    }
+#endif
     if(h->prot) {
         (*s)->read_pause = (int (*)(void *, int))h->prot->url_read_pause;
         (*s)->read_seek  = (int64_t (*)(void *, int, int64_t, int))h->prot->url_read_seek;
@@ -801,6 +935,7 @@ int avio_close(AVIOContext *s)
     avio_flush(s);
     h = s->opaque;
     av_freep(&s->buffer);
+    av_freep(&s->write_queue);
     av_free(s);
     return ffurl_close(h);
 }
@@ -942,6 +1077,7 @@ static int url_open_dyn_buf_internal(AVIOContext **s, int max_packet_size)
         return AVERROR(ENOMEM);
     }
     (*s)->max_packet_size = max_packet_size;
+    (*s)->direct          = !max_packet_size;
     return 0;
 }
 
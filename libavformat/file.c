@@ -31,6 +31,9 @@
 #include <unistd.h>
 #endif
 #include <sys/stat.h>
+#if HAVE_WRITEV
+#include <sys/uio.h>
+#endif
 #include <stdlib.h>
 #include "os_support.h"
 #include "url.h"
@@ -68,6 +71,15 @@ static int file_write(URLContext *h, const unsigned char *buf, int size)
     return write(c->fd, buf, size);
 }
 
+#if HAVE_WRITEV
+static int file_writev(URLContext *h, const struct iovec *iov, int iovcnt)
+{
+    FileContext *c = h->priv_data;
+    int ret = writev(c->fd, iov, iovcnt);
+    return ret < 0 ? AVERROR(errno) : ret;
+}
+#endif
+
 static int file_get_handle(URLContext *h)
 {
     FileContext *c = h->priv_data;
@@ -147,6 +159,9 @@ URLProtocol ff_file_protocol = {
     .url_open            = file_open,
     .url_read            = file_read,
     .url_write           = file_write,
+#if HAVE_WRITEV
+    .url_writev          = file_writev,
+#endif
     .url_seek            = file_seek,
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
@@ -187,6 +202,9 @@ URLProtocol ff_pipe_protocol = {
     .url_open            = pipe_open,
     .url_read            = file_read,
     .url_write           = file_write,
+#if HAVE_WRITEV
+    .url_writev          = file_writev,
+#endif
     .url_get_file_handle = file_get_handle,
     .url_check           = file_check,
     .priv_data_size      = sizeof(FileContext),
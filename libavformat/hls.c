@@ -25,6 +25,8 @@
  * http://tools.ietf.org/html/draft-pantos-http-live-streaming
  */
 
+#include "config.h"
+#include "libavutil/aes.h"
 #include "libavutil/avstring.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mathematics.h"
@@ -36,7 +38,15 @@
 #include "avio_internal.h"
 #include "url.h"
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 #define INITIAL_BUFFER_SIZE 32768
+#define MAX_PREFETCH        8
+#define MAX_PREFETCH_THREADS 16
+/* how long the reader waits before checking the interrupt callback, in us */
+#define POLLING_TIME        100000
 
 /*
  * An apple http stream consists of a playlist with media segment files,
@@ -63,6 +73,29 @@ struct segment {
     uint8_t iv[16];
 };
 
+enum PrefetchState {
+    PREFETCH_FREE,
+    PREFETCH_PENDING,
+    PREFETCH_RUNNING,
+    PREFETCH_DONE,
+};
+
+/*
+ * A segment downloaded into memory by the prefetch threads. The data can
+ * be consumed while the download is still running. Everything but the
+ * segment copy is protected by the HLSContext lock.
+ */
+struct prefetch {
+    enum PrefetchState state;
+    int seq_no;
+    int cancel;             /* abandoned while running, freed by the thread */
+    struct segment seg;     /* copy, the playlist may be reloaded meanwhile */
+    uint8_t *data;
+    unsigned int alloc_size;
+    int size, pos;
+    int error;              /* error downloading the segment */
+};
+
 /*
  * Each variant has its own demuxer. If it currently is active,
  * it has an open AVIOContext too, and potentially an AVPacket
@@ -91,9 +124,16 @@ struct variant {
 
     char key_url[MAX_URL_SIZE];
     uint8_t key[16];
+
+    struct prefetch *prefetch;
+    struct prefetch *cur_prefetch;
+#if HAVE_PTHREADS
+    pthread_mutex_t key_lock;
+#endif
 };
 
 typedef struct HLSContext {
+    const AVClass *class;
     int n_variants;
     struct variant **variants;
     int cur_seq_no;
@@ -103,6 +143,19 @@ typedef struct HLSContext {
     int64_t seek_timestamp;
     int seek_flags;
     AVIOInterruptCB *interrupt_callback;
+
+    int prefetch;           /* number of segments to download ahead */
+    int nb_slots;           /* prefetch slots per variant */
+#if HAVE_PTHREADS
+    int nb_threads;
+    pthread_t threads[MAX_PREFETCH_THREADS];
+    struct variant **pf_variants;
+    int n_pf_variants;
+    pthread_mutex_t lock;
+    pthread_cond_t job_cond;    /* signalled when a download is queued */
+    pthread_cond_t data_cond;   /* signalled when downloaded data arrives */
+    int abort;
+#endif
 } HLSContext;
 
 static int read_chomp_line(AVIOContext *s, char *buf, int maxlen)
@@ -130,6 +183,12 @@ static void free_variant_list(HLSContext *c)
         free_segment_list(var);
         av_free_packet(&var->pkt);
         av_free(var->pb.buffer);
+        if (var->prefetch) {
+            int j;
+            for (j = 0; j < c->nb_slots; j++)
+                av_free(var->prefetch[j].data);
+            av_freep(&var->prefetch);
+        }
         if (var->input)
             ffurl_close(var->input);
         if (var->ctx) {
@@ -324,19 +383,22 @@ fail:
     return ret;
 }
 
-static int open_input(struct variant *var)
+static int open_input(HLSContext *c, struct variant *var, struct segment *seg,
+                      URLContext **input, AVIOInterruptCB *int_cb)
 {
-    struct segment *seg = var->segments[var->cur_seq_no - var->start_seq_no];
     if (seg->key_type == KEY_NONE) {
-        return ffurl_open(&var->input, seg->url, AVIO_FLAG_READ,
-                          &var->parent->interrupt_callback, NULL);
+        return ffurl_open(input, seg->url, AVIO_FLAG_READ, int_cb, NULL);
     } else if (seg->key_type == KEY_AES_128) {
         char iv[33], key[33], url[MAX_URL_SIZE];
         int ret;
+#if HAVE_PTHREADS
+        /* the key is shared by the prefetch threads */
+        if (c->nb_threads)
+            pthread_mutex_lock(&var->key_lock);
+#endif
         if (strcmp(seg->key, var->key_url)) {
             URLContext *uc;
-            if (ffurl_open(&uc, seg->key, AVIO_FLAG_READ,
-                           &var->parent->interrupt_callback, NULL) == 0) {
+            if (ffurl_open(&uc, seg->key, AVIO_FLAG_READ, int_cb, NULL) == 0) {
                 if (ffurl_read_complete(uc, var->key, sizeof(var->key))
                     != sizeof(var->key)) {
                     av_log(NULL, AV_LOG_ERROR, "Unable to read key file %s\n",
@@ -351,19 +413,22 @@ static int open_input(struct variant *var)
         }
         ff_data_to_hex(iv, seg->iv, sizeof(seg->iv), 0);
         ff_data_to_hex(key, var->key, sizeof(var->key), 0);
+#if HAVE_PTHREADS
+        if (c->nb_threads)
+            pthread_mutex_unlock(&var->key_lock);
+#endif
         iv[32] = key[32] = '\0';
         if (strstr(seg->url, "://"))
             snprintf(url, sizeof(url), "crypto+%s", seg->url);
         else
             snprintf(url, sizeof(url), "crypto:%s", seg->url);
-        if ((ret = ffurl_alloc(&var->input, url, AVIO_FLAG_READ,
-                               &var->parent->interrupt_callback)) < 0)
+        if ((ret = ffurl_alloc(input, url, AVIO_FLAG_READ, int_cb)) < 0)
             return ret;
-        av_opt_set(var->input->priv_data, "key", key, 0);
-        av_opt_set(var->input->priv_data, "iv", iv, 0);
-        if ((ret = ffurl_connect(var->input, NULL)) < 0) {
-            ffurl_close(var->input);
-            var->input = NULL;
+        av_opt_set((*input)->priv_data, "key", key, 0);
+        av_opt_set((*input)->priv_data, "iv", iv, 0);
+        if ((ret = ffurl_connect(*input, NULL)) < 0) {
+            ffurl_close(*input);
+            *input = NULL;
             return ret;
         }
         return 0;
@@ -371,14 +436,318 @@ static int open_input(struct variant *var)
     return AVERROR(ENOSYS);
 }
 
+#if HAVE_PTHREADS
+struct prefetch_job {
+    HLSContext *c;
+    struct prefetch *pf;
+};
+
+static int prefetch_interrupt_cb(void *opaque)
+{
+    struct prefetch_job *job = opaque;
+    int stop;
+
+    /* called from the thread's I/O, which is done without the lock held */
+    pthread_mutex_lock(&job->c->lock);
+    stop = job->c->abort || job->pf->cancel;
+    pthread_mutex_unlock(&job->c->lock);
+    return stop || ff_check_interrupt(job->c->interrupt_callback);
+}
+
+/* Must be called with the lock held. */
+static void cancel_prefetch(struct prefetch *pf)
+{
+    if (pf->state == PREFETCH_RUNNING) {
+        pf->cancel = 1;
+        return;
+    }
+    av_freep(&pf->data);
+    pf->alloc_size = pf->size = pf->pos = 0;
+    pf->state = PREFETCH_FREE;
+}
+
+static void *prefetch_thread(void *arg)
+{
+    HLSContext *c = arg;
+    struct prefetch_job job = { c };
+    AVIOInterruptCB int_cb  = { prefetch_interrupt_cb, &job };
+    uint8_t *buf = av_malloc(INITIAL_BUFFER_SIZE);
+
+    pthread_mutex_lock(&c->lock);
+    while (buf && !c->abort) {
+        struct variant *var = NULL;
+        URLContext *input = NULL;
+        int i, j, ret;
+
+        /* pick the pending segment that is needed first */
+        job.pf = NULL;
+        for (i = 0; i < c->n_pf_variants; i++) {
+            struct variant *v = c->pf_variants[i];
+            for (j = 0; j < c->nb_slots; j++) {
+                struct prefetch *pf = &v->prefetch[j];
+                if (pf->state == PREFETCH_PENDING &&
+                    (!job.pf || pf->seq_no < job.pf->seq_no)) {
+                    job.pf = pf;
+                    var    = v;
+                }
+            }
+        }
+        if (!job.pf) {
+            pthread_cond_wait(&c->job_cond, &c->lock);
+            continue;
+        }
+        job.pf->state = PREFETCH_RUNNING;
+        pthread_mutex_unlock(&c->lock);
+
+        ret = open_input(c, var, &job.pf->seg, &input, &int_cb);
+        while (ret >= 0) {
+            ret = ffurl_read(input, buf, INITIAL_BUFFER_SIZE);
+            if (ret <= 0)
+                break;
+            pthread_mutex_lock(&c->lock);
+            if (!job.pf->cancel) {
+                uint8_t *data = av_fast_realloc(job.pf->data,
+                                                &job.pf->alloc_size,
+                                                job.pf->size + ret);
+                if (data) {
+                    memcpy(data + job.pf->size, buf, ret);
+                    job.pf->data  = data;
+                    job.pf->size += ret;
+                    pthread_cond_broadcast(&c->data_cond);
+                } else {
+                    ret = AVERROR(ENOMEM);
+                }
+            }
+            pthread_mutex_unlock(&c->lock);
+        }
+        if (input)
+            ffurl_close(input);
+
+        pthread_mutex_lock(&c->lock);
+        job.pf->error = ret == AVERROR_EOF ? 0 : FFMIN(ret, 0);
+        job.pf->state = PREFETCH_DONE;
+        if (job.pf->cancel) {
+            job.pf->cancel = 0;
+            cancel_prefetch(job.pf);
+        }
+        pthread_cond_broadcast(&c->data_cond);
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    av_free(buf);
+    return NULL;
+}
+
+/*
+ * Queue the downloads of the current segment and the following ones,
+ * and attach the current one to the variant.
+ */
+static int schedule_prefetch(HLSContext *c, struct variant *v)
+{
+    int end = FFMIN(v->cur_seq_no + c->prefetch + 1,
+                    v->start_seq_no + v->n_segments);
+    int i, seq;
+
+    pthread_mutex_lock(&c->lock);
+    for (i = 0; i < c->nb_slots; i++) {
+        struct prefetch *pf = &v->prefetch[i];
+        if (pf->state != PREFETCH_FREE &&
+            (pf->seq_no < v->cur_seq_no ||
+             pf->seq_no > v->cur_seq_no + c->prefetch))
+            cancel_prefetch(pf);
+    }
+
+    while (!v->cur_prefetch) {
+        for (seq = v->cur_seq_no; seq < end; seq++) {
+            struct prefetch *pf = NULL;
+            for (i = 0; i < c->nb_slots; i++) {
+                if (v->prefetch[i].state != PREFETCH_FREE &&
+                    !v->prefetch[i].cancel && v->prefetch[i].seq_no == seq) {
+                    pf = &v->prefetch[i];
+                    break;
+                }
+            }
+            if (!pf) {
+                for (i = 0; i < c->nb_slots; i++) {
+                    if (v->prefetch[i].state == PREFETCH_FREE) {
+                        pf = &v->prefetch[i];
+                        break;
+                    }
+                }
+                if (!pf)
+                    break;
+                pf->seq_no = seq;
+                pf->seg    = *v->segments[seq - v->start_seq_no];
+                pf->error  = 0;
+                pf->state  = PREFETCH_PENDING;
+                pthread_cond_broadcast(&c->job_cond);
+            }
+            if (seq == v->cur_seq_no)
+                v->cur_prefetch = pf;
+        }
+
+        /* all slots are taken by abandoned downloads, wait for one */
+        if (!v->cur_prefetch) {
+            int64_t t = av_gettime() + POLLING_TIME;
+            struct timespec tv = { .tv_sec  =  t / 1000000,
+                                   .tv_nsec = (t % 1000000) * 1000 };
+            if (ff_check_interrupt(c->interrupt_callback)) {
+                pthread_mutex_unlock(&c->lock);
+                return AVERROR_EXIT;
+            }
+            pthread_cond_timedwait(&c->data_cond, &c->lock, &tv);
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+    return 0;
+}
+
+/*
+ * Read from the current prefetched segment, waiting for the download if
+ * needed. Returns 0 at the end of the segment.
+ */
+static int read_prefetched(HLSContext *c, struct variant *v,
+                           uint8_t *buf, int buf_size)
+{
+    struct prefetch *pf = v->cur_prefetch;
+    int ret;
+
+    pthread_mutex_lock(&c->lock);
+    while (pf->pos == pf->size && pf->state != PREFETCH_DONE) {
+        int64_t t = av_gettime() + POLLING_TIME;
+        struct timespec tv = { .tv_sec  =  t / 1000000,
+                               .tv_nsec = (t % 1000000) * 1000 };
+        if (ff_check_interrupt(c->interrupt_callback)) {
+            pthread_mutex_unlock(&c->lock);
+            return AVERROR_EXIT;
+        }
+        pthread_cond_timedwait(&c->data_cond, &c->lock, &tv);
+    }
+    if (pf->pos < pf->size) {
+        ret = FFMIN(buf_size, pf->size - pf->pos);
+        memcpy(buf, pf->data + pf->pos, ret);
+        pf->pos += ret;
+    } else {
+        /* done with this segment, or with its failed download */
+        ret = pf->error;
+        cancel_prefetch(pf);
+        v->cur_prefetch = NULL;
+    }
+    pthread_mutex_unlock(&c->lock);
+    return ret;
+}
+
+static int is_encrypted(HLSContext *c)
+{
+    int i, j;
+
+    for (i = 0; i < c->n_variants; i++)
+        for (j = 0; j < c->variants[i]->n_segments; j++)
+            if (c->variants[i]->segments[j]->key_type != KEY_NONE)
+                return 1;
+    return 0;
+}
+
+static int start_prefetch(HLSContext *c)
+{
+    int i;
+
+    if (!c->prefetch)
+        return 0;
+
+    /* av_aes_init() sets up its tables on first use, which is not safe
+     * to do from several threads at once */
+    if (is_encrypted(c)) {
+        uint8_t key[16] = { 0 };
+        struct AVAES *aes = av_aes_alloc();
+        if (!aes)
+            return AVERROR(ENOMEM);
+        av_aes_init(aes, key, 128, 1);
+        av_free(aes);
+    }
+
+    c->nb_slots    = 2 * (c->prefetch + 1);
+    c->pf_variants = av_malloc(c->n_variants * sizeof(*c->pf_variants));
+    if (!c->pf_variants)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < c->n_variants; i++) {
+        struct variant *v = c->variants[i];
+        v->prefetch = av_mallocz(c->nb_slots * sizeof(*v->prefetch));
+        if (!v->prefetch) {
+            av_freep(&c->pf_variants);
+            return AVERROR(ENOMEM);
+        }
+        pthread_mutex_init(&v->key_lock, NULL);
+        c->pf_variants[i] = v;
+    }
+    c->n_pf_variants = c->n_variants;
+
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->job_cond, NULL);
+    pthread_cond_init(&c->data_cond, NULL);
+
+    for (i = 0; i < FFMIN((c->prefetch + 1) * c->n_pf_variants,
+                          MAX_PREFETCH_THREADS); i++) {
+        if (pthread_create(&c->threads[i], NULL, prefetch_thread, c))
+            break;
+        c->nb_threads++;
+    }
+    if (!c->nb_threads)
+        av_log(NULL, AV_LOG_WARNING,
+               "Unable to start prefetch threads, downloading on demand\n");
+    return 0;
+}
+
+static void stop_prefetch(HLSContext *c)
+{
+    int i;
+
+    if (!c->pf_variants)
+        return;
+
+    pthread_mutex_lock(&c->lock);
+    c->abort = 1;
+    pthread_cond_broadcast(&c->job_cond);
+    pthread_mutex_unlock(&c->lock);
+    for (i = 0; i < c->nb_threads; i++)
+        pthread_join(c->threads[i], NULL);
+    c->nb_threads = 0;
+
+    for (i = 0; i < c->n_pf_variants; i++)
+        pthread_mutex_destroy(&c->pf_variants[i]->key_lock);
+    pthread_mutex_destroy(&c->lock);
+    pthread_cond_destroy(&c->job_cond);
+    pthread_cond_destroy(&c->data_cond);
+    av_freep(&c->pf_variants);
+}
+#endif
+
+/* Drop the prefetched segments of a variant, e.g. when seeking. */
+static void reset_prefetch(HLSContext *c, struct variant *v)
+{
+#if HAVE_PTHREADS
+    int i;
+
+    if (!c->nb_threads)
+        return;
+    pthread_mutex_lock(&c->lock);
+    for (i = 0; i < c->nb_slots; i++)
+        if (v->prefetch[i].state != PREFETCH_FREE)
+            cancel_prefetch(&v->prefetch[i]);
+    v->cur_prefetch = NULL;
+    pthread_mutex_unlock(&c->lock);
+#endif
+}
+
 static int read_data(void *opaque, uint8_t *buf, int buf_size)
 {
     struct variant *v = opaque;
     HLSContext *c = v->parent->priv_data;
+    int64_t wait;
     int ret, i;
 
 restart:
-    if (!v->input) {
+    if (!v->input && !v->cur_prefetch) {
         /* If this is a live stream and the reload interval has elapsed since
          * the last playlist reload, reload the variant playlists now. */
         int64_t reload_interval = v->n_segments > 0 ?
@@ -404,24 +773,57 @@ reload:
         if (v->cur_seq_no >= v->start_seq_no + v->n_segments) {
             if (v->finished)
                 return AVERROR_EOF;
-            while (av_gettime() - v->last_load_time < reload_interval) {
+            /* Sleep until the reload is due, waking up regularly to
+             * check the interrupt callback. */
+            while ((wait = v->last_load_time + reload_interval -
+                           av_gettime()) > 0) {
                 if (ff_check_interrupt(c->interrupt_callback))
                     return AVERROR_EXIT;
-                av_usleep(100*1000);
+                av_usleep(FFMIN(wait, POLLING_TIME));
             }
             /* Enough time has elapsed since the last reload */
             goto reload;
         }
 
-        ret = open_input(v);
-        if (ret < 0)
+#if HAVE_PTHREADS
+        if (c->nb_threads) {
+            if ((ret = schedule_prefetch(c, v)) < 0)
+                return ret;
+        } else
+#endif
+        {
+            ret = open_input(c, v, v->segments[v->cur_seq_no - v->start_seq_no],
+                             &v->input, &v->parent->interrupt_callback);
+            if (ret == AVERROR_EXIT)
+                return ret;
+            if (ret < 0)
+                goto next_segment;
+        }
+    }
+#if HAVE_PTHREADS
+    if (v->cur_prefetch) {
+        ret = read_prefetched(c, v, buf, buf_size);
+        if (ret > 0 || ret == AVERROR_EXIT)
             return ret;
+    } else
+#endif
+    {
+        ret = ffurl_read(v->input, buf, buf_size);
+        if (ret > 0)
+            return ret;
+        if (ret == AVERROR_EOF)
+            ret = 0;
+        ffurl_close(v->input);
+        v->input = NULL;
     }
-    ret = ffurl_read(v->input, buf, buf_size);
-    if (ret > 0)
-        return ret;
-    ffurl_close(v->input);
-    v->input = NULL;
+
+next_segment:
+    /* a segment that failed to download is skipped, reading goes on with
+     * the next one */
+    if (ret < 0)
+        av_log(v->parent, AV_LOG_WARNING,
+               "Failed to download segment %d of variant %d, skipping\n",
+               v->cur_seq_no, v->index);
     v->cur_seq_no++;
 
     c->end_of_segment = 1;
@@ -484,6 +886,11 @@ static int hls_read_header(AVFormatContext *s)
         s->duration = duration;
     }
 
+#if HAVE_PTHREADS
+    if ((ret = start_prefetch(c)) < 0)
+        goto fail;
+#endif
+
     /* Open the demuxer for each variant */
     for (i = 0; i < c->n_variants; i++) {
         struct variant *v = c->variants[i];
@@ -566,6 +973,9 @@ static int hls_read_header(AVFormatContext *s)
 
     return 0;
 fail:
+#if HAVE_PTHREADS
+    stop_prefetch(c);
+#endif
     free_variant_list(c);
     return ret;
 }
@@ -592,11 +1002,13 @@ static int recheck_discard_flags(AVFormatContext *s, int first)
             changed = 1;
             v->cur_seq_no = c->cur_seq_no;
             v->pb.eof_reached = 0;
+            v->pb.error       = 0;
             av_log(s, AV_LOG_INFO, "Now receiving variant %d\n", i);
         } else if (first && !v->cur_needed && v->needed) {
             if (v->input)
                 ffurl_close(v->input);
             v->input = NULL;
+            reset_prefetch(c, v);
             v->needed = 0;
             changed = 1;
             av_log(s, AV_LOG_INFO, "No longer receiving variant %d\n", i);
@@ -627,6 +1039,16 @@ start:
                 AVStream *st;
                 ret = av_read_frame(var->ctx, &var->pkt);
                 if (ret < 0) {
+                    /* Failed segments are skipped by read_data(), other
+                     * errors, like a failed playlist reload, are not the
+                     * end of the variant: report them once, the next read
+                     * tries again. */
+                    if (var->pb.error < 0 && var->pb.error != AVERROR_EOF) {
+                        ret = var->pb.error;
+                        var->pb.error       = 0;
+                        var->pb.eof_reached = 0;
+                        return ret;
+                    }
                     if (!var->pb.eof_reached)
                         return ret;
                     reset_packet(&var->pkt);
@@ -705,6 +1127,9 @@ static int hls_close(AVFormatContext *s)
 {
     HLSContext *c = s->priv_data;
 
+#if HAVE_PTHREADS
+    stop_prefetch(c);
+#endif
     free_variant_list(c);
     return 0;
 }
@@ -743,9 +1168,11 @@ static int hls_read_seek(AVFormatContext *s, int stream_index,
             ffurl_close(var->input);
             var->input = NULL;
         }
+        reset_prefetch(c, var);
         av_free_packet(&var->pkt);
         reset_packet(&var->pkt);
         var->pb.eof_reached = 0;
+        var->pb.error       = 0;
         /* Clear any buffered data */
         var->pb.buf_end = var->pb.buf_ptr = var->pb.buffer;
         /* Reset the pos, to let the mpegts demuxer know we've seeked. */
@@ -780,6 +1207,22 @@ static int hls_probe(AVProbeData *p)
     return 0;
 }
 
+#define OFFSET(x) offsetof(HLSContext, x)
+#define FLAGS AV_OPT_FLAG_DECODING_PARAM
+static const AVOption hls_options[] = {
+    { "prefetch", "Number of segments to download in advance, per variant",
+      OFFSET(prefetch), AV_OPT_TYPE_INT, { .i64 = HAVE_PTHREADS ? 2 : 0 },
+      0, MAX_PREFETCH, FLAGS },
+    { NULL },
+};
+
+static const AVClass hls_class = {
+    .class_name = "hls demuxer",
+    .item_name  = av_default_item_name,
+    .option     = hls_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 AVInputFormat ff_hls_demuxer = {
     .name           = "hls,applehttp",
     .long_name      = NULL_IF_CONFIG_SMALL("Apple HTTP Live Streaming"),
@@ -789,4 +1232,5 @@ AVInputFormat ff_hls_demuxer = {
     .read_packet    = hls_read_packet,
     .read_close     = hls_close,
     .read_seek      = hls_read_seek,
+    .priv_class     = &hls_class,
 };
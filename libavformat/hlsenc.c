@@ -29,6 +29,7 @@
 
 #include "avformat.h"
 #include "internal.h"
+#include "segwriter.h"
 
 typedef struct ListEntry {
     char  name[1024];
@@ -45,6 +46,8 @@ typedef struct HLSContext {
     float time;            // Set by a private option.
     int  size;             // Set by a private option.
     int  wrap;             // Set by a private option.
+    int  flush_packets;    // Set by a private option.
+    int  io_thread;        // Set by a private option.
     int64_t recording_time;
     int has_video;
     int64_t start_pts;
@@ -54,7 +57,7 @@ typedef struct HLSContext {
     ListEntry *list;
     ListEntry *end_list;
     char *basename;
-    AVIOContext *pb;
+    SegWriter *writer;
 } HLSContext;
 
 static int hls_mux_init(AVFormatContext *s)
@@ -69,6 +72,8 @@ static int hls_mux_init(AVFormatContext *s)
 
     oc->oformat            = hls->oformat;
     oc->interrupt_callback = s->interrupt_callback;
+    if (hls->flush_packets)
+        oc->flags |= AVFMT_FLAG_FLUSH_PACKETS;
 
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *st;
@@ -127,35 +132,35 @@ static int hls_window(AVFormatContext *s, int last)
 {
     HLSContext *hls = s->priv_data;
     ListEntry *en;
+    AVIOContext *pb;
+    uint8_t *buf;
     int target_duration = 0;
-    int ret = 0;
+    int ret, size;
 
-    if ((ret = avio_open2(&hls->pb, s->filename, AVIO_FLAG_WRITE,
-                          &s->interrupt_callback, NULL)) < 0)
-        goto fail;
+    if ((ret = avio_open_dyn_buf(&pb)) < 0)
+        return ret;
 
     for (en = hls->list; en; en = en->next) {
         if (target_duration < en->duration)
             target_duration = en->duration;
     }
 
-    avio_printf(hls->pb, "#EXTM3U\n");
-    avio_printf(hls->pb, "#EXT-X-VERSION:3\n");
-    avio_printf(hls->pb, "#EXT-X-TARGETDURATION:%d\n", target_duration);
-    avio_printf(hls->pb, "#EXT-X-MEDIA-SEQUENCE:%"PRId64"\n",
+    avio_printf(pb, "#EXTM3U\n");
+    avio_printf(pb, "#EXT-X-VERSION:3\n");
+    avio_printf(pb, "#EXT-X-TARGETDURATION:%d\n", target_duration);
+    avio_printf(pb, "#EXT-X-MEDIA-SEQUENCE:%"PRId64"\n",
                 FFMAX(0, hls->sequence - hls->size));
 
     for (en = hls->list; en; en = en->next) {
-        avio_printf(hls->pb, "#EXTINF:%d,\n", en->duration);
-        avio_printf(hls->pb, "%s\n", en->name);
+        avio_printf(pb, "#EXTINF:%d,\n", en->duration);
+        avio_printf(pb, "%s\n", en->name);
     }
 
     if (last)
-        avio_printf(hls->pb, "#EXT-X-ENDLIST\n");
+        avio_printf(pb, "#EXT-X-ENDLIST\n");
 
-fail:
-    avio_closep(&hls->pb);
-    return ret;
+    size = avio_close_dyn_buf(pb, &buf);
+    return ff_segwriter_write_file(hls->writer, s->filename, buf, size);
 }
 
 static int hls_start(AVFormatContext *s)
@@ -169,8 +174,7 @@ static int hls_start(AVFormatContext *s)
         return AVERROR(EINVAL);
     c->number++;
 
-    if ((err = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
-                          &s->interrupt_callback, NULL)) < 0)
+    if ((err = ff_segwriter_open(c->writer, &oc->pb, oc->filename)) < 0)
         return err;
 
     if (oc->oformat->priv_class && oc->priv_data)
@@ -224,6 +228,9 @@ static int hls_write_header(AVFormatContext *s)
 
     av_strlcat(hls->basename, pattern, basename_size);
 
+    if ((ret = ff_segwriter_alloc(&hls->writer, s, hls->io_thread)) < 0)
+        goto fail;
+
     if ((ret = hls_mux_init(s)) < 0)
         goto fail;
 
@@ -237,8 +244,11 @@ static int hls_write_header(AVFormatContext *s)
 fail:
     if (ret) {
         av_free(hls->basename);
-        if (hls->avf)
+        if (hls->avf) {
+            ff_segwriter_close(hls->writer, &hls->avf->pb);
             avformat_free_context(hls->avf);
+        }
+        ff_segwriter_free(&hls->writer);
     }
     return ret;
 }
@@ -276,9 +286,10 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
         hls->duration = 0;
 
         av_write_frame(oc, NULL); /* Flush any buffered data */
-        avio_close(oc->pb);
+        ret = ff_segwriter_close(hls->writer, &oc->pb);
 
-        ret = hls_start(s);
+        if (!ret)
+            ret = hls_start(s);
 
         if (ret)
             return ret;
@@ -298,17 +309,24 @@ static int hls_write_trailer(struct AVFormatContext *s)
 {
     HLSContext *hls = s->priv_data;
     AVFormatContext *oc = hls->avf;
-
-    av_write_trailer(oc);
-    avio_closep(&oc->pb);
+    int ret, err;
+
+    ret = av_write_trailer(oc);
+    err = ff_segwriter_close(hls->writer, &oc->pb);
+    if (ret >= 0)
+        ret = err;
+    err = append_entry(hls, hls->duration);
+    if (ret >= 0)
+        ret = err;
     avformat_free_context(oc);
     av_free(hls->basename);
-    append_entry(hls, hls->duration);
-    hls_window(s, 1);
+    err = hls_window(s, 1);
+    if (ret >= 0)
+        ret = err;
 
     free_entries(hls);
-    avio_close(hls->pb);
-    return 0;
+    err = ff_segwriter_free(&hls->writer);
+    return ret < 0 ? ret : err;
 }
 
 #define OFFSET(x) offsetof(HLSContext, x)
@@ -318,6 +336,8 @@ static const AVOption options[] = {
     {"hls_time",      "segment length in seconds",               OFFSET(time),    AV_OPT_TYPE_FLOAT,  {.dbl = 2},     0, FLT_MAX, E},
     {"hls_list_size", "maximum number of playlist entries",      OFFSET(size),    AV_OPT_TYPE_INT,    {.i64 = 5},     0, INT_MAX, E},
     {"hls_wrap",      "number after which the index wraps",      OFFSET(wrap),    AV_OPT_TYPE_INT,    {.i64 = 0},     0, INT_MAX, E},
+    {"hls_flush_packets", "flush the segment after each packet", OFFSET(flush_packets), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, E},
+    {"hls_io_thread", "write the files from a separate thread",  OFFSET(io_thread), AV_OPT_TYPE_INT,  {.i64 = 0},     0, 1, E},
     { NULL },
 };
 
@@ -19,7 +19,9 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
 #include "libavutil/avstring.h"
+#include "libavutil/time.h"
 #include "avformat.h"
 #include "internal.h"
 #include "network.h"
@@ -32,6 +34,9 @@
 #if CONFIG_ZLIB
 #include <zlib.h>
 #endif
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 
 /* XXX: POST protocol is not completely implemented because avconv uses
    only a subset of it. */
@@ -43,6 +48,14 @@
 #define BUFFER_SIZE MAX_URL_SIZE
 #define MAX_REDIRECTS 8
 
+/* maximum number of idle connections kept for reuse */
+#define POOL_SIZE 16
+/* idle connections older than this are not reused */
+#define POOL_IDLE_TIMEOUT (10 * AV_TIME_BASE)
+/* at most this many unread bytes are skipped to reuse a connection,
+ * also the size of the first byte range requested after a seek */
+#define DRAIN_LIMIT 65536
+
 typedef struct {
     const AVClass *class;
     URLContext *hd;
@@ -51,6 +64,8 @@ typedef struct {
     int http_code;
     int64_t chunksize;      /**< Used if "Transfer-Encoding: chunked" otherwise -1. */
     int64_t off, filesize;
+    int64_t end_off;        /**< End of the byte range of the response, 0 if unknown. */
+    int64_t range_size;     /**< Size of the byte ranges requested after a seek, 0 for open ended requests. */
     char location[MAX_URL_SIZE];
     HTTPAuthState auth_state;
     HTTPAuthState proxy_auth_state;
@@ -60,6 +75,10 @@ typedef struct {
     int end_chunked_post;   /**< A flag which indicates if the end of chunked encoding has been sent. */
     int end_header;         /**< A flag which indicates we have finished to read POST reply. */
     int multiple_requests;  /**< A flag which indicates if we use persistent connections. */
+    int connection_pool;    /**< Take connections from and return them to the pool of idle connections. */
+    char pool_url[1024];    /**< Lower protocol URL of a connection that may be pooled, or empty. */
+    int keep_alive;         /**< Set if the server keeps the connection open after the response. */
+    int chunk_end;          /**< Set once the last chunk and the trailer have been read. */
     uint8_t *post_data;
     int post_datalen;
 #if CONFIG_ZLIB
@@ -78,6 +97,7 @@ static const AVOption options[] = {
 {"headers", "custom HTTP headers, can override built in default headers", OFFSET(headers), AV_OPT_TYPE_STRING, { 0 }, 0, 0, D|E },
 {"multiple_requests", "use persistent connections", OFFSET(multiple_requests), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, D|E },
 {"post_data", "custom HTTP post data", OFFSET(post_data), AV_OPT_TYPE_BINARY, .flags = D|E },
+{"connection_pool", "reuse idle connections to the same server", OFFSET(connection_pool), AV_OPT_TYPE_INT, {.i64 = 1}, 0, 1, D },
 {NULL}
 };
 #define HTTP_CLASS(flavor)\
@@ -104,6 +124,121 @@ void ff_http_init_auth_state(URLContext *dest, const URLContext *src)
            sizeof(HTTPAuthState));
 }
 
+#if HAVE_PTHREADS
+/*
+ * Connections whose last response has been read completely, kept open
+ * so that the next request to the same server can skip the connection
+ * setup. The pool is shared by all HTTP contexts.
+ */
+typedef struct HTTPPoolEntry {
+    char url[1024];         /**< lower protocol URL, e.g. tcp://host:port */
+    URLContext *hd;
+    int64_t idle_since;
+} HTTPPoolEntry;
+
+static HTTPPoolEntry pool[POOL_SIZE];
+static int pool_count;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void pool_remove(int i)
+{
+    pool_count--;
+    memmove(&pool[i], &pool[i + 1], (pool_count - i) * sizeof(*pool));
+}
+
+/* An idle connection must not have anything to read: readable means the
+ * server has closed it or sent something unexpected. */
+static int connection_alive(URLContext *hd)
+{
+    struct pollfd p = { ffurl_get_file_handle(hd), POLLIN, 0 };
+    return p.fd >= 0 && poll(&p, 1, 0) == 0;
+}
+
+static URLContext *pool_get(const char *url, const AVIOInterruptCB *int_cb)
+{
+    URLContext *hd = NULL;
+
+    while (!hd) {
+        int64_t now = av_gettime();
+        int i;
+
+        pthread_mutex_lock(&pool_lock);
+        for (i = pool_count - 1; i >= 0; i--) {
+            if (now - pool[i].idle_since > POOL_IDLE_TIMEOUT) {
+                ffurl_close(pool[i].hd);
+                pool_remove(i);
+            } else if (!hd && !strcmp(pool[i].url, url)) {
+                hd = pool[i].hd;
+                pool_remove(i);
+            }
+        }
+        pthread_mutex_unlock(&pool_lock);
+
+        if (!hd)
+            break;
+        if (!connection_alive(hd)) {
+            ffurl_close(hd);
+            hd = NULL;
+        }
+    }
+    if (hd)
+        hd->interrupt_callback = *int_cb;
+    return hd;
+}
+
+static void pool_put(const char *url, URLContext *hd)
+{
+    pthread_mutex_lock(&pool_lock);
+    if (pool_count == POOL_SIZE) {
+        ffurl_close(pool[0].hd);
+        pool_remove(0);
+    }
+    av_strlcpy(pool[pool_count].url, url, sizeof(pool[pool_count].url));
+    pool[pool_count].hd         = hd;
+    pool[pool_count].idle_since = av_gettime();
+    /* the owner of the callback may go away while the connection is idle */
+    hd->interrupt_callback.callback = NULL;
+    pool_count++;
+    pthread_mutex_unlock(&pool_lock);
+}
+#endif
+
+void ff_http_close_idle_connections(void)
+{
+#if HAVE_PTHREADS
+    pthread_mutex_lock(&pool_lock);
+    while (pool_count > 0)
+        ffurl_close(pool[--pool_count].hd);
+    pthread_mutex_unlock(&pool_lock);
+#endif
+}
+
+static int response_done(HTTPContext *s)
+{
+    if (s->chunksize >= 0)
+        return s->chunk_end;
+    if (s->end_off)
+        return s->off >= s->end_off;
+    return s->filesize >= 0 && s->off >= s->filesize;
+}
+
+/* Return the connection to the pool if the response has been read
+ * completely and the server keeps it open, close it otherwise. */
+static void http_release_connection(HTTPContext *s)
+{
+#if HAVE_PTHREADS
+    if (s->pool_url[0] && s->keep_alive && s->end_header &&
+        s->http_code >= 200 && s->http_code < 300 &&
+        s->buf_ptr == s->buf_end && response_done(s)) {
+        pool_put(s->pool_url, s->hd);
+        s->hd = NULL;
+        return;
+    }
+#endif
+    ffurl_close(s->hd);
+    s->hd = NULL;
+}
+
 /* return non zero if error */
 static int http_open_cnx(URLContext *h, AVDictionary **options)
 {
@@ -113,8 +248,10 @@ static int http_open_cnx(URLContext *h, AVDictionary **options)
     char path1[MAX_URL_SIZE];
     char buf[1024], urlbuf[MAX_URL_SIZE];
     int port, use_proxy, err, location_changed = 0, redirects = 0, attempts = 0;
+    int reused = 0;
     HTTPAuthType cur_auth_type, cur_proxy_auth_type;
     HTTPContext *s = h->priv_data;
+    int64_t off = s->off;
 
     /* fill the dest addr */
  redo:
@@ -154,17 +291,43 @@ static int http_open_cnx(URLContext *h, AVDictionary **options)
 
     ff_url_join(buf, sizeof(buf), lower_proto, NULL, hostname, port, NULL);
 
+    /* Only plain connections are pooled, tls keeps a reference to the
+     * interrupt callback of the context that opened it. */
+    s->pool_url[0] = '\0';
+    if (HAVE_PTHREADS && s->connection_pool && !strcmp(lower_proto, "tcp") &&
+        !(h->flags & AVIO_FLAG_WRITE) && !s->post_data)
+        av_strlcpy(s->pool_url, buf, sizeof(s->pool_url));
+
     if (!s->hd) {
-        err = ffurl_open(&s->hd, buf, AVIO_FLAG_READ_WRITE,
-                         &h->interrupt_callback, options);
-        if (err < 0)
-            goto fail;
+#if HAVE_PTHREADS
+        if (s->pool_url[0] &&
+            (s->hd = pool_get(s->pool_url, &h->interrupt_callback)))
+            reused = 1;
+#endif
+        if (!s->hd) {
+            err = ffurl_open(&s->hd, buf, AVIO_FLAG_READ_WRITE,
+                             &h->interrupt_callback, options);
+            if (err < 0)
+                goto fail;
+        }
     }
 
     cur_auth_type = s->auth_state.auth_type;
     cur_proxy_auth_type = s->auth_state.auth_type;
-    if (http_connect(h, path, local_path, hoststr, auth, proxyauth, &location_changed) < 0)
+    s->http_code = 0;
+    if (http_connect(h, path, local_path, hoststr, auth, proxyauth, &location_changed) < 0) {
+        if (reused && !s->http_code) {
+            /* The server closed the idle connection before getting our
+             * request, try again on a new one. */
+            ffurl_close(s->hd);
+            s->hd  = NULL;
+            s->off = off;
+            reused = 0;
+            goto redo;
+        }
         goto fail;
+    }
+    reused = 0;
     attempts++;
     if (s->http_code == 401) {
         if ((cur_auth_type == HTTP_AUTH_NONE || s->auth_state.stale) &&
@@ -213,6 +376,7 @@ int ff_http_do_new_request(URLContext *h, const char *uri)
     int ret;
 
     s->off = 0;
+    s->range_size = 0;
     av_strlcpy(s->location, uri, sizeof(s->location));
 
     av_dict_copy(&options, s->chained_options, 0);
@@ -300,6 +464,8 @@ static int process_line(URLContext *h, char *line, int line_count,
 
     p = line;
     if (line_count == 0) {
+        /* HTTP/1.1 connections are persistent unless stated otherwise */
+        s->keep_alive = av_strstart(p, "HTTP/1.1", NULL);
         while (!av_isspace(*p) && *p != '\0')
             p++;
         while (av_isspace(*p))
@@ -339,7 +505,9 @@ static int process_line(URLContext *h, char *line, int line_count,
             const char *slash;
             if (!strncmp (p, "bytes ", 6)) {
                 p += 6;
-                s->off = strtoll(p, NULL, 10);
+                s->off = strtoll(p, &end, 10);
+                if (*end == '-')
+                    s->end_off = strtoll(end + 1, NULL, 10) + 1;
                 if ((slash = strchr(p, '/')) && strlen(slash) > 0)
                     s->filesize = strtoll(slash+1, NULL, 10);
             }
@@ -356,8 +524,12 @@ static int process_line(URLContext *h, char *line, int line_count,
         } else if (!av_strcasecmp (tag, "Proxy-Authenticate")) {
             ff_http_auth_handle_header(&s->proxy_auth_state, tag, p);
         } else if (!av_strcasecmp (tag, "Connection")) {
-            if (!strcmp(p, "close"))
-                s->willclose = 1;
+            if (!strcmp(p, "close")) {
+                s->willclose  = 1;
+                s->keep_alive = 0;
+            } else if (!av_strcasecmp(p, "keep-alive")) {
+                s->keep_alive = 1;
+            }
         } else if (!av_strcasecmp (tag, "Content-Encoding")) {
             if (!av_strncasecmp(p, "gzip", 4) || !av_strncasecmp(p, "deflate", 7)) {
 #if CONFIG_ZLIB
@@ -457,12 +629,21 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
     if (!has_header(s->headers, "\r\nAccept: "))
         len += av_strlcpy(headers + len, "Accept: */*\r\n",
                           sizeof(headers) - len);
-    if (!has_header(s->headers, "\r\nRange: ") && !post)
-        len += av_strlcatf(headers + len, sizeof(headers) - len,
-                           "Range: bytes=%"PRId64"-\r\n", s->off);
+    if (!has_header(s->headers, "\r\nRange: ") && !post) {
+        /* a bounded range keeps the connection reusable for the next
+         * seek, see http_seek() */
+        if (s->pool_url[0] && s->range_size && s->filesize >= 0 &&
+            s->off + s->range_size < s->filesize)
+            len += av_strlcatf(headers + len, sizeof(headers) - len,
+                               "Range: bytes=%"PRId64"-%"PRId64"\r\n",
+                               s->off, s->off + s->range_size - 1);
+        else
+            len += av_strlcatf(headers + len, sizeof(headers) - len,
+                               "Range: bytes=%"PRId64"-\r\n", s->off);
+    }
 
     if (!has_header(s->headers, "\r\nConnection: ")) {
-        if (s->multiple_requests) {
+        if (s->multiple_requests || s->pool_url[0]) {
             len += av_strlcpy(headers + len, "Connection: keep-alive\r\n",
                               sizeof(headers) - len);
         } else {
@@ -511,7 +692,10 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
     s->line_count = 0;
     s->off = 0;
     s->filesize = -1;
+    s->end_off = 0;
     s->willclose = 0;
+    s->keep_alive = 0;
+    s->chunk_end = 0;
     s->end_chunked_post = 0;
     s->end_header = 0;
     if (post && !s->post_data) {
@@ -543,7 +727,21 @@ static int http_buf_read(URLContext *h, uint8_t *buf, int size)
         memcpy(buf, s->buf_ptr, len);
         s->buf_ptr += len;
     } else {
-        if (!s->willclose && s->filesize >= 0 && s->off >= s->filesize)
+        if (s->end_off && s->off >= s->end_off && s->off < s->filesize) {
+            /* the requested range is done, ask for a larger one */
+            AVDictionary *options = NULL;
+            int err;
+
+            http_release_connection(s);
+            s->range_size *= 2;
+            av_dict_copy(&options, s->chained_options, 0);
+            err = http_open_cnx(h, &options);
+            av_dict_free(&options);
+            if (err < 0)
+                return err;
+            return http_buf_read(h, buf, size);
+        }
+        if (!s->willclose && response_done(s))
             return AVERROR_EOF;
         len = ffurl_read(s->hd, buf, size);
     }
@@ -602,6 +800,8 @@ static int http_read(URLContext *h, uint8_t *buf, int size)
     }
 
     if (s->chunksize >= 0) {
+        if (s->chunk_end)
+            return 0;
         if (!s->chunksize) {
             char line[32];
 
@@ -615,8 +815,16 @@ static int http_read(URLContext *h, uint8_t *buf, int size)
 
                 av_dlog(NULL, "Chunked encoding data size: %"PRId64"'\n", s->chunksize);
 
-                if (!s->chunksize)
+                if (!s->chunksize) {
+                    /* skip the trailer, up to the final empty line */
+                    do {
+                        err = http_get_line(s, line, sizeof(line));
+                    } while (err >= 0 && *line);
+                    if (err < 0)
+                        s->keep_alive = 0;
+                    s->chunk_end = 1;
                     return 0;
+                }
                 break;
             }
         }
@@ -688,7 +896,7 @@ static int http_close(URLContext *h)
     }
 
     if (s->hd)
-        ffurl_close(s->hd);
+        http_release_connection(s);
     av_dict_free(&s->chained_options);
     return ret;
 }
@@ -696,40 +904,51 @@ static int http_close(URLContext *h)
 static int64_t http_seek(URLContext *h, int64_t off, int whence)
 {
     HTTPContext *s = h->priv_data;
-    URLContext *old_hd = s->hd;
     int64_t old_off = s->off;
-    uint8_t old_buf[BUFFER_SIZE];
-    int old_buf_size;
     AVDictionary *options = NULL;
+    int ret;
 
     if (whence == AVSEEK_SIZE)
         return s->filesize;
     else if ((s->filesize == -1 && whence == SEEK_END) || h->is_streamed)
         return -1;
 
-    /* we save the old context in case the seek fails */
-    old_buf_size = s->buf_end - s->buf_ptr;
-    memcpy(old_buf, s->buf_ptr, old_buf_size);
-    s->hd = NULL;
     if (whence == SEEK_CUR)
         off += s->off;
     else if (whence == SEEK_END)
         off += s->filesize;
-    s->off = off;
 
-    /* if it fails, continue on old connection */
+#if HAVE_PTHREADS
+    /* Skip the rest of a short response so that the connection goes back
+     * to the pool, the new request is then sent on it. Requesting bounded
+     * ranges after a seek keeps the rest short for the following seeks. */
+    if (s->pool_url[0] && s->keep_alive && s->end_header &&
+        s->http_code >= 200 && s->http_code < 300 && s->chunksize < 0 &&
+        (s->end_off || s->filesize >= 0) &&
+        (s->end_off ? s->end_off : s->filesize) - s->off <= DRAIN_LIMIT) {
+        uint8_t buf[BUFFER_SIZE];
+
+        while (!response_done(s))
+            if (http_buf_read(h, buf, sizeof(buf)) <= 0)
+                break;
+    }
+    s->range_size = DRAIN_LIMIT;
+#endif
+    if (s->hd)
+        http_release_connection(s);
+
+    s->off = off;
     av_dict_copy(&options, s->chained_options, 0);
-    if (http_open_cnx(h, &options) < 0) {
-        av_dict_free(&options);
-        memcpy(s->buffer, old_buf, old_buf_size);
-        s->buf_ptr = s->buffer;
-        s->buf_end = s->buffer + old_buf_size;
-        s->hd = old_hd;
+    ret = http_open_cnx(h, &options);
+    av_dict_free(&options);
+    if (ret < 0) {
+        /* if it fails, continue at the old position */
         s->off = old_off;
+        av_dict_copy(&options, s->chained_options, 0);
+        http_open_cnx(h, &options);
+        av_dict_free(&options);
         return -1;
     }
-    av_dict_free(&options);
-    ffurl_close(old_hd);
     return off;
 }
 
@@ -45,4 +45,9 @@ void ff_http_init_auth_state(URLContext *dest, const URLContext *src);
  */
 int ff_http_do_new_request(URLContext *h, const char *uri);
 
+/**
+ * Close the idle connections kept for reuse by the HTTP protocol.
+ */
+void ff_http_close_idle_connections(void);
+
 #endif /* AVFORMAT_HTTP_H */
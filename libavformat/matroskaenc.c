@@ -1179,7 +1179,8 @@ static void mkv_write_block(AVFormatContext *s, AVIOContext *pb,
     avio_w8(pb, 0x80 | (pkt->stream_index + 1));     // this assumes stream_index is less than 126
     avio_wb16(pb, ts - mkv->cluster_pts);
     avio_w8(pb, flags);
-    avio_write(pb, data + offset, size);
+    avio_write_buffer(pb, data == pkt->data ? pkt->buf : NULL,
+                      data + offset, size);
     if (data != pkt->data)
         av_free(data);
 }
@@ -2907,7 +2907,7 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
             size = ff_avc_parse_nal_units(pb, pkt->data, pkt->size);
         }
     } else {
-        avio_write(pb, pkt->data, size);
+        avio_write_buffer(pb, pkt->buf, pkt->data, size);
     }
 
     if ((enc->codec_id == AV_CODEC_ID_DNXHD ||
@@ -127,6 +127,12 @@ struct MpegTSContext {
     struct Program *prg;
 
 
+    /** pids only comprised in programs with discard=AVDISCARD_ALL,
+     *  one bit per pid                                      */
+    uint8_t discard_pids[NB_PID_MAX / 8];
+    /** program tables or selection changed, discard_pids has to be rebuilt */
+    int discard_update;
+
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
 };
@@ -190,12 +196,14 @@ static void clear_program(MpegTSContext *ts, unsigned int programid)
     for(i=0; i<ts->nb_prg; i++)
         if(ts->prg[i].id == programid)
             ts->prg[i].nb_pids = 0;
+    ts->discard_update = 1;
 }
 
 static void clear_programs(MpegTSContext *ts)
 {
     av_freep(&ts->prg);
     ts->nb_prg=0;
+    ts->discard_update = 1;
 }
 
 static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
@@ -209,6 +217,7 @@ static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
     p->id = programid;
     p->nb_pids = 0;
     ts->nb_prg++;
+    ts->discard_update = 1;
 }
 
 static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid, unsigned int pid)
@@ -227,50 +236,54 @@ static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid, unsigned i
     if(p->nb_pids >= MAX_PIDS_PER_PROGRAM)
         return;
     p->pids[p->nb_pids++] = pid;
+    ts->discard_update = 1;
 }
 
 /**
- * @brief discard_pid() decides if the pid is to be discarded according
- *                      to caller's programs selection
- * @param ts    : - TS context
- * @param pid   : - pid
- * @return 1 if the pid is only comprised in programs that have .discard=AVDISCARD_ALL
- *         0 otherwise
+ * Rebuild the set of pids to be discarded according to caller's programs
+ * selection: a pid is discarded if it is only comprised in programs that
+ * have .discard=AVDISCARD_ALL.
  */
-static int discard_pid(MpegTSContext *ts, unsigned int pid)
+static void update_discard_pids(MpegTSContext *ts)
 {
+    AVFormatContext *s = ts->stream;
+    uint8_t used[NB_PID_MAX / 8] = { 0 };
     int i, j, k;
-    int used = 0, discarded = 0;
-    struct Program *p;
+
+    ts->discard_update = 0;
+    memset(ts->discard_pids, 0, sizeof(ts->discard_pids));
 
     /* If none of the programs have .discard=AVDISCARD_ALL then there's
-     * no way we have to discard this packet
+     * no way we have to discard any packet
      */
-    for (k = 0; k < ts->stream->nb_programs; k++) {
-        if (ts->stream->programs[k]->discard == AVDISCARD_ALL)
+    for (k = 0; k < s->nb_programs; k++) {
+        if (s->programs[k]->discard == AVDISCARD_ALL)
             break;
     }
-    if (k == ts->stream->nb_programs)
-        return 0;
+    if (k == s->nb_programs)
+        return;
 
-    for(i=0; i<ts->nb_prg; i++) {
-        p = &ts->prg[i];
-        for(j=0; j<p->nb_pids; j++) {
-            if(p->pids[j] != pid)
+    for (i = 0; i < ts->nb_prg; i++) {
+        struct Program *p = &ts->prg[i];
+        for (k = 0; k < s->nb_programs; k++) {
+            uint8_t *set;
+            if (s->programs[k]->id != p->id)
                 continue;
-            //is program with id p->id set to be discarded?
-            for(k=0; k<ts->stream->nb_programs; k++) {
-                if(ts->stream->programs[k]->id == p->id) {
-                    if(ts->stream->programs[k]->discard == AVDISCARD_ALL)
-                        discarded++;
-                    else
-                        used++;
-                }
-            }
+            set = s->programs[k]->discard == AVDISCARD_ALL ? ts->discard_pids
+                                                           : used;
+            for (j = 0; j < p->nb_pids; j++)
+                set[p->pids[j] >> 3] |= 1 << (p->pids[j] & 7);
         }
     }
+    for (i = 0; i < NB_PID_MAX / 8; i++)
+        ts->discard_pids[i] &= ~used[i];
+}
 
-    return !used && discarded;
+static av_always_inline int discard_pid(MpegTSContext *ts, unsigned int pid)
+{
+    if (ts->discard_update)
+        update_discard_pids(ts);
+    return ts->discard_pids[pid >> 3] & (1 << (pid & 7));
 }
 
 /**
@@ -1781,6 +1794,34 @@ static int read_packet(AVFormatContext *s, uint8_t *buf, int raw_packet_size, co
     return 0;
 }
 
+/**
+ * Skip the packets already in the I/O buffer which handle_packet() would
+ * ignore, i.e. the ones of discarded or unknown pids, without copying
+ * them. On a multiplex of many programs where only a few streams are
+ * wanted, this is most of the packets.
+ *
+ * @return the number of packets skipped, at most max_packets
+ */
+static int skip_ignored_packets(MpegTSContext *ts, int max_packets)
+{
+    AVIOContext *pb = ts->stream->pb;
+    const uint8_t *p = pb->buf_ptr;
+    int n;
+
+    for (n = 0; n < max_packets; n++) {
+        int pid;
+        if (pb->buf_end - p < ts->raw_packet_size || p[0] != 0x47)
+            break;
+        pid = AV_RB16(p + 1) & 0x1fff;
+        if (!(pid && discard_pid(ts, pid)) &&
+            (ts->pids[pid] || (ts->auto_guess && (p[1] & 0x40))))
+            break;
+        p += ts->raw_packet_size;
+    }
+    pb->buf_ptr += n * ts->raw_packet_size;
+    return n;
+}
+
 static void finished_reading_packet(AVFormatContext *s, int raw_packet_size)
 {
     AVIOContext *pb = s->pb;
@@ -1794,7 +1835,7 @@ static int handle_packets(MpegTSContext *ts, int nb_packets)
     AVFormatContext *s = ts->stream;
     uint8_t packet[TS_PACKET_SIZE+FF_INPUT_BUFFER_PADDING_SIZE];
     const uint8_t *data;
-    int packet_num, ret = 0;
+    int packet_num, skipped, ret = 0;
 
     if (avio_tell(s->pb) != ts->last_pos) {
         int i;
@@ -1813,6 +1854,8 @@ static int handle_packets(MpegTSContext *ts, int nb_packets)
         }
     }
 
+    /* the caller may have changed the programs selection */
+    ts->discard_update = 1;
     ts->stop_parse = 0;
     packet_num = 0;
     memset(packet + TS_PACKET_SIZE, 0, FF_INPUT_BUFFER_PADDING_SIZE);
@@ -1822,6 +1865,12 @@ static int handle_packets(MpegTSContext *ts, int nb_packets)
         packet_num++;
         if (nb_packets != 0 && packet_num >= nb_packets)
             break;
+        skipped = skip_ignored_packets(ts, nb_packets ? nb_packets - packet_num
+                                                      : INT_MAX);
+        if (skipped) {
+            packet_num += skipped - 1;
+            continue;
+        }
         ret = read_packet(s, packet, ts->raw_packet_size, &data);
         if (ret != 0)
             break;
@@ -19,6 +19,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "libavutil/avstring.h"
 #include "libavutil/bswap.h"
 #include "libavutil/crc.h"
 #include "libavutil/dict.h"
@@ -54,6 +55,14 @@ typedef struct MpegTSService {
     int pcr_packet_period;
 } MpegTSService;
 
+/* an additional output carrying a subset of the streams */
+typedef struct MpegTSOutput {
+    char *url;
+    AVIOContext *pb;
+    MpegTSSection pmt; /* pmt listing only the streams of this output */
+    uint8_t *streams;  /* for each stream, nonzero if carried */
+} MpegTSOutput;
+
 typedef struct MpegTSWrite {
     const AVClass *av_class;
     MpegTSSection pat; /* MPEG2 pat table */
@@ -82,6 +91,10 @@ typedef struct MpegTSWrite {
 #define MPEGTS_FLAG_REEMIT_PAT_PMT  0x01
 #define MPEGTS_FLAG_AAC_LATM        0x02
     int flags;
+
+    char *outputs_str;
+    MpegTSOutput *outputs;
+    int nb_outputs;
 } MpegTSWrite;
 
 /* a PES packet header is generated every DEFAULT_PES_HEADER_FREQ packets */
@@ -113,6 +126,8 @@ static const AVOption options[] = {
     // backward compatibility
     { "resend_headers", "Reemit PAT/PMT before writing the next packet",
       offsetof(MpegTSWrite, reemit_pat_pmt), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM},
+    { "mpegts_outputs", "Additional outputs, '|' separated, each optionally prefixed with [stream indexes]",
+      offsetof(MpegTSWrite, outputs_str), AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM},
     { NULL },
 };
 
@@ -247,7 +262,9 @@ static void mpegts_write_pat(AVFormatContext *s)
                           data, q - data);
 }
 
-static void mpegts_write_pmt(AVFormatContext *s, MpegTSService *service)
+/* streams is NULL to list all the streams */
+static void mpegts_write_pmt(AVFormatContext *s, MpegTSService *service,
+                             MpegTSSection *pmt, const uint8_t *streams)
 {
     MpegTSWrite *ts = s->priv_data;
     uint8_t data[1012], *q, *desc_length_ptr, *program_info_length_ptr;
@@ -269,6 +286,8 @@ static void mpegts_write_pmt(AVFormatContext *s, MpegTSService *service)
         AVStream *st = s->streams[i];
         MpegTSWriteStream *ts_st = st->priv_data;
         AVDictionaryEntry *lang = av_dict_get(st->metadata, "language", NULL,0);
+        if (streams && !streams[i])
+            continue;
         switch(st->codec->codec_id) {
         case AV_CODEC_ID_MPEG1VIDEO:
         case AV_CODEC_ID_MPEG2VIDEO:
@@ -380,7 +399,7 @@ static void mpegts_write_pmt(AVFormatContext *s, MpegTSService *service)
         desc_length_ptr[0] = val >> 8;
         desc_length_ptr[1] = val;
     }
-    mpegts_write_section1(&service->pmt, PMT_TID, service->sid, 0, 0, 0,
+    mpegts_write_section1(pmt, PMT_TID, service->sid, 0, 0, 0,
                           data, q - data);
 }
 
@@ -464,6 +483,160 @@ static void section_write_packet(MpegTSSection *s, const uint8_t *packet)
     avio_write(ctx->pb, packet, TS_PACKET_SIZE);
 }
 
+/* the PAT and SDT are the same for all the outputs */
+static void shared_section_write_packet(MpegTSSection *s, const uint8_t *packet)
+{
+    AVFormatContext *ctx = s->opaque;
+    MpegTSWrite *ts = ctx->priv_data;
+    int i;
+
+    avio_write(ctx->pb, packet, TS_PACKET_SIZE);
+    for (i = 0; i < ts->nb_outputs; i++)
+        avio_write(ts->outputs[i].pb, packet, TS_PACKET_SIZE);
+}
+
+static void output_section_write_packet(MpegTSSection *s, const uint8_t *packet)
+{
+    MpegTSOutput *o = s->opaque;
+    avio_write(o->pb, packet, TS_PACKET_SIZE);
+}
+
+/* write a packet of the stream to all the outputs carrying it */
+static void write_ts_packet(AVFormatContext *s, int stream_index,
+                            const uint8_t *packet)
+{
+    MpegTSWrite *ts = s->priv_data;
+    int i;
+
+    avio_write(s->pb, packet, TS_PACKET_SIZE);
+    for (i = 0; i < ts->nb_outputs; i++)
+        if (ts->outputs[i].streams[stream_index])
+            avio_write(ts->outputs[i].pb, packet, TS_PACKET_SIZE);
+}
+
+static void flush_outputs(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+    int i;
+
+    avio_flush(s->pb);
+    for (i = 0; i < ts->nb_outputs; i++)
+        avio_flush(ts->outputs[i].pb);
+}
+
+static void free_outputs(MpegTSWrite *ts)
+{
+    int i;
+
+    for (i = 0; i < ts->nb_outputs; i++) {
+        MpegTSOutput *o = &ts->outputs[i];
+        if (o->pb)
+            avio_close(o->pb);
+        av_free(o->url);
+        av_free(o->streams);
+    }
+    av_freep(&ts->outputs);
+    ts->nb_outputs = 0;
+}
+
+/**
+ * Open the outputs given as "[0,2]a.ts|b.ts", the optional list in
+ * brackets being the indexes of the streams carried, all of them if
+ * it is missing.
+ */
+static int open_outputs(AVFormatContext *s, MpegTSService *service)
+{
+    MpegTSWrite *ts = s->priv_data;
+    const char *p = ts->outputs_str;
+    int i, j, ret;
+
+    while (*p) {
+        MpegTSOutput *o;
+        char *spec = av_get_token(&p, "|"), *url;
+
+        if (*p)
+            p++;
+        if (!spec)
+            return AVERROR(ENOMEM);
+        if (!*spec) {
+            av_free(spec);
+            continue;
+        }
+        /* keep the outputs parsed so far on failure, free_outputs() will
+         * release them */
+        o = av_realloc(ts->outputs, (ts->nb_outputs + 1) * sizeof(*o));
+        if (!o) {
+            av_free(spec);
+            return AVERROR(ENOMEM);
+        }
+        ts->outputs = o;
+        o = &ts->outputs[ts->nb_outputs++];
+        memset(o, 0, sizeof(*o));
+        o->streams = av_malloc(s->nb_streams);
+        if (!o->streams) {
+            av_free(spec);
+            return AVERROR(ENOMEM);
+        }
+
+        url = spec;
+        if (*spec == '[') {
+            char *end = strchr(spec, ']'), *q = spec + 1;
+            memset(o->streams, 0, s->nb_streams);
+            if (!end) {
+                av_log(s, AV_LOG_ERROR, "Missing ']' in output '%s'\n", spec);
+                av_free(spec);
+                return AVERROR(EINVAL);
+            }
+            *end = 0;
+            while (*q) {
+                int index = strtol(q, &q, 10);
+                if (index < 0 || index >= s->nb_streams ||
+                    (*q && *q != ',')) {
+                    av_log(s, AV_LOG_ERROR, "Invalid stream list '%s'\n",
+                           spec + 1);
+                    av_free(spec);
+                    return AVERROR(EINVAL);
+                }
+                o->streams[index] = 1;
+                if (*q)
+                    q++;
+            }
+            url = end + 1;
+        } else {
+            memset(o->streams, 1, s->nb_streams);
+        }
+        o->url = av_strdup(url);
+        av_free(spec);
+        if (!o->url)
+            return AVERROR(ENOMEM);
+    }
+
+    for (j = 0; j < ts->nb_outputs; j++) {
+        MpegTSOutput *o = &ts->outputs[j];
+
+        /* the PCR is only carried in the packets of one stream */
+        for (i = 0; i < s->nb_streams; i++) {
+            MpegTSWriteStream *ts_st = s->streams[i]->priv_data;
+            if (ts_st->pid == service->pcr_pid && !o->streams[i]) {
+                av_log(s, AV_LOG_ERROR, "Output %s must carry stream %d, "
+                       "used for the PCR\n", o->url, i);
+                return AVERROR(EINVAL);
+            }
+        }
+
+        o->pmt.pid          = service->pmt.pid;
+        o->pmt.cc           = 15;
+        o->pmt.write_packet = output_section_write_packet;
+        o->pmt.opaque       = o;
+        if ((ret = avio_open2(&o->pb, o->url, AVIO_FLAG_WRITE,
+                              &s->interrupt_callback, NULL)) < 0) {
+            av_log(s, AV_LOG_ERROR, "Unable to open %s\n", o->url);
+            return ret;
+        }
+    }
+    return 0;
+}
+
 static int mpegts_write_header(AVFormatContext *s)
 {
     MpegTSWrite *ts = s->priv_data;
@@ -499,12 +672,12 @@ static int mpegts_write_header(AVFormatContext *s)
 
     ts->pat.pid = PAT_PID;
     ts->pat.cc = 15; // Initialize at 15 so that it wraps and be equal to 0 for the first packet we write
-    ts->pat.write_packet = section_write_packet;
+    ts->pat.write_packet = shared_section_write_packet;
     ts->pat.opaque = s;
 
     ts->sdt.pid = SDT_PID;
     ts->sdt.cc = 15;
-    ts->sdt.write_packet = section_write_packet;
+    ts->sdt.write_packet = shared_section_write_packet;
     ts->sdt.opaque = s;
 
     pids = av_malloc(s->nb_streams * sizeof(*pids));
@@ -584,7 +757,7 @@ static int mpegts_write_header(AVFormatContext *s)
         }
     }
 
-    av_free(pids);
+    av_freep(&pids);
 
     /* if no video stream, use the first stream as PCR */
     if (service->pcr_pid == 0x1fff && s->nb_streams > 0) {
@@ -593,6 +766,19 @@ static int mpegts_write_header(AVFormatContext *s)
         service->pcr_pid = ts_st->pid;
     }
 
+    if (ts->outputs_str) {
+        /* with a constant rate, the PCR and padding depend on the position
+         * in each output, so its packets could not be shared */
+        if (ts->mux_rate > 1) {
+            av_log(s, AV_LOG_ERROR,
+                   "Additional outputs are not supported with muxrate\n");
+            ret = AVERROR(EINVAL);
+            goto fail;
+        }
+        if ((ret = open_outputs(s, service)) < 0)
+            goto fail;
+    }
+
     if (ts->mux_rate > 1) {
         service->pcr_packet_period = (ts->mux_rate * PCR_RETRANS_TIME) /
             (TS_PACKET_SIZE * 8 * 1000);
@@ -636,12 +822,13 @@ static int mpegts_write_header(AVFormatContext *s)
            service->pcr_packet_period,
            ts->sdt_packet_period, ts->pat_packet_period);
 
-    avio_flush(s->pb);
+    flush_outputs(s);
 
     return 0;
 
  fail:
     av_free(pids);
+    free_outputs(ts);
     for(i = 0;i < s->nb_streams; i++) {
         MpegTSWriteStream *ts_st;
         st = s->streams[i];
@@ -672,8 +859,11 @@ static void retransmit_si_info(AVFormatContext *s)
         ts->pat_packet_count = 0;
         mpegts_write_pat(s);
         for(i = 0; i < ts->nb_services; i++) {
-            mpegts_write_pmt(s, ts->services[i]);
+            mpegts_write_pmt(s, ts->services[i], &ts->services[i]->pmt, NULL);
         }
+        for (i = 0; i < ts->nb_outputs; i++)
+            mpegts_write_pmt(s, ts->services[0], &ts->outputs[i].pmt,
+                             ts->outputs[i].streams);
     }
 }
 
@@ -970,9 +1160,9 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         memcpy(buf + TS_PACKET_SIZE - len, payload, len);
         payload += len;
         payload_size -= len;
-        avio_write(s->pb, buf, TS_PACKET_SIZE);
+        write_ts_packet(s, st->index, buf);
     }
-    avio_flush(s->pb);
+    flush_outputs(s);
 }
 
 static int mpegts_write_packet_internal(AVFormatContext *s, AVPacket *pkt)
@@ -1122,17 +1312,24 @@ static void mpegts_write_flush(AVFormatContext *s)
             ts_st->payload_size = 0;
         }
     }
-    avio_flush(s->pb);
+    flush_outputs(s);
 }
 
 static int mpegts_write_packet(AVFormatContext *s, AVPacket *pkt)
 {
+    MpegTSWrite *ts = s->priv_data;
+    int i, ret;
+
     if (!pkt) {
         mpegts_write_flush(s);
-        return 1;
+        ret = 1;
     } else {
-        return mpegts_write_packet_internal(s, pkt);
+        ret = mpegts_write_packet_internal(s, pkt);
     }
+    for (i = 0; i < ts->nb_outputs && ret >= 0; i++)
+        if (ts->outputs[i].pb->error < 0)
+            ret = ts->outputs[i].pb->error;
+    return ret;
 }
 
 static int mpegts_write_end(AVFormatContext *s)
@@ -1142,6 +1339,7 @@ static int mpegts_write_end(AVFormatContext *s)
     int i;
 
     mpegts_write_flush(s);
+    free_outputs(ts);
 
     for(i = 0; i < s->nb_streams; i++) {
         AVStream *st = s->streams[i];
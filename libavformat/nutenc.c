@@ -908,8 +908,8 @@ static int nut_write_packet(AVFormatContext *s, AVPacket *pkt)
     else
         ffio_get_checksum(bc);
 
-    avio_write(bc, pkt->data + nut->header_len[header_idx],
-               pkt->size - nut->header_len[header_idx]);
+    avio_write_buffer(bc, pkt->buf, pkt->data + nut->header_len[header_idx],
+                      pkt->size - nut->header_len[header_idx]);
     nus->last_flags = flags;
     nus->last_pts   = pkt->pts;
 
@@ -531,6 +531,20 @@ void ff_rtp_parse_set_crypto(RTPDemuxContext *s, const char *suite,
         s->srtp_enabled = 1;
 }
 
+static AVRational rtp_time_base(RTPDemuxContext *s)
+{
+    /* streams without an AVStream are MPEG-TS, using a 90 kHz clock */
+    return s->st ? s->st->time_base : (AVRational){ 1, 90000 };
+}
+
+void ff_rtp_parse_set_jitter_buffer(RTPDemuxContext *s, int64_t max_delay)
+{
+    s->queue_max_delay = av_rescale_q(max_delay, AV_TIME_BASE_Q,
+                                      rtp_time_base(s));
+    /* start with the full delay, it shrinks while there is no reordering */
+    s->queue_delay     = s->queue_max_delay;
+}
+
 /**
  * This was the second switch in rtp_parse packet.
  * Normalizes time, if required, sets stream_index, etc.
@@ -668,8 +682,9 @@ void ff_rtp_reset_packet_queue(RTPDemuxContext *s)
 
 static void enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
 {
-    uint16_t seq   = AV_RB16(buf + 2);
-    RTPPacket **cur = &s->queue, *packet;
+    uint16_t seq       = AV_RB16(buf + 2);
+    uint32_t timestamp = AV_RB32(buf + 4);
+    RTPPacket **cur    = &s->queue, *packet;
 
     /* Find the correct place in the queue to insert the packet */
     while (*cur) {
@@ -682,18 +697,53 @@ static void enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
     packet = av_mallocz(sizeof(*packet));
     if (!packet)
         return;
-    packet->recvtime = av_gettime();
-    packet->seq      = seq;
-    packet->len      = len;
-    packet->buf      = buf;
-    packet->next     = *cur;
+    packet->recvtime  = av_gettime();
+    packet->seq       = seq;
+    packet->timestamp = timestamp;
+    packet->len       = len;
+    packet->buf       = buf;
+    packet->next      = *cur;
     *cur = packet;
     s->queue_len++;
 }
 
+/**
+ * Check whether the oldest queued packet has been held longer, in RTP time,
+ * than the jitter buffer allows.
+ */
+static int queue_overdue(RTPDemuxContext *s)
+{
+    return s->queue && s->queue_max_delay &&
+           (int32_t)(s->queue_last_ts - s->queue->timestamp) > s->queue_delay;
+}
+
 static int has_next_packet(RTPDemuxContext *s)
 {
-    return s->queue && s->queue->seq == (uint16_t) (s->seq + 1);
+    return s->queue && (s->queue->seq == (uint16_t) (s->seq + 1) ||
+                        queue_overdue(s));
+}
+
+/**
+ * Adapt the jitter buffer depth to a packet that arrived late_by RTP time
+ * units after newer ones, or to the lack of reordering if late_by is 0.
+ */
+static void update_queue_delay(RTPDemuxContext *s, int64_t late_by)
+{
+    /* never go below a few times the interarrival jitter */
+    int64_t min_delay = FFMIN(s->statistics.jitter >> 2, s->queue_max_delay);
+    int64_t delay     = s->queue_delay;
+
+    if (late_by > 0)
+        delay = FFMIN(FFMAX(delay, 2 * late_by), s->queue_max_delay);
+    else
+        delay -= (delay - min_delay) >> 12;
+    delay = FFMAX(delay, min_delay);
+
+    if (late_by > 0 && delay != s->queue_delay)
+        av_log(s->st ? s->st->codec : NULL, AV_LOG_DEBUG,
+               "RTP: jitter buffer set to %"PRId64" ms\n",
+               av_rescale_q(delay, rtp_time_base(s), (AVRational){ 1, 1000 }));
+    s->queue_delay = delay;
 }
 
 int64_t ff_rtp_queued_packet_time(RTPDemuxContext *s)
@@ -709,9 +759,12 @@ static int rtp_parse_queued_packet(RTPDemuxContext *s, AVPacket *pkt)
     if (s->queue_len <= 0)
         return -1;
 
-    if (!has_next_packet(s))
+    if (s->queue->seq != (uint16_t) (s->seq + 1)) {
+        uint16_t missed = s->queue->seq - s->seq - 1;
         av_log(s->st ? s->st->codec : NULL, AV_LOG_WARNING,
-               "RTP: missed %d packets\n", s->queue->seq - s->seq - 1);
+               "RTP: missed %d packets\n", missed);
+        s->statistics.missed += missed;
+    }
 
     /* Parse the first packet in the queue, and dequeue it */
     rv   = rtp_parse_packet_internal(s, pkt, s->queue->buf, s->queue->len);
@@ -771,26 +824,38 @@ static int rtp_parse_one_packet(RTPDemuxContext *s, AVPacket *pkt,
 
     if ((s->seq == 0 && !s->queue) || s->queue_size <= 1) {
         /* First packet, or no reordering */
+        s->queue_last_ts = AV_RB32(buf + 4);
         return rtp_parse_packet_internal(s, pkt, buf, len);
     } else {
         uint16_t seq = AV_RB16(buf + 2);
         int16_t diff = seq - s->seq;
+        timestamp = AV_RB32(buf + 4);
         if (diff < 0) {
             /* Packet older than the previously emitted one, drop */
             av_log(s->st ? s->st->codec : NULL, AV_LOG_WARNING,
                    "RTP: dropping old packet received too late\n");
+            s->statistics.late++;
+            if (s->queue_max_delay)
+                update_queue_delay(s, (int32_t)(s->queue_last_ts - timestamp));
             return -1;
         } else if (diff <= 1) {
             /* Correct packet */
+            if (s->queue_max_delay)
+                update_queue_delay(s, s->queue ?
+                                   (int32_t)(s->queue_last_ts - timestamp) : 0);
+            if (!s->queue)
+                s->queue_last_ts = timestamp;
             rv = rtp_parse_packet_internal(s, pkt, buf, len);
             return rv;
         } else {
             /* Still missing some packet, enqueue this one. */
+            if ((int32_t)(timestamp - s->queue_last_ts) > 0 || !s->queue)
+                s->queue_last_ts = timestamp;
             enqueue_packet(s, buf, len);
             *bufptr = NULL;
-            /* Return the first enqueued packet if the queue is full,
-             * even if we're missing something */
-            if (s->queue_len >= s->queue_size)
+            /* Return the first enqueued packet if the queue is full or
+             * has been held for too long, even if we're missing something */
+            if (s->queue_len >= s->queue_size || queue_overdue(s))
                 return rtp_parse_queued_packet(s, pkt);
             return -1;
         }
@@ -821,6 +886,16 @@ int ff_rtp_parse_packet(RTPDemuxContext *s, AVPacket *pkt,
 
 void ff_rtp_parse_close(RTPDemuxContext *s)
 {
+    if (s->queue_size > 1)
+        av_log(s->st ? s->st->codec : NULL, AV_LOG_VERBOSE,
+               "RTP: %u packets received, %u missed, %u received too late\n",
+               s->statistics.received, s->statistics.missed,
+               s->statistics.late);
+    if (s->queue_max_delay)
+        av_log(s->st ? s->st->codec : NULL, AV_LOG_VERBOSE,
+               "RTP: jitter buffer %"PRId64" ms\n",
+               av_rescale_q(s->queue_delay, rtp_time_base(s),
+                            (AVRational){ 1, 1000 }));
     ff_rtp_reset_packet_queue(s);
     ff_srtp_free(&s->srtp);
     av_free(s);
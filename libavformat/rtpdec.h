@@ -35,7 +35,8 @@ typedef struct RTPDynamicProtocolHandler RTPDynamicProtocolHandler;
 #define RTP_MIN_PACKET_LENGTH 12
 #define RTP_MAX_PACKET_LENGTH 8192
 
-#define RTP_REORDER_QUEUE_DEFAULT_SIZE 10
+/** Size of the reordering queue when it is bounded by duration */
+#define RTP_REORDER_QUEUE_MAX_SIZE 500
 
 #define RTP_NOTS_VALUE ((uint32_t)-1)
 
@@ -46,6 +47,14 @@ void ff_rtp_parse_set_dynamic_protocol(RTPDemuxContext *s, PayloadContext *ctx,
                                        RTPDynamicProtocolHandler *handler);
 void ff_rtp_parse_set_crypto(RTPDemuxContext *s, const char *suite,
                              const char *params);
+/**
+ * Bound the reordering queue by the time span of the queued packets instead
+ * of their number only. The span adapts to the reordering actually observed,
+ * up to max_delay.
+ *
+ * @param max_delay maximum span of the queue in AV_TIME_BASE units
+ */
+void ff_rtp_parse_set_jitter_buffer(RTPDemuxContext *s, int64_t max_delay);
 int ff_rtp_parse_packet(RTPDemuxContext *s, AVPacket *pkt,
                         uint8_t **buf, int len);
 void ff_rtp_parse_close(RTPDemuxContext *s);
@@ -87,6 +96,8 @@ typedef struct RTPStatistics {
     uint32_t received_prior;    ///< packets received in last interval
     uint32_t transit;           ///< relative transit time for previous packet
     uint32_t jitter;            ///< estimated jitter.
+    uint32_t missed;            ///< missing packets skipped by the reordering queue
+    uint32_t late;              ///< packets dropped for arriving too late
 } RTPStatistics;
 
 #define RTP_FLAG_KEY    0x1 ///< RTP packet contains a keyframe
@@ -138,6 +149,7 @@ struct RTPDynamicProtocolHandler {
 
 typedef struct RTPPacket {
     uint16_t seq;
+    uint32_t timestamp;
     uint8_t *buf;
     int len;
     int64_t recvtime;
@@ -170,6 +182,9 @@ struct RTPDemuxContext {
     RTPPacket* queue; ///< A sorted queue of buffered packets not yet returned
     int queue_len;    ///< The number of packets in queue
     int queue_size;   ///< The size of queue, or 0 if reordering is disabled
+    int64_t queue_delay;     ///< Current maximum time span of the queue, in RTP timestamp units
+    int64_t queue_max_delay; ///< Upper bound of queue_delay, or 0 if the queue is bounded by size only
+    uint32_t queue_last_ts;  ///< RTP timestamp of the latest received packet
     /*@}*/
 
     /* rtcp sender statistics receive */
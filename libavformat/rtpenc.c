@@ -25,6 +25,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/random_seed.h"
 #include "libavutil/opt.h"
+#include "libavutil/time.h"
 
 #include "rtpenc.h"
 
@@ -296,6 +297,32 @@ static void rtcp_send_sr(AVFormatContext *s1, int64_t ntp_time)
     avio_flush(s1->pb);
 }
 
+/* wait until the current packet is due, if pacing is enabled */
+static void rtp_pace(AVFormatContext *s1)
+{
+    RTPMuxContext *s = s1->priv_data;
+    AVStream *st = s1->streams[0];
+    int64_t now = av_gettime(), due;
+
+    if (s->pace_start) {
+        s->pace_elapsed += (int32_t)(s->timestamp - s->pace_timestamp);
+        due = s->pace_start + av_rescale_q(s->pace_elapsed, st->time_base,
+                                           AV_TIME_BASE_Q);
+    } else {
+        due = now;
+    }
+    s->pace_timestamp = s->timestamp;
+
+    /* restart on timestamp discontinuities or if we fell far behind */
+    if (FFABS(due - now) > 2 * AV_TIME_BASE || !s->pace_start) {
+        s->pace_start   = now;
+        s->pace_elapsed = 0;
+        return;
+    }
+    if (due > now)
+        av_usleep(due - now);
+}
+
 /* send an rtp packet. sequence number is incremented, but the caller
    must update the timestamp itself */
 void ff_rtp_send_data(AVFormatContext *s1, const uint8_t *buf1, int len, int m)
@@ -304,6 +331,9 @@ void ff_rtp_send_data(AVFormatContext *s1, const uint8_t *buf1, int len, int m)
 
     av_dlog(s1, "rtp_send_data size=%d\n", len);
 
+    if (s->flags & FF_RTP_FLAG_PACE)
+        rtp_pace(s1);
+
     /* build the RTP header */
     avio_w8(s1->pb, (RTP_VERSION << 6));
     avio_w8(s1->pb, (s->payload_type & 0x7f) | ((m & 0x01) << 7));
@@ -191,7 +191,7 @@ static av_printf_format(3, 4) void url_add_option(char *buf, int buf_size, const
 static void build_udp_url(char *buf, int buf_size,
                           const char *hostname, int port,
                           int local_port, int ttl,
-                          int max_packet_size, int connect,
+                          int max_packet_size, int connect, int batch,
                           const char *include_sources,
                           const char *exclude_sources)
 {
@@ -204,10 +204,14 @@ static void build_udp_url(char *buf, int buf_size,
         url_add_option(buf, buf_size, "pkt_size=%d", max_packet_size);
     if (connect)
         url_add_option(buf, buf_size, "connect=1");
+    if (batch > 1)
+        url_add_option(buf, buf_size, "batch=%d", batch);
     if (include_sources && include_sources[0])
         url_add_option(buf, buf_size, "sources=%s", include_sources);
     if (exclude_sources && exclude_sources[0])
         url_add_option(buf, buf_size, "block=%s", exclude_sources);
+    /* the sockets are polled and read directly in rtp_read() */
+    url_add_option(buf, buf_size, "fifo_size=0");
 }
 
 static void rtp_parse_addr_list(URLContext *h, char *buf,
@@ -261,6 +265,7 @@ static void rtp_parse_addr_list(URLContext *h, char *buf,
  *         'sources=ip[,ip]'  : list allowed source IP addresses
  *         'block=ip[,ip]'    : list disallowed source IP addresses
  *         'write_to_source=0/1' : send packets to the source address of the latest received packet
+ *         'batch=n'          : queue up to n RTP packets per send call
  * deprecated option:
  *         'localport=n'      : set the local port to n
  *
@@ -274,7 +279,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
 {
     RTPContext *s = h->priv_data;
     int rtp_port, rtcp_port,
-        ttl, connect,
+        ttl, connect, batch,
         local_rtp_port, local_rtcp_port, max_packet_size;
     char hostname[256], include_sources[1024] = "", exclude_sources[1024] = "";
     char buf[1024];
@@ -290,6 +295,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
     local_rtcp_port = -1;
     max_packet_size = -1;
     connect = 0;
+    batch = 0;
 
     p = strchr(uri, '?');
     if (p) {
@@ -314,6 +320,9 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "connect", p)) {
             connect = strtol(buf, NULL, 10);
         }
+        if (av_find_info_tag(buf, sizeof(buf), "batch", p)) {
+            batch = strtol(buf, NULL, 10);
+        }
         if (av_find_info_tag(buf, sizeof(buf), "write_to_source", p)) {
             s->write_to_source = strtol(buf, NULL, 10);
         }
@@ -329,7 +338,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
 
     build_udp_url(buf, sizeof(buf),
                   hostname, rtp_port, local_rtp_port, ttl, max_packet_size,
-                  connect, include_sources, exclude_sources);
+                  connect, batch, include_sources, exclude_sources);
     if (ffurl_open(&s->rtp_hd, buf, flags, &h->interrupt_callback, NULL) < 0)
         goto fail;
     if (local_rtp_port>=0 && local_rtcp_port<0)
@@ -337,7 +346,7 @@ static int rtp_open(URLContext *h, const char *uri, int flags)
 
     build_udp_url(buf, sizeof(buf),
                   hostname, rtcp_port, local_rtcp_port, ttl, max_packet_size,
-                  connect, include_sources, exclude_sources);
+                  connect, 0, include_sources, exclude_sources);
     if (ffurl_open(&s->rtcp_hd, buf, flags, &h->interrupt_callback, NULL) < 0)
         goto fail;
 
@@ -73,7 +73,7 @@
     { "data", "Data", 0, AV_OPT_TYPE_CONST, {.i64 = 1 << AVMEDIA_TYPE_DATA}, 0, 0, DEC, "allowed_media_types" }
 
 #define RTSP_REORDERING_OPTS() \
-    { "reorder_queue_size", "Number of packets to buffer for handling of reordered packets", OFFSET(reordering_queue_size), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, INT_MAX, DEC }
+    { "reorder_queue_size", "Number of packets to buffer for handling of reordered packets, bounded by max_delay if unset", OFFSET(reordering_queue_size), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, INT_MAX, DEC }
 
 const AVOption ff_rtsp_options[] = {
     { "initial_pause",  "Don't start playing the stream immediately", OFFSET(initial_pause), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, DEC },
@@ -710,11 +710,15 @@ int ff_rtsp_open_transport_ctx(AVFormatContext *s, RTSPStream *rtsp_st)
     RTSPState *rt = s->priv_data;
     AVStream *st = NULL;
     int reordering_queue_size = rt->reordering_queue_size;
+    int jitter_buffer = 0;
     if (reordering_queue_size < 0) {
-        if (rt->lower_transport == RTSP_LOWER_TRANSPORT_TCP || !s->max_delay)
+        if (rt->lower_transport == RTSP_LOWER_TRANSPORT_TCP || !s->max_delay) {
             reordering_queue_size = 0;
-        else
-            reordering_queue_size = RTP_REORDER_QUEUE_DEFAULT_SIZE;
+        } else {
+            /* bound the queue by duration, adapted to the reordering */
+            reordering_queue_size = RTP_REORDER_QUEUE_MAX_SIZE;
+            jitter_buffer         = 1;
+        }
     }
 
     /* open the RTP context */
@@ -755,6 +759,9 @@ int ff_rtsp_open_transport_ctx(AVFormatContext *s, RTSPStream *rtsp_st)
             ff_rtp_parse_set_crypto(rtsp_st->transport_priv,
                                     rtsp_st->crypto_suite,
                                     rtsp_st->crypto_params);
+        if (jitter_buffer)
+            ff_rtp_parse_set_jitter_buffer(rtsp_st->transport_priv,
+                                           s->max_delay);
     }
 
     return 0;
@@ -82,8 +82,9 @@ static int sap_read_header(AVFormatContext *s)
         av_strlcpy(host, "224.2.127.254", sizeof(host));
     }
 
-    ff_url_join(url, sizeof(url), "udp", NULL, host, port, "?localport=%d",
-                port);
+    /* the socket is polled directly in sap_fetch_packet() */
+    ff_url_join(url, sizeof(url), "udp", NULL, host, port,
+                "?localport=%d&fifo_size=0", port);
     ret = ffurl_open(&sap->ann_fd, url, AVIO_FLAG_READ,
                      &s->interrupt_callback, NULL);
     if (ret)
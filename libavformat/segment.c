@@ -23,6 +23,7 @@
 
 #include "avformat.h"
 #include "internal.h"
+#include "segwriter.h"
 
 #include "libavutil/log.h"
 #include "libavutil/opt.h"
@@ -43,10 +44,13 @@ typedef struct {
     int  wrap;             /**< Set by a private option. */
     int  individual_header_trailer; /**< Set by a private option. */
     int  write_header_trailer; /**< Set by a private option. */
+    int  flush_packets;    /**< Set by a private option. */
+    int  io_thread;        /**< Set by a private option. */
     int64_t offset_time;
     int64_t recording_time;
     int has_video;
     AVIOContext *pb;
+    SegWriter *writer;
 } SegmentContext;
 
 enum {
@@ -66,6 +70,8 @@ static int segment_mux_init(AVFormatContext *s)
 
     oc->oformat            = seg->oformat;
     oc->interrupt_callback = s->interrupt_callback;
+    if (seg->flush_packets)
+        oc->flags |= AVFMT_FLAG_FLUSH_PACKETS;
 
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *st;
@@ -81,31 +87,32 @@ static int segment_mux_init(AVFormatContext *s)
 static int segment_hls_window(AVFormatContext *s, int last)
 {
     SegmentContext *seg = s->priv_data;
-    int i, ret = 0;
+    AVIOContext *pb;
+    uint8_t *list;
+    int i, ret, size;
     char buf[1024];
 
-    if ((ret = avio_open2(&seg->pb, seg->list, AVIO_FLAG_WRITE,
-                              &s->interrupt_callback, NULL)) < 0)
-        goto fail;
+    if ((ret = avio_open_dyn_buf(&pb)) < 0)
+        return ret;
 
-    avio_printf(seg->pb, "#EXTM3U\n");
-    avio_printf(seg->pb, "#EXT-X-VERSION:3\n");
-    avio_printf(seg->pb, "#EXT-X-TARGETDURATION:%d\n", (int)seg->time);
-    avio_printf(seg->pb, "#EXT-X-MEDIA-SEQUENCE:%d\n",
+    avio_printf(pb, "#EXTM3U\n");
+    avio_printf(pb, "#EXT-X-VERSION:3\n");
+    avio_printf(pb, "#EXT-X-TARGETDURATION:%d\n", (int)seg->time);
+    avio_printf(pb, "#EXT-X-MEDIA-SEQUENCE:%d\n",
                 FFMAX(0, seg->number - seg->size));
 
     for (i = FFMAX(0, seg->number - seg->size);
          i < seg->number; i++) {
-        avio_printf(seg->pb, "#EXTINF:%d,\n", (int)seg->time);
+        avio_printf(pb, "#EXTINF:%d,\n", (int)seg->time);
         av_get_frame_filename(buf, sizeof(buf), s->filename, i);
-        avio_printf(seg->pb, "%s\n", buf);
+        avio_printf(pb, "%s\n", buf);
     }
 
     if (last)
-        avio_printf(seg->pb, "#EXT-X-ENDLIST\n");
-fail:
-    avio_closep(&seg->pb);
-    return ret;
+        avio_printf(pb, "#EXT-X-ENDLIST\n");
+
+    size = avio_close_dyn_buf(pb, &list);
+    return ff_segwriter_write_file(seg->writer, seg->list, list, size);
 }
 
 static int segment_start(AVFormatContext *s, int write_header)
@@ -129,8 +136,7 @@ static int segment_start(AVFormatContext *s, int write_header)
                               s->filename, c->number++) < 0)
         return AVERROR(EINVAL);
 
-    if ((err = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
-                          &s->interrupt_callback, NULL)) < 0)
+    if ((err = ff_segwriter_open(c->writer, &oc->pb, oc->filename)) < 0)
         return err;
 
     if (oc->oformat->priv_class && oc->priv_data)
@@ -144,16 +150,16 @@ static int segment_start(AVFormatContext *s, int write_header)
     return 0;
 }
 
-static int segment_end(AVFormatContext *oc, int write_trailer)
+static int segment_end(AVFormatContext *s, int write_trailer)
 {
-    int ret = 0;
+    SegmentContext *seg = s->priv_data;
+    AVFormatContext *oc = seg->avf;
 
     av_write_frame(oc, NULL); /* Flush any buffered data (fragmented mp4) */
     if (write_trailer)
         av_write_trailer(oc);
-    avio_close(oc->pb);
 
-    return ret;
+    return ff_segwriter_close(seg->writer, &oc->pb);
 }
 
 static int open_null_ctx(AVIOContext **ctx)
@@ -188,6 +194,9 @@ static int seg_write_header(AVFormatContext *s)
     if (!seg->write_header_trailer)
         seg->individual_header_trailer = 0;
 
+    if ((ret = ff_segwriter_alloc(&seg->writer, s, seg->io_thread)) < 0)
+        return ret;
+
     if (seg->list && seg->list_type != LIST_HLS)
         if ((ret = avio_open2(&seg->pb, seg->list, AVIO_FLAG_WRITE,
                               &s->interrupt_callback, NULL)) < 0)
@@ -226,8 +235,7 @@ static int seg_write_header(AVFormatContext *s)
     }
 
     if (seg->write_header_trailer) {
-        if ((ret = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
-                              &s->interrupt_callback, NULL)) < 0)
+        if ((ret = ff_segwriter_open(seg->writer, &oc->pb, oc->filename)) < 0)
             goto fail;
     } else {
         if ((ret = open_null_ctx(&oc->pb)) < 0)
@@ -235,14 +243,16 @@ static int seg_write_header(AVFormatContext *s)
     }
 
     if ((ret = avformat_write_header(oc, NULL)) < 0) {
-        avio_close(oc->pb);
+        if (!seg->write_header_trailer) {
+            close_null_ctx(oc->pb);
+            oc->pb = NULL;
+        }
         goto fail;
     }
 
     if (!seg->write_header_trailer) {
         close_null_ctx(oc->pb);
-        if ((ret = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
-                              &s->interrupt_callback, NULL)) < 0)
+        if ((ret = ff_segwriter_open(seg->writer, &oc->pb, oc->filename)) < 0)
             goto fail;
     }
 
@@ -260,8 +270,11 @@ fail:
     if (ret) {
         if (seg->list)
             avio_close(seg->pb);
-        if (seg->avf)
+        if (seg->avf) {
+            ff_segwriter_close(seg->writer, &seg->avf->pb);
             avformat_free_context(seg->avf);
+        }
+        ff_segwriter_free(&seg->writer);
     }
     return ret;
 }
@@ -284,7 +297,7 @@ static int seg_write_packet(AVFormatContext *s, AVPacket *pkt)
         av_log(s, AV_LOG_DEBUG, "Next segment starts at %d %"PRId64"\n",
                pkt->stream_index, pkt->pts);
 
-        ret = segment_end(oc, seg->individual_header_trailer);
+        ret = segment_end(s, seg->individual_header_trailer);
 
         if (!ret)
             ret = segment_start(s, seg->individual_header_trailer);
@@ -327,15 +340,15 @@ static int seg_write_trailer(struct AVFormatContext *s)
 {
     SegmentContext *seg = s->priv_data;
     AVFormatContext *oc = seg->avf;
-    int ret;
+    int ret, err;
     if (!seg->write_header_trailer) {
-        if ((ret = segment_end(oc, 0)) < 0)
+        if ((ret = segment_end(s, 0)) < 0)
             goto fail;
         open_null_ctx(&oc->pb);
         ret = av_write_trailer(oc);
         close_null_ctx(oc->pb);
     } else {
-        ret = segment_end(oc, 1);
+        ret = segment_end(s, 1);
     }
 
     if (ret < 0)
@@ -349,7 +362,8 @@ static int seg_write_trailer(struct AVFormatContext *s)
 fail:
     avio_close(seg->pb);
     avformat_free_context(oc);
-    return ret;
+    err = ff_segwriter_free(&seg->writer);
+    return ret < 0 ? ret : err;
 }
 
 #define OFFSET(x) offsetof(SegmentContext, x)
@@ -365,6 +379,8 @@ static const AVOption options[] = {
     { "segment_wrap",      "number after which the index wraps",      OFFSET(wrap),    AV_OPT_TYPE_INT,    {.i64 = 0},     0, INT_MAX, E },
     { "individual_header_trailer", "write header/trailer to each segment", OFFSET(individual_header_trailer), AV_OPT_TYPE_INT, {.i64 = 1}, 0, 1, E },
     { "write_header_trailer", "write a header to the first segment and a trailer to the last one", OFFSET(write_header_trailer), AV_OPT_TYPE_INT, {.i64 = 1}, 0, 1, E },
+    { "segment_flush_packets", "flush the segment after each packet",  OFFSET(flush_packets), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, E },
+    { "segment_io_thread", "write the files from a separate thread",    OFFSET(io_thread), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, E },
     { NULL },
 };
 
@@ -0,0 +1,416 @@
+/*
+ * Segment and playlist file writing for segmenting muxers
+ *
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+#if defined(_WIN32) && !defined(__MINGW32CE__)
+#include <windows.h>
+#endif
+
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
+#include "avformat.h"
+#include "segwriter.h"
+#include "url.h"
+
+/* Data queued for the writing thread beyond this makes the muxer wait,
+ * so that storage slower than the stream does not exhaust the memory. */
+#define MAX_QUEUED (64 << 20)
+
+#define IO_BUFFER_SIZE 32768
+
+enum JobType {
+    JOB_OPEN,
+    JOB_WRITE,
+    JOB_SEEK,
+    JOB_CLOSE,
+    JOB_FILE,
+};
+
+typedef struct Job {
+    enum JobType type;
+    char *url;
+    uint8_t *data;
+    int size;
+    int64_t pos;
+    struct Job *next;
+} Job;
+
+struct SegWriter {
+    AVFormatContext *s;
+    int threaded;
+    URLContext *out;        ///< segment file written by the thread
+    int64_t pos;            ///< segment position as seen by the muxer
+    int64_t size;           ///< segment size as seen by the muxer
+    int error;
+#if HAVE_PTHREADS
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    Job *first, *last;
+    int queued;             ///< bytes of data waiting in the queue
+    int quit;
+#endif
+};
+
+static int is_local(const char *url)
+{
+    return av_strstart(url, "file:", NULL) || !strchr(url, ':');
+}
+
+#if defined(_WIN32) && !defined(__MINGW32CE__)
+static wchar_t *utf8_to_wchar(const char *s)
+{
+    int num_chars = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS,
+                                        s, -1, NULL, 0);
+    wchar_t *w;
+
+    if (num_chars <= 0 || !(w = av_malloc_array(num_chars, sizeof(*w))))
+        return NULL;
+    MultiByteToWideChar(CP_UTF8, 0, s, -1, w, num_chars);
+    return w;
+}
+#endif
+
+/* Replace dst with src, rename() fails on Windows if dst exists. */
+static int replace_file(const char *src, const char *dst)
+{
+#if defined(_WIN32) && !defined(__MINGW32CE__)
+    wchar_t *src_w = utf8_to_wchar(src), *dst_w = utf8_to_wchar(dst);
+    BOOL ok;
+
+    /* the names may be in CP_ACP */
+    if (src_w && dst_w)
+        ok = MoveFileExW(src_w, dst_w, MOVEFILE_REPLACE_EXISTING);
+    else
+        ok = MoveFileExA(src, dst, MOVEFILE_REPLACE_EXISTING);
+    av_free(src_w);
+    av_free(dst_w);
+    return ok ? 0 : AVERROR(EIO);
+#else
+    return rename(src, dst) ? AVERROR(errno) : 0;
+#endif
+}
+
+static int write_file(SegWriter *w, const char *url,
+                      const uint8_t *buf, int size)
+{
+    char tmp[1024];
+    const char *path = url;
+    AVIOContext *pb;
+    int ret;
+
+    if (is_local(url)) {
+        av_strstart(url, "file:", &path);
+        snprintf(tmp, sizeof(tmp), "file:%s.tmp", path);
+        url = tmp;
+    }
+
+    if ((ret = avio_open2(&pb, url, AVIO_FLAG_WRITE,
+                          &w->s->interrupt_callback, NULL)) < 0)
+        return ret;
+    avio_write(pb, buf, size);
+    avio_flush(pb);
+    ret = pb->error;
+    avio_close(pb);
+
+    if (url == tmp) {
+        if (ret < 0)
+            remove(tmp + 5);
+        else
+            ret = replace_file(tmp + 5, path);
+    }
+    return ret;
+}
+
+static int run_job(SegWriter *w, Job *job)
+{
+    int ret = 0;
+
+    switch (job->type) {
+    /* the data is already buffered by the muxer side context */
+    case JOB_OPEN:
+        ret = ffurl_open(&w->out, job->url, AVIO_FLAG_WRITE,
+                         &w->s->interrupt_callback, NULL);
+        break;
+    case JOB_WRITE:
+        if (w->out)
+            ret = ffurl_write(w->out, job->data, job->size);
+        break;
+    case JOB_SEEK:
+        if (w->out)
+            ret = ffurl_seek(w->out, job->pos, SEEK_SET);
+        break;
+    case JOB_CLOSE:
+        ret = ffurl_close(w->out);
+        w->out = NULL;
+        break;
+    case JOB_FILE:
+        ret = write_file(w, job->url, job->data, job->size);
+        break;
+    }
+    return ret < 0 ? ret : 0;
+}
+
+static void free_job(Job *job)
+{
+    av_free(job->url);
+    av_free(job->data);
+    av_free(job);
+}
+
+#if HAVE_PTHREADS
+static void *writer_thread(void *arg)
+{
+    SegWriter *w = arg;
+
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        Job *job;
+        int ret;
+
+        while (!w->first && !w->quit)
+            pthread_cond_wait(&w->cond, &w->lock);
+        if (!w->first)
+            break;
+        /* keep the job queued while running it, an empty queue means
+         * that everything has been written */
+        job = w->first;
+        pthread_mutex_unlock(&w->lock);
+        ret = run_job(w, job);
+        pthread_mutex_lock(&w->lock);
+        if (ret < 0 && !w->error) {
+            av_log(w->s, AV_LOG_ERROR, "Error writing %s\n",
+                   job->url ? job->url : "segment data");
+            w->error = ret;
+        }
+        w->first   = job->next;
+        if (!w->first)
+            w->last = NULL;
+        w->queued -= job->size;
+        free_job(job);
+        pthread_cond_broadcast(&w->cond);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+#endif
+
+static int submit_job(SegWriter *w, enum JobType type, const char *url,
+                      uint8_t *data, int size, int64_t pos)
+{
+    Job *job = av_mallocz(sizeof(*job));
+    int ret;
+
+    if (!job || (url && !(job->url = av_strdup(url)))) {
+        av_free(job);
+        av_free(data);
+        return AVERROR(ENOMEM);
+    }
+    job->type = type;
+    job->data = data;
+    job->size = size;
+    job->pos  = pos;
+
+#if HAVE_PTHREADS
+    if (w->threaded) {
+        pthread_mutex_lock(&w->lock);
+        while (w->queued > MAX_QUEUED && !w->error)
+            pthread_cond_wait(&w->cond, &w->lock);
+        if ((ret = w->error) < 0) {
+            pthread_mutex_unlock(&w->lock);
+            free_job(job);
+            return ret;
+        }
+        if (w->last)
+            w->last->next = job;
+        else
+            w->first = job;
+        w->last    = job;
+        w->queued += size;
+        pthread_cond_signal(&w->cond);
+        pthread_mutex_unlock(&w->lock);
+        return 0;
+    }
+#endif
+
+    ret = run_job(w, job);
+    free_job(job);
+    return ret;
+}
+
+static int queue_write(void *opaque, uint8_t *buf, int size)
+{
+    SegWriter *w = opaque;
+    uint8_t *data = av_malloc(size);
+    int ret;
+
+    if (!data)
+        return AVERROR(ENOMEM);
+    memcpy(data, buf, size);
+    if ((ret = submit_job(w, JOB_WRITE, NULL, data, size, 0)) < 0)
+        return ret;
+    w->pos += size;
+    w->size = FFMAX(w->size, w->pos);
+    return size;
+}
+
+static int64_t queue_seek(void *opaque, int64_t offset, int whence)
+{
+    SegWriter *w = opaque;
+    int ret;
+
+    switch (whence) {
+    case AVSEEK_SIZE:
+        return w->size;
+    case SEEK_SET:
+        break;
+    case SEEK_CUR:
+        offset += w->pos;
+        break;
+    case SEEK_END:
+        offset += w->size;
+        break;
+    default:
+        return AVERROR(EINVAL);
+    }
+    if (offset < 0)
+        return AVERROR(EINVAL);
+    if ((ret = submit_job(w, JOB_SEEK, NULL, NULL, 0, offset)) < 0)
+        return ret;
+    w->pos = offset;
+    return offset;
+}
+
+int ff_segwriter_alloc(SegWriter **w, AVFormatContext *s, int threaded)
+{
+    SegWriter *sw = av_mallocz(sizeof(*sw));
+
+    if (!sw)
+        return AVERROR(ENOMEM);
+    sw->s = s;
+
+#if HAVE_PTHREADS
+    if (threaded) {
+        pthread_mutex_init(&sw->lock, NULL);
+        pthread_cond_init(&sw->cond, NULL);
+        if (pthread_create(&sw->thread, NULL, writer_thread, sw)) {
+            av_log(s, AV_LOG_WARNING,
+                   "Unable to start the writing thread, writing directly\n");
+            pthread_mutex_destroy(&sw->lock);
+            pthread_cond_destroy(&sw->cond);
+        } else {
+            sw->threaded = 1;
+        }
+    }
+#endif
+
+    *w = sw;
+    return 0;
+}
+
+int ff_segwriter_open(SegWriter *w, AVIOContext **pb, const char *url)
+{
+    uint8_t *buf;
+    int ret;
+
+    if (!w->threaded)
+        return avio_open2(pb, url, AVIO_FLAG_WRITE,
+                          &w->s->interrupt_callback, NULL);
+
+    if ((ret = submit_job(w, JOB_OPEN, url, NULL, 0, 0)) < 0)
+        return ret;
+    w->pos  = 0;
+    w->size = 0;
+
+    if (!(buf = av_malloc(IO_BUFFER_SIZE)))
+        return AVERROR(ENOMEM);
+    *pb = avio_alloc_context(buf, IO_BUFFER_SIZE, AVIO_FLAG_WRITE, w,
+                             NULL, queue_write, queue_seek);
+    if (!*pb) {
+        av_free(buf);
+        return AVERROR(ENOMEM);
+    }
+    /* the muxer must not rely on seeking where the file can't */
+    if (!is_local(url))
+        (*pb)->seekable = 0;
+    return 0;
+}
+
+int ff_segwriter_close(SegWriter *w, AVIOContext **pb)
+{
+    int ret, err;
+
+    if (!*pb)
+        return 0;
+    avio_flush(*pb);
+    ret = (*pb)->error;
+
+    if (!w->threaded) {
+        avio_closep(pb);
+        return ret;
+    }
+
+    av_free((*pb)->buffer);
+    av_freep(pb);
+    /* the segment is closed even if writing it failed */
+    err = submit_job(w, JOB_CLOSE, NULL, NULL, 0, 0);
+    return ret < 0 ? ret : err;
+}
+
+int ff_segwriter_write_file(SegWriter *w, const char *url,
+                            uint8_t *buf, int size)
+{
+    return submit_job(w, JOB_FILE, url, buf, size, 0);
+}
+
+int ff_segwriter_free(SegWriter **w)
+{
+    SegWriter *sw = *w;
+    int ret;
+
+    if (!sw)
+        return 0;
+
+#if HAVE_PTHREADS
+    if (sw->threaded) {
+        pthread_mutex_lock(&sw->lock);
+        sw->quit = 1;
+        pthread_cond_signal(&sw->cond);
+        pthread_mutex_unlock(&sw->lock);
+        pthread_join(sw->thread, NULL);
+        pthread_mutex_destroy(&sw->lock);
+        pthread_cond_destroy(&sw->cond);
+    }
+#endif
+
+    /* a segment left open after an error */
+    if (sw->out)
+        ffurl_close(sw->out);
+    ret = sw->error;
+    av_freep(w);
+    return ret;
+}
@@ -0,0 +1,71 @@
+/*
+ * Segment and playlist file writing for segmenting muxers
+ *
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_SEGWRITER_H
+#define AVFORMAT_SEGWRITER_H
+
+#include <stdint.h>
+
+#include "avformat.h"
+
+typedef struct SegWriter SegWriter;
+
+/**
+ * Allocate a writer for the files created by a segmenting muxer.
+ *
+ * @param s        the segmenting muxer, used for logging and for its
+ *                 interrupt callback
+ * @param threaded if nonzero, the files are opened, written and closed by
+ *                 a background thread, so that slow storage does not stall
+ *                 the caller; ignored if threads are not available
+ */
+int ff_segwriter_alloc(SegWriter **w, AVFormatContext *s, int threaded);
+
+/**
+ * Open a segment file for writing. Only one segment can be open at a time.
+ *
+ * @param pb set to the context the segment data is to be written to
+ */
+int ff_segwriter_open(SegWriter *w, AVIOContext **pb, const char *url);
+
+/**
+ * Flush and close a context returned by ff_segwriter_open().
+ */
+int ff_segwriter_close(SegWriter *w, AVIOContext **pb);
+
+/**
+ * Replace the content of a file, e.g. a playlist. Local files are written
+ * to a temporary file which is then renamed, so that readers never see a
+ * partially written one.
+ *
+ * @param buf the file content, allocated with av_malloc(); ownership is
+ *            taken even on failure
+ */
+int ff_segwriter_write_file(SegWriter *w, const char *url,
+                            uint8_t *buf, int size);
+
+/**
+ * Wait until all pending data is written and free the writer.
+ *
+ * @return the first error encountered while writing, 0 otherwise
+ */
+int ff_segwriter_free(SegWriter **w);
+
+#endif /* AVFORMAT_SEGWRITER_H */
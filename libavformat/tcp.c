@@ -27,6 +27,9 @@
 #if HAVE_POLL_H
 #include <poll.h>
 #endif
+#if HAVE_WRITEV
+#include <sys/uio.h>
+#endif
 
 typedef struct TCPContext {
     int fd;
@@ -158,6 +161,22 @@ static int tcp_write(URLContext *h, const uint8_t *buf, int size)
     return ret < 0 ? ff_neterrno() : ret;
 }
 
+#if HAVE_WRITEV
+static int tcp_writev(URLContext *h, const struct iovec *iov, int iovcnt)
+{
+    TCPContext *s = h->priv_data;
+    int ret;
+
+    if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
+        ret = ff_network_wait_fd(s->fd, 1);
+        if (ret < 0)
+            return ret;
+    }
+    ret = writev(s->fd, iov, iovcnt);
+    return ret < 0 ? ff_neterrno() : ret;
+}
+#endif
+
 static int tcp_shutdown(URLContext *h, int flags)
 {
     TCPContext *s = h->priv_data;
@@ -192,6 +211,9 @@ URLProtocol ff_tcp_protocol = {
     .url_open            = tcp_open,
     .url_read            = tcp_read,
     .url_write           = tcp_write,
+#if HAVE_WRITEV
+    .url_writev          = tcp_writev,
+#endif
     .url_close           = tcp_close,
     .url_get_file_handle = tcp_get_file_handle,
     .url_shutdown        = tcp_shutdown,
@@ -25,21 +25,39 @@
  */
 
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() */
 
 #include "avformat.h"
 #include "avio_internal.h"
+#include "libavutil/fifo.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mathematics.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/avstring.h"
+#include "libavutil/time.h"
 #include "internal.h"
 #include "network.h"
 #include "os_support.h"
 #include "url.h"
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 #ifndef IPV6_ADD_MEMBERSHIP
 #define IPV6_ADD_MEMBERSHIP IPV6_JOIN_GROUP
 #define IPV6_DROP_MEMBERSHIP IPV6_LEAVE_GROUP
 #endif
 
+/* number of datagrams fetched per receive call by the receiver thread */
+#define UDP_RECV_BATCH 32
+/* maximum number of datagrams queued for a single send call */
+#define UDP_MAX_SEND_BATCH 64
+/* default time a datagram may wait in the output queue, in microseconds */
+#define UDP_BATCH_DELAY 10000
+/* time given to the queued datagrams to be sent on close */
+#define UDP_CLOSE_TIMEOUT AV_TIME_BASE
+
 typedef struct {
     int udp_fd;
     int ttl;
@@ -50,6 +68,49 @@ typedef struct {
     struct sockaddr_storage dest_addr;
     int dest_addr_len;
     int is_connected;
+
+    /* circular buffer filled by a receiver thread */
+    int circular_buffer_size;
+    int overrun_nonfatal;
+#if HAVE_PTHREADS
+    AVFifoBuffer *fifo;
+    int circular_buffer_error;
+    int close_req;
+    int thread_started;
+    pthread_t circular_buffer_thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint8_t *recv_buf;          ///< UDP_RECV_BATCH datagram slots
+    int recv_len[UDP_RECV_BATCH];
+#if HAVE_RECVMMSG
+    struct mmsghdr recv_msgs[UDP_RECV_BATCH];
+    struct iovec recv_iov[UDP_RECV_BATCH];
+#endif
+    int64_t nb_dropped;         ///< datagrams dropped on buffer overrun
+    int fifo_high_water;        ///< highest buffer fullness seen, in bytes
+#endif
+
+    /* output queue, flushed with a single send call */
+    int send_batch;
+    uint8_t *send_buf;          ///< send_batch slots of max_packet_size bytes
+    int send_len[UDP_MAX_SEND_BATCH];
+    int nb_queued;
+    int64_t batch_delay;        ///< maximum time a datagram stays queued
+    int64_t queue_time;         ///< time the oldest queued datagram was queued
+#if HAVE_SENDMMSG
+    struct mmsghdr send_msgs[UDP_MAX_SEND_BATCH];
+    struct iovec send_iov[UDP_MAX_SEND_BATCH];
+#endif
+
+    /* MPEG-TS output pacing, driven by the PCRs found in the datagrams */
+    int pacing;
+    int64_t pace_wall;          ///< wallclock time matching pace_pcr
+    int64_t pace_pcr;           ///< first PCR after the last resync, unwrapped
+    int64_t last_pcr;           ///< last PCR seen, unwrapped, or -1
+    int64_t last_pcr_time;      ///< send time of the datagram with last_pcr
+    int64_t bytes_since_pcr;    ///< bytes sent since the datagram with last_pcr
+    int64_t pace_rate;          ///< bytes per second between the last two PCRs
+    int64_t pace_due;           ///< deadline of the datagram being written
 } UDPContext;
 
 #define UDP_TX_BUF_SIZE 32768
@@ -399,6 +460,263 @@ static int parse_source_list(char *buf, char **sources, int *num_sources,
     return 0;
 }
 
+#if HAVE_PTHREADS
+/* Fetch one or more datagrams into the receive slots, without blocking.
+ * Returns the number of datagrams read or a negative error code. */
+static int udp_recv_batch(UDPContext *s)
+{
+#if HAVE_RECVMMSG
+    int i, ret = recvmmsg(s->udp_fd, s->recv_msgs, UDP_RECV_BATCH,
+                          MSG_DONTWAIT, NULL);
+    if (ret < 0)
+        return ff_neterrno();
+    for (i = 0; i < ret; i++)
+        s->recv_len[i] = s->recv_msgs[i].msg_len;
+    return ret;
+#else
+    int ret = recv(s->udp_fd, s->recv_buf, UDP_MAX_PKT_SIZE, 0);
+    if (ret < 0)
+        return ff_neterrno();
+    s->recv_len[0] = ret;
+    return 1;
+#endif
+}
+
+static void *circular_buffer_task(void *arg)
+{
+    URLContext *h = arg;
+    UDPContext *s = h->priv_data;
+    uint8_t tmp[4];
+    int i, n, len, ret = 0;
+
+    pthread_mutex_lock(&s->mutex);
+    while (!s->close_req) {
+        pthread_mutex_unlock(&s->mutex);
+        ret = ff_network_wait_fd(s->udp_fd, 0);
+        if (ret >= 0) {
+            ret = n = udp_recv_batch(s);
+        }
+        pthread_mutex_lock(&s->mutex);
+        if (ret == AVERROR(EAGAIN))
+            continue;
+        if (ret < 0)
+            break;
+
+        for (i = 0; i < n; i++) {
+            len = s->recv_len[i];
+            if (av_fifo_space(s->fifo) < len + 4) {
+                if (!s->overrun_nonfatal) {
+                    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                           "Surge in UDP traffic or the reader is too slow; "
+                           "raise fifo_size or set overrun_nonfatal=1\n");
+                    ret = AVERROR(EIO);
+                    goto end;
+                }
+                s->nb_dropped++;
+                continue;
+            }
+            AV_WL32(tmp, len);
+            av_fifo_generic_write(s->fifo, tmp, 4, NULL);
+            av_fifo_generic_write(s->fifo, s->recv_buf + i * UDP_MAX_PKT_SIZE,
+                                  len, NULL);
+        }
+        s->fifo_high_water = FFMAX(s->fifo_high_water, av_fifo_size(s->fifo));
+        pthread_cond_signal(&s->cond);
+    }
+
+end:
+    s->circular_buffer_error = ret < 0 ? ret : AVERROR_EOF;
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+    return NULL;
+}
+
+static int udp_start_receiver(URLContext *h)
+{
+    UDPContext *s = h->priv_data;
+    int i, ret;
+
+    s->fifo     = av_fifo_alloc(s->circular_buffer_size);
+    s->recv_buf = av_malloc(UDP_RECV_BATCH * UDP_MAX_PKT_SIZE);
+    if (!s->fifo || !s->recv_buf)
+        goto fail;
+#if HAVE_RECVMMSG
+    for (i = 0; i < UDP_RECV_BATCH; i++) {
+        s->recv_iov[i].iov_base = s->recv_buf + i * UDP_MAX_PKT_SIZE;
+        s->recv_iov[i].iov_len  = UDP_MAX_PKT_SIZE;
+        memset(&s->recv_msgs[i], 0, sizeof(s->recv_msgs[i]));
+        s->recv_msgs[i].msg_hdr.msg_iov    = &s->recv_iov[i];
+        s->recv_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+
+    pthread_mutex_init(&s->mutex, NULL);
+    pthread_cond_init(&s->cond, NULL);
+    ret = pthread_create(&s->circular_buffer_thread, NULL,
+                         circular_buffer_task, h);
+    if (ret) {
+        av_log(h, AV_LOG_ERROR, "pthread_create failed\n");
+        pthread_cond_destroy(&s->cond);
+        pthread_mutex_destroy(&s->mutex);
+        goto fail;
+    }
+    s->thread_started = 1;
+    return 0;
+
+fail:
+    av_fifo_free(s->fifo);
+    s->fifo = NULL;
+    av_freep(&s->recv_buf);
+    return AVERROR(ENOMEM);
+}
+
+static void udp_stop_receiver(URLContext *h)
+{
+    UDPContext *s = h->priv_data;
+
+    pthread_mutex_lock(&s->mutex);
+    s->close_req = 1;
+    pthread_mutex_unlock(&s->mutex);
+    pthread_join(s->circular_buffer_thread, NULL);
+    pthread_cond_destroy(&s->cond);
+    pthread_mutex_destroy(&s->mutex);
+
+    if (s->nb_dropped)
+        av_log(h, AV_LOG_WARNING, "%"PRId64" datagrams dropped on "
+               "circular buffer overrun\n", s->nb_dropped);
+    av_log(h, AV_LOG_VERBOSE, "Circular buffer high-water mark: %d of %d bytes\n",
+           s->fifo_high_water, s->circular_buffer_size);
+
+    av_fifo_free(s->fifo);
+    s->fifo = NULL;
+    av_freep(&s->recv_buf);
+    s->thread_started = 0;
+}
+#endif
+
+/* Send all queued datagrams, in as few system calls as possible. Whatever
+ * could not be sent stays queued. */
+static int udp_flush_queue(URLContext *h)
+{
+    UDPContext *s = h->priv_data;
+    int i = 0, ret = 0;
+
+    while (i < s->nb_queued) {
+        if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
+            ret = ff_network_wait_fd(s->udp_fd, 1);
+            if (ret < 0)
+                break;
+        }
+#if HAVE_SENDMMSG
+        {
+            int j;
+            for (j = i; j < s->nb_queued; j++) {
+                struct msghdr *hdr = &s->send_msgs[j].msg_hdr;
+                s->send_iov[j].iov_base = s->send_buf + j * h->max_packet_size;
+                s->send_iov[j].iov_len  = s->send_len[j];
+                memset(hdr, 0, sizeof(*hdr));
+                hdr->msg_iov    = &s->send_iov[j];
+                hdr->msg_iovlen = 1;
+                if (!s->is_connected) {
+                    hdr->msg_name    = &s->dest_addr;
+                    hdr->msg_namelen = s->dest_addr_len;
+                }
+            }
+            ret = sendmmsg(s->udp_fd, s->send_msgs + i, s->nb_queued - i, 0);
+        }
+#else
+        if (!s->is_connected)
+            ret = sendto(s->udp_fd, s->send_buf + i * h->max_packet_size,
+                         s->send_len[i], 0,
+                         (struct sockaddr *) &s->dest_addr, s->dest_addr_len);
+        else
+            ret = send(s->udp_fd, s->send_buf + i * h->max_packet_size,
+                       s->send_len[i], 0);
+        if (ret >= 0)
+            ret = 1;
+#endif
+        if (ret < 0) {
+            ret = ff_neterrno();
+            break;
+        }
+        i  += ret;
+        ret = 0;
+    }
+
+    /* keep what could not be sent at the head of the queue */
+    if (i && i < s->nb_queued) {
+        memmove(s->send_buf, s->send_buf + i * h->max_packet_size,
+                (s->nb_queued - i) * h->max_packet_size);
+        memmove(s->send_len, s->send_len + i,
+                (s->nb_queued - i) * sizeof(*s->send_len));
+    }
+    s->nb_queued -= i;
+    return ret;
+}
+
+#define PCR_WRAP    (300LL << 33)
+#define PCR_FREQ    27000000
+/* PCR jumps larger than this restart the pacing */
+#define PACE_RESYNC (2 * AV_TIME_BASE)
+
+/* Return the first PCR in a datagram of MPEG-TS packets, or -1. */
+static int64_t udp_find_pcr(const uint8_t *buf, int size)
+{
+    int i;
+
+    if (size % 188)
+        return -1;
+    for (i = 0; i < size; i += 188) {
+        const uint8_t *p = buf + i;
+        if (p[0] != 0x47)
+            return -1;
+        /* adaptation field present, long enough and with the PCR flag */
+        if ((p[3] & 0x20) && p[4] >= 7 && (p[5] & 0x10))
+            return (((int64_t)AV_RB32(p + 6) << 1) | (p[10] >> 7)) * 300 +
+                   (AV_RB16(p + 10) & 0x1ff);
+    }
+    return -1;
+}
+
+/* Compute when a datagram of an MPEG-TS stream is due. Datagrams with a
+ * PCR are scheduled by it, the ones in between at the bitrate measured
+ * between the two previous PCRs. */
+static int64_t udp_pace_deadline(UDPContext *s, const uint8_t *buf, int size,
+                                 int64_t now)
+{
+    int64_t pcr = udp_find_pcr(buf, size), due;
+
+    if (pcr >= 0) {
+        if (s->last_pcr >= 0) {
+            int64_t delta = (pcr - s->last_pcr) % PCR_WRAP;
+            if (delta < 0)
+                delta += PCR_WRAP;
+            pcr = s->last_pcr + delta;
+        }
+        due = s->last_pcr < 0 ? now :
+              s->pace_wall + av_rescale(pcr - s->pace_pcr, AV_TIME_BASE, PCR_FREQ);
+        if (s->last_pcr < 0 || FFABS(due - now) > PACE_RESYNC) {
+            s->pace_wall = due = now;
+            s->pace_pcr  = pcr;
+            s->pace_rate = 0;
+        } else if (pcr > s->last_pcr) {
+            s->pace_rate = av_rescale(s->bytes_since_pcr, PCR_FREQ,
+                                      pcr - s->last_pcr);
+        }
+        s->last_pcr        = pcr;
+        s->last_pcr_time   = due;
+        s->bytes_since_pcr = 0;
+    } else if (s->last_pcr >= 0 && s->pace_rate > 0) {
+        due = s->last_pcr_time +
+              av_rescale(s->bytes_since_pcr, AV_TIME_BASE, s->pace_rate);
+    } else {
+        due = now;
+    }
+    s->bytes_since_pcr += size;
+
+    return due;
+}
+
 /* put it in UDP context */
 /* return non zero if error */
 static int udp_open(URLContext *h, const char *uri, int flags)
@@ -422,6 +740,8 @@ static int udp_open(URLContext *h, const char *uri, int flags)
 
     s->ttl = 16;
     s->buffer_size = is_output ? UDP_TX_BUF_SIZE : UDP_MAX_PKT_SIZE;
+    s->circular_buffer_size = 7 * 188 * 4096;
+    s->batch_delay = UDP_BATCH_DELAY;
 
     p = strchr(uri, '?');
     if (p) {
@@ -461,6 +781,21 @@ static int udp_open(URLContext *h, const char *uri, int flags)
                                   FF_ARRAY_ELEMS(exclude_sources)))
                 goto fail;
         }
+        if (av_find_info_tag(buf, sizeof(buf), "fifo_size", p)) {
+            s->circular_buffer_size = strtol(buf, NULL, 10) * 188;
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "overrun_nonfatal", p)) {
+            s->overrun_nonfatal = strtol(buf, NULL, 10);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "batch", p)) {
+            s->send_batch = strtol(buf, NULL, 10);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "batch_delay", p)) {
+            s->batch_delay = strtoll(buf, NULL, 10);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "pacing", p)) {
+            s->pacing = strtol(buf, NULL, 10);
+        }
     }
 
     /* fill the dest addr */
@@ -560,12 +895,29 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         }
     }
 
+    s->udp_fd = udp_fd;
+
+#if HAVE_PTHREADS
+    if (!is_output && s->circular_buffer_size > 0) {
+        if (udp_start_receiver(h) < 0)
+            goto fail;
+    }
+#endif
+
+    s->last_pcr   = -1;
+    s->pace_due   = AV_NOPTS_VALUE;
+    s->send_batch = av_clip(s->send_batch, 1, UDP_MAX_SEND_BATCH);
+    if (is_output && s->send_batch > 1) {
+        s->send_buf = av_malloc(s->send_batch * h->max_packet_size);
+        if (!s->send_buf)
+            goto fail;
+    }
+
     for (i = 0; i < num_include_sources; i++)
         av_freep(&include_sources[i]);
     for (i = 0; i < num_exclude_sources; i++)
         av_freep(&exclude_sources[i]);
 
-    s->udp_fd = udp_fd;
     return 0;
  fail:
     if (udp_fd >= 0)
@@ -582,6 +934,44 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
     UDPContext *s = h->priv_data;
     int ret;
 
+#if HAVE_PTHREADS
+    if (s->fifo) {
+        uint8_t tmp[4];
+        int avail;
+
+        pthread_mutex_lock(&s->mutex);
+        if (!av_fifo_size(s->fifo) && !s->circular_buffer_error &&
+            !(h->flags & AVIO_FLAG_NONBLOCK)) {
+            /* wait at most POLLING_TIME so that the caller can check
+             * the interrupt callback */
+            int64_t t = av_gettime() + POLLING_TIME * 1000;
+            struct timespec tv = { .tv_sec  =  t / 1000000,
+                                   .tv_nsec = (t % 1000000) * 1000 };
+            pthread_cond_timedwait(&s->cond, &s->mutex, &tv);
+        }
+        if (av_fifo_size(s->fifo)) {
+            av_fifo_generic_read(s->fifo, tmp, 4, NULL);
+            avail = AV_RL32(tmp);
+            if (avail > size) {
+                av_log(h, AV_LOG_WARNING, "Part of datagram lost due to "
+                       "insufficient buffer size\n");
+                av_fifo_generic_read(s->fifo, buf, size, NULL);
+                av_fifo_drain(s->fifo, avail - size);
+                avail = size;
+            } else {
+                av_fifo_generic_read(s->fifo, buf, avail, NULL);
+            }
+            ret = avail;
+        } else if (s->circular_buffer_error) {
+            ret = s->circular_buffer_error;
+        } else {
+            ret = AVERROR(EAGAIN);
+        }
+        pthread_mutex_unlock(&s->mutex);
+        return ret;
+    }
+#endif
+
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 0);
         if (ret < 0)
@@ -591,11 +981,33 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
     return ret < 0 ? ff_neterrno() : ret;
 }
 
-static int udp_write(URLContext *h, const uint8_t *buf, int size)
+static int udp_send_packet(URLContext *h, const uint8_t *buf, int size)
 {
     UDPContext *s = h->priv_data;
     int ret;
 
+    if (s->send_buf && size <= h->max_packet_size) {
+        int64_t now = av_gettime();
+        /* make room first, so that a failed flush can be retried safely */
+        if (s->nb_queued == s->send_batch && (ret = udp_flush_queue(h)) < 0)
+            return ret;
+        if (!s->nb_queued)
+            s->queue_time = now;
+        memcpy(s->send_buf + s->nb_queued * h->max_packet_size, buf, size);
+        s->send_len[s->nb_queued++] = size;
+        /* don't hold datagrams back for too long when the stream is slow;
+         * a failed flush leaves this datagram last in the queue, it is taken
+         * out again so that the caller can retry it */
+        if (now - s->queue_time >= s->batch_delay &&
+            (ret = udp_flush_queue(h)) < 0) {
+            s->nb_queued--;
+            return ret;
+        }
+        return size;
+    }
+    if (s->nb_queued && (ret = udp_flush_queue(h)) < 0)
+        return ret;
+
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 1);
         if (ret < 0)
@@ -612,10 +1024,49 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
     return ret < 0 ? ff_neterrno() : ret;
 }
 
+static int udp_write(URLContext *h, const uint8_t *buf, int size)
+{
+    UDPContext *s = h->priv_data;
+    int ret;
+
+    if (s->pacing) {
+        int64_t now = av_gettime();
+        /* a retried write keeps the deadline computed the first time */
+        if (s->pace_due == AV_NOPTS_VALUE)
+            s->pace_due = udp_pace_deadline(s, buf, size, now);
+        if (s->pace_due > now) {
+            /* send what is due before waiting */
+            if (s->nb_queued && (ret = udp_flush_queue(h)) < 0)
+                return ret;
+            av_usleep(s->pace_due - now);
+        }
+    }
+
+    ret = udp_send_packet(h, buf, size);
+    if (ret != AVERROR(EAGAIN))
+        s->pace_due = AV_NOPTS_VALUE;
+    return ret;
+}
+
 static int udp_close(URLContext *h)
 {
     UDPContext *s = h->priv_data;
 
+#if HAVE_PTHREADS
+    if (s->thread_started)
+        udp_stop_receiver(h);
+#endif
+    if (s->nb_queued) {
+        int64_t deadline = av_gettime() + UDP_CLOSE_TIMEOUT;
+        while (udp_flush_queue(h) == AVERROR(EAGAIN) &&
+               !ff_check_interrupt(&h->interrupt_callback) &&
+               av_gettime() < deadline)
+            av_usleep(1000);
+        if (s->nb_queued)
+            av_log(h, AV_LOG_WARNING, "%d queued datagrams not sent\n",
+                   s->nb_queued);
+    }
+    av_freep(&s->send_buf);
     if (s->is_multicast && (h->flags & AVIO_FLAG_READ))
         udp_leave_multicast_group(s->udp_fd, (struct sockaddr *)&s->dest_addr);
     closesocket(s->udp_fd);
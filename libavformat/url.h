@@ -36,6 +36,8 @@
 
 extern int (*url_interrupt_cb)(void);
 
+struct iovec;
+
 extern const AVClass ffurl_context_class;
 
 typedef struct URLContext {
@@ -88,6 +90,12 @@ typedef struct URLProtocol {
     const AVClass *priv_data_class;
     int flags;
     int (*url_check)(URLContext *h, int mask);
+    /**
+     * Write the iovcnt buffers in iov, like writev().
+     * Return the number of bytes written, which may be less than requested,
+     * or an AVERROR code. Only available if HAVE_WRITEV.
+     */
+    int (*url_writev)(URLContext *h, const struct iovec *iov, int iovcnt);
 } URLProtocol;
 
 /**
@@ -163,6 +171,15 @@ int ffurl_read_complete(URLContext *h, unsigned char *buf, int size);
  */
 int ffurl_write(URLContext *h, const unsigned char *buf, int size);
 
+/**
+ * Write the iovcnt buffers in iov to the resource accessed by h.
+ * The protocol must provide url_writev. Short writes are retried until
+ * everything is written; iov is updated in the process.
+ *
+ * @return 0 on success, or a negative AVERROR code in case of failure
+ */
+int ffurl_writev(URLContext *h, struct iovec *iov, int iovcnt);
+
 /**
  * Change the position that will be used by the next read/write
  * operation on the resource accessed by h.
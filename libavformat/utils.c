@@ -40,6 +40,7 @@
 #include "url.h"
 #include <stdarg.h>
 #if CONFIG_NETWORK
+#include "http.h"
 #include "network.h"
 #endif
 
@@ -3239,6 +3240,9 @@ int avformat_network_init(void)
 int avformat_network_deinit(void)
 {
 #if CONFIG_NETWORK
+#if CONFIG_HTTP_PROTOCOL || CONFIG_HTTPS_PROTOCOL
+    ff_http_close_idle_connections();
+#endif
     ff_network_close();
     ff_tls_deinit();
 #endif
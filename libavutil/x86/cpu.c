@@ -45,7 +45,7 @@
         "cpuid                       \n\t"                      \
         "xchg   %%"REG_b", %%"REG_S                             \
         : "=a" (eax), "=S" (ebx), "=c" (ecx), "=d" (edx)        \
-        : "0" (index))
+        : "0" (index), "2" (0))
 
 #define xgetbv(index, eax, edx)                                 \
     __asm__ (".byte 0x0f, 0x01, 0xd0" : "=a"(eax), "=d"(edx) : "c" (index))
@@ -138,6 +138,15 @@ int ff_get_cpu_flags_x86(void)
 #endif /* HAVE_SSE */
     }
 
+    if (max_std_level >= 7) {
+        cpuid(7, eax, ebx, ecx, edx);
+#if HAVE_AVX2
+        /* AVX2 needs the same OS support for the YMM registers as AVX. */
+        if ((rval & AV_CPU_FLAG_AVX) && (ebx & 0x00000020))
+            rval |= AV_CPU_FLAG_AVX2;
+#endif /* HAVE_AVX2 */
+    }
+
     cpuid(0x80000000, max_ext_level, ebx, ecx, edx);
 
     if (max_ext_level >= 0x80000001) {
@@ -0,0 +1,122 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Measure the demuxing throughput of a file, e.g.
+ *   demuxbench -p 1 -n 5 transponder.ts
+ * With -p, only the streams of the given program are read and all the
+ * other programs are discarded, as a player tuned to one channel would do.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+
+static int usage(const char *argv0, int ret)
+{
+    fprintf(stderr, "%s [-p program_id] [-n runs] input_file\n", argv0);
+    return ret;
+}
+
+static int select_program(AVFormatContext *ic, int program_id)
+{
+    int i, j, found = 0;
+
+    for (i = 0; i < ic->nb_streams; i++)
+        ic->streams[i]->discard = AVDISCARD_ALL;
+    for (i = 0; i < ic->nb_programs; i++) {
+        AVProgram *p = ic->programs[i];
+        if (p->id != program_id) {
+            p->discard = AVDISCARD_ALL;
+            continue;
+        }
+        for (j = 0; j < p->nb_stream_indexes; j++)
+            ic->streams[p->stream_index[j]]->discard = AVDISCARD_DEFAULT;
+        found = 1;
+    }
+    return found;
+}
+
+int main(int argc, char **argv)
+{
+    int program_id = -1, runs = 1, run, i, ret;
+    const char *filename = NULL;
+    int64_t best = INT64_MAX, size = 0, nb_packets = 0, payload = 0;
+    char errbuf[50];
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+            program_id = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if (!filename) {
+            filename = argv[i];
+        } else {
+            return usage(argv[0], 1);
+        }
+    }
+    if (!filename || runs <= 0)
+        return usage(argv[0], 1);
+
+    av_register_all();
+
+    for (run = 0; run < runs; run++) {
+        AVFormatContext *ic = NULL;
+        AVPacket pkt;
+        int64_t start;
+
+        if ((ret = avformat_open_input(&ic, filename, NULL, NULL)) < 0 ||
+            (ret = avformat_find_stream_info(ic, NULL)) < 0) {
+            av_strerror(ret, errbuf, sizeof(errbuf));
+            fprintf(stderr, "Unable to open %s: %s\n", filename, errbuf);
+            avformat_close_input(&ic);
+            return 1;
+        }
+        if (program_id >= 0 && !select_program(ic, program_id)) {
+            fprintf(stderr, "Program %d not found\n", program_id);
+            avformat_close_input(&ic);
+            return 1;
+        }
+
+        nb_packets = payload = 0;
+        start = av_gettime();
+        while ((ret = av_read_frame(ic, &pkt)) >= 0) {
+            nb_packets++;
+            payload += pkt.size;
+            av_free_packet(&pkt);
+        }
+        best = FFMIN(best, av_gettime() - start);
+        size = avio_tell(ic->pb);
+        avformat_close_input(&ic);
+        if (ret != AVERROR_EOF) {
+            av_strerror(ret, errbuf, sizeof(errbuf));
+            fprintf(stderr, "Error reading %s: %s\n", filename, errbuf);
+            return 1;
+        }
+    }
+
+    printf("%"PRId64" packets, %"PRId64" payload bytes out of %"PRId64"\n",
+           nb_packets, payload, size);
+    printf("best of %d: %.3f s, %.1f MB/s, %.1f Mbit/s\n", runs,
+           best / 1000000.0, size / (double)FFMAX(best, 1),
+           size * 8.0 / FFMAX(best, 1));
+    return 0;
+}
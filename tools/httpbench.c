@@ -0,0 +1,294 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Load an HTTP streaming server with many simultaneous clients, e.g.
+ *   httpbench -n 2000 -t 30 http://127.0.0.1:8090/test.mpg
+ * Each client requests the URL and reads the response until the end of
+ * the test, the received data is discarded.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#if HAVE_SETRLIMIT
+#include <sys/resource.h>
+#endif
+
+#include "libavutil/avstring.h"
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+
+enum ClientState {
+    CLIENT_IDLE,
+    CLIENT_CONNECTING,
+    CLIENT_RECEIVING,
+    CLIENT_DONE,
+    CLIENT_FAILED,
+};
+
+typedef struct Client {
+    enum ClientState state;
+    int fd;
+    int request_sent;
+    int64_t start_time;
+    int64_t first_byte_time;
+    int64_t end_time;
+    int64_t bytes;
+} Client;
+
+static int usage(const char *argv0, int ret)
+{
+    fprintf(stderr, "%s [-n clients] [-r connections_per_second] "
+                    "[-t seconds] url\n", argv0);
+    return ret;
+}
+
+static int cmp_int64(const void *a, const void *b)
+{
+    int64_t va = *(const int64_t *)a, vb = *(const int64_t *)b;
+    return va < vb ? -1 : va > vb;
+}
+
+static int open_client(Client *cl, const struct addrinfo *ai)
+{
+    cl->fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (cl->fd < 0)
+        return AVERROR(errno);
+    fcntl(cl->fd, F_SETFL, fcntl(cl->fd, F_GETFL) | O_NONBLOCK);
+    cl->start_time = av_gettime();
+    if (connect(cl->fd, ai->ai_addr, ai->ai_addrlen) < 0 &&
+        errno != EINPROGRESS) {
+        close(cl->fd);
+        cl->fd = -1;
+        return AVERROR(errno);
+    }
+    cl->state = CLIENT_CONNECTING;
+    return 0;
+}
+
+static void close_client(Client *cl, enum ClientState state)
+{
+    close(cl->fd);
+    cl->fd       = -1;
+    cl->state    = state;
+    cl->end_time = av_gettime();
+}
+
+int main(int argc, char **argv)
+{
+    int nb_clients = 100, rate = 1000, duration = 10, ret, i, n;
+    int nb_opened = 0, nb_active = 0, nb_failed = 0, nb_ended = 0;
+    int request_len;
+    const char *url = NULL;
+    char proto[16], host[256], path[1024], port_str[16], request[1400];
+    char buf[65536];
+    int port;
+    int64_t start_time, now, total_bytes = 0, nb_first = 0, first_sum = 0;
+    int64_t first_max = 0, *rates;
+    struct addrinfo hints = { 0 }, *ai = NULL;
+    struct pollfd *fds;
+    Client *clients;
+    int *fd_client;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            nb_clients = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            rate = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            duration = atoi(argv[++i]);
+        } else if (!url) {
+            url = argv[i];
+        } else {
+            return usage(argv[0], 1);
+        }
+    }
+    if (!url || nb_clients <= 0 || rate <= 0 || duration <= 0)
+        return usage(argv[0], 1);
+
+    av_url_split(proto, sizeof(proto), NULL, 0, host, sizeof(host), &port,
+                 path, sizeof(path), url);
+    if (strcmp(proto, "http") || !host[0]) {
+        fprintf(stderr, "Only http:// URLs are supported\n");
+        return 1;
+    }
+    if (!path[0])
+        av_strlcpy(path, "/", sizeof(path));
+    snprintf(port_str, sizeof(port_str), "%d", port < 0 ? 80 : port);
+    request_len = snprintf(request, sizeof(request),
+                           "GET %s HTTP/1.0\r\n"
+                           "Host: %s\r\n"
+                           "User-Agent: httpbench\r\n"
+                           "\r\n", path, host);
+
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if ((ret = getaddrinfo(host, port_str, &hints, &ai))) {
+        fprintf(stderr, "Unable to resolve %s: %s\n", host, gai_strerror(ret));
+        return 1;
+    }
+
+#if HAVE_SETRLIMIT
+    {
+        /* one descriptor per client, and a few for stdio */
+        struct rlimit rl;
+        if (!getrlimit(RLIMIT_NOFILE, &rl) && rl.rlim_cur < nb_clients + 16) {
+            rl.rlim_cur = FFMIN(nb_clients + 16, rl.rlim_max);
+            setrlimit(RLIMIT_NOFILE, &rl);
+        }
+    }
+#endif
+
+    clients   = av_mallocz(nb_clients * sizeof(*clients));
+    fds       = av_malloc(nb_clients * sizeof(*fds));
+    fd_client = av_malloc(nb_clients * sizeof(*fd_client));
+    rates     = av_malloc(nb_clients * sizeof(*rates));
+    if (!clients || !fds || !fd_client || !rates) {
+        ret = 1;
+        goto end;
+    }
+
+    start_time = av_gettime();
+    for (;;) {
+        now = av_gettime();
+        if (now - start_time >= duration * (int64_t)AV_TIME_BASE)
+            break;
+
+        /* ramp up the number of clients at the requested rate */
+        while (nb_opened < nb_clients &&
+               nb_opened < (now - start_time) * rate / AV_TIME_BASE + 1) {
+            Client *cl = &clients[nb_opened++];
+            if ((ret = open_client(cl, ai)) < 0) {
+                av_strerror(ret, buf, sizeof(buf));
+                if (!nb_failed)
+                    fprintf(stderr, "Unable to open a connection: %s\n", buf);
+                cl->state = CLIENT_FAILED;
+                nb_failed++;
+            } else {
+                nb_active++;
+            }
+        }
+        if (!nb_active && nb_opened == nb_clients)
+            break;
+
+        n = 0;
+        for (i = 0; i < nb_opened; i++) {
+            Client *cl = &clients[i];
+            if (cl->state != CLIENT_CONNECTING && cl->state != CLIENT_RECEIVING)
+                continue;
+            fds[n].fd      = cl->fd;
+            fds[n].events  = cl->request_sent ? POLLIN : POLLOUT;
+            fds[n].revents = 0;
+            fd_client[n++] = i;
+        }
+        ret = poll(fds, n, 10);
+        if (ret < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+
+        now = av_gettime();
+        for (i = 0; i < n && ret > 0; i++) {
+            Client *cl = &clients[fd_client[i]];
+            int len;
+
+            if (!fds[i].revents)
+                continue;
+            if (!cl->request_sent) {
+                int err = 0;
+                socklen_t optlen = sizeof(err);
+                getsockopt(cl->fd, SOL_SOCKET, SO_ERROR, &err, &optlen);
+                /* the request is small enough to be sent at once */
+                if (err || send(cl->fd, request, request_len, 0) != request_len) {
+                    close_client(cl, CLIENT_FAILED);
+                    nb_active--;
+                    nb_failed++;
+                    continue;
+                }
+                cl->request_sent = 1;
+                cl->state        = CLIENT_RECEIVING;
+                continue;
+            }
+            while ((len = recv(cl->fd, buf, sizeof(buf), 0)) > 0) {
+                if (!cl->bytes) {
+                    cl->first_byte_time = now;
+                    nb_first++;
+                    first_sum += now - cl->start_time;
+                    first_max  = FFMAX(first_max, now - cl->start_time);
+                }
+                cl->bytes   += len;
+                total_bytes += len;
+            }
+            if (len == 0 || (errno != EAGAIN && errno != EINTR)) {
+                close_client(cl, cl->bytes ? CLIENT_DONE : CLIENT_FAILED);
+                nb_active--;
+                if (cl->state == CLIENT_DONE)
+                    nb_ended++;
+                else
+                    nb_failed++;
+            }
+        }
+    }
+
+    /* receiving rate of each client that got data, in bytes per second */
+    now = av_gettime();
+    n = 0;
+    for (i = 0; i < nb_opened; i++) {
+        Client *cl = &clients[i];
+        int64_t end = cl->fd >= 0 ? now : cl->end_time;
+        if (cl->bytes)
+            rates[n++] = cl->bytes * AV_TIME_BASE /
+                         FFMAX(end - cl->first_byte_time, 1);
+        if (cl->fd >= 0)
+            close(cl->fd);
+    }
+    qsort(rates, n, sizeof(*rates), cmp_int64);
+
+    printf("%d clients: %d receiving at the end, %d ended, %d failed\n",
+           nb_opened, nb_active, nb_ended, nb_failed);
+    printf("received %"PRId64" bytes in %.3f s: %.1f Mbit/s\n", total_bytes,
+           (now - start_time) / (double)AV_TIME_BASE,
+           total_bytes * 8.0 / FFMAX(now - start_time, 1));
+    if (n)
+        printf("per client kbit/s: min %"PRId64", median %"PRId64", "
+               "max %"PRId64"\n", rates[0] * 8 / 1000,
+               rates[n / 2] * 8 / 1000, rates[n - 1] * 8 / 1000);
+    if (nb_first)
+        printf("time to first byte: average %.1f ms, max %.1f ms\n",
+               first_sum / 1000.0 / nb_first, first_max / 1000.0);
+    ret = 0;
+
+end:
+    freeaddrinfo(ai);
+    av_free(clients);
+    av_free(fds);
+    av_free(fd_client);
+    av_free(rates);
+    return ret;
+}
@@ -0,0 +1,140 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Measure the throughput of a packet based output protocol, e.g. by
+ * running a receiver and a sender over the loopback interface:
+ *   udpbench -r "udp://127.0.0.1:5000?buffer_size=16777216"
+ *   udpbench -n 200000 "udp://127.0.0.1:5000?pkt_size=1316&batch=32"
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+
+static int64_t last_activity;
+static int64_t idle_timeout;
+
+static int interrupt_cb(void *ctx)
+{
+    return last_activity &&
+           av_gettime() - last_activity > idle_timeout;
+}
+
+static int usage(const char *argv0, int ret)
+{
+    fprintf(stderr, "%s [-n packets] [-s size] output_url\n", argv0);
+    fprintf(stderr, "%s -r [-s size] [-t idle_seconds] input_url\n", argv0);
+    return ret;
+}
+
+static void report(const char *what, int64_t bytes, int size, int64_t elapsed)
+{
+    double secs = FFMAX(elapsed, 1) / (double)AV_TIME_BASE;
+
+    printf("%s %"PRId64" bytes (%"PRId64" packets of %d bytes) in %.3f s: "
+           "%.1f Mbit/s, %.0f packets/s\n", what, bytes, bytes / size, size,
+           secs, bytes * 8 / secs / 1000000, bytes / size / secs);
+}
+
+int main(int argc, char **argv)
+{
+    int receive = 0, size = 1316, ret, i;
+    int64_t packets = 100000, bytes = 0, start_time = 0, n;
+    const char *url = NULL;
+    char errbuf[50];
+    uint8_t *buf;
+    AVIOContext *pb;
+    AVIOInterruptCB int_cb = { interrupt_cb, NULL };
+
+    idle_timeout = AV_TIME_BASE;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-r")) {
+            receive = 1;
+        } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            packets = strtoll(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            size = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            idle_timeout = atof(argv[++i]) * AV_TIME_BASE;
+        } else if (!url) {
+            url = argv[i];
+        } else {
+            return usage(argv[0], 1);
+        }
+    }
+    if (!url || size <= 0 || packets <= 0)
+        return usage(argv[0], 1);
+
+    buf = av_mallocz(size);
+    if (!buf)
+        return 1;
+
+    av_register_all();
+    avformat_network_init();
+
+    ret = avio_open2(&pb, url, receive ? AVIO_FLAG_READ : AVIO_FLAG_WRITE,
+                     &int_cb, NULL);
+    if (ret) {
+        av_strerror(ret, errbuf, sizeof(errbuf));
+        fprintf(stderr, "Unable to open %s: %s\n", url, errbuf);
+        goto fail;
+    }
+
+    if (receive) {
+        /* wait for the first packet, then stop once the sender went idle */
+        while ((ret = avio_read(pb, buf, size)) > 0) {
+            last_activity = av_gettime();
+            if (!start_time)
+                start_time = last_activity;
+            bytes += ret;
+        }
+        report("received", bytes, size, last_activity - start_time);
+    } else {
+        start_time = av_gettime();
+        for (n = 0; n < packets; n++) {
+            if (size >= 4)
+                AV_WB32(buf, n);
+            avio_write(pb, buf, size);
+            avio_flush(pb);
+            if (pb->error) {
+                av_strerror(pb->error, errbuf, sizeof(errbuf));
+                fprintf(stderr, "Write error: %s\n", errbuf);
+                break;
+            }
+            bytes += size;
+        }
+        /* closing flushes any datagrams still queued by the protocol */
+        avio_close(pb);
+        pb = NULL;
+        report("sent", bytes, size, av_gettime() - start_time);
+    }
+    ret = 0;
+
+    avio_close(pb);
+fail:
+    av_free(buf);
+    avformat_network_deinit();
+    return ret ? 1 : 0;
+}